@@ -0,0 +1,254 @@
+#include <benchmark/benchmark.h>
+#include "E2Asm/core/assembler.h"
+#include "E2Asm/lexer/lexer.h"
+#include "E2Asm/parser/parser.h"
+#include "E2Asm/preprocessor/preprocessor.h"
+#include "E2Asm/semantic/semantic_analyzer.h"
+#include "E2Asm/codegen/instruction_encoder.h"
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+
+using namespace e2asm;
+
+namespace {
+
+/**
+ * Synthetic program of roughly `lines` lines: blocks of mixed register,
+ * immediate, memory and branch instructions, each under its own global
+ * label with a local loop label. Branches stay short so every block fits
+ * any relaxation outcome.
+ */
+struct Corpus {
+    std::string source;
+    size_t instructions = 0;
+};
+
+const Corpus& plainCorpus(size_t lines) {
+    static std::map<size_t, Corpus> cache;
+    auto it = cache.find(lines);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    Corpus corpus;
+    corpus.source.reserve(lines * 20);
+    for (size_t block = 0; corpus.instructions + block < lines; block++) {
+        std::string n = std::to_string(block);
+        std::string imm = std::to_string(block & 0x7FFF);
+        corpus.source += "f" + n + ":\n";
+        corpus.source += ".loop: MOV AX, " + imm + "\n";
+        corpus.source += "ADD BX, AX\n";
+        corpus.source += "MOV [BX+SI+4], AX\n";
+        corpus.source += "MOV CX, [BP+DI-2]\n";
+        corpus.source += "CMP AL, 0x7F\n";
+        corpus.source += "JNZ .loop\n";
+        corpus.source += "INC DI\n";
+        corpus.source += "PUSH AX\n";
+        corpus.source += "POP DX\n";
+        corpus.source += block == 0 ? "NOP\n" : "JMP f" + std::to_string(block - 1) + "\n";
+        corpus.instructions += 10;
+    }
+    corpus.source += "HLT\n";
+    corpus.instructions++;
+    return cache.emplace(lines, std::move(corpus)).first->second;
+}
+
+/** Include file used by preprocessorCorpus(), written once per run */
+const std::string& includeDir() {
+    static const std::string dir = [] {
+        auto path = std::filesystem::temp_directory_path() / "e2asm_bench";
+        std::filesystem::create_directories(path);
+        std::ofstream header(path / "bench_inc.asm");
+        header << "%ifndef BENCH_INC\n%define BENCH_INC\n"
+                  "%define INC_A 0x10\n%define INC_B 0x20\n%endif\n";
+        return path.string();
+    }();
+    return dir;
+}
+
+/**
+ * Same shape as plainCorpus() but routed through the preprocessor: a few
+ * hundred defines up front, constants used in every block, a guarded
+ * include and a conditional block every few blocks, and a macro call per
+ * block that expands two nested save/restore macros around its arguments.
+ */
+const Corpus& preprocessorCorpus(size_t lines) {
+    static std::map<size_t, Corpus> cache;
+    auto it = cache.find(lines);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    constexpr size_t DEFINES = 256;
+    Corpus corpus;
+    corpus.source.reserve(lines * 28);
+    for (size_t i = 0; i < DEFINES; i++) {
+        corpus.source += "%define K" + std::to_string(i) + " " + std::to_string(i * 3) + "\n";
+    }
+    corpus.source += "%macro SAVE 0\nPUSH AX\nPUSH BX\n%endmacro\n";
+    corpus.source += "%macro RESTORE 0\nPOP BX\nPOP AX\n%endmacro\n";
+    corpus.source += "%macro WITH_SAVED 2\nSAVE\nMOV %1, %2\nRESTORE\n%endmacro\n";
+    for (size_t block = 0; corpus.instructions + block < lines; block++) {
+        std::string k = "K" + std::to_string(block % DEFINES);
+        if (block % 16 == 0) {
+            corpus.source += "%include \"bench_inc.asm\"\n";
+        }
+        corpus.source += "f" + std::to_string(block) + ":\n";
+        corpus.source += "MOV AX, " + k + "\n";
+        corpus.source += "ADD AX, INC_A\n";
+        corpus.source += "%ifdef BENCH_INC\n";
+        corpus.source += "MOV [BX+" + k + "], AX\n";
+        corpus.source += "%else\n";
+        corpus.source += "NOP\n";
+        corpus.source += "%endif\n";
+        corpus.source += "SUB CX, INC_B\n";
+        corpus.source += "WITH_SAVED DX, " + k + "\n";
+        corpus.instructions += 9;
+    }
+    return cache.emplace(lines, std::move(corpus)).first->second;
+}
+
+void setThroughput(benchmark::State& state, const Corpus& corpus) {
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * corpus.source.size()));
+    state.counters["instructions"] = benchmark::Counter(
+        static_cast<double>(state.iterations() * corpus.instructions), benchmark::Counter::kIsRate);
+}
+
+std::unique_ptr<Program> parseSource(const std::string& source) {
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    return parser.parse();
+}
+
+void BM_Lexer(benchmark::State& state) {
+    const Corpus& corpus = plainCorpus(state.range(0));
+    for (auto _ : state) {
+        Lexer lexer(corpus.source);
+        auto tokens = lexer.tokenize();
+        benchmark::DoNotOptimize(tokens.data());
+    }
+    setThroughput(state, corpus);
+}
+
+void BM_Preprocessor(benchmark::State& state) {
+    const Corpus& corpus = preprocessorCorpus(state.range(0));
+    std::vector<std::string> paths{includeDir()};
+    {
+        Preprocessor check;
+        check.setIncludePaths(paths);
+        if (!check.process(corpus.source).success) {
+            state.SkipWithError("benchmark corpus failed to preprocess");
+            return;
+        }
+    }
+    for (auto _ : state) {
+        Preprocessor preprocessor;
+        preprocessor.setIncludePaths(paths);
+        auto result = preprocessor.process(corpus.source);
+        benchmark::DoNotOptimize(result.source.data());
+    }
+    setThroughput(state, corpus);
+}
+
+void BM_Parser(benchmark::State& state) {
+    const Corpus& corpus = plainCorpus(state.range(0));
+    Lexer lexer(corpus.source);
+    const std::vector<Token> tokens = lexer.tokenize();
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::vector<Token> copy = tokens;
+        state.ResumeTiming();
+        Parser parser(std::move(copy));
+        auto program = parser.parse();
+        benchmark::DoNotOptimize(program.get());
+    }
+    setThroughput(state, corpus);
+}
+
+void BM_SemanticAnalyzer(benchmark::State& state) {
+    const Corpus& corpus = plainCorpus(state.range(0));
+    auto program = parseSource(corpus.source);
+    for (auto _ : state) {
+        SemanticAnalyzer analyzer;
+        benchmark::DoNotOptimize(analyzer.analyze(program.get()));
+    }
+    setThroughput(state, corpus);
+}
+
+void BM_Encode(benchmark::State& state, const char* source) {
+    // "here:" gives branches a defined target
+    auto program = parseSource(std::string("here:\n") + source);
+    SemanticAnalyzer analyzer;
+    if (!analyzer.analyze(program.get()) || program->statements.size() != 2) {
+        state.SkipWithError("benchmark instruction failed to analyze");
+        return;
+    }
+    auto* instr = ast_cast<Instruction>(program->statements[1]);
+    InstructionEncoder encoder;
+    encoder.setSymbolTable(&analyzer.getSymbolTable());
+    encoder.setCurrentAddress(instr->assigned_address);
+
+    for (auto _ : state) {
+        auto encoded = encoder.encode(instr);
+        benchmark::DoNotOptimize(encoded.bytes.data());
+    }
+    state.counters["instructions"] = benchmark::Counter(
+        static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+}
+
+void BM_Assemble(benchmark::State& state) {
+    const Corpus& corpus = plainCorpus(state.range(0));
+    Assembler assembler;
+    if (!assembler.assemble(corpus.source).success) {
+        state.SkipWithError("benchmark corpus failed to assemble");
+        return;
+    }
+    for (auto _ : state) {
+        auto result = assembler.assemble(corpus.source);
+        benchmark::DoNotOptimize(result.binary.data());
+    }
+    setThroughput(state, corpus);
+}
+
+void BM_AssembleNoListing(benchmark::State& state) {
+    const Corpus& corpus = plainCorpus(state.range(0));
+    Assembler assembler;
+    assembler.setListingMode(ListingMode::NONE);
+    for (auto _ : state) {
+        auto result = assembler.assemble(corpus.source);
+        benchmark::DoNotOptimize(result.binary.data());
+    }
+    setThroughput(state, corpus);
+}
+
+void corpusSizes(benchmark::internal::Benchmark* bench) {
+    bench->Arg(1000)->Arg(100000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK(BM_Lexer)->Apply(corpusSizes);
+BENCHMARK(BM_Preprocessor)->Apply(corpusSizes);
+BENCHMARK(BM_Parser)->Apply(corpusSizes);
+BENCHMARK(BM_SemanticAnalyzer)->Apply(corpusSizes);
+BENCHMARK(BM_Assemble)->Apply(corpusSizes);
+BENCHMARK(BM_AssembleNoListing)->Apply(corpusSizes);
+
+BENCHMARK_CAPTURE(BM_Encode, reg_reg, "MOV AX, BX");
+BENCHMARK_CAPTURE(BM_Encode, reg_imm, "MOV CX, 0x1234");
+BENCHMARK_CAPTURE(BM_Encode, acc_imm, "ADD AL, 5");
+BENCHMARK_CAPTURE(BM_Encode, reg_mem, "MOV AX, [BX+SI+0x10]");
+BENCHMARK_CAPTURE(BM_Encode, mem_imm, "MOV WORD [BP+DI], 7");
+BENCHMARK_CAPTURE(BM_Encode, direct_mem, "MOV AL, [here]");
+BENCHMARK_CAPTURE(BM_Encode, push_reg, "PUSH DX");
+BENCHMARK_CAPTURE(BM_Encode, no_operand, "CLC");
+BENCHMARK_CAPTURE(BM_Encode, jcc_rel8, "JNZ here");
+BENCHMARK_CAPTURE(BM_Encode, jmp_rel, "JMP here");
+BENCHMARK_CAPTURE(BM_Encode, call_rel16, "CALL here");
+BENCHMARK_CAPTURE(BM_Encode, shift, "SHL AX, 1");
+BENCHMARK_CAPTURE(BM_Encode, port_io, "OUT 0x60, AL");
+BENCHMARK_CAPTURE(BM_Encode, interrupt, "INT 0x21");
+
+BENCHMARK_MAIN();
@@ -1,7 +1,7 @@
 #include "code_generator.h"
-#include <sstream>
-#include <iomanip>
-#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <thread>
 
 namespace e2asm {
 
@@ -14,11 +14,33 @@ AssemblyResult CodeGenerator::generate(const Program* program) {
     AssemblyResult result;
     m_binary.clear();
     m_listing.clear();
+    m_entries.clear();
+    m_listing_error.clear();
     m_current_address = 0;
+    m_sink_offset = 0;
     m_error_reporter.clear();
 
+    if (m_cache) {
+        m_cache->generation++;
+        m_cache->encoded = 0;
+        m_cache->reused = 0;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point phase_start = m_stats ? Clock::now() : Clock::time_point();
+
     Program* non_const_program = const_cast<Program*>(program);
-    if (!m_semantic_analyzer.analyze(non_const_program)) {
+    bool analyzed = m_semantic_analyzer.analyze(non_const_program);
+    result.passes = m_semantic_analyzer.getPassCount();
+    if (m_stats) {
+        Clock::time_point now = Clock::now();
+        m_stats->semantic_time = now - phase_start;
+        m_stats->passes = result.passes;
+        m_stats->symbols = m_semantic_analyzer.getSymbolTable().getAllSymbols().size();
+        phase_start = now;
+        reportPhase(AssemblyPhase::SEMANTIC);
+    }
+    if (!analyzed) {
         result.errors = m_semantic_analyzer.getErrors();
         result.success = false;
         return result;
@@ -26,79 +48,331 @@ AssemblyResult CodeGenerator::generate(const Program* program) {
 
     m_current_address = m_semantic_analyzer.getOriginAddress();
 
-    m_encoder.setSymbolTable(&m_semantic_analyzer.getSymbolTable());
+    // Local labels are resolved against m_scope rather than the table's own
+    // scope, so the table is only read from here on
+    m_symbols = &m_semantic_analyzer.getSymbolTable();
+    m_scope.clear();
+    m_encoder.setSymbolTable(m_symbols);
+    m_encoder.setScope(&m_scope);
 
-    for (const auto& stmt : program->statements) {
-        if (!generateStatement(stmt.get())) {
-            break;
-        }
+    const auto& statements = program->statements;
+    if (m_parallel_workers > 1 && !m_cache && !m_relocatable && statements.size() >= m_parallel_threshold) {
+        generateParallel(statements);
+    } else {
+        generateRange(statements, 0, statements.size());
+    }
+
+    if (m_cache) {
+        // Nodes that weren't generated this time may not exist anymore
+        std::erase_if(m_cache->entries, [this](const auto& item) {
+            return item.second.generation != m_cache->generation;
+        });
+    }
+
+    if (m_sink) {
+        flushToSink();
+    }
+
+    if (m_stats) {
+        m_stats->codegen_time = Clock::now() - phase_start;
+        m_stats->bytes_emitted = m_sink_offset + m_binary.size();
+        m_stats->listing_entries = m_listing.size() + m_entries.size();
+        reportPhase(AssemblyPhase::CODEGEN);
     }
 
-    result.binary = m_binary;
-    result.listing = m_listing;
+    // The generator starts over on the next run, so hand the buffers over
+    result.binary = std::move(m_binary);
+    result.listing = std::move(m_listing);
+    m_binary.clear();
+    m_listing.clear();
+    if (m_listing_mode == ListingMode::LAZY) {
+        auto lazy = std::make_shared<LazyListing>();
+        lazy->program = m_listing_owner;
+        lazy->entries = std::move(m_entries);
+        lazy->error_message = std::move(m_listing_error);
+        result.lazy_listing = std::move(lazy);
+        m_entries.clear();
+    }
     result.errors = m_error_reporter.getErrors();
     result.success = !m_error_reporter.hasErrors();
     result.origin_address = m_semantic_analyzer.getOriginAddress();
 
-    for (const auto& [key, symbol] : m_semantic_analyzer.getSymbolTable().getAllSymbols()) {
+    const SymbolTable& table = m_semantic_analyzer.getSymbolTable();
+    const auto& all_symbols = table.getAllSymbols();
+    std::vector<SymbolIndex::Entry> labels;
+    for (SymbolId id = 0; id < all_symbols.size(); id++) {
+        const Symbol& symbol = all_symbols[id];
         if (symbol.type == SymbolType::LABEL) {
             result.symbols[symbol.name] = symbol.value;
+            labels.push_back({static_cast<uint64_t>(symbol.value), 0,
+                              SymbolTable::isLocalLabel(symbol.name) ? table.qualifiedName(id) : symbol.name});
         }
     }
+    result.symbol_index = SymbolIndex(std::move(labels), m_current_address);
 
     return result;
 }
 
-bool CodeGenerator::generateStatement(const ASTNode* stmt) {
-    if (auto* label = dynamic_cast<const Label*>(stmt)) {
-        processLabel(label);
-        return true;
+AssemblyResult CodeGenerator::generateObject(const Program* program, ObjectModule& module) {
+    m_relocatable = true;
+    m_fixups.clear();
+    m_object_segments.assign(1, {".text", 0});
+    m_segment = 0;
+    m_label_segments.clear();
+    m_semantic_analyzer.setRelocatable(true);
+    m_encoder.setRelocatable(true);
+
+    AssemblyResult result = generate(program);
+    if (result.success) {
+        buildObject(program, module, result);
     }
-    else if (auto* instr = dynamic_cast<const Instruction*>(stmt)) {
-        return processInstruction(instr);
+
+    m_relocatable = false;
+    m_semantic_analyzer.setRelocatable(false);
+    m_encoder.setRelocatable(false);
+    m_fixups.clear();
+    m_label_segments.clear();
+    return result;
+}
+
+void CodeGenerator::buildObject(const Program* program, ObjectModule& module, AssemblyResult& result) const {
+    const auto& binary = result.binary;
+    for (size_t i = 0; i < m_object_segments.size(); i++) {
+        size_t begin = m_object_segments[i].offset;
+        size_t end = i + 1 < m_object_segments.size() ? m_object_segments[i + 1].offset : binary.size();
+        ObjectSegment& segment = module.segments.emplace_back();
+        segment.name = m_object_segments[i].name;
+        segment.data.assign(binary.begin() + static_cast<std::ptrdiff_t>(begin),
+                            binary.begin() + static_cast<std::ptrdiff_t>(end));
     }
-    else if (auto* data = dynamic_cast<const DataDirective*>(stmt)) {
-        return processDataDirective(data);
+
+    for (const Fixup& fixup : m_fixups) {
+        size_t own_start = m_object_segments[fixup.segment].offset;
+        Relocation relocation;
+        relocation.segment = fixup.segment;
+        relocation.offset = fixup.offset - own_start;
+        relocation.size = fixup.size;
+        relocation.relative = fixup.relative;
+        // Addends are kept relative to the segment the target lives in
+        relocation.addend = fixup.addend + (fixup.relative ? static_cast<int64_t>(own_start) : 0);
+
+        if (fixup.target->type == SymbolType::EXTERNAL) {
+            relocation.symbol = fixup.target->name;
+        } else {
+            size_t target = m_label_segments.at(fixup.target);
+            if (fixup.relative && target == fixup.segment) {
+                continue;  // Moves together with the jump, already final
+            }
+            relocation.target_segment = target;
+            relocation.addend += fixup.target->value - static_cast<int64_t>(m_object_segments[target].offset);
+        }
+        module.relocations.push_back(std::move(relocation));
     }
-    else if (auto* equ = dynamic_cast<const EQUDirective*>(stmt)) {
-        processEQUDirective(equ);
-        return true;
+    std::stable_sort(module.relocations.begin(), module.relocations.end(),
+                     [](const Relocation& a, const Relocation& b) {
+        return a.segment != b.segment ? a.segment < b.segment : a.offset < b.offset;
+    });
+
+    CaseInsensitiveEqual same_name;
+    for (const ASTNode* stmt : program->statements) {
+        auto* linkage = ast_cast<LinkageDirective>(stmt);
+        if (!linkage) {
+            continue;
+        }
+        for (const auto& name : linkage->names) {
+            if (linkage->linkage == LinkageDirective::Kind::EXTERN) {
+                module.externals.push_back(name);
+                continue;
+            }
+
+            bool listed = std::any_of(module.exports.begin(), module.exports.end(),
+                                      [&](const ExportedSymbol& e) { return same_name(e.name, name); });
+            if (listed) {
+                continue;
+            }
+            const Symbol* symbol = m_symbols->findDirect(name);
+            auto segment = symbol ? m_label_segments.find(symbol) : m_label_segments.end();
+            if (!symbol || symbol->type != SymbolType::LABEL || segment == m_label_segments.end()) {
+                result.errors.emplace_back("GLOBAL symbol '" + name + "' is not a label defined in this module",
+                                           linkage->location);
+                result.success = false;
+                continue;
+            }
+            module.exports.push_back({symbol->name, segment->second,
+                                      static_cast<size_t>(symbol->value) - m_object_segments[segment->second].offset});
+        }
     }
-    else if (auto* org = dynamic_cast<const ORGDirective*>(stmt)) {
-        processORGDirective(org);
-        return true;
+}
+
+bool CodeGenerator::generateRange(const std::vector<ASTNode*>& statements, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        if (!generateStatement(statements[i])) {
+            return false;
+        }
+        if (m_sink && m_binary.size() >= SINK_BLOCK_SIZE && !flushToSink()) {
+            return false;
+        }
     }
-    else if (auto* seg = dynamic_cast<const SEGMENTDirective*>(stmt)) {
-        processSEGMENTDirective(seg);
+    return true;
+}
+
+bool CodeGenerator::flushToSink() {
+    if (m_binary.empty()) {
         return true;
     }
-    else if (auto* ends = dynamic_cast<const ENDSDirective*>(stmt)) {
-        processENDSDirective(ends);
-        return true;
+    bool written = m_sink->write(m_binary);
+    if (!written) {
+        m_error_reporter.error("Output sink rejected " + std::to_string(m_binary.size()) +
+                                   " bytes at offset " + std::to_string(m_sink_offset),
+                               SourceLocation());
     }
-    else if (auto* res = dynamic_cast<const RESDirective*>(stmt)) {
-        return processRESDirective(res);
+    m_sink_offset += m_binary.size();
+    m_binary.clear();
+    return written;
+}
+
+void CodeGenerator::generateParallel(const std::vector<ASTNode*>& statements) {
+    size_t chunk_count = std::min(m_parallel_workers, statements.size());
+    if (chunk_count == 0) {
+        return;
     }
-    else if (auto* times = dynamic_cast<const TIMESDirective*>(stmt)) {
-        return processTIMESDirective(times);
+    size_t chunk_size = (statements.size() + chunk_count - 1) / chunk_count;
+    chunk_count = (statements.size() + chunk_size - 1) / chunk_size;
+
+    std::vector<CodeGenerator> chunks(chunk_count);
+    std::vector<char> completed(chunk_count, 0);
+    std::string scope = m_scope;
+    for (size_t c = 0; c < chunk_count; c++) {
+        CodeGenerator& chunk = chunks[c];
+        chunk.m_symbols = m_symbols;
+        chunk.m_scope = scope;
+        chunk.m_listing_mode = m_listing_mode;
+        chunk.m_current_address = 0;  // Shifted into place when joining
+        chunk.m_encoder.setSymbolTable(m_symbols);
+        chunk.m_encoder.setScope(&chunk.m_scope);
+
+        // The next chunk starts under whatever global label this one ends in
+        size_t end = std::min(statements.size(), (c + 1) * chunk_size);
+        for (size_t i = c * chunk_size; i < end; i++) {
+            if (auto* label = ast_cast<Label>(statements[i]); label && !SymbolTable::isLocalLabel(label->name)) {
+                scope = label->name;
+            }
+        }
     }
 
-    // Unknown statement type
-    return true;
+    auto run = [&](size_t c) {
+        size_t end = std::min(statements.size(), (c + 1) * chunk_size);
+        completed[c] = chunks[c].generateRange(statements, c * chunk_size, end);
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(chunk_count - 1);
+    for (size_t c = 1; c < chunk_count; c++) {
+        threads.emplace_back(run, c);
+    }
+    run(0);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t c = 0; c < chunk_count; c++) {
+        CodeGenerator& chunk = chunks[c];
+        for (auto& line : chunk.m_listing) {
+            line.address += m_current_address;
+            m_listing.push_back(std::move(line));
+        }
+        for (auto entry : chunk.m_entries) {
+            entry.address += m_current_address;
+            entry.offset += m_sink_offset + m_binary.size();
+            m_entries.push_back(entry);
+        }
+        if (!chunk.m_listing_error.empty()) {
+            m_listing_error = std::move(chunk.m_listing_error);
+        }
+        m_binary.insert(m_binary.end(), chunk.m_binary.begin(), chunk.m_binary.end());
+        m_current_address += chunk.m_current_address;
+        m_error_reporter.merge(chunk.m_error_reporter);
+        if (!completed[c]) {
+            break;
+        }
+        if (m_sink && m_binary.size() >= SINK_BLOCK_SIZE && !flushToSink()) {
+            break;
+        }
+    }
+}
+
+bool CodeGenerator::generateStatement(const ASTNode* stmt) {
+    switch (stmt->kind) {
+        case NodeKind::LABEL:
+            processLabel(static_cast<const Label*>(stmt));
+            return true;
+        case NodeKind::INSTRUCTION:
+            return processInstruction(static_cast<const Instruction*>(stmt));
+        case NodeKind::DATA:
+            return processDataDirective(static_cast<const DataDirective*>(stmt));
+        case NodeKind::EQU:
+            processEQUDirective(static_cast<const EQUDirective*>(stmt));
+            return true;
+        case NodeKind::ORG:
+            processORGDirective(static_cast<const ORGDirective*>(stmt));
+            return true;
+        case NodeKind::SEGMENT:
+            return processSEGMENTDirective(static_cast<const SEGMENTDirective*>(stmt));
+        case NodeKind::ENDS:
+            processENDSDirective(static_cast<const ENDSDirective*>(stmt));
+            return true;
+        case NodeKind::RES:
+            return processRESDirective(static_cast<const RESDirective*>(stmt));
+        case NodeKind::TIMES:
+            return processTIMESDirective(static_cast<const TIMESDirective*>(stmt));
+        default:
+            // Unknown statement type
+            return true;
+    }
+}
+
+void CodeGenerator::record(const ASTNode* stmt, uint64_t address, size_t start, const std::string* error) {
+    if (m_listing_mode == ListingMode::NONE) {
+        return;
+    }
+
+    size_t length = m_binary.size() - start;
+    uint32_t clocks = 0;
+    if (auto* instr = ast_cast<Instruction>(stmt); instr && !error) {
+        clocks = m_encoder.estimateClocks(instr, m_binary.data() + start, length);
+    }
+    if (m_listing_mode == ListingMode::LAZY) {
+        m_entries.push_back({stmt, address, m_sink_offset + start, length, 1, error == nullptr, clocks});
+        if (error) {
+            m_listing_error = *error;
+        }
+        return;
+    }
+
+    AssembledLine& line = m_listing.emplace_back();
+    line.source_line = stmt->location.line;
+    line.source_text = formatStatement(stmt);
+    line.machine_code.assign(m_binary.begin() + start, m_binary.end());
+    line.address = address;
+    line.cycles = clocks;
+    line.success = error == nullptr;
+    if (error) {
+        line.error_message = *error;
+    }
 }
 
 void CodeGenerator::processLabel(const Label* label) {
     if (!SymbolTable::isLocalLabel(label->name)) {
-        m_semantic_analyzer.getSymbolTable().setGlobalScope(label->name);
+        m_scope = label->name;
     }
 
-    AssembledLine line;
-    line.source_line = label->location.line;
-    line.source_text = label->name + ":";
-    line.address = m_current_address;
-    line.success = true;
+    if (m_relocatable) {
+        if (const Symbol* symbol = m_symbols->findFrom(label->name, m_scope)) {
+            m_label_segments[symbol] = m_segment;
+        }
+    }
 
-    m_listing.push_back(line);
+    record(label, m_current_address, m_binary.size());
 }
 
 bool CodeGenerator::processInstruction(const Instruction* instr) {
@@ -107,63 +381,130 @@ bool CodeGenerator::processInstruction(const Instruction* instr) {
     // so we must use the same address system for consistency
     m_encoder.setCurrentAddress(instr->assigned_address);
 
-    auto encoded = m_encoder.encode(instr);
-
-    AssembledLine line;
-    line.source_line = instr->location.line;
-    line.address = m_current_address;
-
-    std::ostringstream source;
-    source << instr->mnemonic;
-    for (size_t i = 0; i < instr->operands.size(); i++) {
-        if (i == 0) source << " ";
-        else source << ", ";
-
-        const auto& op = instr->operands[i];
+    // Same place, same symbol values: the bytes from last time still hold
+    std::vector<int64_t> symbol_values;
+    bool cacheable = m_cache && !m_in_times && referencedSymbolValues(instr, symbol_values);
+    EncodingCache::Entry* cached = nullptr;
+    if (cacheable) {
+        auto it = m_cache->entries.find(instr);
+        if (it != m_cache->entries.end()) {
+            cached = &it->second;
+        }
+    }
 
-        if (auto* reg = dynamic_cast<RegisterOperand*>(op.get())) {
-            source << reg->name;
+    size_t start = m_binary.size();
+    uint64_t address = m_current_address;
+    if (cached && cached->address == instr->assigned_address && cached->symbol_values == symbol_values) {
+        m_binary.insert(m_binary.end(), cached->bytes.begin(), cached->bytes.end());
+        cached->generation = m_cache->generation;
+        m_cache->reused++;
+    } else {
+        // Encoded straight into the output buffer, nothing in between
+        std::string error;
+        bool encoded = m_encoder.encodeInto(instr, m_binary, error);
+        if (m_cache) {
+            m_cache->encoded++;
         }
-        else if (auto* imm = dynamic_cast<ImmediateOperand*>(op.get())) {
-            source << "0x" << std::hex << imm->value << std::dec;
+        if (!encoded) {
+            m_error_reporter.error(error, instr->location);
+            record(instr, address, start, &error);
+            return false;
         }
-        else if (auto* mem = dynamic_cast<MemoryOperand*>(op.get())) {
-            source << "[" << mem->address_expr << "]";
+        if (cacheable) {
+            auto& entry = m_cache->entries[instr];
+            entry.address = instr->assigned_address;
+            entry.symbol_values = std::move(symbol_values);
+            entry.bytes.clear();
+            for (size_t i = start; i < m_binary.size(); i++) {
+                entry.bytes.push_back(m_binary[i]);
+            }
+            entry.generation = m_cache->generation;
         }
     }
-    line.source_text = source.str();
 
-    if (encoded.success) {
-        line.machine_code = encoded.bytes;
-        line.success = true;
+    if (m_relocatable && !recordInstructionFixups(instr, start)) {
+        return false;
+    }
 
-        m_binary.insert(m_binary.end(), encoded.bytes.begin(), encoded.bytes.end());
-        m_current_address += encoded.bytes.size();
-    } else {
-        line.success = false;
-        line.error_message = encoded.error;
+    m_current_address += m_binary.size() - start;
+    record(instr, address, start);
+    return true;
+}
 
-        m_error_reporter.error(encoded.error, instr->location);
+bool CodeGenerator::recordInstructionFixups(const Instruction* instr, size_t start) {
+    size_t length = m_binary.size() - start;
+    InstructionFields fields = m_encoder.locateFields(instr, m_binary.data() + start, length);
+    bool has_memory = std::any_of(instr->operands.begin(), instr->operands.end(),
+                                  [](const Operand* op) { return ast_cast<MemoryOperand>(op) != nullptr; });
+
+    for (const Operand* operand : instr->operands) {
+        if (auto* mem = ast_cast<MemoryOperand>(operand)) {
+            if (!mem->parsed_address || mem->is_direct_address) {
+                continue;
+            }
+            // One label (or external) plus constants is an address the linker can fix up
+            const Symbol* target = nullptr;
+            bool relocatable = true;
+            int64_t addend = mem->parsed_address->displacement;
+            for (const auto& term : mem->parsed_address->symbols) {
+                const Symbol* symbol = findSymbol(term.name, term.id);
+                if (!symbol) {
+                    continue;
+                }
+                if (symbol->type == SymbolType::CONSTANT) {
+                    addend += term.scale * symbol->value;
+                } else {
+                    relocatable = relocatable && !target && term.scale == 1;
+                    target = symbol;
+                }
+            }
+            if (!relocatable) {
+                m_error_reporter.error("Address can't be relocated: [" + mem->address_expr + "]", instr->location);
+                return false;
+            }
+            if (target && !addFixup(start + fields.displacement_offset, fields.displacement_size,
+                                    false, target, addend, instr->location)) {
+                return false;
+            }
+        } else if (auto* imm = ast_cast<ImmediateOperand>(operand)) {
+            // Expressions only take constants, the encoder already checked that
+            if (!imm->has_label || !imm->expression.empty()) {
+                continue;
+            }
+            // LEA reg, label carries the label in the displacement
+            bool in_displacement = fields.immediate_size == 0 && !has_memory;
+            if (!addFixup(start + (in_displacement ? fields.displacement_offset : fields.immediate_offset),
+                          in_displacement ? fields.displacement_size : fields.immediate_size,
+                          false, findSymbol(imm->label_name, imm->label_id), 0, instr->location)) {
+                return false;
+            }
+        } else if (auto* label = ast_cast<LabelRef>(operand)) {
+            int64_t next = static_cast<int64_t>(instr->assigned_address + length);
+            if (!addFixup(start + fields.immediate_offset, fields.immediate_size,
+                          true, findSymbol(label->label, label->label_id), -next, instr->location)) {
+                return false;
+            }
+        }
     }
+    return true;
+}
 
-    m_listing.push_back(line);
-    return encoded.success;
+bool CodeGenerator::addFixup(size_t offset, size_t size, bool relative, const Symbol* target,
+                             int64_t addend, SourceLocation location) {
+    if (!target || target->type == SymbolType::CONSTANT) {
+        return true;
+    }
+    if (size != 1 && size != 2 && size != 4) {
+        m_error_reporter.error("No room for the relocated address of '" + target->name + "'", location);
+        return false;
+    }
+    m_fixups.push_back({offset, static_cast<uint8_t>(size), relative, target, addend, m_segment});
+    return true;
 }
 
 bool CodeGenerator::processDataDirective(const DataDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.address = m_current_address;
-    line.success = true;
-
-    std::ostringstream source;
-    switch (directive->size) {
-        case DataDirective::Size::BYTE: source << "DB "; break;
-        case DataDirective::Size::WORD: source << "DW "; break;
-        case DataDirective::Size::DWORD: source << "DD "; break;
-        case DataDirective::Size::QWORD: source << "DQ "; break;
-        case DataDirective::Size::TBYTE: source << "DT "; break;
-    }
+    size_t start = m_binary.size();
+    uint64_t address = m_current_address;
 
     size_t element_size = 0;
     switch (directive->size) {
@@ -174,105 +515,82 @@ bool CodeGenerator::processDataDirective(const DataDirective* directive) {
         case DataDirective::Size::TBYTE: element_size = 10; break;
     }
 
-    for (size_t i = 0; i < directive->values.size(); i++) {
-        const auto& value = directive->values[i];
-
-        if (i > 0) source << ", ";
-
+    for (const auto& value : directive->values) {
         if (value.type == DataValue::Type::STRING) {
             // String - emit as bytes
-            source << "\"" << value.string_value << "\"";
-            for (char c : value.string_value) {
-                line.machine_code.push_back(static_cast<uint8_t>(c));
-                m_binary.push_back(static_cast<uint8_t>(c));
-            }
-            m_current_address += value.string_value.length();
+            m_binary.insert(m_binary.end(), value.string_value.begin(), value.string_value.end());
         }
         else if (value.type == DataValue::Type::CHARACTER) {
             // Character - emit as byte
-            source << "'" << value.string_value << "'";
             if (!value.string_value.empty()) {
-                line.machine_code.push_back(static_cast<uint8_t>(value.string_value[0]));
                 m_binary.push_back(static_cast<uint8_t>(value.string_value[0]));
-                m_current_address += 1;
             }
         }
         else {
             // Number - emit in little-endian
-            source << "0x" << std::hex << value.number_value << std::dec;
-
+            if (m_relocatable && value.type == DataValue::Type::SYMBOL &&
+                !addFixup(m_binary.size(), element_size, false, findSymbol(value.string_value), 0,
+                          directive->location)) {
+                return false;
+            }
             int64_t num = value.number_value;
             for (size_t j = 0; j < element_size; j++) {
-                uint8_t byte = static_cast<uint8_t>(num & 0xFF);
-                line.machine_code.push_back(byte);
-                m_binary.push_back(byte);
+                m_binary.push_back(static_cast<uint8_t>(num & 0xFF));
                 num >>= 8;
             }
-            m_current_address += element_size;
         }
     }
 
-    line.source_text = source.str();
-    m_listing.push_back(line);
+    m_current_address += m_binary.size() - start;
+    record(directive, address, start);
     return true;
 }
 
 void CodeGenerator::processEQUDirective(const EQUDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.source_text = directive->name + " EQU " + std::to_string(directive->value);
-    line.address = m_current_address;
-    line.success = true;
-
-    m_listing.push_back(line);
+    record(directive, m_current_address, m_binary.size());
 }
 
 void CodeGenerator::processORGDirective(const ORGDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.source_text = "ORG 0x" + std::to_string(directive->address);
-    line.address = m_current_address;
-    line.success = true;
-
-    m_listing.push_back(line);
+    record(directive, m_current_address, m_binary.size());
 }
 
-void CodeGenerator::processSEGMENTDirective(const SEGMENTDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.source_text = "SEGMENT " + directive->name;
-    line.address = m_current_address;
-    line.success = true;
+bool CodeGenerator::processSEGMENTDirective(const SEGMENTDirective* directive) {
+    if (m_relocatable) {
+        CaseInsensitiveEqual same_name;
+        if (!same_name(m_object_segments[m_segment].name, directive->name)) {
+            for (const auto& segment : m_object_segments) {
+                if (same_name(segment.name, directive->name)) {
+                    m_error_reporter.error("Segment '" + directive->name + "' reopened; each segment of an "
+                                           "object module must be one contiguous block",
+                                           directive->location);
+                    return false;
+                }
+            }
+
+            // The implicit .text goes away if nothing was put in it
+            if (m_object_segments.size() == 1 && m_binary.empty() && m_label_segments.empty()) {
+                m_object_segments[0].name = directive->name;
+            } else {
+                m_object_segments.push_back({directive->name, m_binary.size()});
+                m_segment = m_object_segments.size() - 1;
+            }
+        }
+
+        // The segment name doubles as a label for its start
+        if (const Symbol* symbol = m_symbols->findDirect(directive->name)) {
+            m_label_segments[symbol] = m_segment;
+        }
+    }
 
-    m_listing.push_back(line);
+    record(directive, m_current_address, m_binary.size());
+    return true;
 }
 
 void CodeGenerator::processENDSDirective(const ENDSDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.source_text = directive->name.empty() ? "ENDS" : directive->name + " ENDS";
-    line.address = m_current_address;
-    line.success = true;
-
-    m_listing.push_back(line);
+    record(directive, m_current_address, m_binary.size());
 }
 
 bool CodeGenerator::processRESDirective(const RESDirective* directive) {
-    AssembledLine line;
-    line.source_line = directive->location.line;
-    line.address = m_current_address;
-    line.success = true;
-
-    std::string res_name;
-    switch (directive->size) {
-        case RESDirective::Size::BYTE: res_name = "RESB"; break;
-        case RESDirective::Size::WORD: res_name = "RESW"; break;
-        case RESDirective::Size::DWORD: res_name = "RESD"; break;
-        case RESDirective::Size::QWORD: res_name = "RESQ"; break;
-        case RESDirective::Size::TBYTE: res_name = "REST"; break;
-    }
-    line.source_text = res_name + " " + std::to_string(directive->count);
-
     size_t element_size = 0;
     switch (directive->size) {
         case RESDirective::Size::BYTE: element_size = 1; break;
@@ -283,21 +601,124 @@ bool CodeGenerator::processRESDirective(const RESDirective* directive) {
     }
 
     size_t total_size = element_size * directive->count;
+    size_t start = m_binary.size();
+    uint64_t address = m_current_address;
 
-    for (size_t i = 0; i < total_size; i++) {
-        line.machine_code.push_back(0x00);
-        m_binary.push_back(0x00);
-    }
+    // One zero byte in the listing stands for the whole block
+    m_binary.push_back(0x00);
+    record(directive, address, start);
+    markRepeated(directive, total_size);
+    m_binary.resize(start + total_size, 0x00);
 
     m_current_address += total_size;
-    m_listing.push_back(line);
     return true;
 }
 
 bool CodeGenerator::processTIMESDirective(const TIMESDirective* directive) {
-    for (int64_t i = 0; i < directive->count; i++) {
-        if (!generateStatement(directive->repeated_node.get())) {
-            return false;
+    if (directive->count <= 0) {
+        return true;
+    }
+
+    // Every copy is encoded at the same assigned address, so the bytes are
+    // identical: generate the statement once and replicate its output
+    size_t binary_start = m_binary.size();
+    size_t fixups_start = m_fixups.size();
+    m_in_times = true;
+    bool ok = generateStatement(directive->repeated_node);
+    m_in_times = false;
+    if (!ok) {
+        return false;
+    }
+
+    size_t copies = static_cast<size_t>(directive->count);
+    size_t single_size = m_binary.size() - binary_start;
+    m_binary.resize(binary_start + single_size * copies);
+    for (size_t filled = single_size; filled < single_size * copies;) {
+        // Double the filled prefix each round, the last round tops it up
+        size_t chunk = std::min(filled, single_size * copies - filled);
+        std::copy_n(m_binary.begin() + binary_start, chunk, m_binary.begin() + binary_start + filled);
+        filled += chunk;
+    }
+    m_current_address += single_size * (copies - 1);
+
+    // ...and each copy needs its own relocations
+    size_t fixups_end = m_fixups.size();
+    for (size_t copy = 1; copy < copies && fixups_end > fixups_start; copy++) {
+        for (size_t i = fixups_start; i < fixups_end; i++) {
+            Fixup fixup = m_fixups[i];
+            fixup.offset += single_size * copy;
+            if (fixup.relative) {
+                fixup.addend -= static_cast<int64_t>(single_size * copy);
+            }
+            m_fixups.push_back(fixup);
+        }
+    }
+
+    markRepeated(directive, copies);
+    return true;
+}
+
+void CodeGenerator::markRepeated(const ASTNode* stmt, size_t copies) {
+    if (m_listing_mode == ListingMode::LAZY && !m_entries.empty()) {
+        m_entries.back().statement = stmt;
+        m_entries.back().repeat = copies;
+    } else if (m_listing_mode == ListingMode::FULL && !m_listing.empty()) {
+        m_listing.back().source_text = formatStatement(stmt);
+        m_listing.back().repeat = copies;
+    }
+}
+
+const Symbol* CodeGenerator::findSymbol(std::string_view name, std::optional<SymbolId> id) const {
+    // Bound by the semantic analyzer against this same table
+    if (id && *id < m_symbols->getAllSymbols().size()) {
+        return &m_symbols->get(*id);
+    }
+
+    const Symbol* symbol = m_symbols->findFrom(name, m_scope);
+    if (!symbol && SymbolTable::isLocalLabel(name)) {
+        symbol = m_symbols->findDirect(name);
+    }
+    return symbol;
+}
+
+std::optional<int64_t> CodeGenerator::symbolValue(const std::string& name, std::optional<SymbolId> id) const {
+    // Only plain names (a bound id always is one); anything else is an
+    // expression the encoder evaluates itself
+    bool plain = id || (!name.empty() && std::all_of(name.begin(), name.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.';
+    }));
+    if (!plain) {
+        return std::nullopt;
+    }
+
+    const Symbol* symbol = findSymbol(name, id);
+    if (!symbol || !symbol->is_resolved) {
+        return std::nullopt;
+    }
+    return symbol->value;
+}
+
+bool CodeGenerator::referencedSymbolValues(const Instruction* instr, std::vector<int64_t>& values) const {
+    auto add = [&](const std::string& name, std::optional<SymbolId> id) {
+        auto value = symbolValue(name, id);
+        if (value) {
+            values.push_back(*value);
+        }
+        return value.has_value();
+    };
+
+    for (const Operand* operand : instr->operands) {
+        if (auto* label = ast_cast<LabelRef>(operand)) {
+            if (!add(label->label, label->label_id)) return false;
+        } else if (auto* imm = ast_cast<ImmediateOperand>(operand)) {
+            if (imm->has_label && !add(imm->label_name, imm->label_id)) return false;
+        } else if (auto* mem = ast_cast<MemoryOperand>(operand)) {
+            // Folded constants count too, so look at the address as written
+            const auto& addr = mem->written_address ? mem->written_address : mem->parsed_address;
+            if (!addr) continue;
+            for (const auto& term : addr->symbols) {
+                if (!add(term.name, term.id)) return false;
+            }
         }
     }
     return true;
@@ -11,14 +11,44 @@
 
 #include <vector>
 #include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
 #include "../parser/ast.h"
 #include "../core/assembler.h"
 #include "../core/error.h"
+#include "../core/object_module.h"
 #include "../semantic/semantic_analyzer.h"
 #include "instruction_encoder.h"
+#include "listing.h"
 
 namespace e2asm {
 
+/**
+ * @brief Instruction encodings kept between generate() runs over the same tree
+ *
+ * Keyed by instruction node. An entry is reused when the instruction was
+ * placed at the same address and every symbol it refers to still has the
+ * value it had when the bytes were produced. Entries of nodes that didn't
+ * show up in the latest run are dropped at its end.
+ */
+struct EncodingCache {
+    struct Entry {
+        uint64_t address = 0;               ///< assigned_address the bytes were encoded at
+        std::vector<int64_t> symbol_values; ///< Referenced symbol values at that time
+        InstructionBytes bytes;             ///< Encoded instruction
+        uint64_t generation = 0;            ///< Last run that used this entry
+    };
+
+    std::unordered_map<const Instruction*, Entry> entries;  ///< Per-instruction encodings
+    uint64_t generation = 0;  ///< Number of runs so far
+    size_t encoded = 0;       ///< Instructions the last run had to encode
+    size_t reused = 0;        ///< Instructions the last run took from the cache
+
+    /** @brief Forgets every entry (required once the nodes are freed) */
+    void clear() { entries.clear(); }
+};
+
 /**
  * @brief Converts analyzed AST into 8086 machine code
  *
@@ -53,6 +83,82 @@ public:
      */
     AssemblyResult generate(const Program* program);
 
+    /**
+     * @brief Generates a relocatable object module from an AST
+     * @param program Parsed AST
+     * @param module Receives the segments, exports, externals and relocations
+     * @return Result of the run: errors and listing, with the segments back to back in binary
+     *
+     * The program is laid out from address 0 without ORG. Every field that
+     * holds the address of a label, or the value of an EXTERN symbol, becomes
+     * a Relocation; jumps within one segment are already final. Each segment
+     * has to be one contiguous block of the source.
+     */
+    AssemblyResult generateObject(const Program* program, ObjectModule& module);
+
+    /**
+     * @brief Reuses instruction encodings from earlier runs
+     * @param cache Cache to consult and update, or nullptr to always encode
+     *
+     * Only worthwhile when the same nodes are generated again, e.g. by an
+     * AssemblySession after an edit elsewhere in the file.
+     */
+    void setEncodingCache(EncodingCache* cache) { m_cache = cache; }
+
+    /**
+     * @brief Sets the load address used before any ORG directive
+     * @param origin Base address (see Assembler::setOrigin)
+     */
+    void setOrigin(uint64_t origin) { m_semantic_analyzer.setBaseOrigin(origin); }
+
+    /**
+     * @brief Encodes large programs on several threads
+     * @param workers Threads to split the statements over; 1 or less keeps one thread
+     * @param min_statements Programs with fewer statements are always encoded on one thread
+     *
+     * Once analysis has fixed every address, statements are cut into one
+     * contiguous chunk per worker, each chunk is encoded into its own buffer
+     * and the buffers are joined in order. The output is identical to the
+     * single-threaded one. Not used together with an encoding cache.
+     */
+    void setParallelEncoding(size_t workers, size_t min_statements) {
+        m_parallel_workers = workers;
+        m_parallel_threshold = min_statements;
+    }
+
+    /**
+     * @brief Streams the binary into a sink instead of AssemblyResult::binary
+     * @param sink Destination, or nullptr to collect the binary in the result
+     *
+     * Bytes are buffered per statement and handed over in blocks of about
+     * SINK_BLOCK_SIZE bytes; the rest goes out when generation ends.
+     */
+    void setOutputSink(OutputSink* sink) { m_sink = sink; }
+
+    static constexpr size_t SINK_BLOCK_SIZE = 64 * 1024;  ///< Flush threshold for the output sink
+
+    /**
+     * @brief Chooses how the listing is produced
+     * @param mode FULL builds AssembledLine entries, LAZY records entries only, NONE skips it
+     * @param owner For LAZY: keeps the program alive so the listing can be rendered later
+     *
+     * The program passed to generate() must be the one owned by @p owner.
+     */
+    /**
+     * @brief Records analysis and encoding statistics
+     * @param stats Struct to fill (timings, symbol count, passes, bytes), or nullptr
+     * @param callback Called after SEMANTIC and CODEGEN, or nullptr
+     */
+    void setStats(AssemblyStats* stats, const PhaseCallback* callback) {
+        m_stats = stats;
+        m_phase_callback = callback;
+    }
+
+    void setListingMode(ListingMode mode, std::shared_ptr<const Program> owner = {}) {
+        m_listing_mode = mode;
+        m_listing_owner = std::move(owner);
+    }
+
 private:
     /**
      * @brief Processes a single AST node and emits code
@@ -63,6 +169,28 @@ private:
      */
     bool generateStatement(const ASTNode* stmt);
 
+    /**
+     * @brief Generates statements [begin, end) in order
+     * @return false if a statement failed (generation stops there)
+     */
+    bool generateRange(const std::vector<ASTNode*>& statements, size_t begin, size_t end);
+
+    /**
+     * @brief Hands the buffered binary to the output sink
+     * @return false (with an error reported) if the sink rejected it
+     */
+    bool flushToSink();
+
+    /**
+     * @brief Generates all statements split over m_parallel_workers threads
+     *
+     * Each chunk is generated by a helper CodeGenerator sharing the symbol
+     * table, starting in the scope of the last global label before it.
+     * Listing addresses are shifted into place when the chunks are joined;
+     * chunks after the first failing one are dropped, as sequentially.
+     */
+    void generateParallel(const std::vector<ASTNode*>& statements);
+
     /**
      * @brief Records a label in the listing
      * @param label Label node to process
@@ -109,10 +237,11 @@ private:
     /**
      * @brief Enters a segment
      * @param directive SEGMENT directive to process
+     * @return false if an object module's segment was reopened
      *
      * Starts a new logical section in the output.
      */
-    void processSEGMENTDirective(const SEGMENTDirective* directive);
+    bool processSEGMENTDirective(const SEGMENTDirective* directive);
 
     /**
      * @brief Exits a segment
@@ -140,12 +269,100 @@ private:
      */
     bool processTIMESDirective(const TIMESDirective* directive);
 
+    /**
+     * @brief Adds the listing line for a statement whose bytes start at m_binary[start]
+     * @param stmt Statement to list
+     * @param address Address of the statement
+     * @param start Index in m_binary of its first byte (everything after it belongs to it)
+     * @param error Encoding error, or nullptr on success
+     */
+    void record(const ASTNode* stmt, uint64_t address, size_t start, const std::string* error = nullptr);
+
+    /** @brief Tells the phase callback (if any) that phase has finished */
+    void reportPhase(AssemblyPhase phase) const {
+        if (m_phase_callback && *m_phase_callback) {
+            (*m_phase_callback)(phase, *m_stats);
+        }
+    }
+
+    /** @brief Turns the last listing line into one for stmt covering copies repetitions */
+    void markRepeated(const ASTNode* stmt, size_t copies);
+
+    /**
+     * @brief Collects the values of every symbol an instruction refers to
+     * @param instr Instruction to inspect
+     * @param values Receives the values in operand order
+     * @return false if some reference isn't a plain defined symbol (not cacheable)
+     */
+    bool referencedSymbolValues(const Instruction* instr, std::vector<int64_t>& values) const;
+
+    /** @brief Symbol value the encoder would see for name (or its bound id), with its scoping fallback */
+    std::optional<int64_t> symbolValue(const std::string& name, std::optional<SymbolId> id = std::nullopt) const;
+
+    /** @brief Symbol the encoder would see for name (or its bound id), with its scoping fallback */
+    const Symbol* findSymbol(std::string_view name, std::optional<SymbolId> id = std::nullopt) const;
+
+    /**
+     * @brief A field of the output whose value depends on where the linker puts things
+     */
+    struct Fixup {
+        size_t offset;         ///< Position of the field in m_binary
+        uint8_t size;          ///< Field width in bytes
+        bool relative;         ///< Jump displacement rather than an address
+        const Symbol* target;  ///< Label or external the field refers to
+        int64_t addend;        ///< Constant part; for a jump, minus the address after the instruction
+        size_t segment;        ///< Index in m_object_segments of the segment holding the field
+    };
+
+    /** @brief Start of a segment of the object module in m_binary */
+    struct SegmentStart {
+        std::string name;
+        size_t offset;
+    };
+
+    /**
+     * @brief Records the fixups of an instruction just encoded at m_binary[start]
+     * @return false (with an error reported) if a reference can't be relocated
+     */
+    bool recordInstructionFixups(const Instruction* instr, size_t start);
+
+    /**
+     * @brief Records a fixup if target is a label or external
+     * @return false (with an error reported) if the field can't hold it
+     */
+    bool addFixup(size_t offset, size_t size, bool relative, const Symbol* target, int64_t addend,
+                  SourceLocation location);
+
+    /** @brief Copies segments, exports, externals and relocations into module */
+    void buildObject(const Program* program, ObjectModule& module, AssemblyResult& result) const;
+
     SemanticAnalyzer m_semantic_analyzer;  ///< Resolves symbols before code generation
+    const SymbolTable* m_symbols = nullptr; ///< Table to encode against (shared by chunk helpers)
+    std::string m_scope;                   ///< Last global label seen, scope for local labels
     InstructionEncoder m_encoder;          ///< Handles 8086 instruction encoding
     std::vector<uint8_t> m_binary;         ///< Accumulated machine code output
-    std::vector<AssembledLine> m_listing;  ///< Source-to-binary mapping
+    std::vector<AssembledLine> m_listing;  ///< Source-to-binary mapping (ListingMode::FULL)
+    std::vector<ListingEntry> m_entries;   ///< Deferred listing (ListingMode::LAZY)
+    std::string m_listing_error;           ///< Error of the failed entry in m_entries
+    ListingMode m_listing_mode = ListingMode::FULL;   ///< See setListingMode
+    std::shared_ptr<const Program> m_listing_owner;   ///< Program a lazy listing keeps alive
+    AssemblyStats* m_stats = nullptr;                 ///< See setStats
+    const PhaseCallback* m_phase_callback = nullptr;  ///< See setStats
     ErrorReporter m_error_reporter;        ///< Collects code generation errors
     size_t m_current_address;              ///< Current position in output
+    EncodingCache* m_cache = nullptr;      ///< Encodings from earlier runs (see setEncodingCache)
+    OutputSink* m_sink = nullptr;          ///< Where m_binary is flushed to (see setOutputSink)
+    size_t m_sink_offset = 0;              ///< Bytes already handed to m_sink
+    bool m_in_times = false;               ///< Emitting a TIMES body (one node, many copies)
+    size_t m_parallel_workers = 1;         ///< See setParallelEncoding
+    size_t m_parallel_threshold = 0;       ///< See setParallelEncoding
+
+    // Object module output (generateObject)
+    bool m_relocatable = false;                    ///< Recording fixups and segments
+    std::vector<Fixup> m_fixups;                   ///< Fields to relocate, in output order
+    std::vector<SegmentStart> m_object_segments;   ///< Segments in order of appearance
+    size_t m_segment = 0;                          ///< Segment being generated
+    std::unordered_map<const Symbol*, size_t> m_label_segments; ///< Segment each label is defined in
 };
 
 } // namespace e2asm
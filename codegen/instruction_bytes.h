@@ -0,0 +1,99 @@
+/**
+ * @file instruction_bytes.h
+ * @brief Fixed-capacity byte buffer for one encoded instruction
+ *
+ * An 8086 instruction is at most a handful of bytes (prefix, opcode, ModR/M,
+ * 16-bit displacement, 16-bit immediate), so the encoder keeps them inline
+ * instead of in a heap-allocated vector. Encoding a statement then allocates
+ * nothing on the common path.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+
+namespace e2asm {
+
+/**
+ * @brief Up to CAPACITY bytes stored inline with a length byte
+ *
+ * Supports the small part of the vector interface the encoder uses. Pushing
+ * past CAPACITY drops the byte and marks the buffer as overflowed, which the
+ * encoder reports as an error instead of writing out of bounds.
+ */
+class InstructionBytes {
+public:
+    /** @brief Longest instruction the buffer holds (the x86 limit) */
+    static constexpr size_t CAPACITY = 15;
+
+    InstructionBytes() = default;
+
+    InstructionBytes(std::initializer_list<uint8_t> bytes) {
+        for (uint8_t byte : bytes) {
+            push_back(byte);
+        }
+    }
+
+    void push_back(uint8_t byte) {
+        if (m_size == CAPACITY) {
+            m_overflow = true;
+            return;
+        }
+        m_bytes[m_size++] = byte;
+    }
+
+    /** @brief Appends another buffer's bytes */
+    void append(const InstructionBytes& other) {
+        for (uint8_t byte : other) {
+            push_back(byte);
+        }
+    }
+
+    /** @brief Appends `size_bytes` bytes of `value`, little-endian */
+    void appendLittleEndian(int64_t value, size_t size_bytes) {
+        for (size_t i = 0; i < size_bytes; i++) {
+            push_back(static_cast<uint8_t>(value & 0xFF));
+            value >>= 8;
+        }
+    }
+
+    void clear() {
+        m_size = 0;
+        m_overflow = false;
+    }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    /** @brief True if a byte was dropped because the buffer was full */
+    bool overflowed() const { return m_overflow; }
+
+    uint8_t& operator[](size_t i) { return m_bytes[i]; }
+    uint8_t operator[](size_t i) const { return m_bytes[i]; }
+
+    const uint8_t* data() const { return m_bytes.data(); }
+    const uint8_t* begin() const { return m_bytes.data(); }
+    const uint8_t* end() const { return m_bytes.data() + m_size; }
+
+    bool operator==(const InstructionBytes& other) const {
+        if (m_size != other.m_size) {
+            return false;
+        }
+        for (size_t i = 0; i < m_size; i++) {
+            if (m_bytes[i] != other.m_bytes[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    std::array<uint8_t, CAPACITY> m_bytes{};
+    uint8_t m_size = 0;
+    bool m_overflow = false;
+};
+
+} // namespace e2asm
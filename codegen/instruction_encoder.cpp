@@ -1,22 +1,225 @@
 #include "instruction_encoder.h"
 #include "modrm_generator.h"
-#include "../parser/expression_parser.h"
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <iterator>
 
 namespace e2asm {
 
-// Helper: Case-insensitive string compare
-static bool iequals(const std::string& a, const std::string& b) {
-    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
-        [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+namespace {
+
+// Static specificity of an encoding row (higher = more specific).
+// Specific registers (AL/AX/CL/DX) = 10
+// Generic registers (REG8/REG16/SEGREG) = 5
+// RM = 3
+// Other = 1
+constexpr int encodingSpecificity(const InstructionEncoding& encoding) {
+    int specificity = 0;
+    for (OperandSpec spec : encoding.operands) {
+        switch (spec) {
+            case OperandSpec::AL:
+            case OperandSpec::AX:
+            case OperandSpec::CL:
+            case OperandSpec::DX:
+                specificity += 10;
+                break;
+            case OperandSpec::REG8:
+            case OperandSpec::REG16:
+            case OperandSpec::SEGREG:
+                specificity += 5;
+                break;
+            case OperandSpec::RM8:
+            case OperandSpec::RM16:
+                specificity += 3;
+                break;
+            default:
+                specificity += 1;
+                break;
+        }
+    }
+    return specificity;
 }
 
+// Mnemonic -> candidate encodings, built from INSTRUCTION_TABLE at compile time.
+// All rows for a mnemonic live in one contiguous run of SORTED_ROWS, ordered by
+// descending specificity. The insertion sort is stable, so rows of equal
+// specificity keep their table order and the first match wins exactly as a
+// full scan would.
+constexpr size_t ROW_COUNT = std::size(INSTRUCTION_TABLE);
+
+constexpr bool rowBefore(const InstructionEncoding& a, const InstructionEncoding& b) {
+    if (a.mnemonic != b.mnemonic) {
+        return a.mnemonic < b.mnemonic;
+    }
+    return encodingSpecificity(a) > encodingSpecificity(b);
+}
+
+constexpr auto SORTED_ROWS = [] {
+    std::array<const InstructionEncoding*, ROW_COUNT> rows{};
+    for (size_t i = 0; i < ROW_COUNT; i++) {
+        rows[i] = &INSTRUCTION_TABLE[i];
+    }
+    for (size_t i = 1; i < ROW_COUNT; i++) {
+        const InstructionEncoding* row = rows[i];
+        size_t j = i;
+        while (j > 0 && rowBefore(*row, *rows[j - 1])) {
+            rows[j] = rows[j - 1];
+            j--;
+        }
+        rows[j] = row;
+    }
+    return rows;
+}();
+
+// Run of SORTED_ROWS for each mnemonic id (empty for ids without rows)
+struct MnemonicRows {
+    uint16_t begin = 0;
+    uint16_t end = 0;
+};
+
+constexpr auto MNEMONIC_ROWS = [] {
+    std::array<MnemonicRows, MNEMONIC_COUNT> mnemonics{};
+    size_t start = 0;
+    for (size_t i = 1; i <= ROW_COUNT; i++) {
+        if (i == ROW_COUNT || SORTED_ROWS[i]->mnemonic != SORTED_ROWS[start]->mnemonic) {
+            mnemonics[static_cast<size_t>(SORTED_ROWS[start]->mnemonic)] = {
+                static_cast<uint16_t>(start), static_cast<uint16_t>(i)};
+            start = i;
+        }
+    }
+    return mnemonics;
+}();
+
+struct EncodingRange {
+    const InstructionEncoding* const* begin = nullptr;
+    const InstructionEncoding* const* end = nullptr;
+};
+
+EncodingRange findEncodingRows(Mnemonic mnemonic) {
+    const MnemonicRows& rows = MNEMONIC_ROWS[static_cast<size_t>(mnemonic)];
+    return {SORTED_ROWS.data() + rows.begin, SORTED_ROWS.data() + rows.end};
+}
+
+const MemoryOperand* firstMemoryOperand(const Instruction* instr) {
+    for (const Operand* operand : instr->operands) {
+        if (auto* mem = ast_cast<MemoryOperand>(operand)) {
+            return mem;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
 InstructionEncoder::InstructionEncoder() {
 }
 
 EncodedInstruction InstructionEncoder::encode(const Instruction* instr) {
-    const InstructionEncoding* encoding = findEncoding(instr->mnemonic, instr->operands);
+    EncodedInstruction encoded = encodeForm(instr);
+    if (encoded.success && encoded.bytes.overflowed()) {
+        return EncodedInstruction("Instruction too long: " + instr->mnemonic);
+    }
+    return encoded;
+}
+
+bool InstructionEncoder::encodeInto(const Instruction* instr, std::vector<uint8_t>& out, std::string& error) {
+    EncodedInstruction encoded = encode(instr);
+    if (!encoded.success) {
+        error = std::move(encoded.error);
+        return false;
+    }
+    out.insert(out.end(), encoded.bytes.begin(), encoded.bytes.end());
+    return true;
+}
+
+InstructionFields InstructionEncoder::locateFields(const Instruction* instr, const uint8_t* bytes, size_t length) {
+    InstructionFields fields;
+    const InstructionEncoding* encoding = findEncoding(instr->id, instr->operands);
+    if (!encoding || length == 0) {
+        return fields;
+    }
+
+    // Skip the segment override prefix the encoder puts in front
+    const MemoryOperand* memory = firstMemoryOperand(instr);
+    size_t pos = hasOverridePrefix(memory) ? 1 : 0;
+    pos++;  // Opcode
+    if (pos > length) {
+        return fields;
+    }
+
+    auto field = [length](size_t offset, size_t size, uint8_t& field_offset, uint8_t& field_size) {
+        if (offset + size <= length) {
+            field_offset = static_cast<uint8_t>(offset);
+            field_size = static_cast<uint8_t>(size);
+        }
+    };
+
+    switch (encoding->encoding_type) {
+        case EncodingType::MODRM:
+        case EncodingType::MODRM_IMM: {
+            if (pos >= length) {
+                break;
+            }
+            uint8_t modrm = bytes[pos++];
+            uint8_t mod = modrm >> 6;
+            uint8_t rm = modrm & 0x07;
+            size_t disp_size = 0;
+            if (mod == 0x01) {
+                disp_size = 1;
+            } else if (mod == 0x02 || (mod == 0x00 && rm == 0x06)) {
+                disp_size = 2;
+            }
+            field(pos, disp_size, fields.displacement_offset, fields.displacement_size);
+            if (encoding->encoding_type == EncodingType::MODRM_IMM && pos + disp_size < length) {
+                // Whatever follows the displacement is the immediate
+                field(pos + disp_size, length - pos - disp_size, fields.immediate_offset, fields.immediate_size);
+            }
+            break;
+        }
+        case EncodingType::IMMEDIATE:
+            // Either a value or the direct address of MOV AL/AX, [addr]
+            if (memory) {
+                field(pos, length - pos, fields.displacement_offset, fields.displacement_size);
+            } else {
+                field(pos, length - pos, fields.immediate_offset, fields.immediate_size);
+            }
+            break;
+        case EncodingType::REG_IN_OPCODE:
+        case EncodingType::RELATIVE:
+            field(pos, length - pos, fields.immediate_offset, fields.immediate_size);
+            break;
+        default:
+            break;
+    }
+    return fields;
+}
+
+uint32_t InstructionEncoder::estimateClocks(const Instruction* instr, const uint8_t* bytes, size_t length) {
+    const InstructionEncoding* encoding = findEncoding(instr->id, instr->operands);
+    if (!encoding) {
+        return 0;
+    }
+
+    const MemoryOperand* memory = firstMemoryOperand(instr);
+    size_t pos = 0;
+    uint32_t clocks = 0;
+    if (hasOverridePrefix(memory)) {
+        pos++;
+        clocks += 2;
+    }
+
+    // Only the ModRM forms can address memory through an effective address
+    bool modrm = encoding->encoding_type == EncodingType::MODRM ||
+                 encoding->encoding_type == EncodingType::MODRM_IMM;
+    if (modrm && pos + 1 < length && (bytes[pos + 1] >> 6) != 0x03) {
+        return clocks + encoding->clocks.mem + ModRMGenerator::effectiveAddressClocks(bytes[pos + 1]);
+    }
+    return clocks + encoding->clocks.reg;
+}
+
+EncodedInstruction InstructionEncoder::encodeForm(const Instruction* instr) {
+    const InstructionEncoding* encoding = findEncoding(instr->id, instr->operands);
 
     if (!encoding) {
         return EncodedInstruction("No encoding found for instruction: " + instr->mnemonic);
@@ -40,7 +243,7 @@ EncodedInstruction InstructionEncoder::encode(const Instruction* instr) {
 
         case EncodingType::FIXED:
             // Just return the opcode
-            return EncodedInstruction(std::vector<uint8_t>{encoding->base_opcode});
+            return EncodedInstruction(InstructionBytes{encoding->base_opcode});
 
         default:
             return EncodedInstruction(std::string("Unsupported encoding type"));
@@ -48,76 +251,43 @@ EncodedInstruction InstructionEncoder::encode(const Instruction* instr) {
 }
 
 const InstructionEncoding* InstructionEncoder::findEncoding(
-    const std::string& mnemonic,
-    const std::vector<std::unique_ptr<Operand>>& operands
+    Mnemonic mnemonic,
+    const OperandList& operands
 ) {
-    const InstructionEncoding* best_match = nullptr;
-    int best_specificity = -1;
-
-    // Search instruction table for matching encoding
-    // Prefer more specific matches (AL/AX) over generic ones (REG8/REG16)
-    for (const auto& encoding : INSTRUCTION_TABLE) {
-        // Check mnemonic (case-insensitive)
-        if (!iequals(encoding.mnemonic, mnemonic)) {
-            continue;
-        }
+    // Candidates come pre-sorted by specificity, so the first row whose
+    // operands all match is the most specific one (AL/AX over REG8/REG16)
+    auto candidates = findEncodingRows(mnemonic);
+
+    for (auto it = candidates.begin; it != candidates.end; ++it) {
+        const InstructionEncoding* encoding = *it;
 
         // Check operand count
-        if (encoding.operands.size() != operands.size()) {
+        if (encoding->operands.size() != operands.size()) {
             continue;
         }
 
         // Check each operand matches the spec
         bool all_match = true;
-        int specificity = 0;
-
         for (size_t i = 0; i < operands.size(); i++) {
-            if (!matchesSpec(operands[i].get(), encoding.operands[i])) {
+            if (!matchesSpec(operands[i], encoding->operands[i])) {
                 all_match = false;
                 break;
             }
-
-            // Calculate specificity score (higher = more specific)
-            // Specific registers (AL/AX) = 10
-            // Generic registers (REG8/REG16) = 5
-            // RM = 3
-            // Other = 1
-            switch (encoding.operands[i]) {
-                case OperandSpec::AL:
-                case OperandSpec::AX:
-                case OperandSpec::CL:
-                case OperandSpec::DX:
-                    specificity += 10;
-                    break;
-                case OperandSpec::REG8:
-                case OperandSpec::REG16:
-                case OperandSpec::SEGREG:
-                    specificity += 5;
-                    break;
-                case OperandSpec::RM8:
-                case OperandSpec::RM16:
-                    specificity += 3;
-                    break;
-                default:
-                    specificity += 1;
-                    break;
-            }
         }
 
-        if (all_match && specificity > best_specificity) {
-            best_match = &encoding;
-            best_specificity = specificity;
+        if (all_match) {
+            return encoding;
         }
     }
 
-    return best_match;
+    return nullptr;
 }
 
 bool InstructionEncoder::matchesSpec(const Operand* operand, OperandSpec spec) {
-    auto* reg = dynamic_cast<const RegisterOperand*>(operand);
-    auto* imm = dynamic_cast<const ImmediateOperand*>(operand);
-    auto* mem = dynamic_cast<const MemoryOperand*>(operand);
-    auto* label = dynamic_cast<const LabelRef*>(operand);
+    auto* reg = ast_cast<RegisterOperand>(operand);
+    auto* imm = ast_cast<ImmediateOperand>(operand);
+    auto* mem = ast_cast<MemoryOperand>(operand);
+    auto* label = ast_cast<LabelRef>(operand);
 
     switch (spec) {
         case OperandSpec::REG8:
@@ -127,9 +297,11 @@ bool InstructionEncoder::matchesSpec(const Operand* operand, OperandSpec spec) {
             return reg && reg->size == 16 && !reg->is_segment;
 
         case OperandSpec::MEM8:
-            // Pure memory operand (direct address only - for special accumulator encoding)
-            // Non-direct memory should use RM8
-            return mem && mem->is_direct_address;
+            // Pure memory operand (no base/index registers - for special accumulator encoding)
+            // Memory with registers should use RM8
+            if (!mem) return false;
+            if (mem->is_direct_address) return true;
+            return mem->parsed_address && !mem->parsed_address->hasRegisters();
 
         case OperandSpec::MEM16:
             // Pure memory operand (direct address only - for special accumulator encoding)
@@ -139,7 +311,7 @@ bool InstructionEncoder::matchesSpec(const Operand* operand, OperandSpec spec) {
             if (label) return true;  // Plain label reference (e.g., "lea si, data")
             if (!mem) return false;
             if (mem->is_direct_address) return true;
-            if (mem->parsed_address && mem->parsed_address->registers.empty()) return true;
+            if (mem->parsed_address && !mem->parsed_address->hasRegisters()) return true;
             return false;
 
         case OperandSpec::RM8:
@@ -217,10 +389,10 @@ bool InstructionEncoder::matchesSpec(const Operand* operand, OperandSpec spec) {
 }
 
 OperandSpec InstructionEncoder::classifyOperand(const Operand* operand) {
-    auto* reg = dynamic_cast<const RegisterOperand*>(operand);
-    auto* imm = dynamic_cast<const ImmediateOperand*>(operand);
-    auto* mem = dynamic_cast<const MemoryOperand*>(operand);
-    auto* label = dynamic_cast<const LabelRef*>(operand);
+    auto* reg = ast_cast<RegisterOperand>(operand);
+    auto* imm = ast_cast<ImmediateOperand>(operand);
+    auto* mem = ast_cast<MemoryOperand>(operand);
+    auto* label = ast_cast<LabelRef>(operand);
 
     if (reg) {
         if (reg->is_segment) return OperandSpec::SEGREG;
@@ -256,13 +428,13 @@ EncodedInstruction InstructionEncoder::encodeModRM(
     const InstructionEncoding* encoding,
     const Instruction* instr
 ) {
-    std::vector<uint8_t> bytes;
+    InstructionBytes bytes;
 
-    auto* dest_reg = dynamic_cast<const RegisterOperand*>(instr->operands[0].get());
-    auto* src_reg = dynamic_cast<const RegisterOperand*>(instr->operands[1].get());
-    auto* dest_mem = dynamic_cast<const MemoryOperand*>(instr->operands[0].get());
-    auto* src_mem = dynamic_cast<const MemoryOperand*>(instr->operands[1].get());
-    auto* src_label = dynamic_cast<const LabelRef*>(instr->operands[1].get());
+    auto* dest_reg = ast_cast<RegisterOperand>(instr->operands[0]);
+    auto* src_reg = ast_cast<RegisterOperand>(instr->operands[1]);
+    auto* dest_mem = ast_cast<MemoryOperand>(instr->operands[0]);
+    auto* src_mem = ast_cast<MemoryOperand>(instr->operands[1]);
+    auto* src_label = ast_cast<LabelRef>(instr->operands[1]);
 
     // Add segment override prefix if present in any memory operand
     const MemoryOperand* mem_op = dest_mem ? dest_mem : src_mem;
@@ -282,7 +454,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
     }
     else if (dest_reg && src_label) {
         // Register with label (e.g., LEA SI, data) - treat as direct memory address
-        auto symbol = lookupLabel(src_label->label);
+        auto symbol = lookupLabel(src_label->label, src_label->label_id);
         if (!symbol || !symbol->is_resolved) {
             return EncodedInstruction("Undefined label: " + src_label->label);
         }
@@ -293,7 +465,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
         }
 
         bytes.push_back(result.modrm_byte);
-        bytes.insert(bytes.end(), result.displacement.begin(), result.displacement.end());
+        bytes.append(result.displacement);
     }
     else if (dest_mem && src_reg) {
         // Register to memory: [mem], reg
@@ -301,7 +473,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
         if (dest_mem->is_direct_address) {
             result = ModRMGenerator::generateDirect(dest_mem->direct_address_value, src_reg->code);
         } else if (dest_mem->parsed_address) {
-            result = ModRMGenerator::generateMemory(*dest_mem->parsed_address, src_reg->code, m_symbol_table);
+            result = generateMemoryModRM(*dest_mem->parsed_address, src_reg->code);
         } else {
             return EncodedInstruction(std::string("Invalid memory operand"));
         }
@@ -311,7 +483,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
         }
 
         bytes.push_back(result.modrm_byte);
-        bytes.insert(bytes.end(), result.displacement.begin(), result.displacement.end());
+        bytes.append(result.displacement);
     }
     else if (dest_reg && src_mem) {
         // Memory to register: reg, [mem]
@@ -319,7 +491,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
         if (src_mem->is_direct_address) {
             result = ModRMGenerator::generateDirect(src_mem->direct_address_value, dest_reg->code);
         } else if (src_mem->parsed_address) {
-            result = ModRMGenerator::generateMemory(*src_mem->parsed_address, dest_reg->code, m_symbol_table);
+            result = generateMemoryModRM(*src_mem->parsed_address, dest_reg->code);
         } else {
             return EncodedInstruction(std::string("Invalid memory operand"));
         }
@@ -329,7 +501,7 @@ EncodedInstruction InstructionEncoder::encodeModRM(
         }
 
         bytes.push_back(result.modrm_byte);
-        bytes.insert(bytes.end(), result.displacement.begin(), result.displacement.end());
+        bytes.append(result.displacement);
     }
     else {
         return EncodedInstruction(std::string("Invalid operand combination for ModRM"));
@@ -342,10 +514,10 @@ EncodedInstruction InstructionEncoder::encodeRegInOpcode(
     const InstructionEncoding* encoding,
     const Instruction* instr
 ) {
-    std::vector<uint8_t> bytes;
+    InstructionBytes bytes;
 
     // Get register code from first operand
-    auto* reg = dynamic_cast<const RegisterOperand*>(instr->operands[0].get());
+    auto* reg = ast_cast<RegisterOperand>(instr->operands[0]);
     if (!reg) {
         return EncodedInstruction("Expected register operand");
     }
@@ -355,9 +527,9 @@ EncodedInstruction InstructionEncoder::encodeRegInOpcode(
 
     // Check for immediate value (optional - some instructions like PUSH/POP/INC/DEC don't have it)
     if (instr->operands.size() > 1) {
-        auto* imm = dynamic_cast<const ImmediateOperand*>(instr->operands[1].get());
-        auto* label = dynamic_cast<const LabelRef*>(instr->operands[1].get());
-        auto* reg2 = dynamic_cast<const RegisterOperand*>(instr->operands[1].get());
+        auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
+        auto* label = ast_cast<LabelRef>(instr->operands[1]);
+        auto* reg2 = ast_cast<RegisterOperand>(instr->operands[1]);
 
         // Special case: XCHG AX, reg16 - second operand is a register, encoded in opcode
         if (reg2) {
@@ -370,22 +542,16 @@ EncodedInstruction InstructionEncoder::encodeRegInOpcode(
         if (imm) {
             // Check if immediate has a label reference or expression
             if (imm->has_label) {
-                // Check if it contains operators (is an expression)
-                bool is_expression = (imm->label_name.find('+') != std::string::npos ||
-                                     imm->label_name.find('-') != std::string::npos ||
-                                     imm->label_name.find('*') != std::string::npos ||
-                                     imm->label_name.find('/') != std::string::npos);
-
-                if (is_expression) {
-                    // Evaluate expression
-                    auto eval_result = evaluateExpression(imm->label_name);
+                // The parser compiled it if it is more than a single symbol
+                if (!imm->expression.empty()) {
+                    auto eval_result = evaluateExpression(imm->expression);
                     if (!eval_result) {
                         return EncodedInstruction("Invalid expression: " + imm->label_name);
                     }
                     value = *eval_result;
                 } else {
                     // Simple label lookup
-                    auto symbol = lookupLabel(imm->label_name);
+                    auto symbol = lookupLabel(imm->label_name, imm->label_id);
                     if (!symbol || !symbol->is_resolved) {
                         return EncodedInstruction("Undefined label: " + imm->label_name);
                     }
@@ -396,7 +562,7 @@ EncodedInstruction InstructionEncoder::encodeRegInOpcode(
             }
         } else if (label) {
             // Resolve label to address
-            auto symbol = lookupLabel(label->label);
+            auto symbol = lookupLabel(label->label, label->label_id);
             if (!symbol || !symbol->is_resolved) {
                 return EncodedInstruction("Undefined label: " + label->label);
             }
@@ -407,8 +573,7 @@ EncodedInstruction InstructionEncoder::encodeRegInOpcode(
 
         // Encode immediate (8-bit or 16-bit based on register size)
         size_t imm_size = (reg->size == 8) ? 1 : 2;
-        auto imm_bytes = encodeImmediate(value, imm_size);
-        bytes.insert(bytes.end(), imm_bytes.begin(), imm_bytes.end());
+        bytes.appendLittleEndian(value, imm_size);
     }
 
     return EncodedInstruction(bytes);
@@ -418,11 +583,11 @@ EncodedInstruction InstructionEncoder::encodeImmediate(
     const InstructionEncoding* encoding,
     const Instruction* instr
 ) {
-    std::vector<uint8_t> bytes;
+    InstructionBytes bytes;
 
     // Emit segment override prefix if any memory operand has one
     for (const auto& op : instr->operands) {
-      auto* mem = dynamic_cast<const MemoryOperand*>(op.get());
+      auto* mem = ast_cast<MemoryOperand>(op);
       if (mem && mem->segment_override) {
         auto prefix = getSegmentOverridePrefix(*mem->segment_override);
         if (prefix) {
@@ -442,26 +607,21 @@ EncodedInstruction InstructionEncoder::encodeImmediate(
 
     // Single operand (e.g., INT 3, RET imm16)
     if (instr->operands.size() == 1) {
-        auto* imm = dynamic_cast<const ImmediateOperand*>(instr->operands[0].get());
+        auto* imm = ast_cast<ImmediateOperand>(instr->operands[0]);
         if (imm) {
             int64_t value = imm->value;
             // Check if immediate has a label reference or expression
             if (imm->has_label) {
-                // Check if it contains operators (is an expression)
-                bool is_expression = (imm->label_name.find('+') != std::string::npos ||
-                                     imm->label_name.find('-') != std::string::npos ||
-                                     imm->label_name.find('*') != std::string::npos ||
-                                     imm->label_name.find('/') != std::string::npos);
-
-                if (is_expression) {
-                    auto eval_result = evaluateExpression(imm->label_name);
+                // The parser compiled it if it is more than a single symbol
+                if (!imm->expression.empty()) {
+                    auto eval_result = evaluateExpression(imm->expression);
                     if (!eval_result) {
                         return EncodedInstruction("Invalid expression: " + imm->label_name);
                     }
                     value = *eval_result;
                 } else {
                     // Simple label lookup
-                    auto symbol = lookupLabel(imm->label_name);
+                    auto symbol = lookupLabel(imm->label_name, imm->label_id);
                     if (!symbol || !symbol->is_resolved) {
                         return EncodedInstruction("Undefined label: " + imm->label_name);
                     }
@@ -469,54 +629,47 @@ EncodedInstruction InstructionEncoder::encodeImmediate(
                 }
             }
             size_t imm_size = (encoding->operands[0] == OperandSpec::IMM8) ? 1 : 2;
-            auto imm_bytes = encodeImmediate(value, imm_size);
-            bytes.insert(bytes.end(), imm_bytes.begin(), imm_bytes.end());
+            bytes.appendLittleEndian(value, imm_size);
             return EncodedInstruction(bytes);
         }
     }
 
     // Two operands - check for immediate value OR direct memory address (for MOV AL/AX, [addr])
     if (instr->operands.size() >= 2) {
-        auto* imm = dynamic_cast<const ImmediateOperand*>(instr->operands[1].get());
-        auto* mem = dynamic_cast<const MemoryOperand*>(instr->operands[1].get());
+        auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
+        auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
 
         // Also check first operand for OUT imm8, AL/AX
-        auto* imm0 = dynamic_cast<const ImmediateOperand*>(instr->operands[0].get());
-        auto* mem0 = dynamic_cast<const MemoryOperand*>(instr->operands[0].get());
+        auto* imm0 = ast_cast<ImmediateOperand>(instr->operands[0]);
+        auto* mem0 = ast_cast<MemoryOperand>(instr->operands[0]);
 
         if (imm0) {
             // First operand is immediate (e.g., OUT imm8, AL)
             int64_t value = imm0->value;
             if (imm0->has_label) {
-                auto symbol = lookupLabel(imm0->label_name);
+                auto symbol = lookupLabel(imm0->label_name, imm0->label_id);
                 if (!symbol || !symbol->is_resolved) {
                     return EncodedInstruction("Undefined label: " + imm0->label_name);
                 }
                 value = symbol->value;
             }
             size_t imm_size = (encoding->operands[0] == OperandSpec::IMM8) ? 1 : 2;
-            auto imm_bytes = encodeImmediate(value, imm_size);
-            bytes.insert(bytes.end(), imm_bytes.begin(), imm_bytes.end());
+            bytes.appendLittleEndian(value, imm_size);
             return EncodedInstruction(bytes);
         }
         else if (mem0) {
           // First operand is memory (e.g., MOV [MEM16], AX)
           if (mem0->is_direct_address) {
-            auto addr_bytes = encodeImmediate(mem0->direct_address_value, 2);
-            bytes.insert(bytes.end(), addr_bytes.begin(), addr_bytes.end());
+            bytes.appendLittleEndian(mem0->direct_address_value, 2);
             return EncodedInstruction(bytes);
           }
-          else if (mem0->parsed_address && mem0->parsed_address->registers.empty()) {
-            int64_t address = mem0->parsed_address->displacement;
-            if (mem0->parsed_address->has_label) {
-              auto symbol = lookupLabel(mem0->parsed_address->label_name);
-              if (!symbol || !symbol->is_resolved) {
-                return EncodedInstruction("Undefined label: " + mem0->parsed_address->label_name);
-              }
-              address += symbol->value;
+          else if (mem0->parsed_address && !mem0->parsed_address->hasRegisters()) {
+            std::string undefined;
+            auto symbols = resolveAddressSymbols(*mem0->parsed_address, undefined);
+            if (!symbols) {
+              return EncodedInstruction("Undefined label: " + undefined);
             }
-            auto addr_bytes = encodeImmediate(address, 2);
-            bytes.insert(bytes.end(), addr_bytes.begin(), addr_bytes.end());
+            bytes.appendLittleEndian(mem0->parsed_address->displacement + *symbols, 2);
             return EncodedInstruction(bytes);
           }
         }
@@ -524,40 +677,34 @@ EncodedInstruction InstructionEncoder::encodeImmediate(
             // Second operand is immediate
             int64_t value = imm->value;
             if (imm->has_label) {
-                auto symbol = lookupLabel(imm->label_name);
+                auto symbol = lookupLabel(imm->label_name, imm->label_id);
                 if (!symbol || !symbol->is_resolved) {
                     return EncodedInstruction("Undefined label: " + imm->label_name);
                 }
                 value = symbol->value;
             }
             size_t imm_size = (encoding->operands[1] == OperandSpec::IMM8) ? 1 : 2;
-            auto imm_bytes = encodeImmediate(value, imm_size);
-            bytes.insert(bytes.end(), imm_bytes.begin(), imm_bytes.end());
+            bytes.appendLittleEndian(value, imm_size);
             return EncodedInstruction(bytes);
         }
         else if (mem) {
             // Memory operand - check if it's a valid direct address
             if (mem->is_direct_address) {
                 // Numeric direct address (MOV AL/AX, [0x1234])
-                auto addr_bytes = encodeImmediate(mem->direct_address_value, 2);
-                bytes.insert(bytes.end(), addr_bytes.begin(), addr_bytes.end());
+                bytes.appendLittleEndian(mem->direct_address_value, 2);
                 return EncodedInstruction(bytes);
             }
             else if (mem->parsed_address) {
                 // Check if it's a direct address (no registers, just displacement/label)
                 const auto& addr = *mem->parsed_address;
-                if (addr.registers.empty()) {
-                    // Direct address - resolve label if present
-                    int64_t address = addr.displacement;
-                    if (addr.has_label) {
-                        auto symbol = lookupLabel(addr.label_name);
-                        if (!symbol || !symbol->is_resolved) {
-                            return EncodedInstruction("Undefined label: " + addr.label_name);
-                        }
-                        address += symbol->value;
+                if (!addr.hasRegisters()) {
+                    // Direct address - resolve labels if present
+                    std::string undefined;
+                    auto symbols = resolveAddressSymbols(addr, undefined);
+                    if (!symbols) {
+                        return EncodedInstruction("Undefined label: " + undefined);
                     }
-                    auto addr_bytes = encodeImmediate(address, 2);
-                    bytes.insert(bytes.end(), addr_bytes.begin(), addr_bytes.end());
+                    bytes.appendLittleEndian(addr.displacement + *symbols, 2);
                     return EncodedInstruction(bytes);
                 }
             }
@@ -571,11 +718,11 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
     const InstructionEncoding* encoding,
     const Instruction* instr
 ) {
-    std::vector<uint8_t> bytes;
+    InstructionBytes bytes;
 
     // Generate ModR/M byte
-    auto* dest_reg = dynamic_cast<const RegisterOperand*>(instr->operands[0].get());
-    auto* dest_mem = dynamic_cast<const MemoryOperand*>(instr->operands[0].get());
+    auto* dest_reg = ast_cast<RegisterOperand>(instr->operands[0]);
+    auto* dest_mem = ast_cast<MemoryOperand>(instr->operands[0]);
 
     // Add segment override prefix if present in memory operand
     if (dest_mem && dest_mem->segment_override) {
@@ -599,7 +746,7 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
         if (dest_mem->is_direct_address) {
             result = ModRMGenerator::generateDirect(dest_mem->direct_address_value, encoding->modrm_reg_field);
         } else if (dest_mem->parsed_address) {
-            result = ModRMGenerator::generateMemory(*dest_mem->parsed_address, encoding->modrm_reg_field, m_symbol_table);
+            result = generateMemoryModRM(*dest_mem->parsed_address, encoding->modrm_reg_field);
         } else {
             return EncodedInstruction(std::string("Invalid memory operand"));
         }
@@ -609,7 +756,7 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
         }
 
         bytes.push_back(result.modrm_byte);
-        bytes.insert(bytes.end(), result.displacement.begin(), result.displacement.end());
+        bytes.append(result.displacement);
     }
     else {
         return EncodedInstruction(std::string("Invalid destination operand"));
@@ -617,11 +764,11 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
 
     // Add immediate value (if there is one - some instructions like INC/DEC/NEG/NOT/MUL/DIV don't have it)
     if (instr->operands.size() > 1) {
-        auto* imm = dynamic_cast<const ImmediateOperand*>(instr->operands[1].get());
+        auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
 
         // Check for CL operand (for shifts/rotates)
         if (!imm) {
-            auto* cl_reg = dynamic_cast<const RegisterOperand*>(instr->operands[1].get());
+            auto* cl_reg = ast_cast<RegisterOperand>(instr->operands[1]);
             if (cl_reg && cl_reg->code == 1 && cl_reg->size == 8) {
                 // Shift by CL - no immediate to encode
                 return EncodedInstruction(bytes);
@@ -632,22 +779,16 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
         // Resolve immediate value (could be label reference or expression)
         int64_t value = imm->value;
         if (imm->has_label) {
-            // Check if it contains operators (is an expression)
-            bool is_expression = (imm->label_name.find('+') != std::string::npos ||
-                                 imm->label_name.find('-') != std::string::npos ||
-                                 imm->label_name.find('*') != std::string::npos ||
-                                 imm->label_name.find('/') != std::string::npos);
-
-            if (is_expression) {
-                // Evaluate expression
-                auto eval_result = evaluateExpression(imm->label_name);
+            // The parser compiled it if it is more than a single symbol
+            if (!imm->expression.empty()) {
+                auto eval_result = evaluateExpression(imm->expression);
                 if (!eval_result) {
                     return EncodedInstruction("Invalid expression: " + imm->label_name);
                 }
                 value = *eval_result;
             } else {
                 // Simple label lookup
-                auto symbol = lookupLabel(imm->label_name);
+                auto symbol = lookupLabel(imm->label_name, imm->label_id);
                 if (!symbol || !symbol->is_resolved) {
                     return EncodedInstruction("Undefined label: " + imm->label_name);
                 }
@@ -663,8 +804,7 @@ EncodedInstruction InstructionEncoder::encodeModRMImm(
 
         // Determine size from operand spec
         size_t imm_size = (encoding->operands[1] == OperandSpec::IMM8) ? 1 : 2;
-        auto imm_bytes = encodeImmediate(value, imm_size);
-        bytes.insert(bytes.end(), imm_bytes.begin(), imm_bytes.end());
+        bytes.appendLittleEndian(value, imm_size);
     }
 
     return EncodedInstruction(bytes);
@@ -674,16 +814,16 @@ EncodedInstruction InstructionEncoder::encodeRelative(
     const InstructionEncoding* encoding,
     const Instruction* instr
 ) {
-    std::vector<uint8_t> bytes;
+    InstructionBytes bytes;
 
     // Get label reference
-    auto* label_ref = dynamic_cast<const LabelRef*>(instr->operands[0].get());
+    auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
     if (!label_ref) {
         return EncodedInstruction("Expected label operand for jump");
     }
 
     // Look up label address in symbol table
-    auto symbol = lookupLabel(label_ref->label);
+    auto symbol = lookupLabel(label_ref->label, label_ref->label_id);
     if (!symbol) {
         return EncodedInstruction("Undefined label: " + label_ref->label);
     }
@@ -698,12 +838,9 @@ EncodedInstruction InstructionEncoder::encodeRelative(
 
     // Auto-upgrade SHORT to NEAR for JMP if displacement doesn't fit
     // (Conditional jumps cannot be upgraded - they only support SHORT on 8086)
-    std::string mnemonic_upper = instr->mnemonic;
-    std::transform(mnemonic_upper.begin(), mnemonic_upper.end(), mnemonic_upper.begin(), ::toupper);
-
     if (disp_size == 1 && (displacement < -128 || displacement > 127)) {
         // Check if this is JMP (can be upgraded to NEAR)
-        if (mnemonic_upper == "JMP") {
+        if (instr->id == Mnemonic::JMP) {
             // Auto-upgrade to NEAR (3 bytes: opcode + 16-bit displacement)
             disp_size = 2;
             bytes.push_back(0xE9);  // NEAR JMP opcode
@@ -712,6 +849,9 @@ EncodedInstruction InstructionEncoder::encodeRelative(
             instruction_size = 1 + disp_size;
             next_instruction_address = m_current_address + instruction_size;
             displacement = static_cast<int64_t>(symbol->value) - static_cast<int64_t>(next_instruction_address);
+        } else if (m_dry_run) {
+            // Sizing only - the final encode reports the range error
+            bytes.push_back(encoding->base_opcode);
         } else {
             // Conditional jump - cannot upgrade, must error
             return EncodedInstruction("Jump target too far for SHORT jump (distance: " +
@@ -723,8 +863,7 @@ EncodedInstruction InstructionEncoder::encodeRelative(
     }
 
     // Encode displacement
-    auto disp_bytes = encodeImmediate(displacement, disp_size);
-    bytes.insert(bytes.end(), disp_bytes.begin(), disp_bytes.end());
+    bytes.appendLittleEndian(displacement, disp_size);
 
     return EncodedInstruction(bytes);
 }
@@ -733,40 +872,76 @@ uint8_t InstructionEncoder::generateModRM(uint8_t mod, uint8_t reg, uint8_t rm)
     return ((mod & 0x03) << 6) | ((reg & 0x07) << 3) | (rm & 0x07);
 }
 
-std::vector<uint8_t> InstructionEncoder::encodeImmediate(int64_t value, size_t size_bytes) {
-    std::vector<uint8_t> bytes;
-
-    // Little-endian encoding
-    for (size_t i = 0; i < size_bytes; i++) {
-        bytes.push_back(static_cast<uint8_t>(value & 0xFF));
-        value >>= 8;
-    }
-
-    return bytes;
-}
-
 bool InstructionEncoder::isAccumulator(const Operand* operand) {
-    auto* reg = dynamic_cast<const RegisterOperand*>(operand);
+    auto* reg = ast_cast<RegisterOperand>(operand);
     return reg && reg->code == 0;  // AL (code 0) or AX (code 0)
 }
 
-std::optional<Symbol> InstructionEncoder::lookupLabel(const std::string& label_name) const {
+const Symbol* InstructionEncoder::lookupLabel(std::string_view label_name) const {
     if (!m_symbol_table) {
-        return std::nullopt;
+        return nullptr;
     }
 
     // Try normal lookup first (with scope applied)
-    auto symbol = m_symbol_table->lookup(label_name);
+    const Symbol* symbol = m_scope ? m_symbol_table->findFrom(label_name, *m_scope)
+                                   : m_symbol_table->find(label_name);
 
     // If not found and label starts with '.', try direct lookup (without scope)
     // This handles segment names like .text and .data as global labels
-    if (!symbol && !label_name.empty() && label_name[0] == '.') {
-        symbol = m_symbol_table->lookupDirect(label_name);
+    if (!symbol && SymbolTable::isLocalLabel(label_name)) {
+        symbol = m_symbol_table->findDirect(label_name);
+    }
+
+    // While sizing, a forward reference is assumed to point right here
+    if (!symbol && m_dry_run) {
+        m_placeholder.value = static_cast<int64_t>(m_current_address);
+        symbol = &m_placeholder;
     }
 
     return symbol;
 }
 
+const Symbol* InstructionEncoder::lookupLabel(std::string_view label_name, std::optional<SymbolId> id) const {
+    // Bound against the table this encoder reads, once every symbol existed
+    if (id && m_symbol_table && *id < m_symbol_table->getAllSymbols().size()) {
+        return &m_symbol_table->get(*id);
+    }
+    return lookupLabel(label_name);
+}
+
+std::optional<int64_t> InstructionEncoder::resolveAddressSymbols(const AddressExpression& addr,
+                                                                std::string& undefined) const {
+    int64_t total = 0;
+    for (const auto& term : addr.symbols) {
+        auto symbol = lookupLabel(term.name, term.id);
+        if (!symbol || !symbol->is_resolved) {
+            undefined = term.name;
+            return std::nullopt;
+        }
+        total += term.scale * symbol->value;
+    }
+    return total;
+}
+
+ModRMResult InstructionEncoder::generateMemoryModRM(const AddressExpression& addr, uint8_t reg_field) const {
+    std::string undefined;
+    auto symbols = resolveAddressSymbols(addr, undefined);
+    if (!symbols) {
+        return ModRMResult("Undefined label: " + undefined);
+    }
+
+    // A label's displacement may no longer fit a byte once it is relocated
+    bool wide = addr.wide_displacement;
+    if (m_relocatable) {
+        for (const auto& term : addr.symbols) {
+            const Symbol* symbol = lookupLabel(term.name, term.id);
+            wide = wide || (symbol && symbol->type != SymbolType::CONSTANT);
+        }
+    }
+
+    return ModRMGenerator::generateMemory(addr, reg_field, *symbols, wide);
+}
+
 std::optional<uint8_t> InstructionEncoder::getSegmentOverridePrefix(const std::string& segment) const {
     // Convert to uppercase for comparison
     std::string seg_upper = segment;
@@ -781,38 +956,32 @@ std::optional<uint8_t> InstructionEncoder::getSegmentOverridePrefix(const std::s
     return std::nullopt;  // Invalid segment
 }
 
-std::optional<int64_t> InstructionEncoder::evaluateExpression(const std::string& expr) const {
-    // Substitute EQU constants in the expression
-    std::string substituted = expr;
-
-    // Get all symbols from the symbol table
-    if (m_symbol_table) {
-        auto symbols = m_symbol_table->getAllSymbols();
-
-        // Replace each symbol with its value
-        for (const auto& [name, symbol] : symbols) {
-            // Only substitute constants (EQU directives)
-            if (symbol.type == SymbolType::CONSTANT && symbol.is_resolved) {
-                size_t pos = 0;
-                while ((pos = substituted.find(name, pos)) != std::string::npos) {
-                    // Check if it's a whole word (not part of another identifier)
-                    bool is_word_start = (pos == 0 || (!std::isalnum(substituted[pos - 1]) && substituted[pos - 1] != '_'));
-                    bool is_word_end = (pos + name.size() >= substituted.size() ||
-                                       (!std::isalnum(substituted[pos + name.size()]) && substituted[pos + name.size()] != '_'));
-
-                    if (is_word_start && is_word_end) {
-                        substituted.replace(pos, name.size(), std::to_string(symbol.value));
-                        pos += std::to_string(symbol.value).size();
-                    } else {
-                        ++pos;
-                    }
-                }
-            }
+bool InstructionEncoder::hasOverridePrefix(const MemoryOperand* memory) const {
+    return memory && memory->segment_override && getSegmentOverridePrefix(*memory->segment_override);
+}
+
+std::optional<int64_t> InstructionEncoder::evaluateExpression(const ExpressionProgram& program) const {
+    // Only EQU constants take part, looked up by exact name unless the slot
+    // was bound already
+    const auto& names = program.symbols();
+    auto value = program.evaluate([&](size_t slot) -> std::optional<int64_t> {
+        const Symbol* symbol = nullptr;
+        if (m_symbol_table) {
+            auto id = program.binding(slot);
+            symbol = id && *id < m_symbol_table->getAllSymbols().size() ? &m_symbol_table->get(*id)
+                                                                        : m_symbol_table->findDirect(names[slot]);
         }
-    }
+        if (!symbol || symbol->type != SymbolType::CONSTANT || !symbol->is_resolved) {
+            return std::nullopt;
+        }
+        return symbol->value;
+    });
 
-    // Evaluate the substituted expression using ExpressionParser
-    return ExpressionParser::evaluate(substituted);
+    // While sizing, constants defined further down are not known yet
+    if (!value && m_dry_run) {
+        return 0;
+    }
+    return value;
 }
 
 } // namespace e2asm
@@ -13,9 +13,12 @@
 #include <vector>
 #include <cstdint>
 #include <optional>
+#include <string_view>
 #include "instruction_tables.h"
 #include "../parser/ast.h"
 #include "../core/error.h"
+#include "instruction_bytes.h"
+#include "modrm_generator.h"
 #include "../semantic/symbol_table.h"
 
 namespace e2asm {
@@ -25,17 +28,33 @@ namespace e2asm {
  *
  * Either contains the generated machine code bytes or an error message
  * explaining why encoding failed. Success can be checked via the success flag.
+ * The bytes live inline and the error string is only set on failure, so a
+ * successful encode allocates nothing.
  */
 struct EncodedInstruction {
-    std::vector<uint8_t> bytes;  ///< Machine code bytes (if successful)
-    bool success;                ///< True if encoding succeeded
-    std::string error;           ///< Error message (if failed)
+    InstructionBytes bytes;  ///< Machine code bytes (if successful)
+    bool success;            ///< True if encoding succeeded
+    std::string error;       ///< Error message (if failed)
 
     EncodedInstruction() : success(false) {}
-    EncodedInstruction(std::vector<uint8_t> b) : bytes(std::move(b)), success(true) {}
+    EncodedInstruction(const InstructionBytes& b) : bytes(b), success(true) {}
     EncodedInstruction(std::string err) : success(false), error(std::move(err)) {}
 };
 
+/**
+ * @brief Where an encoded instruction keeps the values it took from operands
+ *
+ * Offsets count from the first byte of the encoding; a size of 0 means the
+ * instruction has no such field. The displacement belongs to the memory
+ * operand, the immediate to the immediate or jump-target operand.
+ */
+struct InstructionFields {
+    uint8_t displacement_offset = 0;  ///< Address displacement (ModR/M disp or direct address)
+    uint8_t displacement_size = 0;
+    uint8_t immediate_offset = 0;     ///< Immediate value or relative jump displacement
+    uint8_t immediate_size = 0;
+};
+
 /**
  * @brief Table-driven 8086 instruction encoder
  *
@@ -88,6 +107,37 @@ public:
      */
     void setCurrentAddress(uint64_t address) { m_current_address = address; }
 
+    /**
+     * @brief Resolves local labels under a fixed global label
+     * @param global_label Scope to use, or nullptr to follow the symbol table's current scope
+     *
+     * Lets several encoders share one symbol table without touching its
+     * scope. The string is read on every lookup and must stay alive.
+     */
+    void setScope(const std::string* global_label) { m_scope = global_label; }
+
+    /**
+     * @brief Enables or disables sizing (dry-run) mode
+     * @param enabled true to encode for size only
+     *
+     * Used by the semantic analyzer to measure instructions before every
+     * symbol has its final address. In dry-run mode a symbol that is not
+     * defined yet resolves to the current address (so a forward jump is
+     * assumed to fit in rel8), and range errors on conditional jumps are
+     * left for the final encode to report. The bytes produced have the
+     * right length but are not meant to be emitted.
+     */
+    void setDryRun(bool enabled) { m_dry_run = enabled; }
+
+    /**
+     * @brief Encodes for an object module
+     * @param enabled true if label addresses will still be relocated by a linker
+     *
+     * A memory operand that refers to a label then always gets a 16-bit
+     * displacement, since the label's final address is not known yet.
+     */
+    void setRelocatable(bool enabled) { m_relocatable = enabled; }
+
     /**
      * @brief Encodes an instruction to machine code
      * @param instr Instruction AST node with mnemonic and operands
@@ -98,20 +148,61 @@ public:
      */
     EncodedInstruction encode(const Instruction* instr);
 
+    /**
+     * @brief Encodes an instruction and appends its bytes to an output buffer
+     * @param instr Instruction AST node with mnemonic and operands
+     * @param out Buffer the bytes are appended to (left untouched on failure)
+     * @param error Set to the error message if encoding fails
+     * @return true if the instruction was encoded
+     */
+    bool encodeInto(const Instruction* instr, std::vector<uint8_t>& out, std::string& error);
+
+    /**
+     * @brief Finds the displacement and immediate fields of an encoding
+     * @param instr Instruction that was encoded
+     * @param bytes Bytes encode() produced for it, in the same encoder state
+     * @param length Number of bytes
+     * @return Field positions (all zero if the instruction has no encoding)
+     *
+     * Used to record relocations: the caller knows which symbol went into
+     * which operand, this says where the operand's value ended up.
+     */
+    InstructionFields locateFields(const Instruction* instr, const uint8_t* bytes, size_t length);
+
+    /**
+     * @brief Estimates how long an encoded instruction takes on an 8086
+     * @param instr Instruction that was encoded
+     * @param bytes Bytes encode() produced for it, in the same encoder state
+     * @param length Number of bytes
+     * @return Clocks of the encoding row (see Clocks), plus the effective
+     *         address and segment override for memory forms; 0 if the
+     *         instruction has no encoding
+     */
+    uint32_t estimateClocks(const Instruction* instr, const uint8_t* bytes, size_t length);
+
 private:
+    /**
+     * @brief Picks the encoding form and runs it (encode() adds the length check)
+     */
+    EncodedInstruction encodeForm(const Instruction* instr);
+
     /**
      * @brief Finds the encoding table entry for an instruction
-     * @param mnemonic Instruction name (MOV, ADD, etc.)
+     * @param mnemonic Instruction id (MOV, ADD, etc.)
      * @param operands Instruction's operands
      * @return Pointer to encoding info, or nullptr if not found
      *
      * Searches the instruction tables for a row matching both the mnemonic
      * and operand pattern. Some instructions have multiple encodings
      * (e.g., MOV has separate forms for reg-to-reg, reg-to-mem, immediate).
+     *
+     * Rows are looked up through a mnemonic index generated at compile time;
+     * each mnemonic's rows are pre-sorted by specificity, so only that
+     * mnemonic's candidates are tested and the first match is taken.
      */
     const InstructionEncoding* findEncoding(
-        const std::string& mnemonic,
-        const std::vector<std::unique_ptr<Operand>>& operands
+        Mnemonic mnemonic,
+        const OperandList& operands
     );
 
     /**
@@ -197,14 +288,6 @@ private:
      */
     uint8_t generateModRM(uint8_t mod, uint8_t reg, uint8_t rm);
 
-    /**
-     * @brief Converts immediate value to little-endian bytes
-     * @param value Numeric value to encode
-     * @param size_bytes Number of bytes (1, 2, or 4)
-     * @return Vector of bytes in little-endian order
-     */
-    std::vector<uint8_t> encodeImmediate(int64_t value, size_t size_bytes);
-
     /**
      * @brief Checks if operand is the accumulator register
      * @param operand Operand to check
@@ -217,11 +300,42 @@ private:
     /**
      * @brief Looks up a symbol with scoping fallback
      * @param label_name Symbol to find
-     * @return Symbol if found
+     * @return Symbol in the table (or the dry-run placeholder), nullptr if not found
      *
      * Tries normal scoped lookup first, then direct lookup for local labels.
      */
-    std::optional<Symbol> lookupLabel(const std::string& label_name) const;
+    const Symbol* lookupLabel(std::string_view label_name) const;
+
+    /**
+     * @brief Looks up a symbol the semantic analyzer may have bound already
+     * @param label_name Symbol to find if it isn't bound
+     * @param id SymbolId bound for the reference, if any
+     * @return The bound symbol, else the result of lookupLabel(label_name)
+     */
+    const Symbol* lookupLabel(std::string_view label_name, std::optional<SymbolId> id) const;
+
+    /**
+     * @brief Sums the symbolic terms of an address expression
+     * @param addr Parsed address expression
+     * @param undefined Set to the offending name if a symbol can't be resolved
+     * @return Sum of scale * value over all terms, or nullopt
+     *
+     * In dry-run mode undefined labels resolve to the current address (see
+     * lookupLabel), so an operand can be sized before every label is placed.
+     */
+    std::optional<int64_t> resolveAddressSymbols(const AddressExpression& addr,
+                                                 std::string& undefined) const;
+
+    /**
+     * @brief Generates ModR/M and displacement for a register-based memory operand
+     * @param addr Parsed address expression
+     * @param reg_field Value for the REG field
+     * @return ModR/M byte and displacement, or error
+     *
+     * Resolves the expression's symbols and hands the numbers to
+     * ModRMGenerator::generateMemory.
+     */
+    ModRMResult generateMemoryModRM(const AddressExpression& addr, uint8_t reg_field) const;
 
     /**
      * @brief Gets segment override prefix byte
@@ -233,16 +347,27 @@ private:
     std::optional<uint8_t> getSegmentOverridePrefix(const std::string& segment) const;
 
     /**
-     * @brief Evaluates arithmetic expression with EQU constants
-     * @param expr Expression string (e.g., "WIDTH - RECT_W")
+     * @brief Whether the encoding of a memory operand starts with an override prefix
+     * @param memory The instruction's memory operand, or nullptr
+     */
+    bool hasOverridePrefix(const MemoryOperand* memory) const;
+
+    /**
+     * @brief Evaluates an immediate's compiled expression with EQU constants
+     * @param program Compiled expression (e.g., of "WIDTH - RECT_W")
      * @return Computed value or nullopt on error
      *
-     * Substitutes EQU constant names with their values and evaluates.
+     * Each symbol slot is looked up once per evaluation; labels are not
+     * accepted. While sizing, an unknown constant evaluates to 0.
      */
-    std::optional<int64_t> evaluateExpression(const std::string& expr) const;
+    std::optional<int64_t> evaluateExpression(const ExpressionProgram& program) const;
 
     const SymbolTable* m_symbol_table = nullptr;  ///< For resolving labels
     uint64_t m_current_address = 0;               ///< For calculating relative jumps
+    const std::string* m_scope = nullptr;         ///< Fixed scope for locals (see setScope)
+    bool m_dry_run = false;                       ///< Size-only encoding (see setDryRun)
+    bool m_relocatable = false;                   ///< Wide label displacements (see setRelocatable)
+    mutable Symbol m_placeholder;                 ///< Stand-in for unseen labels while sizing
 };
 
 } // namespace e2asm
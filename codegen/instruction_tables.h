@@ -1,8 +1,10 @@
 #pragma once
 
+#include <array>
+#include <cstddef>
 #include <cstdint>
-#include <string>
-#include <vector>
+#include <initializer_list>
+#include "../lexer/mnemonic.h"
 
 namespace e2asm {
 
@@ -73,447 +75,500 @@ enum class EncodingType {
     RELATIVE,
 };
 
+/**
+ * Operand pattern of one encoding row, stored inline (no 8086 form takes
+ * more than two operands)
+ */
+struct OperandSpecList {
+    static constexpr size_t MAX_OPERANDS = 2;
+
+    std::array<OperandSpec, MAX_OPERANDS> specs{};
+    uint8_t count = 0;
+
+    constexpr OperandSpecList() = default;
+    constexpr OperandSpecList(std::initializer_list<OperandSpec> list) {
+        for (OperandSpec spec : list) {
+            specs[count++] = spec;
+        }
+    }
+
+    constexpr size_t size() const { return count; }
+    constexpr OperandSpec operator[](size_t i) const { return specs[i]; }
+    constexpr const OperandSpec* begin() const { return specs.data(); }
+    constexpr const OperandSpec* end() const { return specs.data() + count; }
+};
+
+/**
+ * 8086 clock counts of one encoding variant
+ *
+ * Forms with a memory operand cost mem plus the effective-address
+ * calculation (ModRMGenerator::effectiveAddressClocks); everything else,
+ * including the direct-address accumulator moves, costs reg. Branches and
+ * LOOPs are counted as taken, MUL/DIV at the top of their range, string
+ * instructions once (not per REP iteration). 8088 bus penalties for word
+ * transfers are not included.
+ */
+struct Clocks {
+    uint8_t reg = 0;                        // Register/immediate operands (or the only form)
+    uint8_t mem = 0;                        // Memory operand, EA calculation not included
+};
+
 /**
  * Single instruction encoding variant
  * One instruction (like MOV) has multiple encodings for different operand combinations
+ *
+ * Rows are plain constexpr data, so the table sits in read-only memory and
+ * costs nothing at static-initialization time.
  */
 struct InstructionEncoding {
-    std::string mnemonic;                   // "MOV", "ADD", etc.
-    std::vector<OperandSpec> operands;      // Expected operand types
+    Mnemonic mnemonic;                      // MOV, ADD, etc.
+    OperandSpecList operands;               // Expected operand types
     EncodingType encoding_type;             // How to encode this variant
     uint8_t base_opcode;                    // Base opcode byte
     uint8_t modrm_reg_field;                // For MODRM_IMM: value for reg field (e.g., ADD uses /0)
     bool has_direction_bit;                 // D bit: 0=reg is source, 1=reg is dest
     bool has_width_bit;                     // W bit: 0=8-bit, 1=16-bit
+    Clocks clocks;                          // Estimated execution time
+
+    constexpr InstructionEncoding(
+        Mnemonic mn,
+        OperandSpecList ops,
+        EncodingType enc,
+        uint8_t opcode,
+        Clocks clk
+    )
+        : InstructionEncoding(mn, ops, enc, opcode, 0, clk)
+    {}
 
-    InstructionEncoding(
-        std::string mn,
-        std::vector<OperandSpec> ops,
+    constexpr InstructionEncoding(
+        Mnemonic mn,
+        OperandSpecList ops,
         EncodingType enc,
         uint8_t opcode,
-        uint8_t reg_field = 0,
+        uint8_t reg_field,
+        Clocks clk,
         bool d_bit = false,
         bool w_bit = false
     )
-        : mnemonic(std::move(mn))
-        , operands(std::move(ops))
+        : mnemonic(mn)
+        , operands(ops)
         , encoding_type(enc)
         , base_opcode(opcode)
         , modrm_reg_field(reg_field)
         , has_direction_bit(d_bit)
         , has_width_bit(w_bit)
+        , clocks(clk)
     {}
 };
 
 /**
   Master instructions table
-  This should be the only source of truth for instructions encoding in the porject
-  but for now, this is not the case as the instructions size is being calculated
-  elsewhere, this should be fixed.
+  This is the only source of truth for instructions encoding in the project,
+  instruction sizes are measured by dry-run encoding against it.
 */
-inline const std::vector<InstructionEncoding> INSTRUCTION_TABLE = {
+inline constexpr InstructionEncoding INSTRUCTION_TABLE[] = {
     // ========== MOV ==========
     // Register to register/memory (opcode 0x88/0x89)
-    {"MOV", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x88},
-    {"MOV", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x89},
+    {Mnemonic::MOV, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x88, {2, 9}},
+    {Mnemonic::MOV, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x89, {2, 9}},
 
     // Register/memory to register (opcode 0x8A/0x8B)
-    {"MOV", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x8A},
-    {"MOV", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x8B},
+    {Mnemonic::MOV, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x8A, {2, 8}},
+    {Mnemonic::MOV, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x8B, {2, 8}},
 
     // Immediate to register/memory (opcode 0xC6/0xC7)
-    {"MOV", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xC6, 0},
-    {"MOV", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0xC7, 0},
+    {Mnemonic::MOV, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xC6, 0, {4, 10}},
+    {Mnemonic::MOV, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0xC7, 0, {4, 10}},
 
     // Accumulator to/from memory (special opcodes)
-    {"MOV", {OperandSpec::AL, OperandSpec::MEM8}, EncodingType::IMMEDIATE, 0xA0},
-    {"MOV", {OperandSpec::AX, OperandSpec::MEM16}, EncodingType::IMMEDIATE, 0xA1},
-    {"MOV", {OperandSpec::MEM8, OperandSpec::AL}, EncodingType::IMMEDIATE, 0xA2},
-    {"MOV", {OperandSpec::MEM16, OperandSpec::AX}, EncodingType::IMMEDIATE, 0xA3},
+    {Mnemonic::MOV, {OperandSpec::AL, OperandSpec::MEM8}, EncodingType::IMMEDIATE, 0xA0, {10}},
+    {Mnemonic::MOV, {OperandSpec::AX, OperandSpec::MEM16}, EncodingType::IMMEDIATE, 0xA1, {10}},
+    {Mnemonic::MOV, {OperandSpec::MEM8, OperandSpec::AL}, EncodingType::IMMEDIATE, 0xA2, {10}},
+    {Mnemonic::MOV, {OperandSpec::MEM16, OperandSpec::AX}, EncodingType::IMMEDIATE, 0xA3, {10}},
 
     // Immediate to register (B0-B7 for 8-bit, B8-BF for 16-bit)
-    {"MOV", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::REG_IN_OPCODE, 0xB0},
-    {"MOV", {OperandSpec::REG8, OperandSpec::IMM8}, EncodingType::REG_IN_OPCODE, 0xB0},
-    {"MOV", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::REG_IN_OPCODE, 0xB8},
-    {"MOV", {OperandSpec::REG16, OperandSpec::IMM16}, EncodingType::REG_IN_OPCODE, 0xB8},
+    {Mnemonic::MOV, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::REG_IN_OPCODE, 0xB0, {4}},
+    {Mnemonic::MOV, {OperandSpec::REG8, OperandSpec::IMM8}, EncodingType::REG_IN_OPCODE, 0xB0, {4}},
+    {Mnemonic::MOV, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::REG_IN_OPCODE, 0xB8, {4}},
+    {Mnemonic::MOV, {OperandSpec::REG16, OperandSpec::IMM16}, EncodingType::REG_IN_OPCODE, 0xB8, {4}},
 
     // Segment register moves
-    {"MOV", {OperandSpec::RM16, OperandSpec::SEGREG}, EncodingType::MODRM, 0x8C},
-    {"MOV", {OperandSpec::SEGREG, OperandSpec::RM16}, EncodingType::MODRM, 0x8E},
+    {Mnemonic::MOV, {OperandSpec::RM16, OperandSpec::SEGREG}, EncodingType::MODRM, 0x8C, {2, 9}},
+    {Mnemonic::MOV, {OperandSpec::SEGREG, OperandSpec::RM16}, EncodingType::MODRM, 0x8E, {2, 8}},
 
     // ========== ADD ==========
     // Register to register/memory (opcode 0x00/0x01)
-    {"ADD", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x00},
-    {"ADD", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x01},
+    {Mnemonic::ADD, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x00, {3, 16}},
+    {Mnemonic::ADD, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x01, {3, 16}},
 
     // Register/memory to register (opcode 0x02/0x03)
-    {"ADD", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x02},
-    {"ADD", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x03},
+    {Mnemonic::ADD, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x02, {3, 9}},
+    {Mnemonic::ADD, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x03, {3, 9}},
 
     // Immediate to accumulator (opcode 0x04/0x05)
-    {"ADD", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x04},
-    {"ADD", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x05},
+    {Mnemonic::ADD, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x04, {4}},
+    {Mnemonic::ADD, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x05, {4}},
 
     // Immediate to register/memory (opcode 0x80/0x81 with /0 in reg field)
-    {"ADD", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 0},
-    {"ADD", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 0},
-    {"ADD", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 0},  // Sign-extended
+    {Mnemonic::ADD, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 0, {4, 17}},
+    {Mnemonic::ADD, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 0, {4, 17}},
+    {Mnemonic::ADD, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 0, {4, 17}},  // Sign-extended
 
     // ========== ADC ==========
     // Register to register/memory (opcode 0x10/0x11)
-    {"ADC", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x10},
-    {"ADC", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x11},
+    {Mnemonic::ADC, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x10, {3, 16}},
+    {Mnemonic::ADC, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x11, {3, 16}},
 
     // Register/memory to register (opcode 0x12/0x13)
-    {"ADC", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x12},
-    {"ADC", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x13},
+    {Mnemonic::ADC, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x12, {3, 9}},
+    {Mnemonic::ADC, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x13, {3, 9}},
 
     // Immediate to accumulator (opcode 0x14/0x15)
-    {"ADC", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x14},
-    {"ADC", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x15},
+    {Mnemonic::ADC, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x14, {4}},
+    {Mnemonic::ADC, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x15, {4}},
 
     // Immediate to register/memory (opcode 0x80/0x81 with /2 in reg field)
-    {"ADC", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 2},
-    {"ADC", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 2},
-    {"ADC", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 2},  // Sign-extended
+    {Mnemonic::ADC, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 2, {4, 17}},
+    {Mnemonic::ADC, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 2, {4, 17}},
+    {Mnemonic::ADC, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 2, {4, 17}},  // Sign-extended
 
     // ========== SUB ==========
     // Register to register/memory (opcode 0x28/0x29)
-    {"SUB", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x28},
-    {"SUB", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x29},
+    {Mnemonic::SUB, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x28, {3, 16}},
+    {Mnemonic::SUB, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x29, {3, 16}},
 
     // Register/memory to register (opcode 0x2A/0x2B)
-    {"SUB", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x2A},
-    {"SUB", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x2B},
+    {Mnemonic::SUB, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x2A, {3, 9}},
+    {Mnemonic::SUB, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x2B, {3, 9}},
 
     // Immediate to accumulator (opcode 0x2C/0x2D)
-    {"SUB", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x2C},
-    {"SUB", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x2D},
+    {Mnemonic::SUB, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x2C, {4}},
+    {Mnemonic::SUB, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x2D, {4}},
 
     // Immediate to register/memory (opcode 0x80/0x81 with /5 in reg field)
-    {"SUB", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 5},
-    {"SUB", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 5},
-    {"SUB", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 5},  // Sign-extended
+    {Mnemonic::SUB, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 5, {4, 17}},
+    {Mnemonic::SUB, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 5, {4, 17}},
+    {Mnemonic::SUB, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 5, {4, 17}},  // Sign-extended
 
     // ========== SBB ==========
     // Register to register/memory (opcode 0x18/0x19)
-    {"SBB", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x18},
-    {"SBB", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x19},
+    {Mnemonic::SBB, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x18, {3, 16}},
+    {Mnemonic::SBB, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x19, {3, 16}},
 
     // Register/memory to register (opcode 0x1A/0x1B)
-    {"SBB", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x1A},
-    {"SBB", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x1B},
+    {Mnemonic::SBB, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x1A, {3, 9}},
+    {Mnemonic::SBB, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x1B, {3, 9}},
 
     // Immediate to accumulator (opcode 0x1C/0x1D)
-    {"SBB", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x1C},
-    {"SBB", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x1D},
+    {Mnemonic::SBB, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x1C, {4}},
+    {Mnemonic::SBB, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x1D, {4}},
 
     // Immediate to register/memory (opcode 0x80/0x81 with /3 in reg field)
-    {"SBB", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 3},
-    {"SBB", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 3},
-    {"SBB", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 3},  // Sign-extended
+    {Mnemonic::SBB, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 3, {4, 17}},
+    {Mnemonic::SBB, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 3, {4, 17}},
+    {Mnemonic::SBB, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 3, {4, 17}},  // Sign-extended
 
     // ========== JMP ==========
     // Unconditional jump
-    {"JMP", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xEB},   // SHORT jump
-    {"JMP", {OperandSpec::REL16}, EncodingType::RELATIVE, 0xE9},  // NEAR jump
+    {Mnemonic::JMP, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xEB, {15}},   // SHORT jump
+    {Mnemonic::JMP, {OperandSpec::REL16}, EncodingType::RELATIVE, 0xE9, {15}},  // NEAR jump
 
     // ========== Conditional Jumps ==========
     // All conditional jumps are SHORT only (rel8)
-    {"JO", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x70},    // Jump if overflow
-    {"JNO", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x71},   // Jump if not overflow
-    {"JB", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72},    // Jump if below (unsigned)
-    {"JC", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72},    // Jump if carry
-    {"JNAE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72},  // Jump if not above or equal
-    {"JNB", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73},   // Jump if not below
-    {"JAE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73},   // Jump if above or equal
-    {"JNC", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73},   // Jump if not carry
-    {"JE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x74},    // Jump if equal
-    {"JZ", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x74},    // Jump if zero
-    {"JNE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x75},   // Jump if not equal
-    {"JNZ", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x75},   // Jump if not zero
-    {"JBE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x76},   // Jump if below or equal
-    {"JNA", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x76},   // Jump if not above
-    {"JNBE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x77},  // Jump if not below or equal
-    {"JA", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x77},    // Jump if above
-    {"JS", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x78},    // Jump if sign
-    {"JNS", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x79},   // Jump if not sign
-    {"JP", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7A},    // Jump if parity
-    {"JPE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7A},   // Jump if parity even
-    {"JNP", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7B},   // Jump if not parity
-    {"JPO", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7B},   // Jump if parity odd
-    {"JL", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7C},    // Jump if less (signed)
-    {"JNGE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7C},  // Jump if not greater or equal
-    {"JNL", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7D},   // Jump if not less
-    {"JGE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7D},   // Jump if greater or equal
-    {"JLE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7E},   // Jump if less or equal
-    {"JNG", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7E},   // Jump if not greater
-    {"JNLE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7F},  // Jump if not less or equal
-    {"JG", {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7F},    // Jump if greater
+    {Mnemonic::JO, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x70, {16}},    // Jump if overflow
+    {Mnemonic::JNO, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x71, {16}},   // Jump if not overflow
+    {Mnemonic::JB, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72, {16}},    // Jump if below (unsigned)
+    {Mnemonic::JC, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72, {16}},    // Jump if carry
+    {Mnemonic::JNAE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x72, {16}},  // Jump if not above or equal
+    {Mnemonic::JNB, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73, {16}},   // Jump if not below
+    {Mnemonic::JAE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73, {16}},   // Jump if above or equal
+    {Mnemonic::JNC, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x73, {16}},   // Jump if not carry
+    {Mnemonic::JE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x74, {16}},    // Jump if equal
+    {Mnemonic::JZ, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x74, {16}},    // Jump if zero
+    {Mnemonic::JNE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x75, {16}},   // Jump if not equal
+    {Mnemonic::JNZ, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x75, {16}},   // Jump if not zero
+    {Mnemonic::JBE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x76, {16}},   // Jump if below or equal
+    {Mnemonic::JNA, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x76, {16}},   // Jump if not above
+    {Mnemonic::JNBE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x77, {16}},  // Jump if not below or equal
+    {Mnemonic::JA, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x77, {16}},    // Jump if above
+    {Mnemonic::JS, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x78, {16}},    // Jump if sign
+    {Mnemonic::JNS, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x79, {16}},   // Jump if not sign
+    {Mnemonic::JP, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7A, {16}},    // Jump if parity
+    {Mnemonic::JPE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7A, {16}},   // Jump if parity even
+    {Mnemonic::JNP, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7B, {16}},   // Jump if not parity
+    {Mnemonic::JPO, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7B, {16}},   // Jump if parity odd
+    {Mnemonic::JL, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7C, {16}},    // Jump if less (signed)
+    {Mnemonic::JNGE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7C, {16}},  // Jump if not greater or equal
+    {Mnemonic::JNL, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7D, {16}},   // Jump if not less
+    {Mnemonic::JGE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7D, {16}},   // Jump if greater or equal
+    {Mnemonic::JLE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7E, {16}},   // Jump if less or equal
+    {Mnemonic::JNG, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7E, {16}},   // Jump if not greater
+    {Mnemonic::JNLE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7F, {16}},  // Jump if not less or equal
+    {Mnemonic::JG, {OperandSpec::REL8}, EncodingType::RELATIVE, 0x7F, {16}},    // Jump if greater
 
     // ========== CMP ==========
     // Register to register/memory (opcode 0x38/0x39)
-    {"CMP", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x38},
-    {"CMP", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x39},
+    {Mnemonic::CMP, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x38, {3, 9}},
+    {Mnemonic::CMP, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x39, {3, 9}},
 
     // Register/memory to register (opcode 0x3A/0x3B)
-    {"CMP", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x3A},
-    {"CMP", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x3B},
+    {Mnemonic::CMP, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x3A, {3, 9}},
+    {Mnemonic::CMP, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x3B, {3, 9}},
 
     // Immediate to accumulator (opcode 0x3C/0x3D)
-    {"CMP", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x3C},
-    {"CMP", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x3D},
+    {Mnemonic::CMP, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x3C, {4}},
+    {Mnemonic::CMP, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x3D, {4}},
 
     // Immediate to register/memory (opcode 0x80/0x81 with /7 in reg field)
-    {"CMP", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 7},
-    {"CMP", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 7},
-    {"CMP", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 7},  // Sign-extended
+    {Mnemonic::CMP, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 7, {4, 10}},
+    {Mnemonic::CMP, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 7, {4, 10}},
+    {Mnemonic::CMP, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 7, {4, 10}},  // Sign-extended
 
     // ========== INC ==========
     // General form (opcode 0xFE/0xFF with /0 in reg field)
-    {"INC", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xFE, 0},
-    {"INC", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 0},
+    {Mnemonic::INC, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xFE, 0, {3, 15}},
+    {Mnemonic::INC, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 0, {3, 15}},
 
     // Short form for 16-bit registers (0x40-0x47)
-    {"INC", {OperandSpec::AX}, EncodingType::FIXED, 0x40},
-    {"INC", {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x40},
+    {Mnemonic::INC, {OperandSpec::AX}, EncodingType::FIXED, 0x40, {2}},
+    {Mnemonic::INC, {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x40, {2}},
 
     // ========== DEC ==========
     // General form (opcode 0xFE/0xFF with /1 in reg field)
-    {"DEC", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xFE, 1},
-    {"DEC", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 1},
+    {Mnemonic::DEC, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xFE, 1, {3, 15}},
+    {Mnemonic::DEC, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 1, {3, 15}},
 
     // Short form for 16-bit registers (0x48-0x4F)
-    {"DEC", {OperandSpec::AX}, EncodingType::FIXED, 0x48},
-    {"DEC", {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x48},
+    {Mnemonic::DEC, {OperandSpec::AX}, EncodingType::FIXED, 0x48, {2}},
+    {Mnemonic::DEC, {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x48, {2}},
 
     // ========== NEG ==========
-    {"NEG", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 3},
-    {"NEG", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 3},
+    {Mnemonic::NEG, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 3, {3, 16}},
+    {Mnemonic::NEG, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 3, {3, 16}},
 
     // ========== MUL ==========
-    {"MUL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 4},
-    {"MUL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 4},
+    {Mnemonic::MUL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 4, {77, 83}},
+    {Mnemonic::MUL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 4, {133, 139}},
 
     // ========== IMUL ==========
-    {"IMUL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 5},
-    {"IMUL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 5},
+    {Mnemonic::IMUL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 5, {98, 104}},
+    {Mnemonic::IMUL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 5, {154, 160}},
 
     // ========== DIV ==========
-    {"DIV", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 6},
-    {"DIV", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 6},
+    {Mnemonic::DIV, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 6, {90, 96}},
+    {Mnemonic::DIV, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 6, {162, 168}},
 
     // ========== IDIV ==========
-    {"IDIV", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 7},
-    {"IDIV", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 7},
+    {Mnemonic::IDIV, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 7, {112, 118}},
+    {Mnemonic::IDIV, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 7, {184, 190}},
 
     // ========== AND ==========
-    {"AND", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x20},
-    {"AND", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x21},
-    {"AND", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x22},
-    {"AND", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x23},
-    {"AND", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x24},
-    {"AND", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x25},
-    {"AND", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 4},
-    {"AND", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 4},
-    {"AND", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 4},
+    {Mnemonic::AND, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x20, {3, 16}},
+    {Mnemonic::AND, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x21, {3, 16}},
+    {Mnemonic::AND, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x22, {3, 9}},
+    {Mnemonic::AND, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x23, {3, 9}},
+    {Mnemonic::AND, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x24, {4}},
+    {Mnemonic::AND, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x25, {4}},
+    {Mnemonic::AND, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 4, {4, 17}},
+    {Mnemonic::AND, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 4, {4, 17}},
+    {Mnemonic::AND, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 4, {4, 17}},
 
     // ========== OR ==========
-    {"OR", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x08},
-    {"OR", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x09},
-    {"OR", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x0A},
-    {"OR", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x0B},
-    {"OR", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x0C},
-    {"OR", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x0D},
-    {"OR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 1},
-    {"OR", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 1},
-    {"OR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 1},
+    {Mnemonic::OR, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x08, {3, 16}},
+    {Mnemonic::OR, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x09, {3, 16}},
+    {Mnemonic::OR, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x0A, {3, 9}},
+    {Mnemonic::OR, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x0B, {3, 9}},
+    {Mnemonic::OR, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x0C, {4}},
+    {Mnemonic::OR, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x0D, {4}},
+    {Mnemonic::OR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 1, {4, 17}},
+    {Mnemonic::OR, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 1, {4, 17}},
+    {Mnemonic::OR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 1, {4, 17}},
 
     // ========== XOR ==========
-    {"XOR", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x30},
-    {"XOR", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x31},
-    {"XOR", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x32},
-    {"XOR", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x33},
-    {"XOR", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x34},
-    {"XOR", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x35},
-    {"XOR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 6},
-    {"XOR", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 6},
-    {"XOR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 6},
+    {Mnemonic::XOR, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x30, {3, 16}},
+    {Mnemonic::XOR, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x31, {3, 16}},
+    {Mnemonic::XOR, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x32, {3, 9}},
+    {Mnemonic::XOR, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x33, {3, 9}},
+    {Mnemonic::XOR, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0x34, {4}},
+    {Mnemonic::XOR, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0x35, {4}},
+    {Mnemonic::XOR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x80, 6, {4, 17}},
+    {Mnemonic::XOR, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0x81, 6, {4, 17}},
+    {Mnemonic::XOR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0x83, 6, {4, 17}},
 
     // ========== NOT ==========
-    {"NOT", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 2},
-    {"NOT", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 2},
+    {Mnemonic::NOT, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xF6, 2, {3, 16}},
+    {Mnemonic::NOT, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xF7, 2, {3, 16}},
 
     // ========== TEST ==========
-    {"TEST", {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x84},
-    {"TEST", {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x85},
-    {"TEST", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xA8},
-    {"TEST", {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xA9},
-    {"TEST", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xF6, 0},
-    {"TEST", {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0xF7, 0},
+    {Mnemonic::TEST, {OperandSpec::RM8, OperandSpec::REG8}, EncodingType::MODRM, 0x84, {3, 9}},
+    {Mnemonic::TEST, {OperandSpec::RM16, OperandSpec::REG16}, EncodingType::MODRM, 0x85, {3, 9}},
+    {Mnemonic::TEST, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xA8, {4}},
+    {Mnemonic::TEST, {OperandSpec::AX, OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xA9, {4}},
+    {Mnemonic::TEST, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xF6, 0, {5, 11}},
+    {Mnemonic::TEST, {OperandSpec::RM16, OperandSpec::IMM16}, EncodingType::MODRM_IMM, 0xF7, 0, {5, 11}},
 
     // ========== Bit Shifts and Rotates ==========
     // Shift/rotate by 1 (implicit)
-    {"ROL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 0},
-    {"ROL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 0},
-    {"ROR", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 1},
-    {"ROR", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 1},
-    {"RCL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 2},
-    {"RCL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 2},
-    {"RCR", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 3},
-    {"RCR", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 3},
-    {"SHL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 4},
-    {"SHL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 4},
-    {"SAL", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 4},  // Same as SHL
-    {"SAL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 4},
-    {"SHR", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 5},
-    {"SHR", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 5},
-    {"SAR", {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 7},
-    {"SAR", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 7},
+    {Mnemonic::ROL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 0, {2, 15}},
+    {Mnemonic::ROL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 0, {2, 15}},
+    {Mnemonic::ROR, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 1, {2, 15}},
+    {Mnemonic::ROR, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 1, {2, 15}},
+    {Mnemonic::RCL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 2, {2, 15}},
+    {Mnemonic::RCL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 2, {2, 15}},
+    {Mnemonic::RCR, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 3, {2, 15}},
+    {Mnemonic::RCR, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 3, {2, 15}},
+    {Mnemonic::SHL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 4, {2, 15}},
+    {Mnemonic::SHL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 4, {2, 15}},
+    {Mnemonic::SAL, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 4, {2, 15}},  // Same as SHL
+    {Mnemonic::SAL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 4, {2, 15}},
+    {Mnemonic::SHR, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 5, {2, 15}},
+    {Mnemonic::SHR, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 5, {2, 15}},
+    {Mnemonic::SAR, {OperandSpec::RM8}, EncodingType::MODRM_IMM, 0xD0, 7, {2, 15}},
+    {Mnemonic::SAR, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xD1, 7, {2, 15}},
 
     // Shift/rotate by 1 (explicit with IMM8 value of 1)
-    {"ROL", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 0},
-    {"ROL", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 0},
-    {"ROR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 1},
-    {"ROR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 1},
-    {"RCL", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 2},
-    {"RCL", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 2},
-    {"RCR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 3},
-    {"RCR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 3},
-    {"SHL", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 4},
-    {"SHL", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 4},
-    {"SAL", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 4},
-    {"SAL", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 4},
-    {"SHR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 5},
-    {"SHR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 5},
-    {"SAR", {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 7},
-    {"SAR", {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 7},
+    {Mnemonic::ROL, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 0, {2, 15}},
+    {Mnemonic::ROL, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 0, {2, 15}},
+    {Mnemonic::ROR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 1, {2, 15}},
+    {Mnemonic::ROR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 1, {2, 15}},
+    {Mnemonic::RCL, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 2, {2, 15}},
+    {Mnemonic::RCL, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 2, {2, 15}},
+    {Mnemonic::RCR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 3, {2, 15}},
+    {Mnemonic::RCR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 3, {2, 15}},
+    {Mnemonic::SHL, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 4, {2, 15}},
+    {Mnemonic::SHL, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 4, {2, 15}},
+    {Mnemonic::SAL, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 4, {2, 15}},
+    {Mnemonic::SAL, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 4, {2, 15}},
+    {Mnemonic::SHR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 5, {2, 15}},
+    {Mnemonic::SHR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 5, {2, 15}},
+    {Mnemonic::SAR, {OperandSpec::RM8, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD0, 7, {2, 15}},
+    {Mnemonic::SAR, {OperandSpec::RM16, OperandSpec::IMM8}, EncodingType::MODRM_IMM, 0xD1, 7, {2, 15}},
 
     // Shift/rotate by CL
-    {"ROL", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 0},
-    {"ROL", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 0},
-    {"ROR", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 1},
-    {"ROR", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 1},
-    {"RCL", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 2},
-    {"RCL", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 2},
-    {"RCR", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 3},
-    {"RCR", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 3},
-    {"SHL", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 4},
-    {"SHL", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 4},
-    {"SAL", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 4},
-    {"SAL", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 4},
-    {"SHR", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 5},
-    {"SHR", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 5},
-    {"SAR", {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 7},
-    {"SAR", {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 7},
+    {Mnemonic::ROL, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 0, {8, 20}},
+    {Mnemonic::ROL, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 0, {8, 20}},
+    {Mnemonic::ROR, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 1, {8, 20}},
+    {Mnemonic::ROR, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 1, {8, 20}},
+    {Mnemonic::RCL, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 2, {8, 20}},
+    {Mnemonic::RCL, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 2, {8, 20}},
+    {Mnemonic::RCR, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 3, {8, 20}},
+    {Mnemonic::RCR, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 3, {8, 20}},
+    {Mnemonic::SHL, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 4, {8, 20}},
+    {Mnemonic::SHL, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 4, {8, 20}},
+    {Mnemonic::SAL, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 4, {8, 20}},
+    {Mnemonic::SAL, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 4, {8, 20}},
+    {Mnemonic::SHR, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 5, {8, 20}},
+    {Mnemonic::SHR, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 5, {8, 20}},
+    {Mnemonic::SAR, {OperandSpec::RM8, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD2, 7, {8, 20}},
+    {Mnemonic::SAR, {OperandSpec::RM16, OperandSpec::CL}, EncodingType::MODRM_IMM, 0xD3, 7, {8, 20}},
 
     // ========== PUSH ==========
     // Register (0x50-0x57)
-    {"PUSH", {OperandSpec::AX}, EncodingType::FIXED, 0x50},
-    {"PUSH", {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x50},
+    {Mnemonic::PUSH, {OperandSpec::AX}, EncodingType::FIXED, 0x50, {11}},
+    {Mnemonic::PUSH, {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x50, {11}},
     // Segment registers
-    {"PUSH", {OperandSpec::SEGREG}, EncodingType::FIXED, 0x06},  // Will need special handling
+    {Mnemonic::PUSH, {OperandSpec::SEGREG}, EncodingType::FIXED, 0x06, {10}},  // Will need special handling
     // Memory
-    {"PUSH", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 6},
+    {Mnemonic::PUSH, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 6, {11, 16}},
 
     // ========== POP ==========
     // Register (0x58-0x5F)
-    {"POP", {OperandSpec::AX}, EncodingType::FIXED, 0x58},
-    {"POP", {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x58},
+    {Mnemonic::POP, {OperandSpec::AX}, EncodingType::FIXED, 0x58, {8}},
+    {Mnemonic::POP, {OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x58, {8}},
     // Segment registers
-    {"POP", {OperandSpec::SEGREG}, EncodingType::FIXED, 0x07},  // Will need special handling
+    {Mnemonic::POP, {OperandSpec::SEGREG}, EncodingType::FIXED, 0x07, {8}},  // Will need special handling
     // Memory
-    {"POP", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0x8F, 0},
+    {Mnemonic::POP, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0x8F, 0, {8, 17}},
 
     // ========== CALL & RET ==========
-    {"CALL", {OperandSpec::REL16}, EncodingType::RELATIVE, 0xE8},  // Near call
-    {"CALL", {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 2},  // Indirect near call
-    {"RET", {}, EncodingType::FIXED, 0xC3},      // Near return
-    {"RET", {OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xC2}, // Near return with pop
-    {"RETF", {}, EncodingType::FIXED, 0xCB},     // Far return
-    {"RETF", {OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xCA}, // Far return with pop
+    {Mnemonic::CALL, {OperandSpec::REL16}, EncodingType::RELATIVE, 0xE8, {19}},  // Near call
+    {Mnemonic::CALL, {OperandSpec::RM16}, EncodingType::MODRM_IMM, 0xFF, 2, {16, 21}},  // Indirect near call
+    {Mnemonic::RET, {}, EncodingType::FIXED, 0xC3, {8}},      // Near return
+    {Mnemonic::RET, {OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xC2, {12}}, // Near return with pop
+    {Mnemonic::RETF, {}, EncodingType::FIXED, 0xCB, {18}},     // Far return
+    {Mnemonic::RETF, {OperandSpec::IMM16}, EncodingType::IMMEDIATE, 0xCA, {17}}, // Far return with pop
 
     // ========== LOOP Instructions ==========
-    {"LOOP", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE2},
-    {"LOOPE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE1},
-    {"LOOPZ", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE1},
-    {"LOOPNE", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE0},
-    {"LOOPNZ", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE0},
-    {"JCXZ", {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE3},
+    {Mnemonic::LOOP, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE2, {17}},
+    {Mnemonic::LOOPE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE1, {18}},
+    {Mnemonic::LOOPZ, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE1, {18}},
+    {Mnemonic::LOOPNE, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE0, {19}},
+    {Mnemonic::LOOPNZ, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE0, {19}},
+    {Mnemonic::JCXZ, {OperandSpec::REL8}, EncodingType::RELATIVE, 0xE3, {18}},
 
     // ========== INT & IRET ==========
-    {"INT", {OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xCD},
-    {"INT3", {}, EncodingType::FIXED, 0xCC},
-    {"INTO", {}, EncodingType::FIXED, 0xCE},
-    {"IRET", {}, EncodingType::FIXED, 0xCF},
+    {Mnemonic::INT, {OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xCD, {51}},
+    {Mnemonic::INT3, {}, EncodingType::FIXED, 0xCC, {52}},
+    {Mnemonic::INTO, {}, EncodingType::FIXED, 0xCE, {53}},
+    {Mnemonic::IRET, {}, EncodingType::FIXED, 0xCF, {24}},
 
     // ========== String Instructions ==========
-    {"MOVSB", {}, EncodingType::FIXED, 0xA4},
-    {"MOVSW", {}, EncodingType::FIXED, 0xA5},
-    {"CMPSB", {}, EncodingType::FIXED, 0xA6},
-    {"CMPSW", {}, EncodingType::FIXED, 0xA7},
-    {"SCASB", {}, EncodingType::FIXED, 0xAE},
-    {"SCASW", {}, EncodingType::FIXED, 0xAF},
-    {"LODSB", {}, EncodingType::FIXED, 0xAC},
-    {"LODSW", {}, EncodingType::FIXED, 0xAD},
-    {"STOSB", {}, EncodingType::FIXED, 0xAA},
-    {"STOSW", {}, EncodingType::FIXED, 0xAB},
+    {Mnemonic::MOVSB, {}, EncodingType::FIXED, 0xA4, {18}},
+    {Mnemonic::MOVSW, {}, EncodingType::FIXED, 0xA5, {18}},
+    {Mnemonic::CMPSB, {}, EncodingType::FIXED, 0xA6, {22}},
+    {Mnemonic::CMPSW, {}, EncodingType::FIXED, 0xA7, {22}},
+    {Mnemonic::SCASB, {}, EncodingType::FIXED, 0xAE, {15}},
+    {Mnemonic::SCASW, {}, EncodingType::FIXED, 0xAF, {15}},
+    {Mnemonic::LODSB, {}, EncodingType::FIXED, 0xAC, {12}},
+    {Mnemonic::LODSW, {}, EncodingType::FIXED, 0xAD, {12}},
+    {Mnemonic::STOSB, {}, EncodingType::FIXED, 0xAA, {11}},
+    {Mnemonic::STOSW, {}, EncodingType::FIXED, 0xAB, {11}},
 
     // ========== Repeat Prefixes ==========
-    {"REP", {}, EncodingType::FIXED, 0xF3},
-    {"REPE", {}, EncodingType::FIXED, 0xF3},
-    {"REPZ", {}, EncodingType::FIXED, 0xF3},
-    {"REPNE", {}, EncodingType::FIXED, 0xF2},
-    {"REPNZ", {}, EncodingType::FIXED, 0xF2},
+    {Mnemonic::REP, {}, EncodingType::FIXED, 0xF3, {2}},
+    {Mnemonic::REPE, {}, EncodingType::FIXED, 0xF3, {2}},
+    {Mnemonic::REPZ, {}, EncodingType::FIXED, 0xF3, {2}},
+    {Mnemonic::REPNE, {}, EncodingType::FIXED, 0xF2, {2}},
+    {Mnemonic::REPNZ, {}, EncodingType::FIXED, 0xF2, {2}},
 
     // ========== I/O Instructions ==========
-    {"IN", {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xE4},
-    {"IN", {OperandSpec::AX, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xE5},
-    {"IN", {OperandSpec::AL, OperandSpec::DX}, EncodingType::FIXED, 0xEC},
-    {"IN", {OperandSpec::AX, OperandSpec::DX}, EncodingType::FIXED, 0xED},
-    {"OUT", {OperandSpec::IMM8, OperandSpec::AL}, EncodingType::IMMEDIATE, 0xE6},
-    {"OUT", {OperandSpec::IMM8, OperandSpec::AX}, EncodingType::IMMEDIATE, 0xE7},
-    {"OUT", {OperandSpec::DX, OperandSpec::AL}, EncodingType::FIXED, 0xEE},
-    {"OUT", {OperandSpec::DX, OperandSpec::AX}, EncodingType::FIXED, 0xEF},
+    {Mnemonic::IN, {OperandSpec::AL, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xE4, {10}},
+    {Mnemonic::IN, {OperandSpec::AX, OperandSpec::IMM8}, EncodingType::IMMEDIATE, 0xE5, {10}},
+    {Mnemonic::IN, {OperandSpec::AL, OperandSpec::DX}, EncodingType::FIXED, 0xEC, {8}},
+    {Mnemonic::IN, {OperandSpec::AX, OperandSpec::DX}, EncodingType::FIXED, 0xED, {8}},
+    {Mnemonic::OUT, {OperandSpec::IMM8, OperandSpec::AL}, EncodingType::IMMEDIATE, 0xE6, {10}},
+    {Mnemonic::OUT, {OperandSpec::IMM8, OperandSpec::AX}, EncodingType::IMMEDIATE, 0xE7, {10}},
+    {Mnemonic::OUT, {OperandSpec::DX, OperandSpec::AL}, EncodingType::FIXED, 0xEE, {8}},
+    {Mnemonic::OUT, {OperandSpec::DX, OperandSpec::AX}, EncodingType::FIXED, 0xEF, {8}},
 
     // ========== Special/No-operand Instructions ==========
-    {"NOP", {}, EncodingType::FIXED, 0x90},
-    {"HLT", {}, EncodingType::FIXED, 0xF4},
-    {"PUSHA", {}, EncodingType::FIXED, 0x60},
-    {"POPA", {}, EncodingType::FIXED, 0x61},
-    {"CLC", {}, EncodingType::FIXED, 0xF8},
-    {"STC", {}, EncodingType::FIXED, 0xF9},
-    {"CMC", {}, EncodingType::FIXED, 0xF5},
-    {"CLD", {}, EncodingType::FIXED, 0xFC},
-    {"STD", {}, EncodingType::FIXED, 0xFD},
-    {"CLI", {}, EncodingType::FIXED, 0xFA},
-    {"STI", {}, EncodingType::FIXED, 0xFB},
-    {"LAHF", {}, EncodingType::FIXED, 0x9F},
-    {"SAHF", {}, EncodingType::FIXED, 0x9E},
-    {"PUSHF", {}, EncodingType::FIXED, 0x9C},
-    {"POPF", {}, EncodingType::FIXED, 0x9D},
-    {"CBW", {}, EncodingType::FIXED, 0x98},
-    {"CWD", {}, EncodingType::FIXED, 0x99},
-    {"AAA", {}, EncodingType::FIXED, 0x37},
-    {"AAS", {}, EncodingType::FIXED, 0x3F},
-    {"AAM", {}, EncodingType::FIXED, 0xD4},
-    {"AAD", {}, EncodingType::FIXED, 0xD5},
-    {"DAA", {}, EncodingType::FIXED, 0x27},
-    {"DAS", {}, EncodingType::FIXED, 0x2F},
-    {"XLAT", {}, EncodingType::FIXED, 0xD7},
-    {"WAIT", {}, EncodingType::FIXED, 0x9B},
-    {"LOCK", {}, EncodingType::FIXED, 0xF0},
+    {Mnemonic::NOP, {}, EncodingType::FIXED, 0x90, {3}},
+    {Mnemonic::HLT, {}, EncodingType::FIXED, 0xF4, {2}},
+    {Mnemonic::PUSHA, {}, EncodingType::FIXED, 0x60, {36}},   // 80186 timing, no 8086 form
+    {Mnemonic::POPA, {}, EncodingType::FIXED, 0x61, {51}},    // 80186 timing, no 8086 form
+    {Mnemonic::CLC, {}, EncodingType::FIXED, 0xF8, {2}},
+    {Mnemonic::STC, {}, EncodingType::FIXED, 0xF9, {2}},
+    {Mnemonic::CMC, {}, EncodingType::FIXED, 0xF5, {2}},
+    {Mnemonic::CLD, {}, EncodingType::FIXED, 0xFC, {2}},
+    {Mnemonic::STD, {}, EncodingType::FIXED, 0xFD, {2}},
+    {Mnemonic::CLI, {}, EncodingType::FIXED, 0xFA, {2}},
+    {Mnemonic::STI, {}, EncodingType::FIXED, 0xFB, {2}},
+    {Mnemonic::LAHF, {}, EncodingType::FIXED, 0x9F, {4}},
+    {Mnemonic::SAHF, {}, EncodingType::FIXED, 0x9E, {4}},
+    {Mnemonic::PUSHF, {}, EncodingType::FIXED, 0x9C, {10}},
+    {Mnemonic::POPF, {}, EncodingType::FIXED, 0x9D, {8}},
+    {Mnemonic::CBW, {}, EncodingType::FIXED, 0x98, {2}},
+    {Mnemonic::CWD, {}, EncodingType::FIXED, 0x99, {5}},
+    {Mnemonic::AAA, {}, EncodingType::FIXED, 0x37, {4}},
+    {Mnemonic::AAS, {}, EncodingType::FIXED, 0x3F, {4}},
+    {Mnemonic::AAM, {}, EncodingType::FIXED, 0xD4, {83}},
+    {Mnemonic::AAD, {}, EncodingType::FIXED, 0xD5, {60}},
+    {Mnemonic::DAA, {}, EncodingType::FIXED, 0x27, {4}},
+    {Mnemonic::DAS, {}, EncodingType::FIXED, 0x2F, {4}},
+    {Mnemonic::XLAT, {}, EncodingType::FIXED, 0xD7, {11}},
+    {Mnemonic::WAIT, {}, EncodingType::FIXED, 0x9B, {3}},
+    {Mnemonic::LOCK, {}, EncodingType::FIXED, 0xF0, {2}},
 
     // ========== Exchange Instructions ==========
-    {"XCHG", {OperandSpec::AX, OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x90},
-    {"XCHG", {OperandSpec::REG16, OperandSpec::AX}, EncodingType::REG_IN_OPCODE, 0x90},
-    {"XCHG", {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x86},
-    {"XCHG", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x87},
+    {Mnemonic::XCHG, {OperandSpec::AX, OperandSpec::REG16}, EncodingType::REG_IN_OPCODE, 0x90, {3}},
+    {Mnemonic::XCHG, {OperandSpec::REG16, OperandSpec::AX}, EncodingType::REG_IN_OPCODE, 0x90, {3}},
+    {Mnemonic::XCHG, {OperandSpec::REG8, OperandSpec::RM8}, EncodingType::MODRM, 0x86, {4, 17}},
+    {Mnemonic::XCHG, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x87, {4, 17}},
 
     // ========== Load Effective Address ==========
-    {"LEA", {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x8D},
-    {"LDS", {OperandSpec::REG16, OperandSpec::MEM16}, EncodingType::MODRM, 0xC5},
-    {"LES", {OperandSpec::REG16, OperandSpec::MEM16}, EncodingType::MODRM, 0xC4},
+    {Mnemonic::LEA, {OperandSpec::REG16, OperandSpec::RM16}, EncodingType::MODRM, 0x8D, {2, 2}},
+    {Mnemonic::LDS, {OperandSpec::REG16, OperandSpec::MEM16}, EncodingType::MODRM, 0xC5, {16, 16}},
+    {Mnemonic::LES, {OperandSpec::REG16, OperandSpec::MEM16}, EncodingType::MODRM, 0xC4, {16, 16}},
 };
 
 } // namespace e2asm
@@ -0,0 +1,223 @@
+#include "listing.h"
+#include <algorithm>
+#include <charconv>
+
+namespace e2asm {
+
+namespace {
+
+void appendHex(std::string& out, uint64_t value) {
+    char buffer[16];
+    auto end = std::to_chars(buffer, buffer + sizeof(buffer), value, 16).ptr;
+    out.append(buffer, end);
+}
+
+const char* dataPrefix(DataDirective::Size size) {
+    switch (size) {
+        case DataDirective::Size::BYTE: return "DB ";
+        case DataDirective::Size::WORD: return "DW ";
+        case DataDirective::Size::DWORD: return "DD ";
+        case DataDirective::Size::QWORD: return "DQ ";
+        case DataDirective::Size::TBYTE: return "DT ";
+    }
+    return "";
+}
+
+const char* resName(RESDirective::Size size) {
+    switch (size) {
+        case RESDirective::Size::BYTE: return "RESB";
+        case RESDirective::Size::WORD: return "RESW";
+        case RESDirective::Size::DWORD: return "RESD";
+        case RESDirective::Size::QWORD: return "RESQ";
+        case RESDirective::Size::TBYTE: return "REST";
+    }
+    return "";
+}
+
+void appendStatement(std::string& out, const ASTNode* stmt) {
+    switch (stmt->kind) {
+        case NodeKind::LABEL:
+            out += static_cast<const Label*>(stmt)->name;
+            out += ':';
+            break;
+        case NodeKind::INSTRUCTION: {
+            auto* instr = static_cast<const Instruction*>(stmt);
+            out += instr->mnemonic;
+            for (size_t i = 0; i < instr->operands.size(); i++) {
+                out += i == 0 ? " " : ", ";
+                const Operand* op = instr->operands[i];
+                if (auto* reg = ast_cast<RegisterOperand>(op)) {
+                    out += reg->name;
+                } else if (auto* imm = ast_cast<ImmediateOperand>(op)) {
+                    out += "0x";
+                    appendHex(out, static_cast<uint64_t>(imm->value));
+                } else if (auto* mem = ast_cast<MemoryOperand>(op)) {
+                    out += '[';
+                    out += mem->address_expr;
+                    out += ']';
+                } else if (auto* label = ast_cast<LabelRef>(op)) {
+                    out += label->label;
+                }
+            }
+            break;
+        }
+        case NodeKind::DATA: {
+            auto* data = static_cast<const DataDirective*>(stmt);
+            out += dataPrefix(data->size);
+            for (size_t i = 0; i < data->values.size(); i++) {
+                const auto& value = data->values[i];
+                if (i > 0) out += ", ";
+                if (value.type == DataValue::Type::STRING) {
+                    out += '"';
+                    out += value.string_value;
+                    out += '"';
+                } else if (value.type == DataValue::Type::CHARACTER) {
+                    out += '\'';
+                    out += value.string_value;
+                    out += '\'';
+                } else {
+                    out += "0x";
+                    appendHex(out, static_cast<uint64_t>(value.number_value));
+                }
+            }
+            break;
+        }
+        case NodeKind::EQU: {
+            auto* equ = static_cast<const EQUDirective*>(stmt);
+            out += equ->name;
+            out += " EQU ";
+            out += std::to_string(equ->value);
+            break;
+        }
+        case NodeKind::ORG:
+            out += "ORG 0x";
+            appendHex(out, static_cast<uint64_t>(static_cast<const ORGDirective*>(stmt)->address));
+            break;
+        case NodeKind::SEGMENT:
+            out += "SEGMENT ";
+            out += static_cast<const SEGMENTDirective*>(stmt)->name;
+            break;
+        case NodeKind::ENDS: {
+            auto* ends = static_cast<const ENDSDirective*>(stmt);
+            if (!ends->name.empty()) {
+                out += ends->name;
+                out += ' ';
+            }
+            out += "ENDS";
+            break;
+        }
+        case NodeKind::RES: {
+            auto* res = static_cast<const RESDirective*>(stmt);
+            out += resName(res->size);
+            out += ' ';
+            out += std::to_string(res->count);
+            break;
+        }
+        case NodeKind::LINKAGE: {
+            auto* linkage = static_cast<const LinkageDirective*>(stmt);
+            out += linkage->linkage == LinkageDirective::Kind::GLOBAL ? "GLOBAL " : "EXTERN ";
+            for (size_t i = 0; i < linkage->names.size(); i++) {
+                if (i > 0) out += ", ";
+                out += linkage->names[i];
+            }
+            break;
+        }
+        case NodeKind::TIMES: {
+            auto* times = static_cast<const TIMESDirective*>(stmt);
+            out += "TIMES ";
+            out += std::to_string(times->count);
+            out += ' ';
+            appendStatement(out, times->repeated_node);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+std::span<const uint8_t> entryBytes(const ListingEntry& entry, std::span<const uint8_t> binary) {
+    if (entry.offset >= binary.size()) {
+        return {};
+    }
+    return binary.subspan(entry.offset, std::min(entry.length, binary.size() - entry.offset));
+}
+
+} // namespace
+
+std::string formatStatement(const ASTNode* stmt) {
+    std::string text;
+    appendStatement(text, stmt);
+    return text;
+}
+
+void appendListingLine(std::string& out, uint64_t address, std::span<const uint8_t> code,
+                       size_t repeat, std::string_view text) {
+    static constexpr char DIGITS[] = "0123456789ABCDEF";
+
+    // At least four address digits, more if the address needs them
+    int digits = 4;
+    while (digits < 16 && (address >> (digits * 4)) != 0) {
+        digits++;
+    }
+    for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+        out += DIGITS[(address >> shift) & 0xF];
+    }
+    out += " | ";
+
+    size_t start = out.size();
+    out.resize(start + code.size() * 3);
+    char* cursor = out.data() + start;
+    for (uint8_t byte : code) {
+        *cursor++ = DIGITS[byte >> 4];
+        *cursor++ = DIGITS[byte & 0xF];
+        *cursor++ = ' ';
+    }
+    if (repeat != 1) {
+        out += 'x';
+        out += std::to_string(repeat);
+        out += ' ';
+    }
+
+    out += " | ";
+    out += text;
+    out += '\n';
+}
+
+std::vector<AssembledLine> LazyListing::lines(std::span<const uint8_t> binary) const {
+    std::vector<AssembledLine> result;
+    result.reserve(entries.size());
+    for (const auto& entry : entries) {
+        auto code = entryBytes(entry, binary);
+        AssembledLine& line = result.emplace_back();
+        line.source_line = entry.statement->location.line;
+        line.source_text = formatStatement(entry.statement);
+        line.machine_code.assign(code.begin(), code.end());
+        line.repeat = entry.repeat;
+        line.address = entry.address;
+        line.cycles = entry.cycles;
+        line.success = entry.success;
+        if (!entry.success) {
+            line.error_message = error_message;
+        }
+    }
+    return result;
+}
+
+std::string LazyListing::render(std::span<const uint8_t> binary) const {
+    size_t bytes = 0;
+    for (const auto& entry : entries) {
+        bytes += entry.length;
+    }
+
+    std::string out;
+    out.reserve(entries.size() * 40 + bytes * 3);
+    std::string text;
+    for (const auto& entry : entries) {
+        text.clear();
+        appendStatement(text, entry.statement);
+        appendListingLine(out, entry.address, entryBytes(entry, binary), entry.repeat, text);
+    }
+    return out;
+}
+
+} // namespace e2asm
@@ -0,0 +1,81 @@
+/**
+ * @file listing.h
+ * @brief Listing text for statements, deferred listings and the listing renderer
+ *
+ * Building a listing line means formatting the statement back to text and
+ * copying its bytes, which adds up for big programs whose listing nobody
+ * reads. A deferred listing only records where each statement's bytes went
+ * and formats the text when it is actually asked for.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../core/assembler.h"
+#include "../parser/ast.h"
+
+namespace e2asm {
+
+/**
+ * @brief Where one statement's output went
+ *
+ * The statement pointer stays valid because the LazyListing owning the
+ * entry also owns the program.
+ */
+struct ListingEntry {
+    const ASTNode* statement;  ///< Listed statement (a TIMES node for repeated output)
+    uint64_t address;          ///< Address of its first byte
+    size_t offset;             ///< Offset of its bytes in AssemblyResult::binary
+    size_t length;             ///< Bytes of one copy
+    size_t repeat;             ///< Copies that were emitted
+    bool success;              ///< false for the statement that failed to encode
+    uint32_t cycles;           ///< Estimated clocks of one copy (see AssembledLine::cycles)
+};
+
+/**
+ * @brief Listing recorded as entries, rendered on demand (ListingMode::LAZY)
+ */
+struct LazyListing {
+    std::shared_ptr<const Program> program;  ///< Keeps the listed statements alive
+    std::vector<ListingEntry> entries;       ///< In output order
+    std::string error_message;               ///< Message of the failed entry (generation stops at the first)
+
+    /**
+     * @brief Builds the full listing lines
+     * @param binary The result's binary; bytes past its end are left out
+     * @return Same lines ListingMode::FULL would have produced
+     */
+    std::vector<AssembledLine> lines(std::span<const uint8_t> binary) const;
+
+    /**
+     * @brief Renders the listing text directly, without building lines
+     * @param binary The result's binary; bytes past its end are left out
+     */
+    std::string render(std::span<const uint8_t> binary) const;
+};
+
+/**
+ * @brief Formats a statement the way it appears in the listing
+ * @param stmt Statement after code generation (values resolved)
+ * @return Text like "MOV AX, 0x10" or "TIMES 4 DB 0x0"
+ */
+std::string formatStatement(const ASTNode* stmt);
+
+/**
+ * @brief Appends one "address | bytes | source" listing line
+ * @param out Text to append to
+ * @param address Address of the first byte
+ * @param code One copy of the line's machine code
+ * @param repeat Copies in the binary (printed as "xN" unless 1)
+ * @param text Source text
+ */
+void appendListingLine(std::string& out, uint64_t address, std::span<const uint8_t> code,
+                       size_t repeat, std::string_view text);
+
+} // namespace e2asm
@@ -1,21 +1,17 @@
 #include "modrm_generator.h"
 #include "../parser/ast.h"
-#include "../semantic/symbol_table.h"
-#include <algorithm>
 
 namespace e2asm {
 
-const std::unordered_map<std::string, uint8_t> ModRMGenerator::RM_CODES = {
-    {"BX+SI", 0x00},
-    {"BX+DI", 0x01},
-    {"BP+SI", 0x02},
-    {"BP+DI", 0x03},
-    {"SI", 0x04},
-    {"DI", 0x05},
-    {"BP", 0x06},
-    {"BX", 0x07},
-    {"DA", 0x06}  // Direct address (special case)
-};
+namespace {
+
+// 16-bit register codes usable in an effective address
+constexpr uint8_t REG_BX = 3;
+constexpr uint8_t REG_BP = 5;
+constexpr uint8_t REG_SI = 6;
+constexpr uint8_t REG_DI = 7;
+
+} // anonymous namespace
 
 uint8_t ModRMGenerator::generateRegToReg(uint8_t reg_field, uint8_t rm_field) {
     // Register-to-register: MOD = 11b (0x03)
@@ -23,52 +19,43 @@ uint8_t ModRMGenerator::generateRegToReg(uint8_t reg_field, uint8_t rm_field) {
 }
 
 ModRMResult ModRMGenerator::generateMemory(const AddressExpression& addr_expr, uint8_t reg_field,
-                                           const SymbolTable* symbol_table) {
-    // Resolve label if present
-    int64_t total_displacement = addr_expr.displacement;
-    bool has_disp = addr_expr.has_displacement;
-
-    if (addr_expr.has_label) {
-        if (!symbol_table) {
-            return ModRMResult("Symbol table not available for label resolution");
-        }
-        auto symbol = symbol_table->lookup(addr_expr.label_name);
-        if (!symbol || !symbol->is_resolved) {
-            return ModRMResult("Undefined label: " + addr_expr.label_name);
-        }
-        total_displacement += symbol->value;
-        has_disp = true;
-    }
+                                           int64_t symbol_value, bool wide_displacement) {
+    // Symbolic terms always make the displacement present, whatever they add up to
+    int64_t total_displacement = addr_expr.displacement + symbol_value;
+    bool has_disp = addr_expr.has_displacement || addr_expr.hasSymbols();
 
     // Determine R/M code from registers
-    auto rm_code = calculateRM(addr_expr.registers);
+    auto rm_code = calculateRM(addr_expr);
     if (!rm_code) {
         return ModRMResult("Invalid addressing mode combination");
     }
 
     // Special case: Direct address (no registers, just displacement/label)
     // Must use MOD=00, R/M=110, 16-bit displacement
-    if (addr_expr.registers.empty() && (has_disp || addr_expr.has_label)) {
+    if (!addr_expr.hasRegisters() && has_disp) {
         uint8_t modrm = combineModRM(0x00, reg_field, 0x06);
-        std::vector<uint8_t> disp_bytes = encodeDisplacement(total_displacement, 2);
+        InstructionBytes disp_bytes = encodeDisplacement(total_displacement, 2);
         return ModRMResult(modrm, disp_bytes);
     }
 
     // Calculate MOD field based on displacement
     uint8_t mod = calculateMod(total_displacement, has_disp);
+    if (wide_displacement && has_disp) {
+        mod = 0x02;
+    }
 
     // Special case: [BP] without displacement requires MOD=01 with disp8=0
-    if (addr_expr.registers.size() == 1 && addr_expr.registers[0] == "BP" && !has_disp) {
+    if (addr_expr.register_count == 1 && addr_expr.registers[0] == REG_BP && !has_disp) {
         mod = 0x01;  // Force 8-bit displacement
         uint8_t modrm = combineModRM(mod, reg_field, *rm_code);
-        return ModRMResult(modrm, std::vector<uint8_t>{0x00});
+        return ModRMResult(modrm, InstructionBytes{0x00});
     }
 
     // Generate ModRM byte
     uint8_t modrm = combineModRM(mod, reg_field, *rm_code);
 
     // Generate displacement bytes
-    std::vector<uint8_t> disp_bytes;
+    InstructionBytes disp_bytes;
     if (mod == 0x01) {
         // 8-bit displacement
         disp_bytes = encodeDisplacement(total_displacement, 1);
@@ -86,11 +73,26 @@ ModRMResult ModRMGenerator::generateDirect(uint16_t address, uint8_t reg_field)
     uint8_t modrm = combineModRM(0x00, reg_field, 0x06);
 
     // Direct address is always 16-bit
-    std::vector<uint8_t> disp_bytes = encodeDisplacement(address, 2);
+    InstructionBytes disp_bytes = encodeDisplacement(address, 2);
 
     return ModRMResult(modrm, disp_bytes);
 }
 
+uint8_t ModRMGenerator::effectiveAddressClocks(uint8_t modrm) {
+    // Base or index alone is 5, the BP+DI/BX+SI pairs 7, BP+SI/BX+DI 8
+    static constexpr uint8_t RM_CLOCKS[8] = {7, 8, 8, 7, 5, 5, 5, 5};
+    uint8_t mod = modrm >> 6;
+    uint8_t rm = modrm & 0x07;
+    if (mod == 0x03) {
+        return 0;
+    }
+    if (mod == 0x00 && rm == 0x06) {
+        return 6;  // Direct address
+    }
+    // A displacement adds 4
+    return RM_CLOCKS[rm] + (mod == 0x00 ? 0 : 4);
+}
+
 uint8_t ModRMGenerator::calculateMod(int64_t displacement, bool has_displacement) {
     if (!has_displacement) {
         return 0x00;
@@ -104,41 +106,34 @@ uint8_t ModRMGenerator::calculateMod(int64_t displacement, bool has_displacement
     return 0x02;  // 16-bit displacement
 }
 
-std::optional<uint8_t> ModRMGenerator::calculateRM(const std::vector<std::string>& registers) {
-    if (registers.empty()) {
+std::optional<uint8_t> ModRMGenerator::calculateRM(const AddressExpression& addr_expr) {
+    if (addr_expr.register_count == 0) {
         // Direct address
         return 0x06;
     }
 
-    if (registers.size() == 1) {
+    if (addr_expr.register_count == 1) {
         // Single register
-        const std::string& reg = registers[0];
-
-        if (reg == "BX") return RM_CODES.at("BX");
-        if (reg == "SI") return RM_CODES.at("SI");
-        if (reg == "DI") return RM_CODES.at("DI");
-        if (reg == "BP") return RM_CODES.at("BP");
-
-        return std::nullopt;  // Invalid register
+        switch (addr_expr.registers[0]) {
+            case REG_SI: return 0x04;
+            case REG_DI: return 0x05;
+            case REG_BP: return 0x06;
+            case REG_BX: return 0x07;
+            default: return std::nullopt;  // Invalid register
+        }
     }
 
-    if (registers.size() == 2) {
-        // Two registers - check valid combinations
-        bool has_bx = std::find(registers.begin(), registers.end(), "BX") != registers.end();
-        bool has_bp = std::find(registers.begin(), registers.end(), "BP") != registers.end();
-        bool has_si = std::find(registers.begin(), registers.end(), "SI") != registers.end();
-        bool has_di = std::find(registers.begin(), registers.end(), "DI") != registers.end();
+    // Two registers - one base (BX/BP) and one index (SI/DI), in either order
+    uint8_t a = addr_expr.registers[0];
+    uint8_t b = addr_expr.registers[1];
+    auto has = [a, b](uint8_t reg) { return a == reg || b == reg; };
 
-        if (has_bx && has_si) return RM_CODES.at("BX+SI");
-        if (has_bx && has_di) return RM_CODES.at("BX+DI");
-        if (has_bp && has_si) return RM_CODES.at("BP+SI");
-        if (has_bp && has_di) return RM_CODES.at("BP+DI");
+    if (has(REG_BX) && has(REG_SI)) return 0x00;
+    if (has(REG_BX) && has(REG_DI)) return 0x01;
+    if (has(REG_BP) && has(REG_SI)) return 0x02;
+    if (has(REG_BP) && has(REG_DI)) return 0x03;
 
-        return std::nullopt;  // Invalid combination
-    }
-
-    // More than 2 registers - invalid
-    return std::nullopt;
+    return std::nullopt;  // Invalid combination
 }
 
 bool ModRMGenerator::isMod1(int64_t displacement) {
@@ -146,15 +141,9 @@ bool ModRMGenerator::isMod1(int64_t displacement) {
     return (displacement >= -128 && displacement <= 127);
 }
 
-std::vector<uint8_t> ModRMGenerator::encodeDisplacement(int64_t value, size_t size_bytes) {
-    std::vector<uint8_t> bytes;
-
-    // Little-endian encoding
-    for (size_t i = 0; i < size_bytes; i++) {
-        bytes.push_back(static_cast<uint8_t>(value & 0xFF));
-        value >>= 8;
-    }
-
+InstructionBytes ModRMGenerator::encodeDisplacement(int64_t value, size_t size_bytes) {
+    InstructionBytes bytes;
+    bytes.appendLittleEndian(value, size_bytes);
     return bytes;
 }
 
@@ -4,21 +4,21 @@
 #include <vector>
 #include <string>
 #include <optional>
-#include <unordered_map>
 #include "../parser/expression_parser.h"
+#include "instruction_bytes.h"
 
 namespace e2asm {
 
 struct ModRMResult {
     uint8_t modrm_byte;
-    std::vector<uint8_t> displacement;
+    InstructionBytes displacement;
     bool success;
     std::string error;
 
     ModRMResult() : modrm_byte(0), success(false) {}
     ModRMResult(uint8_t modrm) : modrm_byte(modrm), success(true) {}
-    ModRMResult(uint8_t modrm, std::vector<uint8_t> disp)
-        : modrm_byte(modrm), displacement(std::move(disp)), success(true) {}
+    ModRMResult(uint8_t modrm, InstructionBytes disp)
+        : modrm_byte(modrm), displacement(disp), success(true) {}
     ModRMResult(std::string err) : modrm_byte(0), success(false), error(std::move(err)) {}
 };
 
@@ -36,11 +36,12 @@ public:
      * Generate ModRM byte + displacement for memory operand
      * @param addr_expr Parsed address expression
      * @param reg_field REG field (0-7)
-     * @param symbol_table Symbol table for resolving labels (optional)
+     * @param symbol_value Sum of the expression's symbolic terms, already resolved by the caller
+     * @param wide_displacement Always use a 16-bit displacement (one the linker still relocates)
      * @return ModRM byte and displacement bytes
      */
     static ModRMResult generateMemory(const AddressExpression& addr_expr, uint8_t reg_field,
-                                     const class SymbolTable* symbol_table = nullptr);
+                                     int64_t symbol_value = 0, bool wide_displacement = false);
 
     /**
      * Generate ModRM byte + displacement for direct memory address
@@ -50,18 +51,24 @@ public:
      */
     static ModRMResult generateDirect(uint16_t address, uint8_t reg_field);
 
+    /**
+     * 8086 clocks spent computing the effective address of a ModRM byte
+     * @param modrm ModRM byte as generated above
+     * @return 5-12 for memory forms (6 for a direct address), 0 for MOD=11;
+     *         a segment override prefix costs another 2, not included here
+     */
+    static uint8_t effectiveAddressClocks(uint8_t modrm);
+
 private:
     static uint8_t calculateMod(int64_t displacement, bool has_displacement);
 
-    static std::optional<uint8_t> calculateRM(const std::vector<std::string>& registers);
+    static std::optional<uint8_t> calculateRM(const AddressExpression& addr_expr);
 
     static bool isMod1(int64_t displacement);
 
-    static std::vector<uint8_t> encodeDisplacement(int64_t value, size_t size_bytes);
+    static InstructionBytes encodeDisplacement(int64_t value, size_t size_bytes);
 
     static uint8_t combineModRM(uint8_t mod, uint8_t reg, uint8_t rm);
-
-    static const std::unordered_map<std::string, uint8_t> RM_CODES;
 };
 
 } // namespace e2asm
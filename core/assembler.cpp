@@ -1,10 +1,23 @@
 #include "assembler.h"
-#include "../lexer/lexer.h"
+#include "../lexer/token_stream.h"
 #include "../parser/parser.h"
 #include "../codegen/code_generator.h"
+#include "../codegen/listing.h"
 #include "../preprocessor/preprocessor.h"
+#include "mapped_file.h"
+#include "result_cache.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
-#include <sstream>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+
+#ifndef E2ASM_VERSION
+#define E2ASM_VERSION "unknown"
+#endif
 
 namespace e2asm {
 
@@ -21,32 +34,133 @@ public:
     size_t origin = 0;
     std::vector<std::string> include_paths;
     bool warnings_enabled = true;
+    size_t codegen_workers = 1;        ///< See setParallelCodegen()
+    size_t codegen_threshold = 4096;
+    ListingMode listing_mode = ListingMode::FULL;
+    bool stats_enabled = false;        ///< See enableStats()
+    PhaseCallback phase_callback;      ///< See setPhaseCallback()
+    IncludeCache include_cache;  ///< Survives between runs, see clearIncludeCache()
+    std::unique_ptr<ResultCache> result_cache;  ///< See setResultCache()
 
-    AssemblyResult assemble(const std::string& source, const std::string& filename) {
+    AssemblyResult assemble(std::string_view source, const std::string& filename, size_t base,
+                            OutputSink* sink = nullptr, ObjectModule* object = nullptr) {
         AssemblyResult result;
 
-        // Phase 0: Preprocessing
+        // One file table per run; locations carry ids and only diagnostics
+        // that make it back to the caller get their names resolved.
+        FileTable files;
+        FileId file = files.intern(filename);
+
+        // Phases 0-2 run as one stream: the parser pulls tokens, the token
+        // stream pulls lines from the preprocessor. No full copy of the
+        // preprocessed text or token list is ever built.
         Preprocessor preprocessor;
+        preprocessor.setFileTable(&files);
         preprocessor.setIncludePaths(include_paths);
-        auto preprocess_result = preprocessor.process(source, filename);
+        preprocessor.setIncludeCache(&include_cache);
+        preprocessor.begin(source, filename);
 
-        if (!preprocess_result.success) {
-            result.errors = preprocess_result.errors;
-            result.success = false;
-            return result;
+        // Statistics are only gathered on request; without them the stream
+        // runs exactly as before and no clock is read
+        std::optional<AssemblyStats> stats;
+        if (stats_enabled || phase_callback) {
+            stats.emplace();
         }
 
-        // Phase 1: Lexical analysis
-        Lexer lexer(preprocess_result.source, filename);
-        std::vector<Token> tokens = lexer.tokenize();
+        // With a result cache the key needs the whole preprocessed text, so
+        // the preprocessor runs to the end first and the lines are replayed
+        std::optional<ResultCache::Key> cache_key;
+        std::vector<std::string> preprocessed;
+        bool replay = result_cache && !sink && !object && listing_mode != ListingMode::LAZY;
+        if (replay) {
+            auto start = stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+            ResultCache::KeyBuilder key;
+            key.add(E2ASM_VERSION);
+            key.add(filename);
+            key.add(static_cast<uint64_t>(base));
+            key.add(static_cast<uint64_t>(listing_mode));
+            while (auto line = preprocessor.nextLine()) {
+                key.add(*line);
+                preprocessed.emplace_back(*line);
+            }
+            if (stats) {
+                stats->preprocess_time = std::chrono::steady_clock::now() - start;
+            }
+
+            if (preprocessor.errors().empty()) {
+                cache_key = key.finish();
+                if (result_cache->load(*cache_key, result)) {
+                    if (stats) {
+                        stats->from_cache = true;
+                        stats->symbols = result.symbols.size();
+                        stats->passes = result.passes;
+                        stats->bytes_emitted = result.binary.size();
+                        stats->listing_entries = result.listing.size();
+                        stats->define_expansions = preprocessor.expansionCount();
+                        stats->macro_expansions = preprocessor.macroExpansionCount();
+                        result.stats = std::move(stats);
+                    }
+                    return result;
+                }
+            }
+        }
+        size_t next_replayed = 0;
 
-        // Phase 2: Parsing
-        Parser parser(std::move(tokens));
+        TokenStream tokens([&preprocessor, &stats, &preprocessed, &next_replayed, replay]()
+                               -> std::optional<std::string_view> {
+            if (replay) {
+                if (next_replayed == preprocessed.size()) {
+                    return std::nullopt;
+                }
+                return preprocessed[next_replayed++];
+            }
+            if (!stats) {
+                return preprocessor.nextLine();
+            }
+            auto start = std::chrono::steady_clock::now();
+            auto line = preprocessor.nextLine();
+            stats->preprocess_time += std::chrono::steady_clock::now() - start;
+            return line;
+        }, file);
+        tokens.setTiming(stats.has_value());
+
+        auto front_end_start = stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+        Parser parser(tokens);
         auto ast = parser.parse();
 
+        if (stats) {
+            auto front_end_time = std::chrono::steady_clock::now() - front_end_start;
+            stats->lex_time = tokens.lexTime();
+            stats->parse_time = std::chrono::duration_cast<std::chrono::nanoseconds>(front_end_time) -
+                                (replay ? std::chrono::nanoseconds(0) : stats->preprocess_time) - stats->lex_time;
+            stats->tokens = tokens.tokenCount();
+            stats->define_expansions = preprocessor.expansionCount();
+            stats->macro_expansions = preprocessor.macroExpansionCount();
+            stats->peak_buffered_lines = tokens.peakBufferedLines();
+            if (ast) {
+                stats->statements = ast->statements.size();
+                stats->ast_bytes = ast->arena.bytesUsed();
+            }
+            if (phase_callback) {
+                phase_callback(AssemblyPhase::PREPROCESS, *stats);
+                phase_callback(AssemblyPhase::LEX, *stats);
+                phase_callback(AssemblyPhase::PARSE, *stats);
+            }
+        }
+
+        if (!preprocessor.errors().empty()) {
+            result.errors = preprocessor.errors();
+            resolveFileNames(result.errors, files);
+            result.success = false;
+            result.stats = std::move(stats);
+            return result;
+        }
+
         if (parser.hasErrors()) {
             result.errors = parser.errors();
+            resolveFileNames(result.errors, files);
             result.success = false;
+            result.stats = std::move(stats);
             return result;
         }
 
@@ -56,12 +170,93 @@ public:
 
         // Phase 4: Code generation
         CodeGenerator generator;
-        result = generator.generate(ast.get());
+        generator.setOrigin(base);
+        generator.setParallelEncoding(codegen_workers, codegen_threshold);
+        generator.setOutputSink(sink);
+        generator.setStats(stats ? &*stats : nullptr, phase_callback ? &phase_callback : nullptr);
+        auto generate = [&generator, object](const Program* program) {
+            return object ? generator.generateObject(program, *object) : generator.generate(program);
+        };
+        if (listing_mode == ListingMode::LAZY) {
+            // The result renders from the tree later, so it shares ownership
+            std::shared_ptr<const Program> program = std::move(ast);
+            generator.setListingMode(listing_mode, program);
+            result = generate(program.get());
+        } else {
+            generator.setListingMode(listing_mode);
+            result = generate(ast.get());
+        }
+        resolveFileNames(result.errors, files);
+        result.stats = std::move(stats);
 
+        if (cache_key && result.success) {
+            result_cache->store(*cache_key, result);
+        }
         return result;
     }
+
+    ObjectModule assembleObject(const std::string& source, const std::string& filename) {
+        ObjectModule module;
+        module.name = filename;
+        AssemblyResult result = assemble(source, filename, 0, nullptr, &module);
+        module.errors = std::move(result.errors);
+        module.success = result.success;
+        if (!module.success) {
+            // Half-built segments are no use to the linker
+            module.segments.clear();
+            module.relocations.clear();
+            module.exports.clear();
+        }
+        return module;
+    }
 };
 
+namespace {
+
+// Runs work(i) for every job on up to workers threads. Workers pull the next
+// job from a shared queue ordered by source size, biggest first; whoever
+// finishes early picks up the small ones left at the tail, which evens out
+// very uneven batches.
+template <typename Work>
+void forEachJob(const std::vector<AssemblyJob>& jobs, size_t workers, Work work) {
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    workers = std::min(workers, jobs.size());
+
+    if (workers <= 1) {
+        for (size_t i = 0; i < jobs.size(); i++) {
+            work(i);
+        }
+        return;
+    }
+
+    std::vector<size_t> order(jobs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&jobs](size_t a, size_t b) {
+        return jobs[a].source.size() > jobs[b].source.size();
+    });
+
+    std::atomic<size_t> next{0};
+    auto run = [&] {
+        for (size_t i = next++; i < order.size(); i = next++) {
+            work(order[i]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(workers - 1);
+    for (size_t i = 1; i < workers; i++) {
+        pool.emplace_back(run);
+    }
+    run();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+} // namespace
+
 Assembler::Assembler()
     : m_impl(std::make_unique<Impl>())
 {
@@ -70,22 +265,49 @@ Assembler::Assembler()
 Assembler::~Assembler() = default;
 
 AssemblyResult Assembler::assemble(const std::string& source, const std::string& filename) {
-    return m_impl->assemble(source, filename);
+    return m_impl->assemble(source, filename, m_impl->origin);
+}
+
+AssemblyResult Assembler::assemble(const std::string& source, OutputSink& sink, const std::string& filename) {
+    return m_impl->assemble(source, filename, m_impl->origin, &sink);
 }
 
 AssemblyResult Assembler::assembleFile(const std::string& filepath) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
+    // The pipeline reads straight out of the mapping; nothing it returns
+    // points into the source, so it can go away with this call
+    MappedFile file;
+    if (!file.open(filepath)) {
         AssemblyResult result;
         result.success = false;
-        result.errors.push_back(Error("Could not open file: " + filepath,
-                                     SourceLocation(filepath, 0, 0)));
+        Error error("Could not open file: " + filepath, SourceLocation(FileTable::INPUT, 0, 0));
+        error.filename = filepath;
+        result.errors.push_back(std::move(error));
         return result;
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return assemble(buffer.str(), filepath);
+    return m_impl->assemble(file.view(), filepath, m_impl->origin);
+}
+
+std::vector<AssemblyResult> Assembler::assembleBatch(const std::vector<AssemblyJob>& jobs,
+                                                     size_t workers) {
+    std::vector<AssemblyResult> results(jobs.size());
+    forEachJob(jobs, workers, [&](size_t i) {
+        results[i] = m_impl->assemble(jobs[i].source, jobs[i].filename, jobs[i].origin);
+    });
+    return results;
+}
+
+ObjectModule Assembler::assembleObject(const std::string& source, const std::string& filename) {
+    return m_impl->assembleObject(source, filename);
+}
+
+std::vector<ObjectModule> Assembler::assembleObjects(const std::vector<AssemblyJob>& jobs,
+                                                     size_t workers) {
+    std::vector<ObjectModule> modules(jobs.size());
+    forEachJob(jobs, workers, [&](size_t i) {
+        modules[i] = m_impl->assembleObject(jobs[i].source, jobs[i].filename);
+    });
+    return modules;
 }
 
 void Assembler::setOrigin(size_t origin) {
@@ -100,25 +322,60 @@ void Assembler::enableWarnings(bool enable) {
     m_impl->warnings_enabled = enable;
 }
 
+void Assembler::setParallelCodegen(size_t workers, size_t min_statements) {
+    m_impl->codegen_workers = workers;
+    m_impl->codegen_threshold = min_statements;
+}
+
+void Assembler::setListingMode(ListingMode mode) {
+    m_impl->listing_mode = mode;
+}
+
+void Assembler::enableStats(bool enable) {
+    m_impl->stats_enabled = enable;
+}
+
+void Assembler::setPhaseCallback(PhaseCallback callback) {
+    m_impl->phase_callback = std::move(callback);
+}
+
+void Assembler::clearIncludeCache() {
+    m_impl->include_cache.clear();
+}
+
+void Assembler::setResultCache(const std::string& directory, uint64_t max_bytes) {
+    if (directory.empty()) {
+        m_impl->result_cache.reset();
+    } else {
+        m_impl->result_cache = std::make_unique<ResultCache>(directory, max_bytes);
+    }
+}
+
+ResultCacheStats Assembler::resultCacheStats() const {
+    return m_impl->result_cache ? m_impl->result_cache->stats() : ResultCacheStats{};
+}
+
 std::string AssemblyResult::getListingText() const {
-    std::string listing;
-    for (const auto& line : this->listing) {
-        // Format: address | machine code | source
-        char addr_buf[16];
-        snprintf(addr_buf, sizeof(addr_buf), "%04zX", line.address);
-        listing += addr_buf;
-        listing += " | ";
-
-        // Machine code bytes
-        for (uint8_t byte : line.machine_code) {
-            char byte_buf[4];
-            snprintf(byte_buf, sizeof(byte_buf), "%02X ", byte);
-            listing += byte_buf;
-        }
+    if (lazy_listing) {
+        return lazy_listing->render(binary);
+    }
+
+    size_t bytes = 0;
+    for (const auto& line : listing) {
+        bytes += line.machine_code.size();
+    }
 
-        listing += " | ";
-        listing += line.source_text;
-        listing += "\n";
+    std::string text;
+    text.reserve(listing.size() * 40 + bytes * 3);
+    for (const auto& line : listing) {
+        appendListingLine(text, line.address, line.machine_code, line.repeat, line.source_text);
+    }
+    return text;
+}
+
+std::vector<AssembledLine> AssemblyResult::getListing() const {
+    if (lazy_listing) {
+        return lazy_listing->lines(binary);
     }
     return listing;
 }
@@ -129,8 +386,76 @@ bool AssemblyResult::writeBinary(const std::string& filename) const {
         return false;
     }
 
-    file.write(reinterpret_cast<const char*>(binary.data()), binary.size());
+    StreamSink sink(file);
+    return sink.write(binary);
+}
+
+bool AssemblyResult::writeMapFile(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    std::string text = symbol_index.mapFile();
+    file.write(text.data(), static_cast<std::streamsize>(text.size()));
     return file.good();
 }
 
+std::vector<LabelCost> AssemblyResult::getCycleReport() const {
+    std::vector<AssembledLine> rendered;
+    if (lazy_listing) {
+        rendered = lazy_listing->lines(binary);
+    }
+    const std::vector<AssembledLine>& lines = lazy_listing ? rendered : listing;
+
+    std::vector<LabelCost> report;
+    std::unordered_map<const SymbolIndex::Entry*, size_t> slots;
+    for (const auto& line : lines) {
+        if (line.machine_code.empty()) {
+            continue;
+        }
+        const SymbolIndex::Entry* entry = symbol_index.symbolAt(line.address);
+        auto [slot, inserted] = slots.try_emplace(entry, report.size());
+        if (inserted) {
+            LabelCost& cost = report.emplace_back();
+            cost.label = entry ? entry->name : std::string();
+            cost.address = entry ? entry->address : line.address;
+        }
+        LabelCost& cost = report[slot->second];
+        cost.bytes += line.machine_code.size() * line.repeat;
+        cost.cycles += static_cast<uint64_t>(line.cycles) * line.repeat;
+        if (line.cycles != 0) {
+            cost.instructions += line.repeat;
+        }
+    }
+    return report;
+}
+
+namespace {
+
+void appendColumn(std::string& out, std::string_view value, size_t width) {
+    out += value;
+    out.append(value.size() < width ? width - value.size() : 1, ' ');
+}
+
+} // namespace
+
+std::string AssemblyResult::getCycleReportText() const {
+    std::vector<LabelCost> report = getCycleReport();
+
+    std::string text = "Address   Bytes     Cycles    Instr     Label\n";
+    text.reserve(text.size() + report.size() * 56);
+    char address[16];
+    for (const LabelCost& cost : report) {
+        std::snprintf(address, sizeof(address), "%08llX", static_cast<unsigned long long>(cost.address));
+        appendColumn(text, address, 10);
+        appendColumn(text, std::to_string(cost.bytes), 10);
+        appendColumn(text, std::to_string(cost.cycles), 10);
+        appendColumn(text, std::to_string(cost.instructions), 10);
+        text += cost.label.empty() ? "-" : cost.label;
+        text += '\n';
+    }
+    return text;
+}
+
 } // namespace e2asm
@@ -12,9 +12,15 @@
 #include <string>
 #include <vector>
 #include <cstdint>
+#include <chrono>
+#include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include "error.h"
+#include "object_module.h"
+#include "output_sink.h"
+#include "symbol_index.h"
 
 namespace e2asm {
 
@@ -24,17 +30,108 @@ namespace e2asm {
  * Each line tracks the original source, generated machine code, and its
  * final address in the binary. Used for generating detailed assembly listings
  * that show the correspondence between source and output.
+ *
+ * Repeating directives (TIMES, RESx) get a single line: machine_code holds
+ * one copy of the pattern and repeat says how many copies the binary has.
+ *
+ * cycles comes from the clock counts in the encoding table plus the
+ * effective-address cost of memory operands. It is an estimate for tuning:
+ * branches count as taken, string instructions once per execution, and
+ * 8088 bus and odd-address penalties are left out.
  */
 struct AssembledLine {
     size_t source_line;                   ///< Line number in the original source file
     std::string source_text;              ///< Original assembly text before processing
-    std::vector<uint8_t> machine_code;    ///< Generated 8086 machine code bytes
+    std::vector<uint8_t> machine_code;    ///< Generated 8086 machine code bytes (one copy if repeated)
+    size_t repeat;                        ///< Consecutive copies of machine_code in the binary
     size_t address;                       ///< Memory address where this instruction is placed
+    uint32_t cycles;                      ///< Estimated 8086 clocks of one copy (0 for non-instructions)
     bool success;                         ///< Whether this line assembled without errors
     std::string error_message;            ///< Error description if assembly failed
 
     AssembledLine()
-        : source_line(0), address(0), success(false) {}
+        : source_line(0), repeat(1), address(0), cycles(0), success(false) {}
+};
+
+struct LazyListing;
+
+/**
+ * @brief Stages of the assembly pipeline, as reported to a PhaseCallback
+ */
+enum class AssemblyPhase {
+    PREPROCESS,  ///< %define/%include/%if handling
+    LEX,         ///< Tokenizing preprocessed lines
+    PARSE,       ///< Building the AST
+    SEMANTIC,    ///< Symbol resolution and address layout
+    CODEGEN      ///< Instruction encoding and output
+};
+
+/**
+ * @brief Where an assembly spent its time and how much it produced
+ *
+ * Preprocessing, lexing and parsing run interleaved as one stream, so their
+ * times are summed over many short calls; parse_time is what is left of the
+ * front end's wall time after the other two.
+ */
+struct AssemblyStats {
+    std::chrono::nanoseconds preprocess_time{0};  ///< Producing preprocessed lines
+    std::chrono::nanoseconds lex_time{0};         ///< Tokenizing them
+    std::chrono::nanoseconds parse_time{0};       ///< Building the AST
+    std::chrono::nanoseconds semantic_time{0};    ///< Layout and symbol resolution
+    std::chrono::nanoseconds codegen_time{0};     ///< Encoding and output
+
+    size_t tokens = 0;             ///< Tokens the parser consumed (newlines excluded)
+    size_t statements = 0;         ///< Top-level AST statements
+    size_t symbols = 0;            ///< Entries in the symbol table
+    size_t define_expansions = 0;  ///< %define substitutions, nested ones included
+    size_t macro_expansions = 0;   ///< %macro calls expanded, nested ones included
+    size_t passes = 0;             ///< Layout passes until addresses settled
+    size_t bytes_emitted = 0;      ///< Size of the binary (also when streamed to a sink)
+
+    size_t peak_buffered_lines = 0;  ///< Most source lines the token stream held at once
+    size_t ast_bytes = 0;            ///< Arena memory used by the AST
+    size_t listing_entries = 0;      ///< Listing lines recorded (FULL or LAZY)
+
+    bool from_cache = false;  ///< Result was read from the result cache; only preprocess_time is timed
+};
+
+/**
+ * @brief Counters of the on-disk result cache (see Assembler::setResultCache)
+ */
+struct ResultCacheStats {
+    size_t hits = 0;       ///< Assemblies answered from the cache
+    size_t misses = 0;     ///< Lookups that found no usable entry
+    size_t stores = 0;     ///< Results written to the cache
+    size_t evictions = 0;  ///< Entries deleted to stay under the size limit
+    uint64_t bytes = 0;    ///< Approximate size of the cache directory
+};
+
+/**
+ * @brief Called when a pipeline phase has finished
+ *
+ * Receives the phase and the statistics gathered so far. PREPROCESS, LEX
+ * and PARSE are reported together once the streamed front end is done.
+ */
+using PhaseCallback = std::function<void(AssemblyPhase phase, const AssemblyStats& stats)>;
+
+/**
+ * @brief How much listing information an assembly produces
+ */
+enum class ListingMode {
+    FULL,  ///< AssemblyResult::listing holds one AssembledLine per statement (default)
+    LAZY,  ///< Only offsets are recorded; text is rendered by getListingText()/getListing()
+    NONE   ///< No listing at all
+};
+
+/**
+ * @brief Size and estimated cost of the code under one label (see AssemblyResult::getCycleReport())
+ */
+struct LabelCost {
+    std::string label;        ///< Qualified label name, empty for code before the first label
+    uint64_t address = 0;     ///< Where the label's range starts
+    uint64_t bytes = 0;       ///< Bytes emitted in the range, data and TIMES copies included
+    uint64_t cycles = 0;      ///< Sum of AssembledLine::cycles over every copy
+    size_t instructions = 0;  ///< Instructions in the range, TIMES copies included
 };
 
 /**
@@ -43,16 +140,28 @@ struct AssembledLine {
  * Contains everything produced by the assembler: the final binary, a detailed
  * listing showing each line's encoding, resolved symbol addresses, and any
  * errors or warnings encountered during assembly.
+ *
+ * When the binary was sent to an OutputSink, binary is left empty.
  */
 struct AssemblyResult {
     std::vector<uint8_t> binary;          ///< Final 8086 machine code ready for execution
     std::vector<AssembledLine> listing;   ///< Detailed line-by-line assembly output
     std::map<std::string, size_t> symbols; ///< Resolved symbols (labels -> addresses)
+    SymbolIndex symbol_index;             ///< The same labels sorted by address (see symbolAt())
     std::vector<Error> errors;            ///< All errors and warnings from assembly
     bool success;                         ///< True only if assembly completed without errors
     uint64_t origin_address;              ///< Base address specified by ORG directive (default: 0)
+    size_t passes;                        ///< Layout passes semantic analysis took to converge
+    std::shared_ptr<const LazyListing> lazy_listing; ///< Deferred listing (ListingMode::LAZY only)
+    std::optional<AssemblyStats> stats;   ///< Filled when statistics are enabled (see Assembler::enableStats)
 
-    AssemblyResult() : success(false), origin_address(0) {}
+    AssemblyResult() : success(false), origin_address(0), passes(0) {}
+
+    // Move-only: the binary and listing can be megabytes, copies must be explicit
+    AssemblyResult(AssemblyResult&&) = default;
+    AssemblyResult& operator=(AssemblyResult&&) = default;
+    AssemblyResult(const AssemblyResult&) = delete;
+    AssemblyResult& operator=(const AssemblyResult&) = delete;
 
     /**
      * @brief Formats the assembly listing as human-readable text
@@ -60,12 +169,54 @@ struct AssemblyResult {
      */
     std::string getListingText() const;
 
+    /**
+     * @brief Gets the listing lines, rendering a lazy listing if needed
+     * @return listing itself, or lines built from lazy_listing
+     */
+    std::vector<AssembledLine> getListing() const;
+
     /**
      * @brief Writes the assembled binary to a file
      * @param filename Path to the output file (typically .bin or .com)
      * @return true if file was written successfully, false on I/O error
+     *
+     * The image is already in binary by now. To write a large image without
+     * holding it in memory, assemble into a StreamSink over the file instead.
      */
     bool writeBinary(const std::string& filename) const;
+
+    /**
+     * @brief Writes symbol_index as a map file (see SymbolIndex::mapFile())
+     * @param filename Path to the output file (typically .map)
+     * @return true if file was written successfully, false on I/O error
+     */
+    bool writeMapFile(const std::string& filename) const;
+
+    /**
+     * @brief Sums the listing's bytes and estimated cycles per label range
+     * @return One entry per range that emitted anything, in listing order
+     *         (empty without a listing)
+     *
+     * Ranges are those of symbol_index; labels sharing an address are
+     * reported under the first one, as symbolAt() does. A loop body's
+     * cycles are one pass through it with every branch taken.
+     */
+    std::vector<LabelCost> getCycleReport() const;
+
+    /**
+     * @brief Formats getCycleReport() as a table
+     * @return "Address  Bytes  Cycles  Instr  Label" columns, one range per line
+     */
+    std::string getCycleReportText() const;
+};
+
+/**
+ * @brief One independent unit of work for Assembler::assembleBatch()
+ */
+struct AssemblyJob {
+    std::string source;                   ///< Complete assembly source
+    std::string filename = "<input>";     ///< Name used in diagnostics
+    size_t origin = 0;                    ///< Base address, as for Assembler::setOrigin()
 };
 
 /**
@@ -78,6 +229,15 @@ struct AssemblyResult {
  * The assembler is designed to be embedded into larger systems like IDEs, emulators,
  * or educational tools. Multiple Assembler instances can coexist independently.
  *
+ * Thread safety: the reserved-word hash and the instruction encoding tables
+ * are constant data built at compile time, and every run builds its own
+ * preprocessor, parser, symbol table and
+ * code generator. assemble(), assembleFile(), assembleBatch() and the
+ * assembleObject() family may therefore be called concurrently on the same
+ * instance; they share only the include cache and the result cache, which
+ * are internally locked (clearIncludeCache() is safe at any time). The
+ * other setters must not race with a running assembly.
+ *
  * @code
  * e2asm::Assembler asm;
  * asm.setOrigin(0x7C00);  // Boot sector address
@@ -112,17 +272,77 @@ public:
     AssemblyResult assemble(const std::string& source,
                            const std::string& filename = "<input>");
 
+    /**
+     * @brief Assembles source code, streaming the binary into a sink
+     *
+     * Same as assemble(), except that machine code is handed to @p sink in
+     * blocks while it is generated and the result's binary stays empty.
+     *
+     * @param source The complete assembly source code as a string
+     * @param sink Receives the image in order (see OutputSink)
+     * @param filename Filename to display in error messages
+     * @return AssemblyResult with listing, symbols and errors, but no binary
+     */
+    AssemblyResult assemble(const std::string& source, OutputSink& sink,
+                           const std::string& filename = "<input>");
+
     /**
      * @brief Assembles 8086 code from a file on disk
      *
-     * Convenience method that reads the file and calls assemble(). The filename
-     * is automatically used for error reporting.
+     * Same as assemble() on the file's contents, which are memory-mapped
+     * (read into one buffer where mmap isn't available) and preprocessed in
+     * place without a copy. The filename is automatically used for error
+     * reporting.
      *
      * @param filepath Path to the assembly source file
      * @return AssemblyResult containing binary, listing, symbols, and any errors
      */
     AssemblyResult assembleFile(const std::string& filepath);
 
+    /**
+     * @brief Assembles many independent programs on a pool of worker threads
+     *
+     * Each job runs through its own pipeline with its own origin; include
+     * paths, warnings and the include cache come from this assembler and are
+     * shared. Workers pull the next job from a shared queue ordered largest
+     * source first, so a few big programs don't leave the other threads idle
+     * at the end of the batch.
+     *
+     * @param jobs Programs to assemble
+     * @param workers Number of threads; 0 uses std::thread::hardware_concurrency()
+     * @return One result per job, in the same order as @p jobs
+     */
+    std::vector<AssemblyResult> assembleBatch(const std::vector<AssemblyJob>& jobs,
+                                              size_t workers = 0);
+
+    /**
+     * @brief Assembles a source into a relocatable object module
+     *
+     * Instead of a flat binary the source becomes segments plus relocations
+     * (see ObjectModule), ready to be combined with other modules by a
+     * Linker. GLOBAL exports labels and EXTERN imports them; other modules
+     * are not needed until the link. The origin set with setOrigin() does
+     * not apply and ORG is rejected, the linker decides where code goes.
+     *
+     * @param source The complete assembly source code as a string
+     * @param filename Filename for error messages, also the module's name
+     * @return The module; check success and errors before linking it
+     */
+    ObjectModule assembleObject(const std::string& source,
+                                const std::string& filename = "<input>");
+
+    /**
+     * @brief Assembles many sources into object modules on worker threads
+     *
+     * Same scheduling as assembleBatch(); each job's origin is ignored.
+     *
+     * @param jobs Sources to assemble
+     * @param workers Number of threads; 0 uses std::thread::hardware_concurrency()
+     * @return One module per job, in the same order as @p jobs
+     */
+    std::vector<ObjectModule> assembleObjects(const std::vector<AssemblyJob>& jobs,
+                                              size_t workers = 0);
+
     /**
      * @brief Sets the base memory address for the assembled code
      *
@@ -155,6 +375,84 @@ public:
      */
     void enableWarnings(bool enable);
 
+    /**
+     * @brief Encodes large programs on several threads (off by default)
+     *
+     * Addresses are always assigned on one thread; only the final encoding
+     * is split into contiguous chunks of statements that are encoded
+     * concurrently and then joined. Results are byte-for-byte the same as
+     * with a single thread, so this only pays off for big inputs.
+     *
+     * @param workers Threads to use; 0 or 1 turns parallel encoding off
+     * @param min_statements Programs with fewer statements stay single-threaded
+     */
+    void setParallelCodegen(size_t workers, size_t min_statements = 4096);
+
+    /**
+     * @brief Chooses how much listing information is produced
+     *
+     * Most builds never read the listing; NONE skips it and LAZY only
+     * records where each statement's bytes are, keeping the parsed program
+     * alive in the result so getListingText() can render it on demand.
+     *
+     * @param mode ListingMode::FULL (default), LAZY or NONE
+     */
+    void setListingMode(ListingMode mode);
+
+    /**
+     * @brief Collects per-phase timings and counts into AssemblyResult::stats
+     *
+     * Off by default; while off no clocks are read and stats stays empty.
+     *
+     * @param enable true to fill AssemblyResult::stats
+     */
+    void enableStats(bool enable);
+
+    /**
+     * @brief Installs a hook that runs at every phase boundary
+     *
+     * Useful to forward timings to a tracing system. Installing a callback
+     * turns statistics collection on; pass an empty function to remove it.
+     * With assembleBatch() the callback is called from worker threads.
+     *
+     * @param callback Called with each finished phase and the stats so far
+     */
+    void setPhaseCallback(PhaseCallback callback);
+
+    /**
+     * @brief Drops cached %include files
+     *
+     * Included files are cached across assemble() calls: search results,
+     * contents (re-read when the file's modification time changes), and
+     * include guards, so a guarded header is only read once per assembler.
+     * Call this if files were replaced in a way the timestamp doesn't show.
+     */
+    void clearIncludeCache();
+
+    /**
+     * @brief Keeps successful results in a directory and reuses them
+     *
+     * The key hashes the fully preprocessed source (so the contents of every
+     * included file), the filename, the origin, the listing mode and the
+     * assembler version. On a hit only the preprocessor runs; lexing,
+     * parsing, layout and encoding are skipped and the stored binary,
+     * symbols, warnings and listing are returned. The preprocessed text is
+     * held in memory while the key is computed.
+     *
+     * Results streamed to an OutputSink, object modules and LAZY listings
+     * bypass the cache. Failed assemblies are never stored.
+     *
+     * @param directory Cache directory, created if missing; empty turns the cache off
+     * @param max_bytes Least recently used entries are deleted beyond this size
+     */
+    void setResultCache(const std::string& directory, uint64_t max_bytes = 256ull << 20);
+
+    /**
+     * @brief Hit, miss, store and eviction counts of the result cache
+     * @return Counters since setResultCache(), all zero when there is no cache
+     */
+    ResultCacheStats resultCacheStats() const;
+
 private:
     class Impl;
     std::unique_ptr<Impl> m_impl;  ///< PIMPL pattern hides implementation details
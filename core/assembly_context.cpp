@@ -0,0 +1,89 @@
+#include "assembly_context.h"
+#include "../codegen/instruction_encoder.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../semantic/semantic_analyzer.h"
+
+namespace e2asm {
+
+class AssemblyContext::Impl {
+public:
+    SymbolTable symbols;                 ///< See setSymbols()
+    AstArena arena;                      ///< Reset, not freed, between lines
+    std::vector<ASTNode*> statements;    ///< Keeps its capacity between lines
+    std::vector<Token> tokens;           ///< Handed to the parser and taken back
+    InstructionEncoder encoder;
+
+    AssembledInstruction assemble(std::string_view text, uint64_t address, const SymbolTable& table) {
+        AssembledInstruction result;
+        arena.reset();
+        statements.clear();
+
+        tokens.clear();
+        Lexer lexer(text);
+        Token token;
+        while (lexer.next(token)) {
+            tokens.push_back(token);
+        }
+        tokens.emplace_back(TokenType::END_OF_FILE, "", lexer.location());
+
+        Parser parser(std::move(tokens));
+        parser.parseInto(arena, statements);
+        tokens = parser.releaseTokens();
+        if (parser.hasErrors()) {
+            result.errors = parser.errors();
+            return result;
+        }
+
+        auto* instr = statements.size() == 1 ? ast_cast<Instruction>(statements[0]) : nullptr;
+        if (!instr) {
+            SourceLocation where = statements.empty() ? SourceLocation() : statements[0]->location;
+            result.errors.emplace_back("Expected a single instruction", where);
+            return result;
+        }
+
+        SemanticAnalyzer::prepareInstruction(instr, table);
+        instr->assigned_address = address;
+
+        encoder.setSymbolTable(&table);
+        encoder.setCurrentAddress(address);
+        EncodedInstruction encoded = encoder.encode(instr);
+        if (!encoded.success) {
+            result.errors.emplace_back(std::move(encoded.error), instr->location);
+            return result;
+        }
+
+        result.bytes = encoded.bytes;
+        result.success = true;
+        return result;
+    }
+};
+
+AssemblyContext::AssemblyContext()
+    : m_impl(std::make_unique<Impl>())
+{
+}
+
+AssemblyContext::~AssemblyContext() = default;
+
+void AssemblyContext::setSymbols(const std::map<std::string, size_t>& symbols) {
+    m_impl->symbols.clear();
+    for (const auto& [name, address] : symbols) {
+        m_impl->symbols.define(name, SymbolType::LABEL, static_cast<int64_t>(address), 0);
+    }
+}
+
+SymbolTable& AssemblyContext::symbols() {
+    return m_impl->symbols;
+}
+
+AssembledInstruction AssemblyContext::assembleInstruction(std::string_view text, uint64_t address) {
+    return m_impl->assemble(text, address, m_impl->symbols);
+}
+
+AssembledInstruction AssemblyContext::assembleInstruction(std::string_view text, uint64_t address,
+                                                          const SymbolTable& symbols) {
+    return m_impl->assemble(text, address, symbols);
+}
+
+} // namespace e2asm
@@ -0,0 +1,102 @@
+/**
+ * @file assembly_context.h
+ * @brief Reusable state for assembling one instruction at a time
+ *
+ * Debuggers and emulators assemble a single line the user typed at the
+ * current CS:IP, over and over. Going through Assembler::assemble() for that
+ * builds and throws away a preprocessor, symbol table, analyzer and code
+ * generator every time. An AssemblyContext keeps what can be kept between
+ * calls and takes the shortest path from text to bytes.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "error.h"
+#include "../codegen/instruction_bytes.h"
+
+namespace e2asm {
+
+class SymbolTable;
+
+/**
+ * @brief Result of AssemblyContext::assembleInstruction()
+ *
+ * The bytes are stored inline; a successful call allocates nothing for the
+ * result.
+ */
+struct AssembledInstruction {
+    InstructionBytes bytes;     ///< Machine code (if successful)
+    std::vector<Error> errors;  ///< Why the line didn't assemble
+    bool success = false;       ///< True if bytes holds the instruction
+};
+
+/**
+ * @brief Long-lived buffers for single-instruction assembly
+ *
+ * assembleInstruction() lexes the line, parses it into an AST arena that is
+ * reset rather than freed between calls, prepares the instruction the way
+ * semantic analysis would and encodes it. There is no preprocessor, layout
+ * pass or segment handling: the text must be exactly one instruction, and
+ * labels in it are looked up in a symbol table that is already complete.
+ *
+ * A context is not thread-safe; give each thread its own.
+ *
+ * @code
+ * e2asm::AssemblyContext context;
+ * context.setSymbols(program.symbols);  // e.g. from a previous AssemblyResult
+ * auto line = context.assembleInstruction("MOV AX, [BX+SI+4]", cs_ip);
+ * if (line.success) {
+ *     memory.write(cs_ip, line.bytes.data(), line.bytes.size());
+ * }
+ * @endcode
+ */
+class AssemblyContext {
+public:
+    AssemblyContext();
+    ~AssemblyContext();
+
+    AssemblyContext(const AssemblyContext&) = delete;
+    AssemblyContext& operator=(const AssemblyContext&) = delete;
+
+    /**
+     * @brief Replaces the context's own symbols
+     * @param symbols Label addresses, as in AssemblyResult::symbols
+     */
+    void setSymbols(const std::map<std::string, size_t>& symbols);
+
+    /**
+     * @brief The context's own symbol table, for adding constants or labels directly
+     * @return Table used by the two-argument assembleInstruction()
+     */
+    SymbolTable& symbols();
+
+    /**
+     * @brief Assembles one instruction against the context's symbols
+     * @param text A single instruction, e.g. "JNZ retry" (a trailing comment is fine)
+     * @param address Address the instruction will be placed at (for relative jumps)
+     * @return Encoded bytes or errors
+     */
+    AssembledInstruction assembleInstruction(std::string_view text, uint64_t address);
+
+    /**
+     * @brief Assembles one instruction against an existing symbol table
+     * @param text A single instruction
+     * @param address Address the instruction will be placed at
+     * @param symbols Table to resolve labels and EQU constants in (kept by the caller)
+     * @return Encoded bytes or errors
+     */
+    AssembledInstruction assembleInstruction(std::string_view text, uint64_t address,
+                                             const SymbolTable& symbols);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;  ///< Keeps the symbol table and parser types out of this header
+};
+
+} // namespace e2asm
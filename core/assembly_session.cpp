@@ -0,0 +1,268 @@
+#include "assembly_session.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../codegen/code_generator.h"
+
+namespace e2asm {
+
+namespace {
+
+constexpr std::string_view WHITESPACE = " \t\n\v\f\r";
+
+// Same trimming the preprocessor applies, so columns match the full pipeline
+std::string_view trimLine(std::string_view line) {
+    size_t first = line.find_first_not_of(WHITESPACE);
+    if (first == std::string_view::npos) {
+        return {};
+    }
+    return line.substr(first, line.find_last_not_of(WHITESPACE) - first + 1);
+}
+
+// Moves a statement (and the operands hanging off it) to another line
+void shiftLines(ASTNode* node, int64_t delta) {
+    node->location.line = static_cast<uint32_t>(node->location.line + delta);
+    if (auto* instr = ast_cast<Instruction>(node)) {
+        for (Operand* operand : instr->operands) {
+            operand->location.line = static_cast<uint32_t>(operand->location.line + delta);
+        }
+    } else if (auto* times = ast_cast<TIMESDirective>(node)) {
+        if (times->repeated_node) {
+            shiftLines(times->repeated_node, delta);
+        }
+    }
+}
+
+// Byte ranges where two images differ, including growth. Bytes cut off the
+// end have nothing in after to point at; finish() reports those separately
+std::vector<ByteRange> diffBinaries(const std::vector<uint8_t>& before, const std::vector<uint8_t>& after) {
+    std::vector<ByteRange> ranges;
+    size_t common = std::min(before.size(), after.size());
+    size_t i = 0;
+    while (i < common) {
+        if (before[i] == after[i]) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < common && before[i] != after[i]) i++;
+        ranges.push_back({start, i - start});
+    }
+
+    if (after.size() > common) {
+        // Merge with a difference that runs right up to the old end
+        if (!ranges.empty() && ranges.back().offset + ranges.back().length == common) {
+            ranges.back().length += after.size() - common;
+        } else {
+            ranges.push_back({common, after.size() - common});
+        }
+    }
+    return ranges;
+}
+
+} // namespace
+
+class AssemblySession::Impl {
+public:
+    /**
+     * @brief Parse state of one source line
+     */
+    struct Line {
+        std::string text;                  ///< Trimmed line text
+        std::vector<ASTNode*> statements;  ///< Nodes parsed from it (in program->arena)
+        size_t arena_bytes = 0;            ///< Arena space those nodes took
+        bool has_errors = false;           ///< Didn't parse on its own
+    };
+
+    /// Dead nodes tolerated in the arena before it is rebuilt from scratch
+    static constexpr size_t MIN_GARBAGE_BYTES = 64 * 1024;
+
+    std::string filename;
+    Assembler assembler;                 ///< Full pipeline for sources the fast path can't handle
+    FileTable files;                     ///< Names for error locations
+    FileId file = FileTable::INPUT;
+
+    std::unique_ptr<Program> program;    ///< Arena + statement list shared by all lines
+    std::vector<Line> lines;             ///< One entry per source line
+    size_t garbage_bytes = 0;            ///< Arena space of nodes from replaced lines
+    size_t error_lines = 0;              ///< Lines with has_errors set
+
+    CodeGenerator generator;
+    EncodingCache cache;
+
+    std::vector<uint8_t> previous_binary;  ///< Binary of the last update, for the diff
+    SessionUpdate last;
+
+    explicit Impl(std::string name) : filename(std::move(name)) {
+        file = files.intern(filename);
+        generator.setEncodingCache(&cache);
+    }
+
+    void reset() {
+        program.reset();
+        lines.clear();
+        garbage_bytes = 0;
+        error_lines = 0;
+        cache.clear();
+        previous_binary.clear();
+        last = SessionUpdate();
+    }
+
+    // Lexes and parses one line on its own
+    void parseLine(Line& line, size_t line_number) {
+        size_t before = program->arena.bytesUsed();
+        Lexer lexer(line.text, file, line_number);
+        Parser parser(lexer.tokenize());
+        parser.parseInto(program->arena, line.statements);
+        line.arena_bytes = program->arena.bytesUsed() - before;
+        line.has_errors = parser.hasErrors();
+        if (line.has_errors) {
+            error_lines++;
+        }
+    }
+
+    const SessionUpdate& update(const std::string& source) {
+        // Split into lines the way the preprocessor reads them
+        std::vector<std::string_view> texts;
+        bool needs_preprocessor = false;
+        std::string_view rest(source);
+        while (!rest.empty()) {
+            size_t end = rest.find('\n');
+            std::string_view raw = rest.substr(0, end);
+            rest = end == std::string_view::npos ? std::string_view() : rest.substr(end + 1);
+
+            std::string_view text = trimLine(raw);
+            if ((!raw.empty() && raw.back() == '\\') || (!text.empty() && text[0] == '%')) {
+                needs_preprocessor = true;
+            }
+            texts.push_back(text);
+        }
+
+        last = SessionUpdate();
+        if (needs_preprocessor) {
+            // Defines and includes can change the meaning of any line
+            program.reset();
+            lines.clear();
+            garbage_bytes = 0;
+            error_lines = 0;
+            cache.clear();
+            last.result = assembler.assemble(source, filename);
+            last.reparsed_lines = texts.size();
+            return finish();
+        }
+
+        size_t reparsed = program ? relex(texts) : rebuild(texts);
+        last.reparsed_lines = reparsed;
+
+        if (error_lines > 0) {
+            // Let the full pipeline report errors exactly as it would
+            last.result = assembler.assemble(source, filename);
+            return finish();
+        }
+
+        program->statements.clear();
+        for (const Line& line : lines) {
+            program->statements.insert(program->statements.end(),
+                                       line.statements.begin(), line.statements.end());
+        }
+
+        last.result = generator.generate(program.get());
+        resolveFileNames(last.result.errors, files);
+        last.encoded_instructions = cache.encoded;
+        last.incremental = true;
+        return finish();
+    }
+
+    // Throws the arena away and parses every line again
+    size_t rebuild(const std::vector<std::string_view>& texts) {
+        program = std::make_unique<Program>();
+        cache.clear();
+        garbage_bytes = 0;
+        error_lines = 0;
+
+        lines.clear();
+        lines.resize(texts.size());
+        for (size_t i = 0; i < texts.size(); i++) {
+            lines[i].text = texts[i];
+            parseLine(lines[i], i + 1);
+        }
+        return texts.size();
+    }
+
+    // Reparses only the lines between the unchanged head and tail
+    size_t relex(const std::vector<std::string_view>& texts) {
+        size_t old_count = lines.size();
+        size_t prefix = 0;
+        while (prefix < old_count && prefix < texts.size() && lines[prefix].text == texts[prefix]) {
+            prefix++;
+        }
+        size_t suffix = 0;
+        while (suffix < old_count - prefix && suffix < texts.size() - prefix &&
+               lines[old_count - 1 - suffix].text == texts[texts.size() - 1 - suffix]) {
+            suffix++;
+        }
+
+        size_t removed = old_count - prefix - suffix;
+        size_t added = texts.size() - prefix - suffix;
+        for (size_t i = prefix; i < prefix + removed; i++) {
+            garbage_bytes += lines[i].arena_bytes;
+            if (lines[i].has_errors) {
+                error_lines--;
+            }
+        }
+
+        size_t live_bytes = program->arena.bytesUsed() - garbage_bytes;
+        if (garbage_bytes > MIN_GARBAGE_BYTES && garbage_bytes > live_bytes) {
+            return rebuild(texts);
+        }
+
+        // Nodes of the tail keep their parse, only their line numbers move
+        int64_t delta = static_cast<int64_t>(added) - static_cast<int64_t>(removed);
+        if (delta != 0) {
+            for (size_t i = old_count - suffix; i < old_count; i++) {
+                for (ASTNode* stmt : lines[i].statements) {
+                    shiftLines(stmt, delta);
+                }
+            }
+        }
+
+        std::vector<Line> replacement(added);
+        for (size_t i = 0; i < added; i++) {
+            replacement[i].text = texts[prefix + i];
+            parseLine(replacement[i], prefix + i + 1);
+        }
+        lines.erase(lines.begin() + static_cast<std::ptrdiff_t>(prefix),
+                    lines.begin() + static_cast<std::ptrdiff_t>(prefix + removed));
+        lines.insert(lines.begin() + static_cast<std::ptrdiff_t>(prefix),
+                     std::make_move_iterator(replacement.begin()),
+                     std::make_move_iterator(replacement.end()));
+        return added;
+    }
+
+    const SessionUpdate& finish() {
+        last.changed = diffBinaries(previous_binary, last.result.binary);
+        last.truncated_from = last.result.binary.size() < previous_binary.size() ? previous_binary.size() : 0;
+        previous_binary = last.result.binary;
+        return last;
+    }
+};
+
+AssemblySession::AssemblySession(std::string filename)
+    : m_impl(std::make_unique<Impl>(std::move(filename)))
+{
+}
+
+AssemblySession::~AssemblySession() = default;
+
+const SessionUpdate& AssemblySession::update(const std::string& source) {
+    return m_impl->update(source);
+}
+
+void AssemblySession::setIncludePaths(const std::vector<std::string>& paths) {
+    m_impl->assembler.setIncludePaths(paths);
+}
+
+void AssemblySession::reset() {
+    m_impl->reset();
+}
+
+} // namespace e2asm
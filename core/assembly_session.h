@@ -0,0 +1,106 @@
+/**
+ * @file assembly_session.h
+ * @brief Incremental reassembly for editors and live-edit sessions
+ *
+ * An IDE that reassembles on every keystroke mostly feeds the assembler the
+ * same text over and over. AssemblySession keeps the per-line parse and the
+ * per-instruction encodings of the previous run and only redoes the parts an
+ * edit can have affected.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "assembler.h"
+
+namespace e2asm {
+
+/**
+ * @brief A contiguous run of bytes in AssemblyResult::binary
+ */
+struct ByteRange {
+    size_t offset;  ///< Offset from the start of the binary (add origin_address for the load address)
+    size_t length;  ///< Number of bytes
+
+    bool operator==(const ByteRange& other) const = default;
+};
+
+/**
+ * @brief Outcome of one AssemblySession::update()
+ */
+struct SessionUpdate {
+    AssemblyResult result;           ///< Same result Assembler::assemble() gives for the text
+    std::vector<ByteRange> changed;  ///< Byte ranges that differ from the previous update's binary
+    size_t truncated_from = 0;       ///< Previous binary size if the binary got shorter (the bytes
+                                     ///< from result.binary.size() up to it are gone), else 0
+    size_t reparsed_lines = 0;       ///< Lines that had to be lexed and parsed again
+    size_t encoded_instructions = 0; ///< Instructions encoded (the rest reused their last bytes)
+    bool incremental = false;        ///< false if the whole pipeline had to run from scratch
+};
+
+/**
+ * @brief Keeps assembly state alive between edits of one source file
+ *
+ * Each update() compares the new text with the previous one line by line.
+ * Only lines that differ are lexed and parsed again; all other lines keep
+ * their AST nodes. Layout is redone over the whole statement list (it is
+ * cheap next to encoding, and one resized instruction moves everything
+ * after it), but an instruction is only re-encoded if its address or the
+ * value of a symbol it refers to changed.
+ *
+ * Sources that use the preprocessor (any line starting with '%', or a line
+ * continuation), or that only parse as a whole, are assembled with the
+ * regular pipeline instead; the result is the same, just not incremental.
+ *
+ * @code
+ * e2asm::AssemblySession session("main.asm");
+ * session.update(text);
+ * auto& update = session.update(text_after_keystroke);
+ * for (const auto& range : update.changed) {
+ *     patchMemory(update.result.origin_address + range.offset,
+ *                 update.result.binary.data() + range.offset, range.length);
+ * }
+ * if (update.truncated_from) {
+ *     size_t end = update.result.binary.size();
+ *     clearMemory(update.result.origin_address + end, update.truncated_from - end);
+ * }
+ * @endcode
+ */
+class AssemblySession {
+public:
+    /**
+     * @brief Creates an empty session
+     * @param filename Filename to display in error messages
+     */
+    explicit AssemblySession(std::string filename = "<input>");
+
+    ~AssemblySession();
+
+    AssemblySession(const AssemblySession&) = delete;
+    AssemblySession& operator=(const AssemblySession&) = delete;
+
+    /**
+     * @brief Assembles the current text of the file
+     * @param source Complete source after the edit
+     * @return Result plus what changed; valid until the next update()
+     */
+    const SessionUpdate& update(const std::string& source);
+
+    /**
+     * @brief Configures search paths for %include directives
+     * @param paths Vector of directory paths (used by the full pipeline)
+     */
+    void setIncludePaths(const std::vector<std::string>& paths);
+
+    /** @brief Drops all retained state; the next update() starts from scratch */
+    void reset();
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> m_impl;  ///< Hides the retained AST and encoder state
+};
+
+} // namespace e2asm
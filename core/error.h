@@ -37,6 +37,7 @@ struct Error {
     std::string message;           ///< Human-readable description of the issue
     SourceLocation location;       ///< Exact position in source where error occurred
     ErrorSeverity severity;        ///< How serious this diagnostic is
+    std::string filename;          ///< location.file resolved to a name (empty until resolveFileNames)
 
     Error() : message(""), location(), severity(ErrorSeverity::ERROR) {}
 
@@ -47,16 +48,20 @@ struct Error {
      * @brief Formats error in standard compiler format
      * @return String like "file.asm:10:5: error: undefined label 'start'"
      *
-     * Output format matches GCC/Clang style for IDE integration.
+     * Output format matches GCC/Clang style for IDE integration. Uses the
+     * resolved filename when set, otherwise falls back to the bare file id.
      */
     std::string format() const {
-        std::string severity_str;
-        switch (severity) {
-            case ErrorSeverity::WARNING: severity_str = "warning"; break;
-            case ErrorSeverity::ERROR:   severity_str = "error"; break;
-            case ErrorSeverity::FATAL:   severity_str = "fatal error"; break;
-        }
-        return location.format() + ": " + severity_str + ": " + message;
+        return formatWith(filename.empty() ? location.format() : location.format(filename));
+    }
+
+    /**
+     * @brief Formats error, resolving the file id through a table
+     * @param files Table of the assembly run that reported the error
+     * @return String like "file.asm:10:5: error: undefined label 'start'"
+     */
+    std::string format(const FileTable& files) const {
+        return formatWith(location.format(files));
     }
 
     /**
@@ -66,8 +71,35 @@ struct Error {
     bool isError() const {
         return severity == ErrorSeverity::ERROR || severity == ErrorSeverity::FATAL;
     }
+
+private:
+    std::string formatWith(const std::string& where) const {
+        std::string severity_str;
+        switch (severity) {
+            case ErrorSeverity::WARNING: severity_str = "warning"; break;
+            case ErrorSeverity::ERROR:   severity_str = "error"; break;
+            case ErrorSeverity::FATAL:   severity_str = "fatal error"; break;
+        }
+        return where + ": " + severity_str + ": " + message;
+    }
 };
 
+/**
+ * @brief Fills in Error::filename for diagnostics leaving an assembly run
+ * @param errors Diagnostics whose locations refer to files
+ * @param files Table the locations' file ids belong to
+ *
+ * Locations only carry a FileId while assembling; names are looked up here,
+ * once, on the (rare) path where diagnostics are handed back to the caller.
+ */
+inline void resolveFileNames(std::vector<Error>& errors, const FileTable& files) {
+    for (auto& err : errors) {
+        if (err.filename.empty()) {
+            err.filename = files.name(err.location.file);
+        }
+    }
+}
+
 /**
  * @brief Collects errors and warnings during a compilation phase
  *
@@ -141,6 +173,15 @@ public:
         return m_errors;
     }
 
+    /**
+     * @brief Appends every diagnostic of another reporter, keeping their order
+     * @param other Reporter to copy from
+     */
+    void merge(const ErrorReporter& other) {
+        m_errors.insert(m_errors.end(), other.m_errors.begin(), other.m_errors.end());
+        m_has_errors = m_has_errors || other.m_has_errors;
+    }
+
     /**
      * @brief Resets the reporter to initial empty state
      *
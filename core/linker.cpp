@@ -0,0 +1,201 @@
+#include "linker.h"
+#include "../semantic/symbol_table.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+
+namespace e2asm {
+
+namespace {
+
+// Link errors have no source line, only the module they came from
+Error linkError(std::string message, const ObjectModule& module) {
+    Error error(std::move(message), SourceLocation(FileTable::INPUT, 0, 0));
+    error.filename = module.name;
+    return error;
+}
+
+bool fits(int64_t value, uint8_t size, bool relative) {
+    switch (size) {
+        case 1: return value >= -128 && value <= (relative ? 127 : 255);
+        case 2: return value >= -32768 && value <= 65535;
+        case 4: return value >= INT32_MIN && value <= UINT32_MAX;
+        default: return false;
+    }
+}
+
+struct Definition {
+    size_t module;
+    int64_t address;
+};
+
+using DefinitionMap = std::unordered_map<std::string, Definition, CaseInsensitiveHash, CaseInsensitiveEqual>;
+
+} // namespace
+
+AssemblyResult Linker::link(const std::vector<ObjectModule>& modules) const {
+    AssemblyResult result;
+    result.origin_address = m_origin;
+
+    // Modules that didn't assemble stop the link, but keep their diagnostics
+    bool assembled = true;
+    for (const auto& module : modules) {
+        result.errors.insert(result.errors.end(), module.errors.begin(), module.errors.end());
+        if (!module.success) {
+            assembled = false;
+            result.errors.push_back(linkError("Module '" + module.name + "' did not assemble", module));
+        }
+    }
+    if (!assembled) {
+        return result;
+    }
+
+    // Group same-named segments; each module's piece goes at the end of its group
+    std::unordered_map<std::string, size_t, CaseInsensitiveHash, CaseInsensitiveEqual> group_ids;
+    std::vector<size_t> group_sizes;
+    std::vector<std::vector<size_t>> groups(modules.size());
+    std::vector<std::vector<size_t>> piece_offsets(modules.size());
+    for (size_t m = 0; m < modules.size(); m++) {
+        for (const auto& segment : modules[m].segments) {
+            auto [it, added] = group_ids.emplace(segment.name, group_sizes.size());
+            if (added) {
+                group_sizes.push_back(0);
+            }
+            groups[m].push_back(it->second);
+            piece_offsets[m].push_back(group_sizes[it->second]);
+            group_sizes[it->second] += segment.data.size();
+        }
+    }
+
+    std::vector<size_t> group_starts(group_sizes.size());
+    size_t image_size = 0;
+    for (size_t g = 0; g < group_sizes.size(); g++) {
+        group_starts[g] = image_size;
+        image_size += group_sizes[g];
+    }
+
+    // Load address of every module segment
+    std::vector<std::vector<int64_t>> addresses(modules.size());
+    for (size_t m = 0; m < modules.size(); m++) {
+        for (size_t s = 0; s < modules[m].segments.size(); s++) {
+            addresses[m].push_back(static_cast<int64_t>(m_origin + group_starts[groups[m][s]] + piece_offsets[m][s]));
+        }
+    }
+
+    DefinitionMap definitions;
+    std::vector<SymbolIndex::Entry> labels;
+    for (size_t m = 0; m < modules.size(); m++) {
+        for (const auto& exported : modules[m].exports) {
+            if (exported.segment >= modules[m].segments.size()) {
+                result.errors.push_back(linkError("Export '" + exported.name + "' refers to a missing segment",
+                                                  modules[m]));
+                continue;
+            }
+            int64_t address = addresses[m][exported.segment] + static_cast<int64_t>(exported.offset);
+            auto [it, added] = definitions.emplace(exported.name, Definition{m, address});
+            if (!added) {
+                result.errors.push_back(linkError("Symbol '" + exported.name + "' is exported by both '" +
+                                                  modules[it->second.module].name + "' and '" +
+                                                  modules[m].name + "'", modules[m]));
+                continue;
+            }
+            result.symbols[exported.name] = static_cast<size_t>(address);
+            labels.push_back({static_cast<uint64_t>(address), 0, exported.name});
+        }
+    }
+    result.symbol_index = SymbolIndex(std::move(labels), m_origin + image_size);
+
+    for (const auto& module : modules) {
+        for (const auto& name : module.externals) {
+            if (!definitions.contains(name)) {
+                result.errors.push_back(linkError("Undefined external symbol: " + name, module));
+            }
+        }
+    }
+    if (std::any_of(result.errors.begin(), result.errors.end(), [](const Error& e) { return e.isError(); })) {
+        return result;
+    }
+
+    // Modules only ever write into their own pieces, so they can be patched side by side
+    result.binary.assign(image_size, 0);
+    std::vector<std::vector<Error>> module_errors(modules.size());
+    auto patch = [&](size_t m) {
+        const ObjectModule& module = modules[m];
+        for (size_t s = 0; s < module.segments.size(); s++) {
+            const auto& data = module.segments[s].data;
+            std::copy(data.begin(), data.end(), result.binary.begin() + (addresses[m][s] - static_cast<int64_t>(m_origin)));
+        }
+
+        for (const auto& relocation : module.relocations) {
+            bool valid = relocation.segment < module.segments.size() &&
+                         relocation.offset + relocation.size <= module.segments[relocation.segment].data.size() &&
+                         (!relocation.symbol.empty() || relocation.target_segment < module.segments.size());
+            if (!valid) {
+                module_errors[m].push_back(linkError("Relocation outside of its module", module));
+                continue;
+            }
+
+            const std::string& target_name = relocation.symbol.empty()
+                ? module.segments[relocation.target_segment].name : relocation.symbol;
+            int64_t target = relocation.symbol.empty() ? addresses[m][relocation.target_segment]
+                                                       : definitions.at(relocation.symbol).address;
+            int64_t value = target + relocation.addend;
+            if (relocation.relative) {
+                value -= addresses[m][relocation.segment];
+            }
+
+            const std::string& segment_name = module.segments[relocation.segment].name;
+            if (!fits(value, relocation.size, relocation.relative)) {
+                module_errors[m].push_back(linkError(
+                    "Reference to '" + target_name + "' at " + segment_name + "+" +
+                    std::to_string(relocation.offset) + " is out of range (" + std::to_string(value) +
+                    " doesn't fit in " + std::to_string(relocation.size) + " byte" +
+                    (relocation.size == 1 ? "" : "s") + ")", module));
+                continue;
+            }
+
+            size_t position = static_cast<size_t>(addresses[m][relocation.segment] - static_cast<int64_t>(m_origin)) +
+                              relocation.offset;
+            for (size_t i = 0; i < relocation.size; i++) {
+                result.binary[position + i] = static_cast<uint8_t>(value >> (8 * i));
+            }
+        }
+    };
+
+    size_t workers = m_workers == 0 ? std::max(1u, std::thread::hardware_concurrency()) : m_workers;
+    workers = std::min(workers, modules.size());
+    if (workers <= 1) {
+        for (size_t m = 0; m < modules.size(); m++) {
+            patch(m);
+        }
+    } else {
+        std::atomic<size_t> next{0};
+        auto run = [&] {
+            for (size_t m = next++; m < modules.size(); m = next++) {
+                patch(m);
+            }
+        };
+        std::vector<std::thread> pool;
+        pool.reserve(workers - 1);
+        for (size_t i = 1; i < workers; i++) {
+            pool.emplace_back(run);
+        }
+        run();
+        for (auto& thread : pool) {
+            thread.join();
+        }
+    }
+
+    for (auto& errors : module_errors) {
+        result.errors.insert(result.errors.end(), errors.begin(), errors.end());
+    }
+    result.success = std::none_of(result.errors.begin(), result.errors.end(),
+                                  [](const Error& e) { return e.isError(); });
+    if (!result.success) {
+        result.binary.clear();
+    }
+    return result;
+}
+
+} // namespace e2asm
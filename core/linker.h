@@ -0,0 +1,72 @@
+/**
+ * @file linker.h
+ * @brief Combines separately assembled object modules into one binary
+ *
+ * The link step is what makes per-module assembly pay off: modules that did
+ * not change are reused as they are, and only laying out segments, matching
+ * EXTERN symbols with GLOBAL ones and patching relocations is redone.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "assembler.h"
+#include "object_module.h"
+
+namespace e2asm {
+
+/**
+ * @brief Lays out, resolves and patches a set of object modules
+ *
+ * Segments with the same name (ignoring case) are concatenated in module
+ * order, and the groups are placed one after another in the order their
+ * names first appear, starting at the origin. Every EXTERN must match
+ * exactly one GLOBAL of another module; each relocation then gets its
+ * final value, with an error if it no longer fits its field (a SHORT jump
+ * to another module that ended up too far away, for example).
+ *
+ * Copying and patching is split over worker threads by module, since
+ * modules never write into each other's bytes.
+ *
+ * @code
+ * e2asm::Assembler assembler;
+ * auto modules = assembler.assembleObjects({{main_src, "main.asm"}, {util_src, "util.asm"}});
+ * e2asm::Linker linker;
+ * linker.setOrigin(0x100);
+ * auto image = linker.link(modules);
+ * if (image.success) {
+ *     image.writeBinary("program.com");
+ * }
+ * @endcode
+ */
+class Linker {
+public:
+    /**
+     * @brief Sets the address the linked image is loaded at
+     * @param origin Address of the first byte (default 0)
+     */
+    void setOrigin(size_t origin) { m_origin = origin; }
+
+    /**
+     * @brief Patches modules on several threads
+     * @param workers Threads to use; 0 uses std::thread::hardware_concurrency(), 1 (default) stays on the caller's
+     */
+    void setWorkers(size_t workers) { m_workers = workers; }
+
+    /**
+     * @brief Links modules into a flat binary
+     * @param modules Modules to combine, in link order
+     * @return Binary, exported symbols with their final addresses, and errors
+     *
+     * Modules that failed to assemble are reported and make the link fail.
+     * The result has no listing.
+     */
+    AssemblyResult link(const std::vector<ObjectModule>& modules) const;
+
+private:
+    size_t m_origin = 0;   ///< See setOrigin
+    size_t m_workers = 1;  ///< See setWorkers
+};
+
+} // namespace e2asm
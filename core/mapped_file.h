@@ -0,0 +1,59 @@
+/**
+ * @file mapped_file.h
+ * @brief Read-only view of a whole file, memory-mapped where the OS allows it
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace e2asm {
+
+/**
+ * @brief Maps a file into memory for reading
+ *
+ * On POSIX systems the file is mmap'ed, so opening it costs no copy and
+ * pages are only read when touched. Elsewhere the contents are read into an
+ * owned buffer; the interface is the same either way.
+ *
+ * Move-only. The view stays valid until the object is destroyed or opened
+ * again; the file shouldn't be truncated while it is mapped.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief Maps a file, replacing whatever was mapped before
+     * @param path File to open
+     * @return false if it can't be opened or mapped
+     */
+    bool open(const std::string& path);
+
+    /** @brief Unmaps the file */
+    void close();
+
+    bool isOpen() const { return m_open; }
+
+    /** @brief The file's contents (empty if not open) */
+    std::string_view view() const { return {m_data, m_size}; }
+
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_open = false;
+    bool m_mapped = false;  ///< m_data is an mmap'ed region, not m_buffer
+    std::string m_buffer;   ///< Contents when mapping isn't available
+};
+
+} // namespace e2asm
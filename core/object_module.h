@@ -0,0 +1,77 @@
+/**
+ * @file object_module.h
+ * @brief Relocatable output of one separately assembled source
+ *
+ * Assembler::assembleObject() turns a source into an ObjectModule instead of
+ * a flat binary: the bytes of each segment, the labels it exports (GLOBAL),
+ * the symbols it imports (EXTERN) and the places in its code and data that
+ * hold an address the Linker has to fill in. Modules don't depend on each
+ * other until they are linked, so they can be assembled in parallel and kept
+ * around for as long as their source doesn't change.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "error.h"
+
+namespace e2asm {
+
+/**
+ * @brief Bytes of one named segment of a module
+ *
+ * Code before the first SEGMENT directive goes to a segment named ".text".
+ * The linker concatenates segments of the same name across modules.
+ */
+struct ObjectSegment {
+    std::string name;           ///< Name from the SEGMENT directive
+    std::vector<uint8_t> data;  ///< Contents, as if the segment started at address 0
+};
+
+/**
+ * @brief A field the linker patches once every segment has an address
+ *
+ * The linker writes
+ *   value = address of the target + addend - (relative ? address of segment : 0)
+ * into the field, little-endian, and reports an error if it doesn't fit.
+ * The target is the start of target_segment for a reference into this
+ * module, or the exported address of symbol for an external one.
+ */
+struct Relocation {
+    size_t segment = 0;         ///< Segment the field is in
+    size_t offset = 0;          ///< Position of the field in that segment
+    uint8_t size = 2;           ///< Width of the field in bytes (1, 2 or 4)
+    bool relative = false;      ///< Field is a jump displacement, not an address
+    size_t target_segment = 0;  ///< Referenced segment of this module (symbol empty)
+    std::string symbol;         ///< Referenced external symbol, empty for a local reference
+    int64_t addend = 0;         ///< Constant part of the value (see above)
+};
+
+/**
+ * @brief A label exported with GLOBAL
+ */
+struct ExportedSymbol {
+    std::string name;    ///< Label name as defined
+    size_t segment = 0;  ///< Segment it is defined in
+    size_t offset = 0;   ///< Position in that segment
+};
+
+/**
+ * @brief Result of assembling one source into a relocatable module
+ *
+ * Copyable: modules are plain data and cheap next to assembling them again.
+ */
+struct ObjectModule {
+    std::string name;                      ///< Filename the module was assembled from
+    std::vector<ObjectSegment> segments;   ///< Segments in order of first appearance
+    std::vector<Relocation> relocations;   ///< Fields to patch, ordered by segment and offset
+    std::vector<ExportedSymbol> exports;   ///< GLOBAL labels
+    std::vector<std::string> externals;    ///< EXTERN symbols, in declaration order
+    std::vector<Error> errors;             ///< Errors and warnings from assembling it
+    bool success = false;                  ///< True if the module can be linked
+};
+
+} // namespace e2asm
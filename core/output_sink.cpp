@@ -0,0 +1,28 @@
+#include "output_sink.h"
+#include <algorithm>
+
+namespace e2asm {
+
+bool SpanSink::write(std::span<const uint8_t> bytes) {
+    size_t required = m_size + bytes.size();
+    if (required > m_buffer.size()) {
+        if (!m_grow) {
+            return false;
+        }
+        m_buffer = m_grow(required);
+        if (required > m_buffer.size()) {
+            return false;
+        }
+    }
+
+    std::copy(bytes.begin(), bytes.end(), m_buffer.begin() + m_size);
+    m_size = required;
+    return true;
+}
+
+bool StreamSink::write(std::span<const uint8_t> bytes) {
+    m_stream.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return m_stream.good();
+}
+
+} // namespace e2asm
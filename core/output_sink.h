@@ -0,0 +1,103 @@
+/**
+ * @file output_sink.h
+ * @brief Destinations that receive machine code while it is generated
+ *
+ * By default the assembled image ends up in AssemblyResult::binary. For big
+ * images a caller can instead hand the assembler an OutputSink, which gets
+ * the bytes in order as code generation goes, so the image never has to sit
+ * in an intermediate vector.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <span>
+#include <utility>
+
+namespace e2asm {
+
+/**
+ * @brief Receives the assembled binary in order, a block at a time
+ *
+ * Blocks arrive in address order with no gaps and never overlap. If assembly
+ * fails part-way the sink has only seen a prefix of the image, so check
+ * AssemblyResult::success before using what was written.
+ */
+class OutputSink {
+public:
+    virtual ~OutputSink() = default;
+
+    /**
+     * @brief Appends a block of machine code
+     * @param bytes Next bytes of the image (only valid during the call)
+     * @return false to report a write failure; assembly then stops with an error
+     */
+    virtual bool write(std::span<const uint8_t> bytes) = 0;
+};
+
+/**
+ * @brief Writes into caller-owned memory, asking for more when it runs out
+ *
+ * @code
+ * std::vector<uint8_t> image(64 * 1024);
+ * e2asm::SpanSink sink(image, [&image](size_t required) {
+ *     image.resize(required * 2);
+ *     return std::span<uint8_t>(image);
+ * });
+ * auto result = assembler.assemble(source, sink);
+ * image.resize(sink.size());
+ * @endcode
+ */
+class SpanSink : public OutputSink {
+public:
+    /**
+     * @brief Called when a write doesn't fit
+     *
+     * Receives the total number of bytes needed and returns the buffer to
+     * continue in. It must be at least that large and start with the bytes
+     * written so far (as a realloc or vector resize leaves them). Returning
+     * a smaller span makes the write fail.
+     */
+    using Grow = std::function<std::span<uint8_t>(size_t required)>;
+
+    /**
+     * @brief Creates a sink over a preallocated buffer
+     * @param buffer Memory to write into, starting at its first byte
+     * @param grow Growth callback, or empty to fail once the buffer is full
+     */
+    explicit SpanSink(std::span<uint8_t> buffer, Grow grow = {})
+        : m_buffer(buffer), m_grow(std::move(grow)) {}
+
+    bool write(std::span<const uint8_t> bytes) override;
+
+    /** @brief Bytes written so far */
+    size_t size() const { return m_size; }
+
+    /** @brief The buffer currently written into (may differ from the one passed in) */
+    std::span<uint8_t> buffer() const { return m_buffer; }
+
+private:
+    std::span<uint8_t> m_buffer;  ///< Current destination
+    Grow m_grow;                  ///< Asked for a bigger buffer when needed
+    size_t m_size = 0;            ///< Bytes written into m_buffer
+};
+
+/**
+ * @brief Writes straight to a std::ostream, e.g. an output file
+ *
+ * The stream should be opened in binary mode.
+ */
+class StreamSink : public OutputSink {
+public:
+    explicit StreamSink(std::ostream& stream) : m_stream(stream) {}
+
+    bool write(std::span<const uint8_t> bytes) override;
+
+private:
+    std::ostream& m_stream;  ///< Destination stream (not owned)
+};
+
+} // namespace e2asm
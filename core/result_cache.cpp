@@ -0,0 +1,397 @@
+#include "result_cache.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include <vector>
+
+namespace e2asm {
+
+namespace {
+
+constexpr std::string_view MAGIC("E2ASMRC\0", 8);
+constexpr uint32_t FORMAT_VERSION = 3;  // Bump when the layout below changes
+constexpr std::string_view EXTENSION = ".e2c";
+
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+uint64_t mix(uint64_t value) {
+    // splitmix64 finalizer, spreads FNV's weak high bits
+    value ^= value >> 30;
+    value *= 0xbf58476d1ce4e5b9ULL;
+    value ^= value >> 27;
+    value *= 0x94d049bb133111ebULL;
+    value ^= value >> 31;
+    return value;
+}
+
+class Writer {
+public:
+    void u8(uint8_t value) { m_out.push_back(static_cast<char>(value)); }
+
+    void u32(uint32_t value) {
+        for (int i = 0; i < 4; i++) u8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void u64(uint64_t value) {
+        for (int i = 0; i < 8; i++) u8(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void bytes(std::string_view data) {
+        u64(data.size());
+        m_out.append(data);
+    }
+
+    void bytes(const std::vector<uint8_t>& data) {
+        bytes(std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+    }
+
+    void raw(std::string_view data) { m_out.append(data); }
+
+    const std::string& data() const { return m_out; }
+
+private:
+    std::string m_out;
+};
+
+// Bounds-checked reader; after the first short read every call fails
+class Reader {
+public:
+    explicit Reader(std::string_view data) : m_data(data) {}
+
+    bool ok() const { return m_ok; }
+    bool atEnd() const { return m_pos == m_data.size(); }
+
+    uint8_t u8() {
+        if (!need(1)) return 0;
+        return static_cast<uint8_t>(m_data[m_pos++]);
+    }
+
+    uint32_t u32() {
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(u8()) << (8 * i);
+        return value;
+    }
+
+    uint64_t u64() {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(u8()) << (8 * i);
+        return value;
+    }
+
+    std::string_view bytes() {
+        uint64_t size = u64();
+        if (!need(size)) return {};
+        std::string_view data = m_data.substr(m_pos, size);
+        m_pos += size;
+        return data;
+    }
+
+    std::string_view raw(size_t size) {
+        if (!need(size)) return {};
+        std::string_view data = m_data.substr(m_pos, size);
+        m_pos += size;
+        return data;
+    }
+
+    // Element counts are checked against the bytes left, so a corrupt
+    // count can't make the caller reserve gigabytes
+    uint64_t count(size_t min_element_size) {
+        uint64_t value = u64();
+        if (m_ok && value > (m_data.size() - m_pos) / min_element_size) {
+            m_ok = false;
+        }
+        return m_ok ? value : 0;
+    }
+
+private:
+    bool need(uint64_t size) {
+        if (!m_ok || size > m_data.size() - m_pos) {
+            m_ok = false;
+        }
+        return m_ok;
+    }
+
+    std::string_view m_data;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+std::vector<uint8_t> toBytes(std::string_view data) {
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+} // namespace
+
+std::string ResultCache::Key::hex() const {
+    static constexpr char DIGITS[] = "0123456789abcdef";
+    std::string text(32, '0');
+    for (int i = 0; i < 16; i++) {
+        text[15 - i] = DIGITS[(high >> (4 * i)) & 0xF];
+        text[31 - i] = DIGITS[(low >> (4 * i)) & 0xF];
+    }
+    return text;
+}
+
+ResultCache::KeyBuilder::KeyBuilder()
+    : m_high(0xcbf29ce484222325ULL), m_low(0x84222325cbf29ce4ULL) {}
+
+void ResultCache::KeyBuilder::add(std::string_view bytes) {
+    // Length first, so ("ab", "c") and ("a", "bc") differ
+    add(static_cast<uint64_t>(bytes.size()));
+    for (char c : bytes) {
+        m_high = (m_high ^ static_cast<uint8_t>(c)) * FNV_PRIME;
+        m_low = (m_low ^ static_cast<uint8_t>(c) ^ 0x5a) * FNV_PRIME;
+    }
+}
+
+void ResultCache::KeyBuilder::add(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        uint8_t byte = static_cast<uint8_t>(value >> (8 * i));
+        m_high = (m_high ^ byte) * FNV_PRIME;
+        m_low = (m_low ^ byte ^ 0x5a) * FNV_PRIME;
+    }
+}
+
+ResultCache::Key ResultCache::KeyBuilder::finish() const {
+    return Key{mix(m_high ^ (m_low >> 1)), mix(m_low + m_high)};
+}
+
+ResultCache::ResultCache(std::filesystem::path directory, uint64_t max_bytes)
+    : m_directory(std::move(directory)), m_max_bytes(max_bytes), m_bytes(0) {
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+
+    uint64_t total = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(m_directory, ec)) {
+        if (entry.path().extension() == EXTENSION) {
+            total += entry.file_size(ec);
+        }
+    }
+    m_bytes = total;
+}
+
+std::filesystem::path ResultCache::entryPath(const Key& key) const {
+    return m_directory / (key.hex() + std::string(EXTENSION));
+}
+
+bool ResultCache::load(const Key& key, AssemblyResult& result) {
+    std::filesystem::path path = entryPath(key);
+    MappedFile file;
+    if (!file.open(path.string())) {
+        m_misses++;
+        return false;
+    }
+
+    Reader in(file.view());
+    bool valid = in.raw(MAGIC.size()) == MAGIC && in.u32() == FORMAT_VERSION;
+    Key stored;
+    stored.high = in.u64();
+    stored.low = in.u64();
+    valid = valid && in.ok() && stored == key;
+
+    AssemblyResult loaded;
+    if (valid) {
+        loaded.origin_address = in.u64();
+        loaded.passes = in.u64();
+        loaded.binary = toBytes(in.bytes());
+
+        uint64_t symbol_count = in.count(16);
+        for (uint64_t i = 0; i < symbol_count && in.ok(); i++) {
+            std::string name(in.bytes());
+            loaded.symbols.emplace(std::move(name), in.u64());
+        }
+
+        uint64_t error_count = in.count(25);
+        for (uint64_t i = 0; i < error_count && in.ok(); i++) {
+            auto severity = static_cast<ErrorSeverity>(in.u8());
+            uint32_t line = in.u32();
+            uint32_t column = in.u32();
+            Error error(std::string(in.bytes()), SourceLocation(FileTable::INPUT, line, column), severity);
+            error.filename = in.bytes();
+            loaded.errors.push_back(std::move(error));
+        }
+
+        uint64_t line_count = in.count(49);
+        loaded.listing.reserve(line_count);
+        for (uint64_t i = 0; i < line_count && in.ok(); i++) {
+            AssembledLine line;
+            line.source_line = in.u64();
+            line.source_text = in.bytes();
+            line.machine_code = toBytes(in.bytes());
+            line.repeat = in.u64();
+            line.address = in.u64();
+            line.cycles = in.u32();
+            line.success = in.u8() != 0;
+            line.error_message = in.bytes();
+            loaded.listing.push_back(std::move(line));
+        }
+
+        uint64_t label_count = in.count(24);
+        std::vector<SymbolIndex::Entry> labels(label_count);
+        for (auto& label : labels) {
+            label.address = in.u64();
+            label.size = in.u64();
+            label.name = in.bytes();
+        }
+        loaded.symbol_index = SymbolIndex::fromEntries(std::move(labels));
+        valid = in.ok() && in.atEnd();
+    }
+
+    if (!valid) {
+        // Written by another version or damaged; it'll be replaced on the next store
+        file.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        m_misses++;
+        return false;
+    }
+
+    // Used entries are the last to be evicted
+    std::error_code ec;
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), ec);
+
+    loaded.success = true;
+    result = std::move(loaded);
+    m_hits++;
+    return true;
+}
+
+void ResultCache::store(const Key& key, const AssemblyResult& result) {
+    Writer out;
+    out.raw(MAGIC);
+    out.u32(FORMAT_VERSION);
+    out.u64(key.high);
+    out.u64(key.low);
+    out.u64(result.origin_address);
+    out.u64(result.passes);
+    out.bytes(result.binary);
+
+    out.u64(result.symbols.size());
+    for (const auto& [name, value] : result.symbols) {
+        out.bytes(name);
+        out.u64(value);
+    }
+
+    out.u64(result.errors.size());
+    for (const auto& error : result.errors) {
+        out.u8(static_cast<uint8_t>(error.severity));
+        out.u32(error.location.line);
+        out.u32(error.location.column);
+        out.bytes(error.message);
+        out.bytes(error.filename);
+    }
+
+    out.u64(result.listing.size());
+    for (const auto& line : result.listing) {
+        out.u64(line.source_line);
+        out.bytes(line.source_text);
+        out.bytes(line.machine_code);
+        out.u64(line.repeat);
+        out.u64(line.address);
+        out.u32(line.cycles);
+        out.u8(line.success ? 1 : 0);
+        out.bytes(line.error_message);
+    }
+
+    const auto& labels = result.symbol_index.entries();
+    out.u64(labels.size());
+    for (const auto& label : labels) {
+        out.u64(label.address);
+        out.u64(label.size);
+        out.bytes(label.name);
+    }
+
+    // Write beside the entry and rename over it, so readers see all or nothing
+    std::filesystem::path path = entryPath(key);
+    std::filesystem::path temporary = path;
+    temporary += ".tmp" + std::to_string(std::random_device{}());
+    {
+        std::ofstream file(temporary, std::ios::binary);
+        if (!file.is_open()) {
+            return;
+        }
+        file.write(out.data().data(), static_cast<std::streamsize>(out.data().size()));
+        if (!file.good()) {
+            file.close();
+            std::error_code ec;
+            std::filesystem::remove(temporary, ec);
+            return;
+        }
+    }
+
+    // An entry being replaced stops counting towards the size
+    std::error_code ec;
+    uint64_t replaced = std::filesystem::file_size(path, ec);
+    if (ec) {
+        replaced = 0;
+    }
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return;
+    }
+
+    m_stores++;
+    uint64_t bytes = m_bytes.load();
+    uint64_t updated;
+    do {
+        // The total is an estimate, don't let it wrap below zero
+        updated = (bytes > replaced ? bytes - replaced : 0) + out.data().size();
+    } while (!m_bytes.compare_exchange_weak(bytes, updated));
+    if (updated > m_max_bytes) {
+        evict(path);
+    }
+}
+
+void ResultCache::evict(const std::filesystem::path& keep) {
+    std::lock_guard<std::mutex> lock(m_evict_mutex);
+
+    struct Entry {
+        std::filesystem::file_time_type used;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+    std::vector<Entry> entries;
+    std::error_code ec;
+    uint64_t total = std::filesystem::file_size(keep, ec);
+    if (ec) {
+        total = 0;
+    }
+
+    for (const auto& item : std::filesystem::directory_iterator(m_directory, ec)) {
+        if (item.path().extension() != EXTENSION || item.path() == keep) {
+            continue;
+        }
+        std::error_code item_ec;
+        Entry entry{item.last_write_time(item_ec), item.file_size(item_ec), item.path()};
+        if (!item_ec) {
+            total += entry.size;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const auto& entry : entries) {
+        if (total <= m_max_bytes) {
+            break;
+        }
+        if (std::filesystem::remove(entry.path, ec)) {
+            total -= entry.size;
+            m_evictions++;
+        }
+    }
+    m_bytes = total;
+}
+
+ResultCacheStats ResultCache::stats() const {
+    ResultCacheStats stats;
+    stats.hits = m_hits;
+    stats.misses = m_misses;
+    stats.stores = m_stores;
+    stats.evictions = m_evictions;
+    stats.bytes = m_bytes;
+    return stats;
+}
+
+} // namespace e2asm
@@ -0,0 +1,112 @@
+/**
+ * @file result_cache.h
+ * @brief On-disk cache of assembly results, keyed by what went into them
+ *
+ * CI pipelines assemble the same unchanged sources over and over. The cache
+ * stores each successful result under a hash of everything that decides its
+ * bytes, so a later run with the same input reads the result back instead of
+ * lexing, parsing, laying out and encoding it again.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include "assembler.h"
+
+namespace e2asm {
+
+/**
+ * @brief Directory of cached AssemblyResults with a size limit
+ *
+ * Each entry is one file named after its key, in a compact little-endian
+ * format holding the binary, the symbols and their address index,
+ * warnings, and the listing when there is one. Entries are read back through MappedFile. Writes go to a
+ * temporary file that is renamed into place, so concurrent assemblers (in
+ * this process or another) never see a half-written entry.
+ *
+ * When the directory grows past the limit the least recently used entries
+ * are deleted (never the one just written); a hit refreshes the entry's
+ * modification time for that.
+ *
+ * All members are safe to call from several threads at once.
+ */
+class ResultCache {
+public:
+    /** @brief 128-bit content hash identifying one entry */
+    struct Key {
+        uint64_t high = 0;
+        uint64_t low = 0;
+
+        /** @brief 32 hex digits, used as the file name */
+        std::string hex() const;
+        bool operator==(const Key&) const = default;
+    };
+
+    /**
+     * @brief Accumulates the inputs of an assembly into a Key
+     *
+     * Two independent 64-bit FNV-1a lanes, mixed at the end. Not meant to
+     * resist deliberate collisions; entries also store their key and are
+     * ignored if it doesn't match.
+     */
+    class KeyBuilder {
+    public:
+        KeyBuilder();
+        void add(std::string_view bytes);
+        void add(uint64_t value);
+        Key finish() const;
+
+    private:
+        uint64_t m_high;
+        uint64_t m_low;
+    };
+
+    /**
+     * @brief Opens (and creates if needed) a cache directory
+     * @param directory Where entries are kept
+     * @param max_bytes Total size of the entries to keep
+     */
+    ResultCache(std::filesystem::path directory, uint64_t max_bytes);
+
+    /**
+     * @brief Reads a cached result
+     * @param key Key of the assembly
+     * @param result Filled on a hit
+     * @return true on a hit; unreadable or corrupt entries count as misses
+     */
+    bool load(const Key& key, AssemblyResult& result);
+
+    /**
+     * @brief Stores a successful result, then enforces the size limit
+     * @param key Key of the assembly
+     * @param result Result to store (its binary must not have gone to a sink)
+     */
+    void store(const Key& key, const AssemblyResult& result);
+
+    /** @brief Counters since the cache was opened */
+    ResultCacheStats stats() const;
+
+    const std::filesystem::path& directory() const { return m_directory; }
+
+private:
+    std::filesystem::path entryPath(const Key& key) const;
+    void evict(const std::filesystem::path& keep);
+
+    std::filesystem::path m_directory;
+    uint64_t m_max_bytes;
+
+    std::atomic<size_t> m_hits{0};
+    std::atomic<size_t> m_misses{0};
+    std::atomic<size_t> m_stores{0};
+    std::atomic<size_t> m_evictions{0};
+
+    std::mutex m_evict_mutex;        ///< One eviction scan at a time
+    std::atomic<uint64_t> m_bytes;   ///< Estimated size of the directory
+};
+
+} // namespace e2asm
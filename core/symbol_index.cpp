@@ -0,0 +1,145 @@
+#include "symbol_index.h"
+#include <algorithm>
+#include <charconv>
+
+namespace e2asm {
+
+namespace {
+
+constexpr std::string_view MAP_TITLE =
+    "- E2Asm Map file ---------------------------------------------------------------\n\n";
+constexpr std::string_view MAP_SECTION =
+    "-- Symbols (by address) --------------------------------------------------------\n\n";
+constexpr std::string_view MAP_HEADER = "Address   Size      Name";
+
+void appendHex(std::string& out, uint64_t value) {
+    static constexpr char DIGITS[] = "0123456789ABCDEF";
+    char buffer[16];
+    int length = 0;
+    do {
+        buffer[length++] = DIGITS[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    // At least 8 digits keeps the columns lined up for anything 8086-sized
+    for (int i = length; i < 8; i++) {
+        out += '0';
+    }
+    while (length > 0) {
+        out += buffer[--length];
+    }
+}
+
+bool parseHex(std::string_view& line, uint64_t& value) {
+    size_t start = line.find_first_not_of(' ');
+    if (start == std::string_view::npos) {
+        return false;
+    }
+    line.remove_prefix(start);
+    auto [end, ec] = std::from_chars(line.data(), line.data() + line.size(), value, 16);
+    if (ec != std::errc() || end == line.data()) {
+        return false;
+    }
+    line.remove_prefix(static_cast<size_t>(end - line.data()));
+    return true;
+}
+
+} // namespace
+
+SymbolIndex::SymbolIndex(std::vector<Entry> labels, uint64_t end_address)
+    : m_entries(std::move(labels)) {
+    std::sort(m_entries.begin(), m_entries.end(), [](const Entry& a, const Entry& b) {
+        return a.address != b.address ? a.address < b.address : a.name < b.name;
+    });
+
+    // Walk back to front so each group of equal addresses knows where the next one starts
+    uint64_t next = end_address;
+    for (size_t i = m_entries.size(); i-- > 0;) {
+        Entry& entry = m_entries[i];
+        if (i + 1 < m_entries.size() && m_entries[i + 1].address != entry.address) {
+            next = m_entries[i + 1].address;
+        }
+        entry.size = next > entry.address ? next - entry.address : 0;
+    }
+}
+
+SymbolIndex SymbolIndex::fromEntries(std::vector<Entry> entries) {
+    // Only in case the order was edited by hand
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.address != b.address ? a.address < b.address : a.name < b.name;
+    });
+    SymbolIndex index;
+    index.m_entries = std::move(entries);
+    return index;
+}
+
+const SymbolIndex::Entry* SymbolIndex::symbolAt(uint64_t address) const {
+    auto it = std::upper_bound(m_entries.begin(), m_entries.end(), address,
+                               [](uint64_t value, const Entry& entry) { return value < entry.address; });
+    if (it == m_entries.begin()) {
+        return nullptr;
+    }
+
+    // Step back to the first label at that address
+    uint64_t start = std::prev(it)->address;
+    it = std::lower_bound(m_entries.begin(), it, start,
+                          [](const Entry& entry, uint64_t value) { return entry.address < value; });
+    if (address - it->address >= it->size) {
+        return nullptr;
+    }
+    return &*it;
+}
+
+std::string SymbolIndex::mapFile() const {
+    std::string text;
+    text.reserve(MAP_TITLE.size() + MAP_SECTION.size() + MAP_HEADER.size() + 1 + m_entries.size() * 32);
+    text += MAP_TITLE;
+    text += MAP_SECTION;
+    text += MAP_HEADER;
+    text += '\n';
+    for (const Entry& entry : m_entries) {
+        appendHex(text, entry.address);
+        text += "  ";
+        appendHex(text, entry.size);
+        text += "  ";
+        text += entry.name;
+        text += '\n';
+    }
+    return text;
+}
+
+bool SymbolIndex::parseMapFile(std::string_view text, SymbolIndex& index) {
+    size_t header = text.find(MAP_HEADER);
+    if (header == std::string_view::npos) {
+        return false;
+    }
+    text.remove_prefix(header + MAP_HEADER.size());
+
+    std::vector<Entry> entries;
+    while (!text.empty()) {
+        size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.find_first_not_of(' ') == std::string_view::npos) {
+            continue;
+        }
+
+        Entry& entry = entries.emplace_back();
+        if (!parseHex(line, entry.address) || !parseHex(line, entry.size)) {
+            return false;
+        }
+        size_t name = line.find_first_not_of(' ');
+        if (name == 0 || name == std::string_view::npos) {
+            return false;
+        }
+        entry.name = line.substr(name);
+    }
+
+    // Sizes come from the file
+    index = fromEntries(std::move(entries));
+    return true;
+}
+
+} // namespace e2asm
@@ -0,0 +1,99 @@
+/**
+ * @file symbol_index.h
+ * @brief Labels sorted by address, for "which label covers this address" lookups
+ *
+ * Debuggers and profilers map a program counter back to a label on every
+ * breakpoint hit or sample. AssemblyResult::symbols is keyed by name, so
+ * that question meant scanning all of it; the index answers it with a
+ * binary search and can be written out as a map file for other tools.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace e2asm {
+
+/**
+ * @brief Flat, address-sorted list of the labels of one program
+ *
+ * Every label covers the bytes from its address up to the next higher
+ * label, the last one up to the end of the image. Labels at the same
+ * address share the range. Local labels are listed with their qualified
+ * name ("main.loop").
+ *
+ * Map file format (text, one label per line after the column header,
+ * fixed-width hex columns so a tool can scan a mapped file directly):
+ * @code
+ * - E2Asm Map file ---------------------------------------------------------------
+ *
+ * -- Symbols (by address) --------------------------------------------------------
+ *
+ * Address   Size      Name
+ * 00000100  00000003  start
+ * 00000103  00000002  start.loop
+ * @endcode
+ */
+class SymbolIndex {
+public:
+    /** @brief One label and the range it covers */
+    struct Entry {
+        uint64_t address = 0;  ///< First byte of the label
+        uint64_t size = 0;     ///< Bytes up to the next label or the end of the image
+        std::string name;      ///< Qualified label name
+
+        bool operator==(const Entry&) const = default;
+    };
+
+    SymbolIndex() = default;
+
+    /**
+     * @brief Sorts labels and works out their sizes
+     * @param labels Labels in any order; only address and name are read
+     * @param end_address Address just past the image, bounds the last label
+     */
+    SymbolIndex(std::vector<Entry> labels, uint64_t end_address);
+
+    /**
+     * @brief Rebuilds an index from entries that already have their sizes
+     * @param entries Labels as written out before (sizes are kept, only the order is restored)
+     * @return The index
+     */
+    static SymbolIndex fromEntries(std::vector<Entry> entries);
+
+    /**
+     * @brief Finds the label whose range contains an address
+     * @param address Address to look up
+     * @return The label (the first by name if several share the address),
+     *         or nullptr before the first label or past the end of the image
+     */
+    const Entry* symbolAt(uint64_t address) const;
+
+    /** @brief Labels by ascending address, then name */
+    const std::vector<Entry>& entries() const { return m_entries; }
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    /**
+     * @brief Renders the index as a map file
+     * @return Text in the format described above
+     */
+    std::string mapFile() const;
+
+    /**
+     * @brief Reads a map file written by mapFile()
+     * @param text File contents (e.g. a MappedFile view)
+     * @param index Receives the labels
+     * @return false if a line after the header isn't address, size and name
+     */
+    static bool parseMapFile(std::string_view text, SymbolIndex& index);
+
+private:
+    std::vector<Entry> m_entries;
+};
+
+} // namespace e2asm
@@ -0,0 +1,134 @@
+#include "char_scan.h"
+#include <bit>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define E2ASM_SCAN_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define E2ASM_SCAN_NEON
+#endif
+
+namespace e2asm {
+
+namespace {
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool isIdentifierChar(char c) {
+    char lower = static_cast<char>(c | 0x20);
+    return (lower >= 'a' && lower <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '.';
+}
+
+#if defined(E2ASM_SCAN_SSE2) || defined(E2ASM_SCAN_NEON)
+#define E2ASM_SCAN_SIMD
+
+constexpr size_t BLOCK = 16;
+
+// Each block helper yields a byte mask: 0xFF where the byte matches, 0 elsewhere.
+// Range checks only use ASCII bounds, so bytes >= 0x80 never fall in a range
+// (they compare negative under SSE2's signed compares).
+#if defined(E2ASM_SCAN_SSE2)
+using Block = __m128i;
+
+Block load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+Block equal(Block a, char c) { return _mm_cmpeq_epi8(a, _mm_set1_epi8(c)); }
+Block either(Block a, Block b) { return _mm_or_si128(a, b); }
+Block invert(Block a) { return _mm_xor_si128(a, _mm_set1_epi8(-1)); }
+Block setBits(Block a, char bits) { return _mm_or_si128(a, _mm_set1_epi8(bits)); }
+Block inRange(Block a, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(a, _mm_set1_epi8(static_cast<char>(lo - 1))),
+                         _mm_cmplt_epi8(a, _mm_set1_epi8(static_cast<char>(hi + 1))));
+}
+
+size_t firstMatch(Block mask) {
+    unsigned bits = static_cast<unsigned>(_mm_movemask_epi8(mask));
+    return bits ? static_cast<size_t>(std::countr_zero(bits)) : BLOCK;
+}
+#else
+using Block = uint8x16_t;
+
+Block load(const char* p) { return vld1q_u8(reinterpret_cast<const uint8_t*>(p)); }
+Block equal(Block a, char c) { return vceqq_u8(a, vdupq_n_u8(static_cast<uint8_t>(c))); }
+Block either(Block a, Block b) { return vorrq_u8(a, b); }
+Block invert(Block a) { return vmvnq_u8(a); }
+Block setBits(Block a, char bits) { return vorrq_u8(a, vdupq_n_u8(static_cast<uint8_t>(bits))); }
+Block inRange(Block a, char lo, char hi) {
+    return vandq_u8(vcgeq_u8(a, vdupq_n_u8(static_cast<uint8_t>(lo))),
+                    vcleq_u8(a, vdupq_n_u8(static_cast<uint8_t>(hi))));
+}
+
+size_t firstMatch(Block mask) {
+    // Narrow each byte to a nibble: 64 bits, four per lane
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+    uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+    return bits ? static_cast<size_t>(std::countr_zero(bits)) / 4 : BLOCK;
+}
+#endif
+#endif
+
+#ifdef E2ASM_SCAN_SIMD
+// Advances pos a whole block at a time until stop() matches a byte in the
+// block; returns the matching position, or where the last full block ended
+template <typename BlockStop>
+size_t scanBlocks(std::string_view text, size_t pos, BlockStop stop) {
+    while (pos + BLOCK <= text.size()) {
+        size_t hit = firstMatch(stop(load(text.data() + pos)));
+        if (hit < BLOCK) {
+            return pos + hit;
+        }
+        pos += BLOCK;
+    }
+    return pos;
+}
+#endif
+
+template <typename Stop>
+size_t scanTail(std::string_view text, size_t pos, Stop stop) {
+    while (pos < text.size() && !stop(text[pos])) {
+        pos++;
+    }
+    return pos;
+}
+
+} // namespace
+
+size_t skipBlanks(std::string_view text, size_t pos) {
+#ifdef E2ASM_SCAN_SIMD
+    pos = scanBlocks(text, pos, [](Block b) {
+        return invert(either(either(equal(b, ' '), equal(b, '\t')), equal(b, '\r')));
+    });
+#endif
+    return scanTail(text, pos, [](char c) { return !isBlank(c); });
+}
+
+size_t skipIdentifierChars(std::string_view text, size_t pos) {
+#ifdef E2ASM_SCAN_SIMD
+    pos = scanBlocks(text, pos, [](Block b) {
+        Block letter = inRange(setBits(b, 0x20), 'a', 'z');
+        Block digit = inRange(b, '0', '9');
+        Block other = either(equal(b, '_'), equal(b, '.'));
+        return invert(either(either(letter, digit), other));
+    });
+#endif
+    return scanTail(text, pos, [](char c) { return !isIdentifierChar(c); });
+}
+
+size_t findLineEnd(std::string_view text, size_t pos) {
+#ifdef E2ASM_SCAN_SIMD
+    pos = scanBlocks(text, pos, [](Block b) { return equal(b, '\n'); });
+#endif
+    return scanTail(text, pos, [](char c) { return c == '\n'; });
+}
+
+size_t findQuoteOrEscape(std::string_view text, size_t pos, char quote) {
+#ifdef E2ASM_SCAN_SIMD
+    pos = scanBlocks(text, pos, [quote](Block b) { return either(equal(b, quote), equal(b, '\\')); });
+#endif
+    return scanTail(text, pos, [quote](char c) { return c == quote || c == '\\'; });
+}
+
+} // namespace e2asm
@@ -0,0 +1,35 @@
+/**
+ * @file char_scan.h
+ * @brief Block-at-a-time scanning for the lexer's long character runs
+ *
+ * Comments, blank runs, identifiers and string bodies make up most of a big
+ * generated source. Rather than stepping through them one character at a
+ * time, the lexer asks these helpers for the end of the run. They compare 16
+ * bytes per step with SSE2 (x86-64) or NEON (AArch64), and fall back to a
+ * plain loop elsewhere and for the last partial block.
+ *
+ * Each function takes the text and a start position and returns the position
+ * of the first byte that ends the run, or text.size() if the run reaches the
+ * end.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace e2asm {
+
+/** @brief Skips spaces, tabs and carriage returns */
+size_t skipBlanks(std::string_view text, size_t pos);
+
+/** @brief Skips identifier characters: letters, digits, '_' and '.' */
+size_t skipIdentifierChars(std::string_view text, size_t pos);
+
+/** @brief Finds the next newline (the end of a line comment) */
+size_t findLineEnd(std::string_view text, size_t pos);
+
+/** @brief Finds the next `quote` or backslash inside a quoted literal */
+size_t findQuoteOrEscape(std::string_view text, size_t pos, char quote);
+
+} // namespace e2asm
@@ -1,102 +1,33 @@
 #include "lexer.h"
-#include <cctype>
+#include "char_scan.h"
+#include "reserved_words.h"
 #include <algorithm>
+#include <cctype>
+#include <charconv>
 
 namespace e2asm {
 
-static std::string toUpper(std::string str) {
-    std::transform(str.begin(), str.end(), str.begin(), ::toupper);
-    return str;
+// NUMBER token for a literal whose digits (lexeme minus its base prefix or
+// suffix) are in the given base, or an ERROR token if they don't parse or
+// don't fit in 64 bits
+static Token numberToken(std::string_view lexeme, size_t prefix, size_t suffix, int base, SourceLocation loc) {
+    std::string_view digits = lexeme.substr(prefix, lexeme.size() - prefix - suffix);
+    int64_t value = 0;
+    auto [end, ec] = std::from_chars(digits.data(), digits.data() + digits.size(), value, base);
+    if (ec == std::errc::result_out_of_range) {
+        return Token(TokenType::ERROR, "Number literal out of range", loc);
+    }
+    if (ec != std::errc() || end != digits.data() + digits.size()) {
+        return Token(TokenType::ERROR, "Invalid number literal", loc);
+    }
+    return Token(TokenType::NUMBER, lexeme, value, loc);
 }
 
-const std::unordered_map<std::string, TokenType> Lexer::s_keywords = {
-    // Data directives
-    {"DB", TokenType::DIR_DB},
-    {"DW", TokenType::DIR_DW},
-    {"DD", TokenType::DIR_DD},
-    {"DQ", TokenType::DIR_DQ},
-    {"DT", TokenType::DIR_DT},
-    {"EQU", TokenType::DIR_EQU},
-
-    // Segment directives
-    {"SEGMENT", TokenType::DIR_SEGMENT},
-    {"SECTION", TokenType::DIR_SECTION},
-    {"ENDS", TokenType::DIR_ENDS},
-    {"ORG", TokenType::DIR_ORG},
-
-    // Reserve directives
-    {"RESB", TokenType::DIR_RESB},
-    {"RESW", TokenType::DIR_RESW},
-    {"RESD", TokenType::DIR_RESD},
-    {"RESQ", TokenType::DIR_RESQ},
-    {"REST", TokenType::DIR_REST},
-    {"TIMES", TokenType::DIR_TIMES},
-
-    // Size specifiers
-    {"BYTE", TokenType::BYTE_PTR},
-    {"BPTR", TokenType::BYTE_PTR},
-    {"WORD", TokenType::WORD_PTR},
-    {"WPTR", TokenType::WORD_PTR},
-    {"DWORD", TokenType::DWORD_PTR},
-    {"DPTR", TokenType::DWORD_PTR},
-    {"PTR", TokenType::WORD_PTR},  // Default to WORD
-
-    // Jump modifiers
-    {"SHORT", TokenType::SHORT_KW},
-    {"NEAR", TokenType::NEAR_KW},
-    {"FAR", TokenType::FAR_KW},
-};
-
-const std::unordered_map<std::string, TokenType> Lexer::s_registers = {
-    // 8-bit registers
-    {"AL", TokenType::REG8_AL}, {"CL", TokenType::REG8_CL},
-    {"DL", TokenType::REG8_DL}, {"BL", TokenType::REG8_BL},
-    {"AH", TokenType::REG8_AH}, {"CH", TokenType::REG8_CH},
-    {"DH", TokenType::REG8_DH}, {"BH", TokenType::REG8_BH},
-
-    // 16-bit registers
-    {"AX", TokenType::REG16_AX}, {"CX", TokenType::REG16_CX},
-    {"DX", TokenType::REG16_DX}, {"BX", TokenType::REG16_BX},
-    {"SP", TokenType::REG16_SP}, {"BP", TokenType::REG16_BP},
-    {"SI", TokenType::REG16_SI}, {"DI", TokenType::REG16_DI},
-
-    // Segment registers
-    {"ES", TokenType::SEGREG_ES}, {"CS", TokenType::SEGREG_CS},
-    {"SS", TokenType::SEGREG_SS}, {"DS", TokenType::SEGREG_DS},
-};
-
-// Common 8086 instructions
-const std::unordered_set<std::string> Lexer::s_instructions = {
-    "MOV", "PUSH", "POP", "PUSHA", "POPA", "XCHG",
-    "ADD", "SUB", "ADC", "SBB", "INC", "DEC", "NEG", "CMP",
-    "MUL", "IMUL", "DIV", "IDIV",
-    "AND", "OR", "XOR", "NOT", "TEST",
-    "SHL", "SHR", "SAL", "SAR", "ROL", "ROR", "RCL", "RCR",
-    "JMP", "JE", "JZ", "JNE", "JNZ", "JL", "JNGE", "JLE", "JNG",
-    "JG", "JNLE", "JGE", "JNL", "JB", "JNAE", "JC", "JBE", "JNA",
-    "JA", "JNBE", "JAE", "JNB", "JNC", "JS", "JNS", "JO", "JNO",
-    "JP", "JPE", "JNP", "JPO", "JCXZ",
-    "CALL", "RET", "RETF",
-    "LOOP", "LOOPE", "LOOPZ", "LOOPNE", "LOOPNZ",
-    "INT", "IRET", "INTO",
-    "LEA", "LDS", "LES",
-    "MOVS", "MOVSB", "MOVSW", "CMPS", "CMPSB", "CMPSW",
-    "SCAS", "SCASB", "SCASW", "LODS", "LODSB", "LODSW",
-    "STOS", "STOSB", "STOSW",
-    "REP", "REPE", "REPZ", "REPNE", "REPNZ",
-    "IN", "OUT",
-    "HLT", "NOP", "WAIT", "ESC", "LOCK",
-    "CLC", "STC", "CMC", "CLD", "STD", "CLI", "STI",
-    "LAHF", "SAHF", "PUSHF", "POPF",
-    "AAA", "AAS", "AAM", "AAD", "DAA", "DAS",
-    "CBW", "CWD", "XLAT"
-};
-
-Lexer::Lexer(std::string_view source, std::string filename)
+Lexer::Lexer(std::string_view source, FileId file, size_t first_line)
     : m_source(source)
-    , m_filename(std::move(filename))
+    , m_file(file)
     , m_current(0)
-    , m_line(1)
+    , m_line(first_line)
     , m_column(1)
 {
 }
@@ -104,20 +35,28 @@ Lexer::Lexer(std::string_view source, std::string filename)
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
 
+    Token token;
+    while (next(token)) {
+        tokens.push_back(token);
+    }
+
+    // to avoid parser bugs, always add eof
+    tokens.emplace_back(TokenType::END_OF_FILE, "", currentLocation());
+
+    return tokens;
+}
+
+bool Lexer::next(Token& token) {
     while (!isAtEnd()) {
         skipWhitespace();
         if (isAtEnd()) break;
 
-        Token token = nextToken();
+        token = nextToken();
         if (token.type != TokenType::INVALID) {
-            tokens.push_back(token);
+            return true;
         }
     }
-
-    // to avoid parser bugs, always add eof
-    tokens.emplace_back(TokenType::END_OF_FILE, "", currentLocation());
-
-    return tokens;
+    return false;
 }
 
 Token Lexer::nextToken() {
@@ -207,7 +146,7 @@ Token Lexer::nextToken() {
             break;
     }
 
-    return Token(TokenType::INVALID, std::string(1, c), loc);
+    return Token(TokenType::INVALID, m_source.substr(m_current - 1, 1), loc);
 }
 
 Token Lexer::scanNumber() {
@@ -224,10 +163,7 @@ Token Lexer::scanNumber() {
         while (isHexDigit(peek())) {
             advance();
         }
-        std::string num_str(m_source.substr(start + 1, m_current - start - 1));
-        int64_t value = std::stoll(num_str, nullptr, 16);
-        return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                    value, loc);
+        return numberToken(m_source.substr(start, m_current - start), 1, 0, 16, loc);
     }
 
     // Check for 0x prefix (hex)
@@ -237,10 +173,7 @@ Token Lexer::scanNumber() {
         while (isHexDigit(peek())) {
             advance();
         }
-        std::string num_str(m_source.substr(start + 2, m_current - start - 2));
-        int64_t value = std::stoll(num_str, nullptr, 16);
-        return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                    value, loc);
+        return numberToken(m_source.substr(start, m_current - start), 2, 0, 16, loc);
     }
 
     // Check for 0b prefix (binary)
@@ -254,10 +187,7 @@ Token Lexer::scanNumber() {
             while (peek() == '0' || peek() == '1') {
                 advance();
             }
-            std::string num_str(m_source.substr(start + 2, m_current - start - 2));
-            int64_t value = std::stoll(num_str, nullptr, 2);
-            return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                        value, loc);
+            return numberToken(m_source.substr(start, m_current - start), 2, 0, 2, loc);
         }
         // If no binary digits follow, fall through to hex suffix parsing
     }
@@ -273,10 +203,7 @@ Token Lexer::scanNumber() {
             while (peek() >= '0' && peek() <= '7') {
                 advance();
             }
-            std::string num_str(m_source.substr(start + 2, m_current - start - 2));
-            int64_t value = std::stoll(num_str, nullptr, 8);
-            return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                        value, loc);
+            return numberToken(m_source.substr(start, m_current - start), 2, 0, 8, loc);
         }
         // If no octal digits follow, fall through to hex suffix parsing
     }
@@ -290,30 +217,25 @@ Token Lexer::scanNumber() {
     if (suffix == 'h' || suffix == 'H') {
         // Hex suffix
         advance();
-        std::string num_str(m_source.substr(start, m_current - start - 1));
-        int64_t value = std::stoll(num_str, nullptr, 16);
-        return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                    value, loc);
+        return numberToken(m_source.substr(start, m_current - start), 0, 1, 16, loc);
     } else if (suffix == 'b' || suffix == 'B') {
         // Binary suffix
         advance();
-        std::string num_str(m_source.substr(start, m_current - start - 1));
-        int64_t value = std::stoll(num_str, nullptr, 2);
-        return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                    value, loc);
+        return numberToken(m_source.substr(start, m_current - start), 0, 1, 2, loc);
     } else if (suffix == 'o' || suffix == 'O' || suffix == 'q' || suffix == 'Q') {
         // Octal suffix
         advance();
-        std::string num_str(m_source.substr(start, m_current - start - 1));
-        int64_t value = std::stoll(num_str, nullptr, 8);
-        return Token(TokenType::NUMBER, std::string(m_source.substr(start, m_current - start)),
-                    value, loc);
+        return numberToken(m_source.substr(start, m_current - start), 0, 1, 8, loc);
+    }
+
+    // B is a hex digit, so the scan above already took a binary suffix in
+    std::string_view lexeme = m_source.substr(start, m_current - start);
+    if (lexeme.back() == 'b' || lexeme.back() == 'B') {
+        return numberToken(lexeme, 0, 1, 2, loc);
     }
 
     // Default is decimal
-    std::string num_str(m_source.substr(start, m_current - start));
-    int64_t value = std::stoll(num_str, nullptr, 10);
-    return Token(TokenType::NUMBER, num_str, value, loc);
+    return numberToken(lexeme, 0, 0, 10, loc);
 }
 
 Token Lexer::scanIdentifier() {
@@ -326,144 +248,69 @@ Token Lexer::scanIdentifier() {
         while (isAlpha(peek()) || peek() == '_') {
             advance();
         }
-        std::string text(m_source.substr(start, m_current - start));
-        std::string upper = toUpper(text);
-
-        // TODO: Create a static LUT for the macros
-        if (upper == "%DEFINE") return Token(TokenType::PREP_DEFINE, text, loc);
-        if (upper == "%MACRO") return Token(TokenType::PREP_MACRO, text, loc);
-        if (upper == "%ENDMACRO") return Token(TokenType::PREP_ENDMACRO, text, loc);
-        if (upper == "%IF") return Token(TokenType::PREP_IF, text, loc);
-        if (upper == "%ELIF") return Token(TokenType::PREP_ELIF, text, loc);
-        if (upper == "%ELSE") return Token(TokenType::PREP_ELSE, text, loc);
-        if (upper == "%ENDIF") return Token(TokenType::PREP_ENDIF, text, loc);
-        if (upper == "%IFDEF") return Token(TokenType::PREP_IFDEF, text, loc);
-        if (upper == "%IFNDEF") return Token(TokenType::PREP_IFNDEF, text, loc);
-        if (upper == "%INCLUDE") return Token(TokenType::PREP_INCLUDE, text, loc);
-
-        return Token(TokenType::IDENTIFIER, text, loc);
+        std::string_view text = m_source.substr(start, m_current - start);
+        return Token(classifyWord(text).type, text, loc);
     }
 
     // Regular identifier
-    while (isAlphaNumeric(peek()) || peek() == '_' || peek() == '.') {
-        advance();
-    }
+    advanceWithinLine(skipIdentifierChars(m_source, m_current));
 
-    std::string text(m_source.substr(start, m_current - start));
-    std::string upper = toUpper(text);
+    std::string_view text = m_source.substr(start, m_current - start);
+    ReservedWord word = classifyWord(text);
 
-    // Check if it's a register
-    auto reg_it = s_registers.find(upper);
-    if (reg_it != s_registers.end()) {
-        return Token(reg_it->second, text, loc);
-    }
-
-    // Check if it's a keyword
-    auto kw_it = s_keywords.find(upper);
-    if (kw_it != s_keywords.end()) {
-        return Token(kw_it->second, text, loc);
-    }
-
-    // Check if it's an instruction
-    // BUT: If followed by a colon, treat as label (identifier) instead
-    if (s_instructions.count(upper) > 0) {
-        // Look ahead to see if there's a colon (label definition)
-        if (peek() != ':') {
-            return Token(TokenType::INSTRUCTION, text, loc);
+    // An instruction name directly followed by a colon is a label instead
+    if (word.type == TokenType::INSTRUCTION) {
+        if (peek() == ':') {
+            return Token(TokenType::IDENTIFIER, text, loc);
         }
-        // If followed by colon, fall through to identifier (label)
+        Token token(TokenType::INSTRUCTION, text, loc);
+        token.mnemonic = word.mnemonic;
+        return token;
     }
 
-    // Default is identifier (label or symbol)
-    return Token(TokenType::IDENTIFIER, text, loc);
+    // Register, keyword, or plain identifier (label or symbol)
+    return Token(word.type, text, loc);
 }
 
 Token Lexer::scanString() {
     SourceLocation loc = currentLocation();
+    size_t start = m_current;
     advance(); // The opening "
 
-    std::string value;
-    while (!isAtEnd() && peek() != '"') {
-        if (peek() == '\\') {
-            advance();
-            if (isAtEnd()) break;
-
-            char escaped = advance();
-            switch (escaped) {
-                case 'n': value += '\n'; break;
-                case 't': value += '\t'; break;
-                case 'r': value += '\r'; break;
-                case '\\': value += '\\'; break;
-                case '"': value += '"'; break;
-                case '\'': value += '\''; break;
-                case 'x': {
-                    // Hex escape \xHH
-                    if (isHexDigit(peek()) && isHexDigit(peekNext())) {
-                        char hex[3] = {advance(), advance(), '\0'};
-                        value += static_cast<char>(std::stoi(hex, nullptr, 16));
-                    }
-                    break;
-                }
-                default: value += escaped; break;
-            }
-        } else {
-            value += advance();
-        }
-    }
+    // Only find the end here; escapes are decoded by Token::getString()
+    skipQuoted('"');
 
     if (!isAtEnd()) {
         advance(); // The closing "
     }
 
-    return Token(TokenType::STRING, value, value, loc);
+    return Token(TokenType::STRING, m_source.substr(start, m_current - start), loc);
 }
 
 Token Lexer::scanCharacter() {
     SourceLocation loc = currentLocation();
+    size_t start = m_current;
     advance(); // The opening '
 
     // NASM strings style support (using single and double quotes)
-    std::string value;
-    while (!isAtEnd() && peek() != '\'') {
-        if (peek() == '\\') {
-            advance();
-            if (isAtEnd()) break;
-
-            char escaped = advance();
-            switch (escaped) {
-                case 'n': value += '\n'; break;
-                case 't': value += '\t'; break;
-                case 'r': value += '\r'; break;
-                case '\\': value += '\\'; break;
-                case '"': value += '"'; break;
-                case '\'': value += '\''; break;
-                case 'x': {
-                    // Hex escape \xHH
-                    if (isHexDigit(peek()) && isHexDigit(peekNext())) {
-                        char hex[3] = {advance(), advance(), '\0'};
-                        value += static_cast<char>(std::stoi(hex, nullptr, 16));
-                    }
-                    break;
-                }
-                default: value += escaped; break;
-            }
-        } else {
-            value += advance();
-        }
-    }
+    skipQuoted('\'');
 
     if (!isAtEnd()) {
         advance(); // The closing '
     }
 
+    std::string_view text = m_source.substr(start, m_current - start);
+
     // If it's a single character, return as NUMBER token (for compatibility)
+    // Short literals decode into the SSO buffer, so this does not allocate
+    std::string value = Token::decodeQuoted(text);
     if (value.length() == 1) {
         int64_t num_value = static_cast<unsigned char>(value[0]);
-        return Token(TokenType::NUMBER, "'" + value + "'", num_value, loc);
+        return Token(TokenType::NUMBER, text, num_value, loc);
     }
 
     // Multi-character string
-    return Token(TokenType::STRING, value, value, loc);
+    return Token(TokenType::STRING, text, loc);
 }
 
 bool Lexer::isAtEnd() const {
@@ -495,25 +342,45 @@ bool Lexer::match(char expected) {
 }
 
 void Lexer::skipWhitespace() {
-    while (!isAtEnd()) {
-        char c = peek();
-        if (c == ' ' || c == '\t' || c == '\r') {
-            advance();
-        } else {
-            break;
-        }
-    }
+    advanceWithinLine(skipBlanks(m_source, m_current));
 }
 
 void Lexer::skipLineComment() {
     // Skip until newline
-    while (!isAtEnd() && peek() != '\n') {
-        advance();
+    advanceWithinLine(findLineEnd(m_source, m_current));
+}
+
+void Lexer::skipQuoted(char quote) {
+    while (!isAtEnd()) {
+        advanceTo(findQuoteOrEscape(m_source, m_current, quote));
+        if (peek() != '\\') {
+            break;
+        }
+        advance();  // The backslash
+        advance();  // The escaped character
     }
 }
 
 SourceLocation Lexer::currentLocation() const {
-    return SourceLocation(m_filename, m_line, m_column);
+    return SourceLocation(m_file, m_line, m_column);
+}
+
+void Lexer::advanceWithinLine(size_t end) {
+    m_column += end - m_current;
+    m_current = end;
+}
+
+void Lexer::advanceTo(size_t end) {
+    // Line and column for the whole run at once rather than per character
+    std::string_view run = m_source.substr(m_current, end - m_current);
+    size_t last_newline = run.rfind('\n');
+    if (last_newline == std::string_view::npos) {
+        m_column += run.size();
+    } else {
+        m_line += static_cast<size_t>(std::count(run.begin(), run.end(), '\n'));
+        m_column = run.size() - last_newline;
+    }
+    m_current = end;
 }
 
 void Lexer::advanceLocation(char c) {
@@ -13,8 +13,6 @@
 #include <string>
 #include <string_view>
 #include <vector>
-#include <unordered_map>
-#include <unordered_set>
 #include "token.h"
 #include "source_location.h"
 
@@ -35,15 +33,18 @@ namespace e2asm {
  * - Comments (line comments with ';')
  *
  * The lexer is designed to be fast and use minimal memory via string_view.
+ * Token lexemes point straight into the source buffer and string literals
+ * are only decoded when asked for, so scanning does not allocate per token.
  */
 class Lexer {
 public:
     /**
      * @brief Constructs a lexer for the given source
-     * @param source Assembly source code (must outlive the Lexer)
-     * @param filename Name to display in error locations
+     * @param source Assembly source code (must outlive the Lexer and its tokens)
+     * @param file Id of the source file in the run's FileTable (for error locations)
+     * @param first_line Line number of the first line of source
      */
-    explicit Lexer(std::string_view source, std::string filename = "<input>");
+    explicit Lexer(std::string_view source, FileId file = FileTable::INPUT, size_t first_line = 1);
 
     /**
      * @brief Scans the entire source and produces all tokens
@@ -52,9 +53,22 @@ public:
      * Skips whitespace and comments automatically. Returns INVALID tokens
      * for unrecognized characters rather than throwing exceptions, allowing
      * the parser to report multiple errors.
+     *
+     * The returned tokens view the source buffer; keep it alive until they
+     * (and anything holding their lexemes) are no longer used.
      */
     std::vector<Token> tokenize();
 
+    /**
+     * @brief Scans the next token on demand
+     * @param token Receives the token (INVALID characters are skipped)
+     * @return false once the source is exhausted; no END_OF_FILE is produced
+     */
+    bool next(Token& token);
+
+    /** @brief Location just past the last character scanned */
+    SourceLocation location() const { return currentLocation(); }
+
 private:
     /** @brief Scans and returns the next token, advancing position */
     Token nextToken();
@@ -92,12 +106,21 @@ private:
     /** @brief Skips from ';' to end of line */
     void skipLineComment();
 
+    /** @brief Skips a quoted literal's body up to (not including) the closing quote */
+    void skipQuoted(char quote);
+
     /** @brief Creates a SourceLocation for the current position */
     SourceLocation currentLocation() const;
 
     /** @brief Updates line/column tracking after consuming a character */
     void advanceLocation(char c);
 
+    /** @brief Moves to `end`, which must be on the current line */
+    void advanceWithinLine(size_t end);
+
+    /** @brief Moves to `end`, counting any newlines in between */
+    void advanceTo(size_t end);
+
     /** @brief Checks if character is a decimal digit */
     bool isDigit(char c) const;
 
@@ -110,26 +133,12 @@ private:
     /** @brief Checks if character can appear in an identifier */
     bool isAlphaNumeric(char c) const;
 
-    /** @brief Determines if an identifier is a keyword or directive */
-    TokenType identifierType(const std::string& text) const;
-
-    /** @brief Determines if an identifier is a register name */
-    TokenType registerType(const std::string& text) const;
-
     std::string_view m_source;  ///< Source text (not owned, must outlive lexer)
-    std::string m_filename;     ///< Filename for error reporting
+    FileId m_file;              ///< Source file id for error reporting
     size_t m_current;           ///< Current position in source
     size_t m_line;              ///< Current line number (1-based)
     size_t m_column;            ///< Current column number (1-based)
 
-    /** @brief Maps directive names to their token types */
-    static const std::unordered_map<std::string, TokenType> s_keywords;
-
-    /** @brief Maps register names to their token types */
-    static const std::unordered_map<std::string, TokenType> s_registers;
-
-    /** @brief Set of all recognized 8086 instruction mnemonics */
-    static const std::unordered_set<std::string> s_instructions;
 };
 
 } // namespace e2asm
@@ -0,0 +1,86 @@
+/**
+ * @file mnemonic.h
+ * @brief Compact ids for 8086 instruction mnemonics
+ *
+ * The lexer classifies each mnemonic once and the id travels with the token
+ * and the Instruction node, so later phases compare a byte instead of
+ * uppercasing and comparing strings.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace e2asm {
+
+/**
+ * Every mnemonic in the instruction table or the lexer's instruction list,
+ * expanded once per use with X(name)
+ */
+#define E2ASM_MNEMONICS(X) \
+    X(AAA) X(AAD) X(AAM) X(AAS) X(ADC) X(ADD) X(AND) X(CALL) X(CBW) X(CLC) X(CLD) X(CLI) \
+    X(CMC) X(CMP) X(CMPS) X(CMPSB) X(CMPSW) X(CWD) X(DAA) X(DAS) X(DEC) X(DIV) X(ESC) X(HLT) \
+    X(IDIV) X(IMUL) X(IN) X(INC) X(INT) X(INT3) X(INTO) X(IRET) X(JA) X(JAE) X(JB) X(JBE) \
+    X(JC) X(JCXZ) X(JE) X(JG) X(JGE) X(JL) X(JLE) X(JMP) X(JNA) X(JNAE) X(JNB) X(JNBE) X(JNC) \
+    X(JNE) X(JNG) X(JNGE) X(JNL) X(JNLE) X(JNO) X(JNP) X(JNS) X(JNZ) X(JO) X(JP) X(JPE) X(JPO) \
+    X(JS) X(JZ) X(LAHF) X(LDS) X(LEA) X(LES) X(LOCK) X(LODS) X(LODSB) X(LODSW) X(LOOP) \
+    X(LOOPE) X(LOOPNE) X(LOOPNZ) X(LOOPZ) X(MOV) X(MOVS) X(MOVSB) X(MOVSW) X(MUL) X(NEG) \
+    X(NOP) X(NOT) X(OR) X(OUT) X(POP) X(POPA) X(POPF) X(PUSH) X(PUSHA) X(PUSHF) X(RCL) X(RCR) \
+    X(REP) X(REPE) X(REPNE) X(REPNZ) X(REPZ) X(RET) X(RETF) X(ROL) X(ROR) X(SAHF) X(SAL) \
+    X(SAR) X(SBB) X(SCAS) X(SCASB) X(SCASW) X(SHL) X(SHR) X(STC) X(STD) X(STI) X(STOS) \
+    X(STOSB) X(STOSW) X(SUB) X(TEST) X(WAIT) X(XCHG) X(XLAT) X(XOR)
+
+/**
+ * @brief Instruction mnemonic id
+ *
+ * NONE marks an Instruction built without going through the lexer; it
+ * matches no encoding.
+ */
+enum class Mnemonic : uint8_t {
+    NONE,
+#define E2ASM_MNEMONIC_ENUM(name) name,
+    E2ASM_MNEMONICS(E2ASM_MNEMONIC_ENUM)
+#undef E2ASM_MNEMONIC_ENUM
+    COUNT
+};
+
+/** @brief Number of ids including NONE, for tables indexed by Mnemonic */
+inline constexpr size_t MNEMONIC_COUNT = static_cast<size_t>(Mnemonic::COUNT);
+
+/** @brief Uppercase names indexed by Mnemonic (empty for NONE) */
+inline constexpr std::string_view MNEMONIC_NAMES[MNEMONIC_COUNT] = {
+    "",
+#define E2ASM_MNEMONIC_NAME(name) #name,
+    E2ASM_MNEMONICS(E2ASM_MNEMONIC_NAME)
+#undef E2ASM_MNEMONIC_NAME
+};
+
+/** @brief Uppercase name of a mnemonic */
+constexpr std::string_view mnemonicName(Mnemonic mnemonic) {
+    return MNEMONIC_NAMES[static_cast<size_t>(mnemonic)];
+}
+
+/**
+ * @brief Checks for branches that only exist in a SHORT (rel8) form on the 8086
+ * @return true for the conditional jumps, LOOPxx and JCXZ
+ */
+constexpr bool isShortOnlyBranch(Mnemonic mnemonic) {
+    switch (mnemonic) {
+        case Mnemonic::JO: case Mnemonic::JNO: case Mnemonic::JB: case Mnemonic::JC:
+        case Mnemonic::JNAE: case Mnemonic::JNB: case Mnemonic::JAE: case Mnemonic::JNC:
+        case Mnemonic::JE: case Mnemonic::JZ: case Mnemonic::JNE: case Mnemonic::JNZ:
+        case Mnemonic::JBE: case Mnemonic::JNA: case Mnemonic::JNBE: case Mnemonic::JA:
+        case Mnemonic::JS: case Mnemonic::JNS: case Mnemonic::JP: case Mnemonic::JPE:
+        case Mnemonic::JNP: case Mnemonic::JPO: case Mnemonic::JL: case Mnemonic::JNGE:
+        case Mnemonic::JNL: case Mnemonic::JGE: case Mnemonic::JLE: case Mnemonic::JNG:
+        case Mnemonic::JNLE: case Mnemonic::JG: case Mnemonic::LOOP: case Mnemonic::LOOPE:
+        case Mnemonic::LOOPZ: case Mnemonic::LOOPNE: case Mnemonic::LOOPNZ: case Mnemonic::JCXZ:
+            return true;
+        default:
+            return false;
+    }
+}
+
+} // namespace e2asm
@@ -0,0 +1,258 @@
+#include "reserved_words.h"
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+namespace e2asm {
+
+namespace {
+
+struct WordEntry {
+    std::string_view name;  // Uppercase
+    TokenType type;
+    Mnemonic mnemonic;
+};
+
+constexpr WordEntry FIXED_WORDS[] = {
+    // Data directives
+    {"DB", TokenType::DIR_DB, Mnemonic::NONE},
+    {"DW", TokenType::DIR_DW, Mnemonic::NONE},
+    {"DD", TokenType::DIR_DD, Mnemonic::NONE},
+    {"DQ", TokenType::DIR_DQ, Mnemonic::NONE},
+    {"DT", TokenType::DIR_DT, Mnemonic::NONE},
+    {"EQU", TokenType::DIR_EQU, Mnemonic::NONE},
+
+    // Segment directives
+    {"SEGMENT", TokenType::DIR_SEGMENT, Mnemonic::NONE},
+    {"SECTION", TokenType::DIR_SECTION, Mnemonic::NONE},
+    {"ENDS", TokenType::DIR_ENDS, Mnemonic::NONE},
+    {"ORG", TokenType::DIR_ORG, Mnemonic::NONE},
+
+    // Reserve directives
+    {"RESB", TokenType::DIR_RESB, Mnemonic::NONE},
+    {"RESW", TokenType::DIR_RESW, Mnemonic::NONE},
+    {"RESD", TokenType::DIR_RESD, Mnemonic::NONE},
+    {"RESQ", TokenType::DIR_RESQ, Mnemonic::NONE},
+    {"REST", TokenType::DIR_REST, Mnemonic::NONE},
+    {"TIMES", TokenType::DIR_TIMES, Mnemonic::NONE},
+
+    // Linkage directives
+    {"GLOBAL", TokenType::DIR_GLOBAL, Mnemonic::NONE},
+    {"EXTERN", TokenType::DIR_EXTERN, Mnemonic::NONE},
+
+    // Size specifiers
+    {"BYTE", TokenType::BYTE_PTR, Mnemonic::NONE},
+    {"BPTR", TokenType::BYTE_PTR, Mnemonic::NONE},
+    {"WORD", TokenType::WORD_PTR, Mnemonic::NONE},
+    {"WPTR", TokenType::WORD_PTR, Mnemonic::NONE},
+    {"DWORD", TokenType::DWORD_PTR, Mnemonic::NONE},
+    {"DPTR", TokenType::DWORD_PTR, Mnemonic::NONE},
+    {"PTR", TokenType::WORD_PTR, Mnemonic::NONE},  // Default to WORD
+
+    // Jump modifiers
+    {"SHORT", TokenType::SHORT_KW, Mnemonic::NONE},
+    {"NEAR", TokenType::NEAR_KW, Mnemonic::NONE},
+    {"FAR", TokenType::FAR_KW, Mnemonic::NONE},
+
+    // 8-bit registers
+    {"AL", TokenType::REG8_AL, Mnemonic::NONE}, {"CL", TokenType::REG8_CL, Mnemonic::NONE},
+    {"DL", TokenType::REG8_DL, Mnemonic::NONE}, {"BL", TokenType::REG8_BL, Mnemonic::NONE},
+    {"AH", TokenType::REG8_AH, Mnemonic::NONE}, {"CH", TokenType::REG8_CH, Mnemonic::NONE},
+    {"DH", TokenType::REG8_DH, Mnemonic::NONE}, {"BH", TokenType::REG8_BH, Mnemonic::NONE},
+
+    // 16-bit registers
+    {"AX", TokenType::REG16_AX, Mnemonic::NONE}, {"CX", TokenType::REG16_CX, Mnemonic::NONE},
+    {"DX", TokenType::REG16_DX, Mnemonic::NONE}, {"BX", TokenType::REG16_BX, Mnemonic::NONE},
+    {"SP", TokenType::REG16_SP, Mnemonic::NONE}, {"BP", TokenType::REG16_BP, Mnemonic::NONE},
+    {"SI", TokenType::REG16_SI, Mnemonic::NONE}, {"DI", TokenType::REG16_DI, Mnemonic::NONE},
+
+    // Segment registers
+    {"ES", TokenType::SEGREG_ES, Mnemonic::NONE}, {"CS", TokenType::SEGREG_CS, Mnemonic::NONE},
+    {"SS", TokenType::SEGREG_SS, Mnemonic::NONE}, {"DS", TokenType::SEGREG_DS, Mnemonic::NONE},
+
+    // Preprocessor directives
+    {"%DEFINE", TokenType::PREP_DEFINE, Mnemonic::NONE},
+    {"%MACRO", TokenType::PREP_MACRO, Mnemonic::NONE},
+    {"%ENDMACRO", TokenType::PREP_ENDMACRO, Mnemonic::NONE},
+    {"%IF", TokenType::PREP_IF, Mnemonic::NONE},
+    {"%ELIF", TokenType::PREP_ELIF, Mnemonic::NONE},
+    {"%ELSE", TokenType::PREP_ELSE, Mnemonic::NONE},
+    {"%ENDIF", TokenType::PREP_ENDIF, Mnemonic::NONE},
+    {"%IFDEF", TokenType::PREP_IFDEF, Mnemonic::NONE},
+    {"%IFNDEF", TokenType::PREP_IFNDEF, Mnemonic::NONE},
+    {"%INCLUDE", TokenType::PREP_INCLUDE, Mnemonic::NONE},
+};
+
+// INT3 has a table row but was never lexed as an instruction; keeping it a
+// plain identifier leaves existing programs (and labels named INT3) alone
+constexpr bool isReservedMnemonic(Mnemonic mnemonic) {
+    return mnemonic != Mnemonic::NONE && mnemonic != Mnemonic::INT3;
+}
+
+constexpr size_t RESERVED_MNEMONICS = [] {
+    size_t count = 0;
+    for (size_t i = 0; i < MNEMONIC_COUNT; i++) {
+        count += isReservedMnemonic(static_cast<Mnemonic>(i)) ? 1 : 0;
+    }
+    return count;
+}();
+
+constexpr size_t WORD_COUNT = std::size(FIXED_WORDS) + RESERVED_MNEMONICS;
+
+constexpr auto WORDS = [] {
+    std::array<WordEntry, WORD_COUNT> words{};
+    size_t next = 0;
+    for (const auto& word : FIXED_WORDS) {
+        words[next++] = word;
+    }
+    for (size_t i = 0; i < MNEMONIC_COUNT; i++) {
+        auto mnemonic = static_cast<Mnemonic>(i);
+        if (isReservedMnemonic(mnemonic)) {
+            words[next++] = {mnemonicName(mnemonic), TokenType::INSTRUCTION, mnemonic};
+        }
+    }
+    return words;
+}();
+
+constexpr size_t MAX_WORD_LENGTH = [] {
+    size_t length = 0;
+    for (const auto& word : WORDS) {
+        length = word.name.size() > length ? word.name.size() : length;
+    }
+    return length;
+}();
+
+constexpr char toUpperAscii(char c) {
+    return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// FNV-1a over the uppercased text
+constexpr uint32_t hashWord(std::string_view text) {
+    uint32_t hash = 2166136261u;
+    for (char c : text) {
+        hash ^= static_cast<uint8_t>(toUpperAscii(c));
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Murmur3 finalizer, spreads hash + displacement over the slots
+constexpr uint32_t mix(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x85EBCA6Bu;
+    value ^= value >> 13;
+    value *= 0xC2B2AE35u;
+    value ^= value >> 16;
+    return value;
+}
+
+// Hash-and-displace: the first-level hash picks a bucket, and each bucket has
+// a displacement chosen so its words land in otherwise empty slots
+constexpr size_t BUCKETS = 64;
+constexpr size_t SLOTS = 512;
+constexpr size_t MAX_BUCKET_WORDS = 16;
+constexpr uint32_t MAX_DISPLACEMENT = 1u << 16;
+
+static_assert(WORD_COUNT < SLOTS / 2, "grow SLOTS to keep the perfect hash easy to find");
+
+struct PerfectHash {
+    std::array<uint32_t, BUCKETS> displacement{};
+    std::array<int16_t, SLOTS> word{};  ///< Index into WORDS, -1 for an empty slot
+    bool complete = false;
+};
+
+constexpr size_t slotOf(uint32_t hash, uint32_t displacement) {
+    return mix(hash + displacement) & (SLOTS - 1);
+}
+
+constexpr PerfectHash PERFECT_HASH = [] {
+    PerfectHash table;
+    for (auto& slot : table.word) {
+        slot = -1;
+    }
+
+    std::array<std::array<uint16_t, MAX_BUCKET_WORDS>, BUCKETS> members{};
+    std::array<size_t, BUCKETS> sizes{};
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        size_t bucket = hashWord(WORDS[i].name) % BUCKETS;
+        if (sizes[bucket] == MAX_BUCKET_WORDS) {
+            return table;
+        }
+        members[bucket][sizes[bucket]++] = static_cast<uint16_t>(i);
+    }
+
+    // Fullest buckets first, while most slots are still free
+    std::array<size_t, BUCKETS> order{};
+    for (size_t i = 0; i < BUCKETS; i++) {
+        order[i] = i;
+    }
+    for (size_t i = 1; i < BUCKETS; i++) {
+        for (size_t j = i; j > 0 && sizes[order[j]] > sizes[order[j - 1]]; j--) {
+            size_t swap = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = swap;
+        }
+    }
+
+    for (size_t bucket : order) {
+        if (sizes[bucket] == 0) {
+            break;
+        }
+
+        bool placed = false;
+        for (uint32_t displacement = 0; !placed && displacement < MAX_DISPLACEMENT; displacement++) {
+            std::array<size_t, MAX_BUCKET_WORDS> slots{};
+            placed = true;
+            for (size_t m = 0; placed && m < sizes[bucket]; m++) {
+                slots[m] = slotOf(hashWord(WORDS[members[bucket][m]].name), displacement);
+                if (table.word[slots[m]] >= 0) {
+                    placed = false;
+                }
+                for (size_t k = 0; placed && k < m; k++) {
+                    placed = slots[k] != slots[m];
+                }
+            }
+            if (placed) {
+                table.displacement[bucket] = displacement;
+                for (size_t m = 0; m < sizes[bucket]; m++) {
+                    table.word[slots[m]] = static_cast<int16_t>(members[bucket][m]);
+                }
+            }
+        }
+        if (!placed) {
+            return table;
+        }
+    }
+
+    table.complete = true;
+    return table;
+}();
+
+static_assert(PERFECT_HASH.complete, "no perfect hash found for the reserved words");
+
+} // namespace
+
+ReservedWord classifyWord(std::string_view text) {
+    if (text.empty() || text.size() > MAX_WORD_LENGTH) {
+        return {};
+    }
+
+    uint32_t hash = hashWord(text);
+    int16_t index = PERFECT_HASH.word[slotOf(hash, PERFECT_HASH.displacement[hash % BUCKETS])];
+    if (index < 0) {
+        return {};
+    }
+
+    const WordEntry& word = WORDS[static_cast<size_t>(index)];
+    if (word.name.size() != text.size()) {
+        return {};
+    }
+    for (size_t i = 0; i < text.size(); i++) {
+        if (toUpperAscii(text[i]) != word.name[i]) {
+            return {};
+        }
+    }
+    return {word.type, word.mnemonic};
+}
+
+} // namespace e2asm
@@ -0,0 +1,38 @@
+/**
+ * @file reserved_words.h
+ * @brief Case-insensitive lookup of every reserved word in one probe
+ *
+ * Registers, directives, size/jump keywords, preprocessor directives and
+ * instruction mnemonics all share a single perfect hash table that is built
+ * at compile time. Classifying an identifier hashes it once, compares it
+ * against at most one candidate, and never allocates or copies the text.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include "mnemonic.h"
+#include "token.h"
+
+namespace e2asm {
+
+/**
+ * @brief What an identifier turned out to be
+ *
+ * type is IDENTIFIER for words that are not reserved. mnemonic is set
+ * only when type is INSTRUCTION.
+ */
+struct ReservedWord {
+    TokenType type = TokenType::IDENTIFIER;
+    Mnemonic mnemonic = Mnemonic::NONE;
+};
+
+/**
+ * @brief Classifies a word, ignoring case
+ * @param text Identifier text, including the leading '%' for preprocessor directives
+ * @return Token type (and mnemonic id for instructions), or IDENTIFIER
+ */
+ReservedWord classifyWord(std::string_view text);
+
+} // namespace e2asm
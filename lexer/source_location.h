@@ -3,48 +3,130 @@
  * @brief Source code position tracking for error reporting
  *
  * Every token and AST node carries a SourceLocation so errors can point to
- * the exact file, line, and column where a problem occurred.
+ * the exact file, line, and column where a problem occurred. File names are
+ * interned once per assembly in a FileTable; locations only carry the id.
  */
 
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
 
 namespace e2asm {
 
+/**
+ * @brief Compact identifier for a source file within one assembly run
+ */
+using FileId = uint32_t;
+
+/**
+ * @brief Registry of the source files seen during one assembly
+ *
+ * Each distinct file name is stored once and handed out as a small FileId,
+ * so tokens and AST nodes don't have to carry their own copy of the path.
+ * Id 0 is always "<input>", the name used for anonymous string sources.
+ *
+ * Names are only looked up again when a diagnostic is rendered.
+ */
+class FileTable {
+public:
+    static constexpr FileId INPUT = 0;  ///< Id of the anonymous "<input>" source
+
+    FileTable() { intern("<input>"); }
+
+    /**
+     * @brief Registers a file name, returning its id
+     * @param name File name or path
+     * @return Existing id if the name was seen before, otherwise a new one
+     */
+    FileId intern(std::string_view name) {
+        auto it = m_ids.find(std::string(name));
+        if (it != m_ids.end()) {
+            return it->second;
+        }
+        FileId id = static_cast<FileId>(m_names.size());
+        m_names.emplace_back(name);
+        m_ids.emplace(m_names.back(), id);
+        return id;
+    }
+
+    /**
+     * @brief Resolves an id back to its file name
+     * @param id Id previously returned by intern()
+     * @return File name, or "<input>" for an unknown id
+     */
+    const std::string& name(FileId id) const {
+        return id < m_names.size() ? m_names[id] : m_names[INPUT];
+    }
+
+    /** @brief Number of registered files (including "<input>") */
+    size_t size() const { return m_names.size(); }
+
+private:
+    std::deque<std::string> m_names;                  ///< Indexed by FileId (deque keeps references stable)
+    std::unordered_map<std::string, FileId> m_ids;    ///< Name -> id
+};
+
 /**
  * @brief Pinpoints an exact position in source code
  *
- * Tracks filename, line, and column for every element in the compilation pipeline.
+ * Tracks file, line, and column for every element in the compilation pipeline.
  * Line and column numbers are 1-based to match how text editors display positions.
  * This enables precise error messages like "boot.asm:42:10: error: undefined label".
+ *
+ * The file is stored as a FileId so the struct stays small and trivially
+ * copyable; resolve it through the FileTable of the run that produced it.
  */
 struct SourceLocation {
-    std::string filename;  ///< Source file path, or "<input>" for string sources
-    size_t line;           ///< 1-based line number (first line is 1)
-    size_t column;         ///< 1-based column number (first character is 1)
+    FileId file;      ///< Id into the assembly's FileTable (FileTable::INPUT for string sources)
+    uint32_t line;    ///< 1-based line number (first line is 1)
+    uint32_t column;  ///< 1-based column number (first character is 1)
 
     /**
      * @brief Creates a default location for anonymous input
      */
-    SourceLocation() : filename("<input>"), line(1), column(1) {}
+    SourceLocation() : file(FileTable::INPUT), line(1), column(1) {}
 
     /**
      * @brief Creates a location for a specific position
-     * @param file Source filename or path
+     * @param f Source file id
      * @param ln Line number (1-based)
      * @param col Column number (1-based)
      */
-    SourceLocation(std::string file, size_t ln, size_t col)
-        : filename(std::move(file)), line(ln), column(col) {}
+    SourceLocation(FileId f, size_t ln, size_t col)
+        : file(f), line(static_cast<uint32_t>(ln)), column(static_cast<uint32_t>(col)) {}
 
     /**
      * @brief Formats location in compiler-standard format
+     * @param files Table the file id belongs to
      * @return String like "file.asm:10:5" compatible with IDE error parsers
      */
+    std::string format(const FileTable& files) const {
+        return format(files.name(file));
+    }
+
+    /**
+     * @brief Formats location with an already-resolved file name
+     * @param filename Name to print in front of line and column
+     * @return String like "file.asm:10:5"
+     */
+    std::string format(std::string_view filename) const {
+        return std::string(filename) + ":" + std::to_string(line) + ":" + std::to_string(column);
+    }
+
+    /**
+     * @brief Formats location without a file table
+     * @return "<input>:line:col" for string sources, "<file N>:line:col" otherwise
+     */
     std::string format() const {
-        return filename + ":" + std::to_string(line) + ":" + std::to_string(column);
+        if (file == FileTable::INPUT) {
+            return format("<input>");
+        }
+        return format("<file " + std::to_string(file) + ">");
     }
 };
 
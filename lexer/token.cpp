@@ -0,0 +1,60 @@
+#include "token.h"
+
+namespace e2asm {
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+std::string Token::getString() const {
+    if (type == TokenType::STRING || type == TokenType::CHARACTER) {
+        return decodeQuoted(lexeme);
+    }
+    return std::string(lexeme);
+}
+
+std::string Token::decodeQuoted(std::string_view literal) {
+    std::string value;
+    if (literal.empty()) {
+        return value;
+    }
+
+    const char quote = literal[0];
+    value.reserve(literal.size());
+
+    size_t i = 1;
+    while (i < literal.size() && literal[i] != quote) {
+        char c = literal[i++];
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+        if (i >= literal.size()) break;
+
+        char escaped = literal[i++];
+        switch (escaped) {
+            case 'n': value += '\n'; break;
+            case 't': value += '\t'; break;
+            case 'r': value += '\r'; break;
+            case '\\': value += '\\'; break;
+            case '"': value += '"'; break;
+            case '\'': value += '\''; break;
+            case 'x': {
+                // Hex escape \xHH
+                if (i + 1 < literal.size() && hexValue(literal[i]) >= 0 && hexValue(literal[i + 1]) >= 0) {
+                    value += static_cast<char>(hexValue(literal[i]) * 16 + hexValue(literal[i + 1]));
+                    i += 2;
+                }
+                break;
+            }
+            default: value += escaped; break;
+        }
+    }
+
+    return value;
+}
+
+} // namespace e2asm
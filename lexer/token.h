@@ -5,13 +5,19 @@
  * Defines all token types recognized by the E2Asm lexer, from registers and
  * instructions to operators and directives. Each token carries its type, original
  * text (lexeme), parsed value if applicable, and source location.
+ *
+ * Lexemes are views into the buffer handed to the Lexer, so tokens are cheap to
+ * copy but must not outlive that buffer (normally the preprocessed source of the
+ * current assembly run).
  */
 
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <variant>
 #include <cstdint>
+#include "mnemonic.h"
 #include "source_location.h"
 
 namespace e2asm {
@@ -51,6 +57,7 @@ enum class TokenType {
     DIR_ORG,                                    // Origin
     DIR_RESB, DIR_RESW, DIR_RESD, DIR_RESQ, DIR_REST,  // Reserve space
     DIR_TIMES,                                  // Repeat
+    DIR_GLOBAL, DIR_EXTERN,                     // Linkage (object modules)
 
     // Preprocessor directives
     PREP_DEFINE,      // %define
@@ -101,6 +108,7 @@ enum class TokenType {
     // Special
     NEWLINE,      ///< End of a logical line (statement separator)
     END_OF_FILE,  ///< Marks the end of input
+    ERROR,        ///< Malformed literal; the lexeme is the message the parser reports
     INVALID       ///< Lexical error (unrecognized character sequence)
 };
 
@@ -108,10 +116,10 @@ enum class TokenType {
  * @brief Optional parsed value attached to a token
  *
  * Most tokens just have a type and lexeme. But NUMBER tokens also carry the
- * parsed numeric value, and STRING tokens carry the unescaped string content.
- * Uses std::variant to type-safely hold either nothing, an integer, or a string.
+ * parsed numeric value. STRING tokens carry nothing here; their unescaped
+ * content is decoded from the lexeme on demand by Token::getString().
  */
-using TokenValue = std::variant<std::monostate, int64_t, double, std::string>;
+using TokenValue = std::variant<std::monostate, int64_t, double>;
 
 /**
  * @brief A single token produced by the lexer
@@ -122,17 +130,18 @@ using TokenValue = std::variant<std::monostate, int64_t, double, std::string>;
  */
 struct Token {
     TokenType type;             ///< What category this token belongs to
-    std::string lexeme;         ///< Exact text from the source code
-    TokenValue value;           ///< Parsed value for NUMBERs and STRINGs
+    std::string_view lexeme;    ///< Exact text from the source code (view, not owned)
+    TokenValue value;           ///< Parsed value for NUMBERs
     SourceLocation location;    ///< Position in source where this token appears
+    Mnemonic mnemonic = Mnemonic::NONE;  ///< Which instruction, for INSTRUCTION tokens
 
     Token() : type(TokenType::INVALID), lexeme(""), value(std::monostate{}), location() {}
 
-    Token(TokenType t, std::string lex, SourceLocation loc)
-        : type(t), lexeme(std::move(lex)), value(std::monostate{}), location(loc) {}
+    Token(TokenType t, std::string_view lex, SourceLocation loc)
+        : type(t), lexeme(lex), value(std::monostate{}), location(std::move(loc)) {}
 
-    Token(TokenType t, std::string lex, TokenValue val, SourceLocation loc)
-        : type(t), lexeme(std::move(lex)), value(std::move(val)), location(loc) {}
+    Token(TokenType t, std::string_view lex, TokenValue val, SourceLocation loc)
+        : type(t), lexeme(lex), value(val), location(std::move(loc)) {}
 
     /**
      * @brief Extracts integer value from NUMBER tokens
@@ -147,14 +156,22 @@ struct Token {
 
     /**
      * @brief Extracts string content from STRING tokens
-     * @return The parsed string, or the lexeme if this isn't a string token
+     * @return The unescaped string, or a copy of the lexeme if this isn't a string token
+     *
+     * String content is decoded here rather than by the lexer, so literals
+     * that are never looked at cost nothing beyond their view.
      */
-    std::string getString() const {
-        if (std::holds_alternative<std::string>(value)) {
-            return std::get<std::string>(value);
-        }
-        return lexeme;
-    }
+    std::string getString() const;
+
+    /**
+     * @brief Decodes a quoted literal and its escape sequences
+     * @param literal Literal text including the opening quote (closing quote optional)
+     * @return Unescaped content between the quotes
+     *
+     * Supports \n, \t, \r, \\, \", \' and \xHH. Stops at the first
+     * unescaped quote matching the opening one.
+     */
+    static std::string decodeQuoted(std::string_view literal);
 
     /**
      * @brief Checks if this is any kind of register (8-bit, 16-bit, or segment)
@@ -0,0 +1,55 @@
+#include "token_stream.h"
+#include <algorithm>
+
+namespace e2asm {
+
+TokenStream::TokenStream(LineSource source, FileId file)
+    : m_source(std::move(source))
+    , m_file(file)
+    , m_lexer(std::string_view(), file)
+{
+}
+
+Token TokenStream::next() {
+    Token token;
+    while (!m_done) {
+        bool lexed;
+        if (m_timed) {
+            auto start = std::chrono::steady_clock::now();
+            lexed = m_lexer.next(token);
+            m_lex_time += std::chrono::steady_clock::now() - start;
+        } else {
+            lexed = m_lexer.next(token);
+        }
+        if (lexed) {
+            if (token.type != TokenType::NEWLINE) {
+                m_token_count++;
+                return token;
+            }
+            continue;
+        }
+
+        // Current line used up, lex the next one
+        auto line = m_source();
+        if (!line) {
+            m_done = true;
+            break;
+        }
+        m_lines.emplace_back(*line);
+        m_peak_lines = std::max(m_peak_lines, m_lines.size());
+        m_lexer = Lexer(m_lines.back(), m_file, m_next_line++);
+    }
+
+    // Same position the batch lexer reports: start of the line after the last
+    return Token(TokenType::END_OF_FILE, "", SourceLocation(m_file, m_next_line, 1));
+}
+
+void TokenStream::release(size_t first_line_in_use) {
+    // The newest line stays, the lexer is still reading it
+    while (m_lines.size() > 1 && m_first_line < first_line_in_use) {
+        m_lines.pop_front();
+        m_first_line++;
+    }
+}
+
+} // namespace e2asm
@@ -0,0 +1,94 @@
+/**
+ * @file token_stream.h
+ * @brief Pull-based tokenizer over a stream of source lines
+ *
+ * Lexer::tokenize() needs the whole source in memory and returns every token
+ * at once. TokenStream instead asks a line source (normally the preprocessor)
+ * for one line at a time and only keeps the lines whose tokens are still
+ * being looked at, so memory stays flat no matter how long the input is.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "lexer.h"
+
+namespace e2asm {
+
+/**
+ * @brief Callback that yields the next source line, or nullopt at the end
+ *
+ * The view only has to stay valid until the callback is called again.
+ */
+using LineSource = std::function<std::optional<std::string_view>()>;
+
+/**
+ * @brief Incremental token source for the parser
+ *
+ * Produces the same tokens as lexing the concatenated lines, minus NEWLINE
+ * tokens (the parser ignores them). Token lexemes view lines held by the
+ * stream; release() drops the lines that no pending token refers to.
+ *
+ * Line numbers count the lines read from the source, starting at 1.
+ */
+class TokenStream {
+public:
+    /**
+     * @brief Creates a stream over a line source
+     * @param source Callback producing lines without their trailing newline
+     * @param file Id of the source file in the run's FileTable
+     */
+    explicit TokenStream(LineSource source, FileId file = FileTable::INPUT);
+
+    /**
+     * @brief Returns the next token
+     * @return Next token, END_OF_FILE (repeatedly) once the source is exhausted
+     */
+    Token next();
+
+    /**
+     * @brief Frees lines that are no longer referenced
+     * @param first_line_in_use Lowest line number whose tokens are still held
+     *
+     * Tokens from earlier lines must not be used after this call.
+     */
+    void release(size_t first_line_in_use);
+
+    /** @brief Number of lines currently kept alive */
+    size_t bufferedLines() const { return m_lines.size(); }
+
+    /** @brief Most lines kept alive at any one time */
+    size_t peakBufferedLines() const { return m_peak_lines; }
+
+    /** @brief Tokens handed out so far, END_OF_FILE excluded */
+    size_t tokenCount() const { return m_token_count; }
+
+    /**
+     * @brief Measures the time spent lexing
+     * @param enabled true to time every token (the line source is not included)
+     */
+    void setTiming(bool enabled) { m_timed = enabled; }
+
+    /** @brief Time spent lexing while timing was enabled */
+    std::chrono::nanoseconds lexTime() const { return m_lex_time; }
+
+private:
+    LineSource m_source;            ///< Where lines come from
+    FileId m_file;                  ///< File id for token locations
+    std::deque<std::string> m_lines;  ///< Lines still referenced, oldest first
+    size_t m_first_line = 1;        ///< Line number of m_lines.front()
+    size_t m_next_line = 1;         ///< Line number of the next line to read
+    Lexer m_lexer;                  ///< Lexer over the newest line
+    bool m_done = false;            ///< Source has been exhausted
+    size_t m_peak_lines = 0;        ///< See peakBufferedLines()
+    size_t m_token_count = 0;       ///< See tokenCount()
+    bool m_timed = false;           ///< See setTiming()
+    std::chrono::nanoseconds m_lex_time{0};  ///< See lexTime()
+};
+
+} // namespace e2asm
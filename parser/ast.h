@@ -5,17 +5,25 @@
  * The AST represents the parsed structure of assembly source code in a form that's
  * easy to analyze and generate code from. Each construct (instruction, directive,
  * label) becomes a specific node type in the tree.
+ *
+ * Nodes are allocated in the Program's AstArena and refer to each other with
+ * plain pointers. Each node carries a NodeKind tag so the phases can switch
+ * on it (or use ast_cast) instead of going through RTTI.
  */
 
 #pragma once
 
+#include <array>
 #include <memory>
 #include <vector>
 #include <string>
 #include <variant>
 #include <optional>
 #include <cstdint>
+#include "../lexer/mnemonic.h"
 #include "../lexer/source_location.h"
+#include "ast_arena.h"
+#include "expression_program.h"
 
 namespace e2asm {
 
@@ -30,52 +38,150 @@ struct SEGMENTDirective;
 struct ENDSDirective;
 struct RESDirective;
 struct TIMESDirective;
+struct LinkageDirective;
 struct Operand;
 struct RegisterOperand;
 struct ImmediateOperand;
 struct MemoryOperand;
 struct LabelRef;
 
+/**
+ * @brief Symbolic term of an address expression, e.g. the "2*COUNT" in [BX+2*COUNT]
+ *
+ * Kept symbolic by the parser. Once every symbol is defined the semantic
+ * analyzer binds the term to its SymbolId, so relaxation passes and the
+ * encoder read the value by index instead of looking the name up again.
+ */
+struct AddressSymbol {
+    std::string name;             ///< Symbol name as written (label or EQU constant)
+    int64_t scale = 1;            ///< Signed multiplier applied to the symbol's value
+    std::optional<uint32_t> id;   ///< SymbolId the name was bound to, if it resolved
+};
+
 /**
  * @brief Parsed memory address expression like [BX+SI+10] or [label+4]
  *
- * The expression parser breaks down complex address calculations into components
- * that the code generator can encode as ModR/M bytes. Handles 8086 addressing
- * modes with base+index registers and displacements.
+ * The parser breaks address calculations down once into the components the
+ * code generator needs for the ModR/M byte: base/index register codes, the
+ * constant part of the displacement (already folded) and the symbolic terms
+ * that still have to be resolved against the symbol table.
  */
 struct AddressExpression {
-    std::vector<std::string> registers; ///< Base/index regs (e.g., "BX", "SI")
-    int64_t displacement = 0;           ///< Numeric offset added to address
-    bool has_displacement = false;      ///< Whether displacement is present
-    std::string label_name;             ///< Symbol reference in address (e.g., [label+BX])
-    bool has_label = false;             ///< Whether a label is referenced
+    std::array<uint8_t, 2> registers{};  ///< Base/index register codes (BX=3, BP=5, SI=6, DI=7)
+    uint8_t register_count = 0;          ///< Number of valid entries in registers
+    int64_t displacement = 0;            ///< Folded numeric part of the displacement
+    bool has_displacement = false;       ///< Whether a numeric displacement was written
+    std::vector<AddressSymbol> symbols;  ///< Symbolic terms added to the displacement
+    bool wide_displacement = false;      ///< Pinned to disp16 by relaxation, never shrinks back
+
+    bool hasRegisters() const { return register_count != 0; }
+    bool hasSymbols() const { return !symbols.empty(); }
+};
+
+/**
+ * @brief Concrete type of an AST node
+ *
+ * Stored in every node so visitors can dispatch with a switch. Operand
+ * kinds mirror Operand::Type.
+ */
+enum class NodeKind : uint8_t {
+    PROGRAM,
+    INSTRUCTION,
+    LABEL,
+    DATA,
+    EQU,
+    ORG,
+    SEGMENT,
+    ENDS,
+    RES,
+    TIMES,
+    LINKAGE,
+    REGISTER_OPERAND,
+    IMMEDIATE_OPERAND,
+    MEMORY_OPERAND,
+    LABEL_REF
 };
 
 /**
  * @brief Base class for all AST nodes
  *
  * Every element in the syntax tree inherits from ASTNode and carries its
- * source location. Enables polymorphic traversal of the tree and precise
- * error reporting.
+ * kind and source location. Nodes live in an AstArena, are never deleted
+ * through a base pointer and so need no virtual destructor.
  */
 struct ASTNode {
+    NodeKind kind;            ///< Concrete node type (see ast_cast)
     SourceLocation location;  ///< Where in source this construct appeared
 
-    explicit ASTNode(SourceLocation loc) : location(loc) {}
-    virtual ~ASTNode() = default;
+    ASTNode(NodeKind k, SourceLocation loc) : kind(k), location(loc) {}
 };
 
+/**
+ * @brief Checked downcast based on the node's kind tag
+ * @return node as T, or nullptr if it is a different kind (or null)
+ */
+template <typename T>
+T* ast_cast(ASTNode* node) {
+    return node && node->kind == T::KIND ? static_cast<T*>(node) : nullptr;
+}
+
+/** @copydoc ast_cast(ASTNode*) */
+template <typename T>
+const T* ast_cast(const ASTNode* node) {
+    return node && node->kind == T::KIND ? static_cast<const T*>(node) : nullptr;
+}
+
 /**
  * @brief Root of the AST representing a complete assembly file
  *
  * Contains all top-level statements (instructions, labels, directives) in
  * the order they appear in source. The semantic analyzer and code generator
  * process these statements sequentially.
+ *
+ * The Program owns the arena every other node is allocated from; destroying
+ * it frees the whole tree at once.
  */
 struct Program : ASTNode {
-    std::vector<std::unique_ptr<ASTNode>> statements;  ///< All top-level constructs
+    static constexpr NodeKind KIND = NodeKind::PROGRAM;
+
+    AstArena arena;                   ///< Storage for all nodes below this one
+    std::vector<ASTNode*> statements; ///< All top-level constructs (arena-owned)
 
-    explicit Program(SourceLocation loc = SourceLocation()) : ASTNode(loc) {}
+    explicit Program(SourceLocation loc = SourceLocation()) : ASTNode(KIND, loc) {}
+};
+
+/**
+ * @brief Fixed-capacity operand list stored inside its Instruction
+ *
+ * 8086 instructions take at most two explicit operands, so the list is an
+ * inline array rather than a separately allocated vector. The operands
+ * themselves are arena nodes created right after their instruction.
+ */
+class OperandList {
+public:
+    static constexpr size_t CAPACITY = 3;  ///< One spare slot so a stray third operand still reaches the encoder
+
+    /**
+     * @brief Appends an operand
+     * @return false if the list is already full
+     */
+    bool push_back(Operand* operand) {
+        if (m_count == CAPACITY) return false;
+        m_items[m_count++] = operand;
+        return true;
+    }
+
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+    Operand* operator[](size_t i) const { return m_items[i]; }
+
+    Operand* const* begin() const { return m_items; }
+    Operand* const* end() const { return m_items + m_count; }
+
+private:
+    Operand* m_items[CAPACITY] = {};
+    size_t m_count = 0;
 };
 
 /**
@@ -86,14 +192,17 @@ struct Program : ASTNode {
  * then the code generator emits the actual machine bytes.
  */
 struct Instruction : ASTNode {
-    std::string mnemonic;                        ///< Operation name (MOV, ADD, JMP, etc.)
-    std::vector<std::unique_ptr<Operand>> operands;  ///< Destination and source operands
+    static constexpr NodeKind KIND = NodeKind::INSTRUCTION;
+
+    std::string mnemonic;   ///< Operation name as written (MOV, add, JMP, etc.)
+    Mnemonic id;            ///< Which instruction, used for every comparison
+    OperandList operands;   ///< Destination and source operands
 
     size_t assigned_address = 0;  ///< Memory address assigned by semantic analyzer
     size_t estimated_size = 0;    ///< Instruction size in bytes (1-6 for 8086)
 
-    Instruction(std::string mn, SourceLocation loc)
-        : ASTNode(loc), mnemonic(std::move(mn)) {}
+    Instruction(std::string mn, Mnemonic mnemonic_id, SourceLocation loc)
+        : ASTNode(KIND, loc), mnemonic(std::move(mn)), id(mnemonic_id) {}
 };
 
 /**
@@ -104,10 +213,12 @@ struct Instruction : ASTNode {
  * labels (start, loop) and local labels (.retry, .done).
  */
 struct Label : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::LABEL;
+
     std::string name;  ///< Label identifier (e.g., "start" or ".loop")
 
     Label(std::string n, SourceLocation loc)
-        : ASTNode(loc), name(std::move(n)) {}
+        : ASTNode(KIND, loc), name(std::move(n)) {}
 };
 
 /**
@@ -139,6 +250,8 @@ struct DataValue {
  * characters: "DB 'Hello', 0, 13, 10" becomes bytes in the binary.
  */
 struct DataDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::DATA;
+
     enum class Size {
         BYTE,   ///< DB - 1 byte per value
         WORD,   ///< DW - 2 bytes per value
@@ -150,7 +263,7 @@ struct DataDirective : ASTNode {
     std::vector<DataValue> values;  ///< All values to emit
 
     DataDirective(Size s, SourceLocation loc)
-        : ASTNode(loc), size(s) {}
+        : ASTNode(KIND, loc), size(s) {}
 };
 
 /**
@@ -161,11 +274,13 @@ struct DataDirective : ASTNode {
  * Example: "WIDTH EQU 80" allows using WIDTH in place of 80.
  */
 struct EQUDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::EQU;
+
     std::string name;  ///< Constant name
     int64_t value;     ///< Constant value (must be computable at assembly time)
 
     EQUDirective(std::string n, int64_t val, SourceLocation loc)
-        : ASTNode(loc), name(std::move(n)), value(val) {}
+        : ASTNode(KIND, loc), name(std::move(n)), value(val) {}
 };
 
 /**
@@ -175,10 +290,12 @@ struct EQUDirective : ASTNode {
  * and relative jumps. Common values: 0x100 (COM programs), 0x7C00 (boot sector).
  */
 struct ORGDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::ORG;
+
     int64_t address;  ///< Base load address
 
     ORGDirective(int64_t addr, SourceLocation loc)
-        : ASTNode(loc), address(addr) {}
+        : ASTNode(KIND, loc), address(addr) {}
 };
 
 /**
@@ -188,10 +305,12 @@ struct ORGDirective : ASTNode {
  * larger programs into logical sections. SECTION is a synonym for SEGMENT.
  */
 struct SEGMENTDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::SEGMENT;
+
     std::string name;  ///< Segment name (e.g., "CODE", "DATA", ".text")
 
     SEGMENTDirective(std::string n, SourceLocation loc)
-        : ASTNode(loc), name(std::move(n)) {}
+        : ASTNode(KIND, loc), name(std::move(n)) {}
 };
 
 /**
@@ -201,10 +320,12 @@ struct SEGMENTDirective : ASTNode {
  * SEGMENT directive.
  */
 struct ENDSDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::ENDS;
+
     std::string name;  ///< Name of segment being closed
 
     ENDSDirective(std::string n, SourceLocation loc)
-        : ASTNode(loc), name(std::move(n)) {}
+        : ASTNode(KIND, loc), name(std::move(n)) {}
 };
 
 /**
@@ -214,6 +335,8 @@ struct ENDSDirective : ASTNode {
  * creating buffers. "RESB 100" reserves 100 bytes without specifying contents.
  */
 struct RESDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::RES;
+
     enum class Size {
         BYTE,   ///< RESB - 1 byte per unit
         WORD,   ///< RESW - 2 bytes per unit
@@ -225,7 +348,7 @@ struct RESDirective : ASTNode {
     int64_t count;  ///< Number of units to reserve
 
     RESDirective(Size s, int64_t cnt, SourceLocation loc)
-        : ASTNode(loc), size(s), count(cnt) {}
+        : ASTNode(KIND, loc), size(s), count(cnt) {}
 };
 
 /**
@@ -236,12 +359,37 @@ struct RESDirective : ASTNode {
  * Supports expressions with $ (current address) and $$ (section start).
  */
 struct TIMESDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::TIMES;
+
     int64_t count;                          ///< Evaluated repetition count
     std::string count_expr;                 ///< Original expression (e.g., "512-($-$$)")
-    std::unique_ptr<ASTNode> repeated_node; ///< What to repeat
+    ExpressionProgram count_program;        ///< Compiled count_expr, set when it isn't a plain number
+    ASTNode* repeated_node = nullptr;       ///< What to repeat (arena-owned)
+    bool symbolic_count = false;            ///< count depends on symbols or $/$$, evaluated on every analysis pass
 
     TIMESDirective(int64_t cnt, std::string expr, SourceLocation loc)
-        : ASTNode(loc), count(cnt), count_expr(std::move(expr)) {}
+        : ASTNode(KIND, loc), count(cnt), count_expr(std::move(expr)) {}
+};
+
+/**
+ * @brief Symbol linkage directive (GLOBAL names or EXTERN names)
+ *
+ * Only meaningful when a source is assembled into an object module:
+ * GLOBAL exports labels to other modules, EXTERN declares symbols that
+ * another module defines and the linker fills in.
+ */
+struct LinkageDirective : ASTNode {
+    static constexpr NodeKind KIND = NodeKind::LINKAGE;
+
+    enum class Kind {
+        GLOBAL,  ///< Labels this module exports
+        EXTERN   ///< Symbols this module imports
+    } linkage;
+
+    std::vector<std::string> names;  ///< Symbols listed, in source order
+
+    LinkageDirective(Kind k, SourceLocation loc)
+        : ASTNode(KIND, loc), linkage(k) {}
 };
 
 /**
@@ -259,7 +407,7 @@ struct Operand : ASTNode {
         LABEL_REF   ///< Label for jumps/calls
     } type;
 
-    Operand(Type t, SourceLocation loc) : ASTNode(loc), type(t) {}
+    Operand(Type t, NodeKind k, SourceLocation loc) : ASTNode(k, loc), type(t) {}
 };
 
 /**
@@ -269,13 +417,15 @@ struct Operand : ASTNode {
  * value, size, and whether it's a segment register.
  */
 struct RegisterOperand : Operand {
+    static constexpr NodeKind KIND = NodeKind::REGISTER_OPERAND;
+
     std::string name;     ///< Register name as written ("AX", "BL", etc.)
     uint8_t size;         ///< 8 or 16 bits
     uint8_t code;         ///< 3-bit encoding value (0-7) for ModR/M byte
     bool is_segment;      ///< true for ES, CS, SS, DS
 
     RegisterOperand(std::string n, uint8_t sz, uint8_t c, bool seg, SourceLocation loc)
-        : Operand(Type::REGISTER, loc), name(std::move(n)), size(sz), code(c), is_segment(seg) {}
+        : Operand(Type::REGISTER, KIND, loc), name(std::move(n)), size(sz), code(c), is_segment(seg) {}
 };
 
 /**
@@ -286,16 +436,20 @@ struct RegisterOperand : Operand {
  * semantic analysis. The size_hint helps the encoder choose byte vs word encoding.
  */
 struct ImmediateOperand : Operand {
+    static constexpr NodeKind KIND = NodeKind::IMMEDIATE_OPERAND;
+
     int64_t value;              ///< Numeric value (if not a symbol)
     uint8_t size_hint;          ///< 8 or 16 bits, 0 means infer from context
     std::string label_name;     ///< Symbol being referenced
     bool has_label;             ///< true if this is a symbol, not a number
+    ExpressionProgram expression; ///< Compiled label_name when it is more than one symbol
+    std::optional<uint32_t> label_id; ///< SymbolId bound for a single-symbol label_name
 
     ImmediateOperand(int64_t val, SourceLocation loc, uint8_t hint = 0)
-        : Operand(Type::IMMEDIATE, loc), value(val), size_hint(hint), has_label(false) {}
+        : Operand(Type::IMMEDIATE, KIND, loc), value(val), size_hint(hint), has_label(false) {}
 
     ImmediateOperand(std::string label, SourceLocation loc, uint8_t hint = 0)
-        : Operand(Type::IMMEDIATE, loc), value(0), size_hint(hint),
+        : Operand(Type::IMMEDIATE, KIND, loc), value(0), size_hint(hint),
           label_name(std::move(label)), has_label(true) {}
 };
 
@@ -310,15 +464,18 @@ struct ImmediateOperand : Operand {
  * - Size hints: BYTE [BX], WORD [SI]
  */
 struct MemoryOperand : Operand {
+    static constexpr NodeKind KIND = NodeKind::MEMORY_OPERAND;
+
     std::optional<std::string> segment_override;   ///< ES/CS/SS/DS if specified
     std::string address_expr;                      ///< Original bracketed expression
-    std::unique_ptr<AddressExpression> parsed_address; ///< Parsed components
+    std::optional<AddressExpression> parsed_address; ///< Parsed components
+    std::optional<AddressExpression> written_address; ///< parsed_address before constants were folded in
     bool is_direct_address;                        ///< true for [1234] form
     uint16_t direct_address_value;                 ///< Value when is_direct_address
     uint8_t size_hint;                             ///< 8 or 16 bits, 0 means infer
 
     MemoryOperand(std::string addr, SourceLocation loc, uint8_t hint = 0)
-        : Operand(Type::MEMORY, loc)
+        : Operand(Type::MEMORY, KIND, loc)
         , address_expr(std::move(addr))
         , is_direct_address(false)
         , direct_address_value(0)
@@ -333,11 +490,15 @@ struct MemoryOperand : Operand {
  * or FAR (segment:offset).
  */
 struct LabelRef : Operand {
+    static constexpr NodeKind KIND = NodeKind::LABEL_REF;
+
     std::string label;                               ///< Target label name
     enum class JumpType { SHORT, NEAR, FAR } jump_type; ///< Jump distance hint
+    bool distance_explicit = false;                  ///< SHORT/NEAR/FAR written in source (not relaxed)
+    std::optional<uint32_t> label_id;                ///< SymbolId bound for label by the semantic analyzer
 
     LabelRef(std::string lbl, SourceLocation loc, JumpType jt = JumpType::NEAR)
-        : Operand(Type::LABEL_REF, loc), label(std::move(lbl)), jump_type(jt) {}
+        : Operand(Type::LABEL_REF, KIND, loc), label(std::move(lbl)), jump_type(jt) {}
 };
 
 } // namespace e2asm
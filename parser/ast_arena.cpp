@@ -0,0 +1,50 @@
+#include "ast_arena.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace e2asm {
+
+AstArena::~AstArena() {
+    // Later nodes may refer to earlier ones, so tear down newest first
+    for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+}
+
+void AstArena::reset() {
+    for (auto it = m_destructors.rbegin(); it != m_destructors.rend(); ++it) {
+        it->destroy(it->object);
+    }
+    m_destructors.clear();
+
+    // Blocks past the first were only needed by a bigger tree
+    if (m_blocks.size() > 1) {
+        m_blocks.resize(1);
+    }
+    m_cursor = m_blocks.empty() ? nullptr : m_blocks.front().get();
+    m_end = m_blocks.empty() ? nullptr : m_cursor + BLOCK_SIZE;
+    m_bytes_used = 0;
+}
+
+void* AstArena::allocate(size_t size, size_t alignment) {
+    auto aligned = [alignment](std::byte* p) {
+        auto address = reinterpret_cast<std::uintptr_t>(p);
+        return reinterpret_cast<std::byte*>((address + alignment - 1) & ~(alignment - 1));
+    };
+
+    std::byte* start = m_cursor ? aligned(m_cursor) : nullptr;
+    if (!start || start + size > m_end) {
+        // Oversized nodes get a block of their own
+        size_t block_size = std::max(BLOCK_SIZE, size + alignment);
+        m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(block_size));
+        m_cursor = m_blocks.back().get();
+        m_end = m_cursor + block_size;
+        start = aligned(m_cursor);
+    }
+
+    m_cursor = start + size;
+    m_bytes_used += size;
+    return start;
+}
+
+} // namespace e2asm
@@ -0,0 +1,85 @@
+/**
+ * @file ast_arena.h
+ * @brief Bump allocator that owns every node of one parsed program
+ *
+ * AST nodes are created once by the parser and never freed individually, so
+ * they are carved out of large blocks instead of going through the heap one
+ * node at a time. Nodes end up laid out in source order and the whole tree is
+ * released together when its Program goes away.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace e2asm {
+
+/**
+ * @brief Block-based bump arena for AST nodes
+ *
+ * make<T>() constructs a node in the current block and returns a plain
+ * pointer that stays valid for the arena's lifetime. Destructors of
+ * non-trivial nodes (most own a std::string) are recorded and run in reverse
+ * construction order when the arena is destroyed.
+ *
+ * The arena is not copyable or movable - nodes point at each other.
+ */
+class AstArena {
+public:
+    AstArena() = default;
+    ~AstArena();
+
+    AstArena(const AstArena&) = delete;
+    AstArena& operator=(const AstArena&) = delete;
+
+    /**
+     * @brief Constructs a node inside the arena
+     * @param args Constructor arguments forwarded to T
+     * @return Pointer owned by the arena
+     */
+    template <typename T, typename... Args>
+    T* make(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        T* object = new (memory) T(std::forward<Args>(args)...);
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            m_destructors.push_back({object, [](void* p) { static_cast<T*>(p)->~T(); }});
+        }
+        return object;
+    }
+
+    /**
+     * @brief Destroys every node but keeps the first block for the next tree
+     *
+     * For callers that parse many small trees one after another; the
+     * destructor list keeps its capacity too, so a tree that fits in one
+     * block is built again without touching the heap for the arena.
+     */
+    void reset();
+
+    /** @brief Bytes handed out so far (excluding block slack) */
+    size_t bytesUsed() const { return m_bytes_used; }
+
+private:
+    /** @brief Returns aligned storage, starting a new block when the current one is full */
+    void* allocate(size_t size, size_t alignment);
+
+    static constexpr size_t BLOCK_SIZE = 16 * 1024;  ///< Default block size in bytes
+
+    struct Destructor {
+        void* object;
+        void (*destroy)(void*);
+    };
+
+    std::vector<std::unique_ptr<std::byte[]>> m_blocks;  ///< All blocks, oldest first
+    std::byte* m_cursor = nullptr;                       ///< Next free byte in the current block
+    std::byte* m_end = nullptr;                          ///< One past the current block
+    size_t m_bytes_used = 0;                             ///< Total bytes allocated
+    std::vector<Destructor> m_destructors;               ///< Pending destructor calls
+};
+
+} // namespace e2asm
@@ -1,456 +1,257 @@
 #include "expression_parser.h"
 #include "ast.h"
-#include <algorithm>
-#include <cctype>
-#include <sstream>
+#include "../lexer/lexer.h"
 
 namespace e2asm {
 
-// Helper method moved from header
-std::string addressExprToString(const AddressExpression& expr) {
-    std::string result = "[";
-    for (size_t i = 0; i < expr.registers.size(); i++) {
-        if (i > 0) result += "+";
-        result += expr.registers[i];
-    }
-    if (expr.has_displacement) {
-        if (!expr.registers.empty()) result += "+";
-        result += std::to_string(expr.displacement);
+namespace {
+
+/**
+ * Recursive descent over the tokens of a bracketed address. Every
+ * subexpression is kept in linear form (registers + constant + scaled
+ * symbols), which is all an 8086 effective address can be.
+ */
+class AddressParser {
+public:
+    explicit AddressParser(const std::vector<Token>& tokens) : m_tokens(tokens) {}
+
+    std::optional<AddressExpression> parse() {
+        AddressExpression result;
+        if (!parseSum(result) || m_pos != m_tokens.size()) {
+            return std::nullopt;
+        }
+        return result;
     }
-    result += "]";
-    return result;
-}
 
-// Valid addressing registers
-static const std::vector<std::string> VALID_ADDRESSING_REGS = {
-    "BX", "BP", "SI", "DI"
-};
+private:
+    bool parseSum(AddressExpression& out) {
+        if (!parseProduct(out)) return false;
 
-std::optional<AddressExpression> ExpressionParser::parseAddress(const std::string& expr) {
-    AddressExpression result;
-
-    // Split by '+' and '-'
-    std::string current;
-    std::vector<std::string> parts;
-    bool is_negative = false;
-
-    for (size_t i = 0; i < expr.length(); i++) {
-        char c = expr[i];
-
-        if (c == '+' || c == '-') {
-            if (!current.empty()) {
-                // Trim whitespace
-                current.erase(0, current.find_first_not_of(" \t"));
-                current.erase(current.find_last_not_of(" \t") + 1);
-
-                if (!current.empty()) {
-                    if (is_negative) {
-                        current = "-" + current;
-                    }
-                    parts.push_back(current);
-                }
-                current.clear();
-            }
-            is_negative = (c == '-');
-        } else {
-            current += c;
+        while (peekIs(TokenType::PLUS) || peekIs(TokenType::MINUS)) {
+            bool subtract = m_tokens[m_pos++].type == TokenType::MINUS;
+            AddressExpression rhs;
+            if (!parseProduct(rhs)) return false;
+            if (subtract && !scale(rhs, -1)) return false;
+            if (!add(out, rhs)) return false;
         }
+        return true;
     }
 
-    // Add last part
-    if (!current.empty()) {
-        current.erase(0, current.find_first_not_of(" \t"));
-        current.erase(current.find_last_not_of(" \t") + 1);
-        if (!current.empty()) {
-            if (is_negative) {
-                current = "-" + current;
+    bool parseProduct(AddressExpression& out) {
+        if (!parseUnary(out)) return false;
+
+        while (peekIs(TokenType::STAR) || peekIs(TokenType::SLASH)) {
+            bool divide = m_tokens[m_pos++].type == TokenType::SLASH;
+            AddressExpression rhs;
+            if (!parseUnary(rhs)) return false;
+
+            if (divide) {
+                // Only constants can be divided
+                if (!isConstant(out) || !isConstant(rhs) || rhs.displacement == 0) return false;
+                out.displacement /= rhs.displacement;
+            } else if (isConstant(rhs)) {
+                if (!scale(out, rhs.displacement)) return false;
+            } else if (isConstant(out)) {
+                int64_t factor = out.displacement;
+                bool had_number = out.has_displacement;
+                out = std::move(rhs);
+                out.has_displacement |= had_number;
+                if (!scale(out, factor)) return false;
+            } else {
+                return false;  // Product of two symbolic terms
             }
-            parts.push_back(current);
         }
+        return true;
     }
 
-    // Classify each part as register, number, or label
-    for (const auto& part : parts) {
-        if (isRegister(part)) {
-            result.registers.push_back(normalizeRegister(part));
-        } else {
-            // Try to parse as number
-            auto num = parseNumber(part);
-            if (num) {
-                result.displacement += *num;
-                result.has_displacement = true;
-            } else {
-                // Treat as label/symbol reference
-                // Check if it's a valid identifier (letters, digits, underscore, dot)
-                bool is_valid_identifier = !part.empty();
-                for (char c : part) {
-                    if (!std::isalnum(c) && c != '_' && c != '.') {
-                        is_valid_identifier = false;
-                        break;
-                    }
-                }
-
-                if (is_valid_identifier && std::isalpha(part[0])) {
-                    // Valid label reference
-                    result.label_name = part;
-                    result.has_label = true;
-                } else {
-                    // Invalid part
-                    return std::nullopt;
-                }
-            }
+    bool parseUnary(AddressExpression& out) {
+        if (m_pos >= m_tokens.size()) return false;
+        const Token& token = m_tokens[m_pos++];
+
+        switch (token.type) {
+            case TokenType::PLUS:
+                return parseUnary(out);
+            case TokenType::MINUS:
+                return parseUnary(out) && scale(out, -1);
+            case TokenType::LPAREN:
+                if (!parseSum(out) || !peekIs(TokenType::RPAREN)) return false;
+                ++m_pos;
+                return true;
+            case TokenType::NUMBER:
+                out.displacement = token.getNumber();
+                out.has_displacement = true;
+                return true;
+            case TokenType::IDENTIFIER:
+                out.symbols.push_back({std::string(token.lexeme), 1, std::nullopt});
+                return true;
+            case TokenType::REG16_BX:
+            case TokenType::REG16_BP:
+            case TokenType::REG16_SI:
+            case TokenType::REG16_DI:
+                out.registers[0] = static_cast<uint8_t>(
+                    static_cast<int>(token.type) - static_cast<int>(TokenType::REG16_AX));
+                out.register_count = 1;
+                return true;
+            default:
+                return false;
         }
     }
 
-    return result;
-}
-
-std::optional<int64_t> ExpressionParser::evaluate(const std::string& expr) {
-    // Use arithmetic evaluator for Phase 8
-    return evaluateArithmetic(expr);
-}
-
-std::optional<int64_t> ExpressionParser::evaluateWithContext(
-    const std::string& expr,
-    uint64_t current_pos,
-    uint64_t segment_start
-) {
-    // Replace $ and $$ with actual values
-    std::string processed_expr = expr;
-
-    // Replace $$ first (to avoid confusion with $)
-    size_t pos = 0;
-    while ((pos = processed_expr.find("$$", pos)) != std::string::npos) {
-        processed_expr.replace(pos, 2, std::to_string(segment_start));
-        pos += std::to_string(segment_start).length();
+    static bool isConstant(const AddressExpression& expr) {
+        return !expr.hasRegisters() && !expr.hasSymbols();
     }
 
-    // Replace single $
-    pos = 0;
-    while ((pos = processed_expr.find('$', pos)) != std::string::npos) {
-        processed_expr.replace(pos, 1, std::to_string(current_pos));
-        pos += std::to_string(current_pos).length();
+    // Registers can't be negated or scaled on the 8086
+    static bool scale(AddressExpression& expr, int64_t factor) {
+        if (expr.hasRegisters() && factor != 1) return false;
+        expr.displacement *= factor;
+        for (auto& symbol : expr.symbols) {
+            symbol.scale *= factor;
+        }
+        return true;
     }
 
-    // Now evaluate the expression with basic arithmetic
-    return evaluateArithmetic(processed_expr);
-}
+    static bool add(AddressExpression& lhs, AddressExpression& rhs) {
+        if (lhs.register_count + rhs.register_count > lhs.registers.size()) return false;
+        for (uint8_t i = 0; i < rhs.register_count; ++i) {
+            lhs.registers[lhs.register_count++] = rhs.registers[i];
+        }
+        lhs.displacement += rhs.displacement;
+        lhs.has_displacement |= rhs.has_displacement;
+        for (auto& symbol : rhs.symbols) {
+            lhs.symbols.push_back(std::move(symbol));
+        }
+        return true;
+    }
 
-std::optional<int64_t> ExpressionParser::evaluateArithmetic(const std::string& expr) {
-    // Remove whitespace
-    std::string clean;
-    for (char c : expr) {
-        if (!std::isspace(c)) clean += c;
+    bool peekIs(TokenType type) const {
+        return m_pos < m_tokens.size() && m_tokens[m_pos].type == type;
     }
 
-    if (clean.empty()) return std::nullopt;
+    const std::vector<Token>& m_tokens;
+    size_t m_pos = 0;
+};
 
-    // Parse addition/subtraction (lowest precedence, right-to-left scan)
-    for (size_t i = clean.length(); i > 0; i--) {
-        char c = clean[i-1];
-        // Skip if this is a negative sign at the start or after an operator
-        if (i == 1 || (c == '-' && (clean[i-2] == '+' || clean[i-2] == '-' ||
-                                     clean[i-2] == '*' || clean[i-2] == '/' ||
-                                     clean[i-2] == '('))) {
-            continue;
+/**
+ * Recursive descent over the tokens of an arithmetic expression, emitting
+ * postfix steps as it goes. ExpressionProgram folds constant operands as they
+ * are appended, so "2*(3+4)" ends up as a single PUSH_CONST.
+ */
+class ExpressionCompiler {
+public:
+    explicit ExpressionCompiler(const std::vector<Token>& tokens) : m_tokens(tokens) {}
+
+    std::optional<ExpressionProgram> compile() {
+        if (!parseSum() || m_pos != m_tokens.size()) {
+            return std::nullopt;
         }
+        return std::move(m_program);
+    }
 
-        if (c == '+' || c == '-') {
-            auto left = evaluateArithmetic(clean.substr(0, i-1));
-            auto right = evaluateArithmetic(clean.substr(i));
-            if (!left || !right) return std::nullopt;
+private:
+    bool parseSum() {
+        if (!parseProduct()) return false;
 
-            return (c == '+') ? (*left + *right) : (*left - *right);
+        while (peekIs(TokenType::PLUS) || peekIs(TokenType::MINUS)) {
+            ExprOp op = m_tokens[m_pos++].type == TokenType::PLUS ? ExprOp::ADD : ExprOp::SUB;
+            if (!parseProduct() || !m_program.apply(op)) return false;
         }
+        return true;
     }
 
-    // Parse multiplication/division (higher precedence, right-to-left scan)
-    for (size_t i = clean.length(); i > 0; i--) {
-        char c = clean[i-1];
-        if (c == '*' || c == '/') {
-            auto left = evaluateArithmetic(clean.substr(0, i-1));
-            auto right = evaluateArithmetic(clean.substr(i));
-            if (!left || !right) return std::nullopt;
-            if (c == '/' && *right == 0) return std::nullopt;  // Division by zero
+    bool parseProduct() {
+        if (!parseUnary()) return false;
 
-            return (c == '*') ? (*left * *right) : (*left / *right);
+        while (peekIs(TokenType::STAR) || peekIs(TokenType::SLASH)) {
+            ExprOp op = m_tokens[m_pos++].type == TokenType::STAR ? ExprOp::MUL : ExprOp::DIV;
+            if (!parseUnary() || !m_program.apply(op)) return false;
         }
+        return true;
     }
 
-    // Handle parentheses
-    if (clean.front() == '(' && clean.back() == ')') {
-        return evaluateArithmetic(clean.substr(1, clean.length() - 2));
+    bool parseUnary() {
+        if (m_pos >= m_tokens.size()) return false;
+        const Token& token = m_tokens[m_pos++];
+
+        switch (token.type) {
+            case TokenType::PLUS:
+                return parseUnary();
+            case TokenType::MINUS:
+                return parseUnary() && m_program.apply(ExprOp::NEG);
+            case TokenType::LPAREN:
+                if (!parseSum() || !peekIs(TokenType::RPAREN)) return false;
+                ++m_pos;
+                return true;
+            case TokenType::NUMBER:
+                return m_program.pushConstant(token.getNumber());
+            case TokenType::CHARACTER: {
+                std::string text = token.getString();
+                return !text.empty() && m_program.pushConstant(static_cast<int>(text[0]));
+            }
+            case TokenType::IDENTIFIER:
+                return m_program.pushSymbol(token.lexeme);
+            case TokenType::DOLLAR:
+                return m_program.pushHere();
+            case TokenType::DOUBLE_DOLLAR:
+                return m_program.pushSectionStart();
+            default:
+                return false;
+        }
     }
 
-    // Base case: parse as number
-    return parseNumber(clean);
-}
-
-std::optional<int64_t> ExpressionParser::parseNumber(const std::string& str) {
-    if (str.empty()) return std::nullopt;
-
-    std::string s = str;
-    bool is_negative = false;
-
-    // Handle negative sign
-    if (s[0] == '-') {
-        is_negative = true;
-        s = s.substr(1);
+    bool peekIs(TokenType type) const {
+        return m_pos < m_tokens.size() && m_tokens[m_pos].type == type;
     }
 
-    try {
-        int64_t value = 0;
+    const std::vector<Token>& m_tokens;
+    size_t m_pos = 0;
+    ExpressionProgram m_program;
+};
 
-        // Check for hex prefix
-        if (s.length() >= 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
-            value = std::stoll(s.substr(2), nullptr, 16);
-        }
-        // Check for hex suffix
-        else if (s.length() >= 2 && (s.back() == 'h' || s.back() == 'H')) {
-            value = std::stoll(s.substr(0, s.length() - 1), nullptr, 16);
-        }
-        // Check for binary prefix
-        else if (s.length() >= 2 && s[0] == '0' && (s[1] == 'b' || s[1] == 'B')) {
-            value = std::stoll(s.substr(2), nullptr, 2);
-        }
-        // Check for binary suffix
-        else if (s.length() >= 2 && (s.back() == 'b' || s.back() == 'B')) {
-            value = std::stoll(s.substr(0, s.length() - 1), nullptr, 2);
-        }
-        // Check for octal
-        else if (s.length() >= 2 && s[0] == '0' && (s[1] == 'o' || s[1] == 'O')) {
-            value = std::stoll(s.substr(2), nullptr, 8);
-        }
-        // Decimal
-        else {
-            value = std::stoll(s, nullptr, 10);
-        }
+} // anonymous namespace
 
-        return is_negative ? -value : value;
-    } catch (...) {
-        return std::nullopt;
-    }
+std::optional<AddressExpression> ExpressionParser::parseAddress(const std::vector<Token>& tokens) {
+    return AddressParser(tokens).parse();
 }
 
-bool ExpressionParser::isValidIdentifier(const std::string& str) {
-    if (str.empty()) return false;
-    // Must start with letter or underscore
-    if (!std::isalpha(str[0]) && str[0] != '_' && str[0] != '.') return false;
-    // Rest can be alphanumeric, underscore, or dot
-    for (char c : str) {
-        if (!std::isalnum(c) && c != '_' && c != '.') return false;
-    }
-    return true;
+std::optional<ExpressionProgram> ExpressionParser::compile(const std::vector<Token>& tokens) {
+    return ExpressionCompiler(tokens).compile();
 }
 
-std::optional<int64_t> ExpressionParser::evaluateWithSymbols(
-    const std::string& expr,
-    const SymbolLookupCallback& symbol_lookup
-) {
-    return evaluateArithmeticWithSymbols(expr, symbol_lookup);
+std::optional<ExpressionProgram> ExpressionParser::compile(std::string_view expr) {
+    // Unknown characters come back as INVALID tokens and fail the compile
+    std::vector<Token> tokens = Lexer(expr).tokenize();
+    tokens.pop_back();  // END_OF_FILE
+    return compile(tokens);
 }
 
-std::optional<int64_t> ExpressionParser::evaluateArithmeticWithSymbols(
-    const std::string& expr,
-    const SymbolLookupCallback& symbol_lookup
-) {
-    // Remove whitespace
-    std::string clean;
-    for (char c : expr) {
-        if (!std::isspace(c)) clean += c;
-    }
-
-    if (clean.empty()) return std::nullopt;
-
-    // Parse addition/subtraction (lowest precedence, right-to-left scan)
-    for (size_t i = clean.length(); i > 0; i--) {
-        char c = clean[i-1];
-        // Skip if this is a negative sign at the start or after an operator
-        if (i == 1 || (c == '-' && (clean[i-2] == '+' || clean[i-2] == '-' ||
-                                     clean[i-2] == '*' || clean[i-2] == '/' ||
-                                     clean[i-2] == '('))) {
-            continue;
-        }
-
-        if (c == '+' || c == '-') {
-            auto left = evaluateArithmeticWithSymbols(clean.substr(0, i-1), symbol_lookup);
-            auto right = evaluateArithmeticWithSymbols(clean.substr(i), symbol_lookup);
-            if (!left || !right) return std::nullopt;
-
-            return (c == '+') ? (*left + *right) : (*left - *right);
-        }
-    }
-
-    // Parse multiplication/division (higher precedence, right-to-left scan)
-    for (size_t i = clean.length(); i > 0; i--) {
-        char c = clean[i-1];
-        if (c == '*' || c == '/') {
-            auto left = evaluateArithmeticWithSymbols(clean.substr(0, i-1), symbol_lookup);
-            auto right = evaluateArithmeticWithSymbols(clean.substr(i), symbol_lookup);
-            if (!left || !right) return std::nullopt;
-            if (c == '/' && *right == 0) return std::nullopt;  // Division by zero
-
-            return (c == '*') ? (*left * *right) : (*left / *right);
-        }
-    }
-
-    // Handle parentheses
-    if (clean.front() == '(' && clean.back() == ')') {
-        return evaluateArithmeticWithSymbols(clean.substr(1, clean.length() - 2), symbol_lookup);
-    }
-
-    // Try to parse as number first
-    auto num = parseNumber(clean);
-    if (num) return num;
-
-    // Try to resolve as symbol
-    if (isValidIdentifier(clean) && symbol_lookup) {
-        return symbol_lookup(clean);
-    }
-
-    return std::nullopt;
+std::optional<int64_t> ExpressionParser::evaluate(const std::string& expr) {
+    return evaluateWithSymbols(expr, nullptr);
 }
 
-std::optional<AddressExpression> ExpressionParser::parseAddressWithSymbols(
+std::optional<int64_t> ExpressionParser::evaluateWithSymbols(
     const std::string& expr,
     const SymbolLookupCallback& symbol_lookup
 ) {
-    AddressExpression result;
-
-    // First, extract any registers from the expression
-    // We need to identify registers vs arithmetic parts
-    std::string remaining_expr;
-    std::string current;
-    bool in_arithmetic = false;
-    int paren_depth = 0;
-
-    // Tokenize the expression more carefully
-    std::vector<std::pair<std::string, bool>> tokens;  // token, is_negative
-    bool next_negative = false;
-
-    for (size_t i = 0; i < expr.length(); i++) {
-        char c = expr[i];
-
-        if (c == '(') paren_depth++;
-        if (c == ')') paren_depth--;
-
-        if (paren_depth == 0 && (c == '+' || c == '-')) {
-            if (!current.empty()) {
-                // Trim whitespace
-                current.erase(0, current.find_first_not_of(" \t"));
-                if (!current.empty() && current.find_last_not_of(" \t") != std::string::npos) {
-                    current.erase(current.find_last_not_of(" \t") + 1);
-                }
-                if (!current.empty()) {
-                    tokens.push_back({current, next_negative});
-                }
-                current.clear();
-            }
-            next_negative = (c == '-');
-        } else {
-            current += c;
-        }
-    }
-
-    // Add last token
-    if (!current.empty()) {
-        current.erase(0, current.find_first_not_of(" \t"));
-        if (!current.empty() && current.find_last_not_of(" \t") != std::string::npos) {
-            current.erase(current.find_last_not_of(" \t") + 1);
-        }
-        if (!current.empty()) {
-            tokens.push_back({current, next_negative});
-        }
-    }
-
-    // Now process each token
-    for (const auto& [token, is_negative] : tokens) {
-        // Check if it's a simple register
-        if (isRegister(token)) {
-            if (is_negative) {
-                // Can't have negative register
-                return std::nullopt;
-            }
-            result.registers.push_back(normalizeRegister(token));
-            continue;
-        }
-
-        // Try to evaluate as expression (number, symbol, or arithmetic)
-        std::string eval_expr = is_negative ? ("-" + token) : token;
-
-        // Check if it's purely a simple identifier (label reference)
-        if (isValidIdentifier(token) && !isRegister(token)) {
-            // Try to resolve it as a symbol first
-            if (symbol_lookup) {
-                auto resolved = symbol_lookup(token);
-                if (resolved) {
-                    // It's an EQU constant - add to displacement
-                    int64_t value = is_negative ? -*resolved : *resolved;
-                    result.displacement += value;
-                    result.has_displacement = true;
-                    continue;
-                }
-            }
-            // Not found as symbol - treat as label reference
-            if (result.has_label) {
-                // Can't have multiple labels - try to evaluate as expression
-                auto value = evaluateArithmeticWithSymbols(eval_expr, symbol_lookup);
-                if (value) {
-                    result.displacement += *value;
-                    result.has_displacement = true;
-                    continue;
-                }
-                return std::nullopt;  // Multiple unresolved labels
-            }
-            result.label_name = token;
-            result.has_label = true;
-            if (is_negative) {
-                // Label with negative - not typical but mark it
-                // We'll need to handle this in code generation
-            }
-            continue;
-        }
-
-        // Try to evaluate as arithmetic expression with symbols
-        auto value = evaluateArithmeticWithSymbols(eval_expr, symbol_lookup);
-        if (value) {
-            result.displacement += *value;
-            result.has_displacement = true;
-            continue;
-        }
-
-        // If evaluation fails, it might contain an unresolved label
-        // Try simpler parsing
-        auto num = parseNumber(token);
-        if (num) {
-            int64_t value = is_negative ? -*num : *num;
-            result.displacement += value;
-            result.has_displacement = true;
-            continue;
-        }
-
-        // Can't parse this token
-        return std::nullopt;
-    }
+    auto program = compile(expr);
+    if (!program) return std::nullopt;
 
-    return result;
+    return program->evaluate([&](size_t slot) -> std::optional<int64_t> {
+        if (!symbol_lookup) return std::nullopt;
+        return symbol_lookup(program->symbols()[slot]);
+    });
 }
 
-bool ExpressionParser::isRegister(const std::string& str) {
-    std::string upper = str;
-    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-
-    for (const auto& reg : VALID_ADDRESSING_REGS) {
-        if (upper == reg) return true;
-    }
-
-    return false;
-}
+std::optional<int64_t> ExpressionParser::evaluateWithContext(
+    const std::string& expr,
+    uint64_t current_pos,
+    uint64_t segment_start
+) {
+    auto program = compile(expr);
+    if (!program) return std::nullopt;
 
-std::string ExpressionParser::normalizeRegister(const std::string& str) {
-    std::string upper = str;
-    std::transform(upper.begin(), upper.end(), upper.begin(), ::toupper);
-    return upper;
+    ExpressionContext context{static_cast<int64_t>(current_pos), static_cast<int64_t>(segment_start)};
+    return program->evaluate([](size_t) { return std::optional<int64_t>(); }, context);
 }
 
 } // namespace e2asm
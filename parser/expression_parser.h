@@ -5,7 +5,9 @@
 #include <optional>
 #include <cstdint>
 #include <functional>
+#include <string_view>
 #include "../lexer/token.h"
+#include "expression_program.h"
 
 namespace e2asm {
 
@@ -24,22 +26,30 @@ using SymbolLookupCallback = std::function<std::optional<int64_t>(const std::str
 class ExpressionParser {
 public:
     /**
-     * Parse memory address expression from tokens
-     * Example: BX+SI+10 → {registers: ["BX", "SI"], displacement: 16}
+     * Parse the tokens between [ and ] into a structured address
+     * Example: BX+SI+2*4 → {registers: [BX, SI], displacement: 8}
+     *          label+COUNT*2 → {symbols: [label*1, COUNT*2]}
+     * Numbers are folded into the displacement; identifiers stay symbolic so
+     * they can be resolved later without parsing the text again.
+     * @param tokens Tokens of the bracketed expression (brackets excluded)
+     * @return Parsed address or nullopt if it isn't a valid 8086 address
      */
-    static std::optional<AddressExpression> parseAddress(const std::string& expr);
+    static std::optional<AddressExpression> parseAddress(const std::vector<Token>& tokens);
 
     /**
-     * Parse memory address expression with symbol resolution
-     * Resolves EQU constants and labels in expressions like [label + const * 2 - 2]
-     * @param expr Expression string
-     * @param symbol_lookup Callback to resolve symbol names to values
-     * @return Parsed address or nullopt on error
+     * Compile an arithmetic expression into postfix bytecode
+     * Supports numbers, characters, symbols, $ and $$, unary +/-, the binary
+     * operators + - * / and parentheses. Constant parts are folded.
+     * Example: COUNT*2+(4-1) → PUSH_SYMBOL 0, PUSH_CONST 2, MUL, PUSH_CONST 3, ADD
+     * @param tokens Tokens of the expression
+     * @return Program or nullopt if the tokens aren't a valid expression
      */
-    static std::optional<AddressExpression> parseAddressWithSymbols(
-        const std::string& expr,
-        const SymbolLookupCallback& symbol_lookup
-    );
+    static std::optional<ExpressionProgram> compile(const std::vector<Token>& tokens);
+
+    /**
+     * Compile expression text (tokenized with the assembler's lexer)
+     */
+    static std::optional<ExpressionProgram> compile(std::string_view expr);
 
     /**
      * Evaluate simple arithmetic expression to constant
@@ -70,41 +80,6 @@ public:
         uint64_t current_pos,
         uint64_t segment_start
     );
-
-private:
-    /**
-     * Evaluate arithmetic expression with +, -, *, / operators
-     * Handles operator precedence (*, / before +, -)
-     */
-    static std::optional<int64_t> evaluateArithmetic(const std::string& expr);
-
-    /**
-     * Evaluate arithmetic expression with symbol lookup
-     */
-    static std::optional<int64_t> evaluateArithmeticWithSymbols(
-        const std::string& expr,
-        const SymbolLookupCallback& symbol_lookup
-    );
-
-    /**
-     * Parse a number from string (handles hex, binary, octal)
-     */
-    static std::optional<int64_t> parseNumber(const std::string& str);
-
-    /**
-     * Check if string is a register name
-     */
-    static bool isRegister(const std::string& str);
-
-    /**
-     * Check if string is a valid identifier (for symbols/labels)
-     */
-    static bool isValidIdentifier(const std::string& str);
-
-    /**
-     * Normalize register name to uppercase
-     */
-    static std::string normalizeRegister(const std::string& str);
 };
 
 } // namespace e2asm
@@ -0,0 +1,83 @@
+#include "expression_program.h"
+
+namespace e2asm {
+
+bool ExpressionProgram::push(ExprStep step) {
+    if (m_depth == MAX_DEPTH) {
+        return false;
+    }
+    m_code.push_back(step);
+    m_depth++;
+    return true;
+}
+
+bool ExpressionProgram::pushConstant(int64_t value) {
+    return push({ExprOp::PUSH_CONST, value});
+}
+
+bool ExpressionProgram::pushSymbol(std::string_view name) {
+    // A symbol used twice shares its slot, so it's only resolved by name once
+    size_t slot = 0;
+    while (slot < m_symbols.size() && m_symbols[slot] != name) {
+        slot++;
+    }
+    if (slot == m_symbols.size()) {
+        m_symbols.emplace_back(name);
+        m_bindings.emplace_back();
+    }
+    return push({ExprOp::PUSH_SYMBOL, static_cast<int64_t>(slot)});
+}
+
+bool ExpressionProgram::pushHere() {
+    m_uses_position = true;
+    return push({ExprOp::PUSH_HERE});
+}
+
+bool ExpressionProgram::pushSectionStart() {
+    m_uses_position = true;
+    return push({ExprOp::PUSH_SECTION_START});
+}
+
+bool ExpressionProgram::apply(ExprOp op) {
+    size_t size = m_code.size();
+
+    if (op == ExprOp::NEG) {
+        if (m_depth < 1) return false;
+        if (m_code[size - 1].op == ExprOp::PUSH_CONST) {
+            m_code[size - 1].operand = -m_code[size - 1].operand;
+        } else {
+            m_code.push_back({op});
+        }
+        return true;
+    }
+
+    if (m_depth < 2) return false;
+
+    // In postfix, an operand that is a single PUSH_CONST is the whole operand,
+    // so two constant pushes in a row are exactly this operator's inputs
+    if (m_code[size - 1].op == ExprOp::PUSH_CONST && m_code[size - 2].op == ExprOp::PUSH_CONST) {
+        auto value = combine(op, m_code[size - 2].operand, m_code[size - 1].operand);
+        if (!value) return false;
+        m_code.pop_back();
+        m_code.back().operand = *value;
+    } else {
+        m_code.push_back({op});
+    }
+    m_depth--;
+    return true;
+}
+
+std::optional<int64_t> ExpressionProgram::combine(ExprOp op, int64_t lhs, int64_t rhs) {
+    switch (op) {
+        case ExprOp::ADD: return lhs + rhs;
+        case ExprOp::SUB: return lhs - rhs;
+        case ExprOp::MUL: return lhs * rhs;
+        case ExprOp::DIV:
+            if (rhs == 0) return std::nullopt;  // Division by zero
+            return lhs / rhs;
+        default:
+            return std::nullopt;
+    }
+}
+
+} // namespace e2asm
@@ -0,0 +1,169 @@
+/**
+ * @file expression_program.h
+ * @brief Arithmetic expressions compiled once into postfix bytecode
+ *
+ * An expression such as `512-($-$$)` or `COUNT*2+1` is parsed a single time
+ * into a short list of stack operations. Constant subexpressions are folded
+ * while compiling, each distinct symbol gets a numbered slot, and `$`/`$$` are
+ * operands of their own. Evaluating it again on a later relaxation pass, or
+ * after the symbols changed, is then a loop over a few steps with no parsing.
+ */
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace e2asm {
+
+/** @brief Operation of a single ExpressionProgram step */
+enum class ExprOp : uint8_t {
+    PUSH_CONST,          ///< Push the step's operand
+    PUSH_SYMBOL,         ///< Push the value of symbol slot `operand`
+    PUSH_HERE,           ///< Push $, the address of the current statement
+    PUSH_SECTION_START,  ///< Push $$, the start address of the current section
+    NEG,                 ///< Negate the top value
+    ADD,                 ///< Pop b, pop a, push a + b
+    SUB,                 ///< Pop b, pop a, push a - b
+    MUL,                 ///< Pop b, pop a, push a * b
+    DIV                  ///< Pop b, pop a, push a / b (fails on division by zero)
+};
+
+/** @brief One step of an ExpressionProgram */
+struct ExprStep {
+    ExprOp op;
+    int64_t operand = 0;  ///< Constant for PUSH_CONST, slot for PUSH_SYMBOL
+};
+
+/** @brief Values of the position markers for one evaluation */
+struct ExpressionContext {
+    int64_t here = 0;           ///< Value of $
+    int64_t section_start = 0;  ///< Value of $$
+};
+
+/**
+ * @brief Postfix bytecode for one arithmetic expression
+ *
+ * Built by ExpressionParser::compile(). Symbols are referenced by slot; the
+ * names are kept once in symbols() so a caller can resolve them however it
+ * likes. A caller that resolves the same program many times can bind() each
+ * slot to a SymbolId once and index its table from then on. An empty program
+ * means "no expression" (e.g. a plain label operand).
+ */
+class ExpressionProgram {
+public:
+    /** @brief Deepest evaluation stack a program may need */
+    static constexpr size_t MAX_DEPTH = 32;
+
+    bool empty() const { return m_code.empty(); }
+
+    /** @brief True if the whole expression folded to one number */
+    bool isConstant() const { return m_code.size() == 1 && m_code[0].op == ExprOp::PUSH_CONST; }
+
+    /** @brief The folded value; only meaningful when isConstant() */
+    int64_t constantValue() const { return isConstant() ? m_code[0].operand : 0; }
+
+    /** @brief True if the expression reads $ or $$ */
+    bool usesPosition() const { return m_uses_position; }
+
+    /** @brief Symbol names, indexed by slot */
+    const std::vector<std::string>& symbols() const { return m_symbols; }
+
+    /** @brief SymbolId bound to a slot, if any */
+    std::optional<uint32_t> binding(size_t slot) const { return m_bindings[slot]; }
+
+    /** @brief Binds a slot to a SymbolId, or unbinds it with nullopt */
+    void bind(size_t slot, std::optional<uint32_t> id) { m_bindings[slot] = id; }
+
+    const std::vector<ExprStep>& code() const { return m_code; }
+
+    /**
+     * @brief Runs the program without position markers
+     * @param resolve Called as resolve(slot) -> std::optional<int64_t> for each symbol read
+     * @return Value, or nullopt if a symbol is unresolved, the expression uses
+     *         $/$$, or it divides by zero
+     */
+    template <typename Resolve>
+    std::optional<int64_t> evaluate(Resolve&& resolve) const {
+        return run(resolve, nullptr);
+    }
+
+    /** @brief Runs the program with $ and $$ taken from context */
+    template <typename Resolve>
+    std::optional<int64_t> evaluate(Resolve&& resolve, const ExpressionContext& context) const {
+        return run(resolve, &context);
+    }
+
+    /** @name Building (used by the compiler) */
+    ///@{
+    bool pushConstant(int64_t value);
+    bool pushSymbol(std::string_view name);
+    bool pushHere();
+    bool pushSectionStart();
+
+    /**
+     * @brief Appends an operator, folding it if all its operands are constants
+     * @return false if the operands don't exist or a constant division by zero
+     */
+    bool apply(ExprOp op);
+    ///@}
+
+private:
+    bool push(ExprStep step);
+
+    template <typename Resolve>
+    std::optional<int64_t> run(Resolve& resolve, const ExpressionContext* context) const {
+        std::array<int64_t, MAX_DEPTH> stack;
+        size_t top = 0;
+
+        for (const ExprStep& step : m_code) {
+            switch (step.op) {
+                case ExprOp::PUSH_CONST:
+                    stack[top++] = step.operand;
+                    break;
+                case ExprOp::PUSH_SYMBOL: {
+                    std::optional<int64_t> value = resolve(static_cast<size_t>(step.operand));
+                    if (!value) return std::nullopt;
+                    stack[top++] = *value;
+                    break;
+                }
+                case ExprOp::PUSH_HERE:
+                    if (!context) return std::nullopt;
+                    stack[top++] = context->here;
+                    break;
+                case ExprOp::PUSH_SECTION_START:
+                    if (!context) return std::nullopt;
+                    stack[top++] = context->section_start;
+                    break;
+                case ExprOp::NEG:
+                    stack[top - 1] = -stack[top - 1];
+                    break;
+                default: {
+                    int64_t rhs = stack[--top];
+                    std::optional<int64_t> value = combine(step.op, stack[top - 1], rhs);
+                    if (!value) return std::nullopt;
+                    stack[top - 1] = *value;
+                    break;
+                }
+            }
+        }
+
+        if (top != 1) return std::nullopt;
+        return stack[0];
+    }
+
+    static std::optional<int64_t> combine(ExprOp op, int64_t lhs, int64_t rhs);
+
+    std::vector<ExprStep> m_code;
+    std::vector<std::string> m_symbols;
+    std::vector<std::optional<uint32_t>> m_bindings;  ///< Bound SymbolId per slot
+    size_t m_depth = 0;  ///< Stack depth after the last step
+    bool m_uses_position = false;
+};
+
+} // namespace e2asm
@@ -14,22 +14,37 @@ Parser::Parser(std::vector<Token> tokens)
             [](const Token& t) { return t.type == TokenType::NEWLINE; }),
         m_tokens.end()
     );
+    for (Token& token : m_tokens) {
+        screenToken(token);
+    }
+}
+
+Parser::Parser(TokenStream& stream)
+    : m_stream(&stream)
+    , m_current(0)
+{
+    fill();
 }
 
 std::unique_ptr<Program> Parser::parse() {
     auto program = std::make_unique<Program>();
+    parseInto(program->arena, program->statements);
+    return program;
+}
+
+void Parser::parseInto(AstArena& arena, std::vector<ASTNode*>& statements) {
+    m_arena = &arena;
 
     while (!isAtEnd()) {
         auto stmt = parseStatement();
         if (stmt) {
-            program->statements.push_back(std::move(stmt));
+            statements.push_back(stmt);
         }
+        releaseConsumed();
     }
-
-    return program;
 }
 
-std::unique_ptr<ASTNode> Parser::parseStatement() {
+ASTNode* Parser::parseStatement() {
   /**
     To support consecutive labels, we will start with parseLabel() then the parse() loop
     will call us again
@@ -56,7 +71,7 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
             next == TokenType::DIR_RESQ || next == TokenType::DIR_REST) {
             // Parse as label without colon
             Token label_token = advance();
-            return std::make_unique<Label>(label_token.lexeme, label_token.location);
+            return m_arena->make<Label>(std::string(label_token.lexeme), label_token.location);
         }
     }
 
@@ -94,6 +109,11 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
         return parseTIMESDirective();
     }
 
+    // Check for GLOBAL or EXTERN directive
+    if (check(TokenType::DIR_GLOBAL) || check(TokenType::DIR_EXTERN)) {
+        return parseLinkageDirective();
+    }
+
     // Check for instruction
     if (check(TokenType::INSTRUCTION)) {
         return parseInstruction();
@@ -105,9 +125,10 @@ std::unique_ptr<ASTNode> Parser::parseStatement() {
     return nullptr;
 }
 
-std::unique_ptr<Instruction> Parser::parseInstruction() {
+Instruction* Parser::parseInstruction() {
     Token instr_token = consume(TokenType::INSTRUCTION, "Expected instruction");
-    auto instr = std::make_unique<Instruction>(instr_token.lexeme, instr_token.location);
+    auto instr = m_arena->make<Instruction>(std::string(instr_token.lexeme), instr_token.mnemonic,
+                                             instr_token.location);
 
     // Parse operands (comma-separated)
     // BUT: Don't parse an IDENTIFIER as an operand if it's followed by a colon or data directive
@@ -129,16 +150,16 @@ std::unique_ptr<Instruction> Parser::parseInstruction() {
         }
 
         // First operand
-        auto op = parseOperand(instr_token.lexeme);
+        auto* op = parseOperand(instr->id);
         if (op) {
-            instr->operands.push_back(std::move(op));
+            instr->operands.push_back(op);
         }
 
         // Additional operands after commas
         while (match(TokenType::COMMA)) {
-            auto next_op = parseOperand(instr_token.lexeme);
-            if (next_op) {
-                instr->operands.push_back(std::move(next_op));
+            auto* next_op = parseOperand(instr->id);
+            if (next_op && !instr->operands.push_back(next_op)) {
+                error("Too many operands for " + instr->mnemonic);
             }
         }
     }
@@ -146,14 +167,14 @@ std::unique_ptr<Instruction> Parser::parseInstruction() {
     return instr;
 }
 
-std::unique_ptr<Label> Parser::parseLabel() {
+Label* Parser::parseLabel() {
     Token label_token = consume(TokenType::IDENTIFIER, "Expected label name");
     consume(TokenType::COLON, "Expected ':' after label");
 
-    return std::make_unique<Label>(label_token.lexeme, label_token.location);
+    return m_arena->make<Label>(std::string(label_token.lexeme), label_token.location);
 }
 
-std::unique_ptr<Operand> Parser::parseOperand(const std::string& mnemonic) {
+Operand* Parser::parseOperand(Mnemonic mnemonic) {
     // Check for size specifier (BYTE PTR, WORD PTR)
     uint8_t size_hint = 0;
     if (match(TokenType::BYTE_PTR)) {
@@ -168,7 +189,7 @@ std::unique_ptr<Operand> Parser::parseOperand(const std::string& mnemonic) {
     if (peek().isSegReg() && peekNext().type == TokenType::COLON) {
         Token seg_token = advance();  // consume segment register
         advance();  // consume colon
-        segment_override = seg_token.lexeme;
+        segment_override = std::string(seg_token.lexeme);
     }
 
     // Memory operand [...]
@@ -189,95 +210,90 @@ std::unique_ptr<Operand> Parser::parseOperand(const std::string& mnemonic) {
     }
 
     // Check for jump distance specifier (SHORT, NEAR, FAR)
-    // Determine default jump type based on instruction mnemonic
-    std::string mnem_upper = mnemonic;
-    for (char& c : mnem_upper) c = std::toupper(c);
-
     // Conditional jumps on 8086 only support SHORT (8-bit relative)
     // Unconditional JMP and CALL default to NEAR for conservative estimation
-    // IMPORTANT NOTE: backward jumps are optimized to SHORT during semantic analysis
-    LabelRef::JumpType jump_type = LabelRef::JumpType::NEAR;
-
-    // TODO: Do something about this mess but for now, lets get it to work
-    if (mnem_upper == "JO" || mnem_upper == "JNO" || mnem_upper == "JB" || mnem_upper == "JC" ||
-        mnem_upper == "JNAE" || mnem_upper == "JNB" || mnem_upper == "JAE" || mnem_upper == "JNC" ||
-        mnem_upper == "JE" || mnem_upper == "JZ" || mnem_upper == "JNE" || mnem_upper == "JNZ" ||
-        mnem_upper == "JBE" || mnem_upper == "JNA" || mnem_upper == "JNBE" || mnem_upper == "JA" ||
-        mnem_upper == "JS" || mnem_upper == "JNS" || mnem_upper == "JP" || mnem_upper == "JPE" ||
-        mnem_upper == "JNP" || mnem_upper == "JPO" || mnem_upper == "JL" || mnem_upper == "JNGE" ||
-        mnem_upper == "JNL" || mnem_upper == "JGE" || mnem_upper == "JLE" || mnem_upper == "JNG" ||
-        mnem_upper == "JNLE" || mnem_upper == "JG" || mnem_upper == "LOOP" || mnem_upper == "LOOPE" ||
-        mnem_upper == "LOOPZ" || mnem_upper == "LOOPNE" || mnem_upper == "LOOPNZ" || mnem_upper == "JCXZ") {
-        jump_type = LabelRef::JumpType::SHORT;  // Conditional jumps are always SHORT
-    }
+    // IMPORTANT NOTE: unannotated JMPs are relaxed (SHORT first, NEAR if needed) during semantic analysis
+    LabelRef::JumpType jump_type = isShortOnlyBranch(mnemonic) ? LabelRef::JumpType::SHORT
+                                                              : LabelRef::JumpType::NEAR;
 
+    bool distance_explicit = true;
     if (match(TokenType::SHORT_KW)) {
         jump_type = LabelRef::JumpType::SHORT;
     } else if (match(TokenType::NEAR_KW)) {
         jump_type = LabelRef::JumpType::NEAR;
     } else if (match(TokenType::FAR_KW)) {
         jump_type = LabelRef::JumpType::FAR;
+    } else {
+        distance_explicit = false;
     }
 
     // Label reference or expression (for jumps or immediate values like MOV AX, .data or ADD DI, VAR1(-/+)VAR2)
     if (check(TokenType::IDENTIFIER)) {
         Token label_token = advance();
-        std::string expression = label_token.lexeme;
+        std::string expression(label_token.lexeme);
+        std::vector<Token> tokens{label_token};
 
         // Check if followed by arithmetic operators
         while (check(TokenType::PLUS) || check(TokenType::MINUS) ||
                check(TokenType::STAR) || check(TokenType::SLASH)) {
             Token op = advance();
-            expression += " " + op.lexeme + " ";
+            tokens.push_back(op);
+            expression += " ";
+            expression += op.lexeme;
+            expression += " ";
 
             // Expect identifier or number after operator
             if (check(TokenType::IDENTIFIER)) {
                 Token operand = advance();
+                tokens.push_back(operand);
                 expression += operand.lexeme;
             } else if (check(TokenType::NUMBER)) {
                 Token operand = advance();
+                tokens.push_back(operand);
                 expression += operand.lexeme;
             } else {
                 error("Expected identifier or number after operator");
-                break;
+                return nullptr;
             }
         }
 
         // Check if this instruction is a jump/call/loop - use LabelRef
-        if (mnem_upper == "JMP" || mnem_upper == "CALL" || mnem_upper == "JO" || mnem_upper == "JNO" ||
-            mnem_upper == "JB" || mnem_upper == "JC" || mnem_upper == "JNAE" || mnem_upper == "JNB" ||
-            mnem_upper == "JAE" || mnem_upper == "JNC" || mnem_upper == "JE" || mnem_upper == "JZ" ||
-            mnem_upper == "JNE" || mnem_upper == "JNZ" || mnem_upper == "JBE" || mnem_upper == "JNA" ||
-            mnem_upper == "JNBE" || mnem_upper == "JA" || mnem_upper == "JS" || mnem_upper == "JNS" ||
-            mnem_upper == "JP" || mnem_upper == "JPE" || mnem_upper == "JNP" || mnem_upper == "JPO" ||
-            mnem_upper == "JL" || mnem_upper == "JNGE" || mnem_upper == "JNL" || mnem_upper == "JGE" ||
-            mnem_upper == "JLE" || mnem_upper == "JNG" || mnem_upper == "JNLE" || mnem_upper == "JG" ||
-            mnem_upper == "LOOP" || mnem_upper == "LOOPE" || mnem_upper == "LOOPZ" ||
-            mnem_upper == "LOOPNE" || mnem_upper == "LOOPNZ" || mnem_upper == "JCXZ") {
-            return std::make_unique<LabelRef>(expression, label_token.location, jump_type);
+        if (mnemonic == Mnemonic::JMP || mnemonic == Mnemonic::CALL || isShortOnlyBranch(mnemonic)) {
+            auto label_ref = m_arena->make<LabelRef>(expression, label_token.location, jump_type);
+            label_ref->distance_explicit = distance_explicit;
+            return label_ref;
         }
 
         // Otherwise, treat as immediate operand with label/expression ref
-        return std::make_unique<ImmediateOperand>(expression, label_token.location, size_hint);
+        auto* imm = m_arena->make<ImmediateOperand>(expression, label_token.location, size_hint);
+        if (tokens.size() > 1) {
+            auto program = ExpressionParser::compile(tokens);
+            if (!program) {
+                error("Invalid expression: " + expression);
+                return nullptr;
+            }
+            imm->expression = std::move(*program);
+        }
+        return imm;
     }
 
     error("Expected operand (register, immediate, or memory address)");
     return nullptr;
 }
 
-std::unique_ptr<RegisterOperand> Parser::parseRegister() {
+RegisterOperand* Parser::parseRegister() {
     Token reg_token = advance();
 
     uint8_t code = getRegisterCode(reg_token.type);
     uint8_t size = getRegisterSize(reg_token.type);
     bool is_seg = reg_token.isSegReg();
 
-    return std::make_unique<RegisterOperand>(
-        reg_token.lexeme, size, code, is_seg, reg_token.location
+    return m_arena->make<RegisterOperand>(
+        std::string(reg_token.lexeme), size, code, is_seg, reg_token.location
     );
 }
 
-std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
+ImmediateOperand* Parser::parseImmediate(uint8_t size_hint) {
     SourceLocation loc = peek().location;
 
     // Collect tokens that form an expression
@@ -285,6 +301,7 @@ std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
     // IMPORTANT: IDENTIFIER should only be consumed after an operator (to allow label+offset),
     // not at the start or after a value (to avoid consuming next line's label)
     std::string expr;
+    std::vector<Token> tokens;
     bool has_identifier = false;
     int paren_depth = 0;
     bool last_was_operator = true;  // Start true to allow identifier at beginning
@@ -296,18 +313,21 @@ std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
         if (type == TokenType::PLUS || type == TokenType::MINUS ||
             type == TokenType::STAR || type == TokenType::SLASH) {
             Token t = advance();
+            tokens.push_back(t);
             expr += t.lexeme;
             last_was_operator = true;
         }
         // Parentheses
         else if (type == TokenType::LPAREN) {
             Token t = advance();
+            tokens.push_back(t);
             paren_depth++;
             expr += t.lexeme;
             last_was_operator = true;  // After '(' we expect a value
         }
         else if (type == TokenType::RPAREN) {
             Token t = advance();
+            tokens.push_back(t);
             paren_depth--;
             expr += t.lexeme;
             last_was_operator = false;  // After ')' we have a complete subexpression
@@ -315,11 +335,13 @@ std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
         // Numbers and characters (values)
         else if (type == TokenType::NUMBER) {
             Token t = advance();
+            tokens.push_back(t);
             expr += std::to_string(t.getNumber());
             last_was_operator = false;
         }
         else if (type == TokenType::CHARACTER) {
             Token t = advance();
+            tokens.push_back(t);
             std::string char_str = t.getString();
             if (!char_str.empty()) {
                 expr += std::to_string(static_cast<int>(char_str[0]));
@@ -329,6 +351,7 @@ std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
         // Identifiers - only consume after an operator or at the start
         else if (type == TokenType::IDENTIFIER && last_was_operator) {
             Token t = advance();
+            tokens.push_back(t);
             has_identifier = true;
             expr += t.lexeme;
             last_was_operator = false;
@@ -344,28 +367,33 @@ std::unique_ptr<ImmediateOperand> Parser::parseImmediate(uint8_t size_hint) {
         return nullptr;
     }
 
+    auto program = ExpressionParser::compile(tokens);
+    if (!program) {
+        error("Invalid expression: " + expr);
+        return nullptr;
+    }
+
     if (has_identifier) {
-        // Contains labels - store as expression for later resolution during encoding
-        return std::make_unique<ImmediateOperand>(expr, loc, size_hint);
-    } else {
-        // Pure numeric expression - evaluate now
-        auto result = ExpressionParser::evaluate(expr);
-        if (!result) {
-            error("Invalid expression: " + expr);
-            return nullptr;
-        }
-        return std::make_unique<ImmediateOperand>(*result, loc, size_hint);
+        // Contains labels - keep the compiled form for resolution during encoding
+        auto* imm = m_arena->make<ImmediateOperand>(expr, loc, size_hint);
+        imm->expression = std::move(*program);
+        return imm;
     }
+
+    // Pure numeric expression - already folded to a single constant
+    return m_arena->make<ImmediateOperand>(program->constantValue(), loc, size_hint);
 }
 
-std::unique_ptr<MemoryOperand> Parser::parseMemory(const std::optional<std::string>& segment_override, uint8_t size_hint) {
+MemoryOperand* Parser::parseMemory(const std::optional<std::string>& segment_override, uint8_t size_hint) {
     SourceLocation loc = peek().location;
     consume(TokenType::LBRACKET, "Expected '['");
 
-    // Collect address expression
+    // Collect address expression (text for listings, tokens for parsing)
     std::string address_expr;
+    std::vector<Token> address_tokens;
     while (!check(TokenType::RBRACKET) && !isAtEnd()) {
         Token t = advance();
+        address_tokens.push_back(t);
         if (!address_expr.empty() && t.type != TokenType::PLUS &&
             t.type != TokenType::MINUS && t.type != TokenType::STAR &&
             t.type != TokenType::SLASH) {
@@ -380,7 +408,7 @@ std::unique_ptr<MemoryOperand> Parser::parseMemory(const std::optional<std::stri
 
     consume(TokenType::RBRACKET, "Expected ']'");
 
-    auto mem_op = std::make_unique<MemoryOperand>(address_expr, loc, size_hint);
+    auto mem_op = m_arena->make<MemoryOperand>(address_expr, loc, size_hint);
 
     // Store segment override if provided (from outside brackets like "ES:[DI]")
     std::optional<std::string> final_segment_override = segment_override;
@@ -416,20 +444,25 @@ std::unique_ptr<MemoryOperand> Parser::parseMemory(const std::optional<std::stri
     mem_op->segment_override = final_segment_override;
     mem_op->address_expr = address_expr;
 
-    // Parse the address expression
-    auto parsed = ExpressionParser::parseAddress(address_expr);
-    if (parsed) {
-        // Check if it's a direct address (no registers, just a number)
-        if (parsed->registers.empty() && parsed->has_displacement) {
-            mem_op->is_direct_address = true;
-            mem_op->direct_address_value = static_cast<uint16_t>(parsed->displacement);
-        } else {
-            // Store parsed address
-            mem_op->parsed_address = std::make_unique<AddressExpression>(*parsed);
-        }
+    // Drop an in-bracket segment prefix before parsing the address itself
+    if (address_tokens.size() >= 2 && address_tokens[0].isSegReg() &&
+        address_tokens[1].type == TokenType::COLON) {
+        address_tokens.erase(address_tokens.begin(), address_tokens.begin() + 2);
+    }
+
+    // Parse the address once; later phases only resolve its symbols
+    auto parsed = ExpressionParser::parseAddress(address_tokens);
+    if (!parsed) {
+        m_error_reporter.error("Invalid memory operand: " + address_expr, loc);
+        return mem_op;
+    }
+
+    if (!parsed->hasRegisters() && !parsed->hasSymbols() && parsed->has_displacement) {
+        // Plain number, e.g. [1234h]
+        mem_op->is_direct_address = true;
+        mem_op->direct_address_value = static_cast<uint16_t>(parsed->displacement);
     } else {
-        // Failed to parse
-        // Note: This will be caught during the code generation
+        mem_op->parsed_address = std::move(*parsed);
     }
 
     return mem_op;
@@ -449,10 +482,40 @@ Token Parser::peekNext() const {
 Token Parser::advance() {
     if (!isAtEnd()) {
         m_current++;
+        fill();
     }
     return m_tokens[m_current - 1];
 }
 
+void Parser::fill() {
+    if (!m_stream) {
+        return;
+    }
+    // Keep the current token and one of lookahead (peekNext)
+    while (m_tokens.size() < m_current + 2 &&
+           (m_tokens.empty() || m_tokens.back().type != TokenType::END_OF_FILE)) {
+        m_tokens.push_back(m_stream->next());
+        screenToken(m_tokens.back());
+    }
+}
+
+void Parser::screenToken(Token& token) {
+    if (token.type == TokenType::ERROR) {
+        m_error_reporter.error(std::string(token.lexeme), token.location);
+        token = Token(TokenType::NUMBER, "0", int64_t{0}, token.location);
+    }
+}
+
+void Parser::releaseConsumed() {
+    if (!m_stream || m_current == 0) {
+        return;
+    }
+    // The finished statement's tokens are no longer referenced (the AST owns its strings)
+    m_tokens.erase(m_tokens.begin(), m_tokens.begin() + static_cast<std::ptrdiff_t>(m_current));
+    m_current = 0;
+    m_stream->release(m_tokens.front().location.line);
+}
+
 bool Parser::match(TokenType type) {
     if (check(type)) {
         advance();
@@ -559,7 +622,7 @@ bool Parser::isRegisterToken(TokenType type) const {
            (type >= TokenType::SEGREG_ES && type <= TokenType::SEGREG_DS);
 }
 
-std::unique_ptr<DataDirective> Parser::parseDataDirective() {
+DataDirective* Parser::parseDataDirective() {
     Token directive_token = advance();
 
     DataDirective::Size size;
@@ -574,19 +637,19 @@ std::unique_ptr<DataDirective> Parser::parseDataDirective() {
             return nullptr;
     }
 
-    auto directive = std::make_unique<DataDirective>(size, directive_token.location);
+    auto directive = m_arena->make<DataDirective>(size, directive_token.location);
 
     // Parse comma-separated values
     do {
         if (check(TokenType::STRING)) {
             // String literal
             Token str_token = advance();
-            directive->values.emplace_back(str_token.lexeme, DataValue::Type::STRING);
+            directive->values.emplace_back(str_token.getString(), DataValue::Type::STRING);
         }
         else if (check(TokenType::CHARACTER)) {
             // Character literal
             Token char_token = advance();
-            directive->values.emplace_back(char_token.lexeme, DataValue::Type::CHARACTER);
+            directive->values.emplace_back(char_token.getString(), DataValue::Type::CHARACTER);
         }
         else if (check(TokenType::NUMBER)) {
             // Numeric value
@@ -596,7 +659,7 @@ std::unique_ptr<DataDirective> Parser::parseDataDirective() {
         else if (check(TokenType::IDENTIFIER)) {
             // Symbol reference (EQU constant or label) - resolved during semantic analysis
             Token id_token = advance();
-            directive->values.emplace_back(id_token.lexeme, DataValue::Type::SYMBOL);
+            directive->values.emplace_back(std::string(id_token.lexeme), DataValue::Type::SYMBOL);
         }
         else {
             error("Expected number, string, character literal, or symbol");
@@ -609,20 +672,20 @@ std::unique_ptr<DataDirective> Parser::parseDataDirective() {
     return directive;
 }
 
-std::unique_ptr<EQUDirective> Parser::parseEQUDirective() {
+EQUDirective* Parser::parseEQUDirective() {
     Token name_token = consume(TokenType::IDENTIFIER, "Expected constant name");
     consume(TokenType::DIR_EQU, "Expected EQU");
 
     Token value_token = consume(TokenType::NUMBER, "Expected numeric value");
 
-    return std::make_unique<EQUDirective>(
-        name_token.lexeme,
+    return m_arena->make<EQUDirective>(
+        std::string(name_token.lexeme),
         value_token.getNumber(),
         name_token.location
     );
 }
 
-std::unique_ptr<ORGDirective> Parser::parseORGDirective() {
+ORGDirective* Parser::parseORGDirective() {
     Token org_token = consume(TokenType::DIR_ORG, "Expected ORG");
 
     // Parse address (could be a number or expression)
@@ -630,10 +693,10 @@ std::unique_ptr<ORGDirective> Parser::parseORGDirective() {
     Token addr_token = consume(TokenType::NUMBER, "Expected address after ORG");
     int64_t address = addr_token.getNumber();
 
-    return std::make_unique<ORGDirective>(address, org_token.location);
+    return m_arena->make<ORGDirective>(address, org_token.location);
 }
 
-std::unique_ptr<SEGMENTDirective> Parser::parseSEGMENTDirective() {
+SEGMENTDirective* Parser::parseSEGMENTDirective() {
     // Accept either SEGMENT or SECTION because NASM supports both
     // For flat binaries, they are the same so just add both for convenience.
     Token seg_token = peek();
@@ -645,10 +708,10 @@ std::unique_ptr<SEGMENTDirective> Parser::parseSEGMENTDirective() {
 
     Token name_token = consume(TokenType::IDENTIFIER, "Expected segment name");
 
-    return std::make_unique<SEGMENTDirective>(name_token.lexeme, seg_token.location);
+    return m_arena->make<SEGMENTDirective>(std::string(name_token.lexeme), seg_token.location);
 }
 
-std::unique_ptr<ENDSDirective> Parser::parseENDSDirective() {
+ENDSDirective* Parser::parseENDSDirective() {
     // ENDS can be: "segment_name ENDS" or just "ENDS"
     Token ends_token = consume(TokenType::DIR_ENDS, "Expected ENDS");
 
@@ -659,10 +722,10 @@ std::unique_ptr<ENDSDirective> Parser::parseENDSDirective() {
     */
     std::string name = "";  // Empty means close current segment
 
-    return std::make_unique<ENDSDirective>(name, ends_token.location);
+    return m_arena->make<ENDSDirective>(name, ends_token.location);
 }
 
-std::unique_ptr<RESDirective> Parser::parseRESDirective() {
+RESDirective* Parser::parseRESDirective() {
     Token directive_token = advance();
 
     // Determine size based on directive type
@@ -682,32 +745,72 @@ std::unique_ptr<RESDirective> Parser::parseRESDirective() {
     Token count_token = consume(TokenType::NUMBER, "Expected count after RES directive");
     int64_t count = count_token.getNumber();
 
-    return std::make_unique<RESDirective>(size, count, directive_token.location);
+    return m_arena->make<RESDirective>(size, count, directive_token.location);
 }
 
-std::unique_ptr<TIMESDirective> Parser::parseTIMESDirective() {
+LinkageDirective* Parser::parseLinkageDirective() {
+    Token directive_token = advance();
+    auto kind = directive_token.type == TokenType::DIR_GLOBAL ? LinkageDirective::Kind::GLOBAL
+                                                              : LinkageDirective::Kind::EXTERN;
+    auto* directive = m_arena->make<LinkageDirective>(kind, directive_token.location);
+
+    // One or more names, comma separated
+    do {
+        if (!check(TokenType::IDENTIFIER)) {
+            error("Expected symbol name after " + std::string(directive_token.lexeme));
+            return nullptr;
+        }
+        Token name_token = advance();
+        // Local labels belong to their global label, they can't cross modules
+        if (name_token.lexeme.starts_with('.')) {
+            error("Local label can't be " + std::string(directive_token.lexeme) + ": " +
+                  std::string(name_token.lexeme));
+            return nullptr;
+        }
+        directive->names.emplace_back(name_token.lexeme);
+    } while (match(TokenType::COMMA));
+
+    return directive;
+}
+
+TIMESDirective* Parser::parseTIMESDirective() {
     Token times_token = consume(TokenType::DIR_TIMES, "Expected TIMES");
 
-    // Parse the count - can be a number or an identifier (EQU constant)
-    int64_t count = -1;  // -1 indicates unresolved
+    // Parse the count - a number, a constant, or an expression such as 510-($-$$)
+    // Identifiers are only taken after an operator, so "TIMES 3 label" still stops at the label
     std::string count_expr;
+    std::vector<Token> count_tokens;
+    bool last_was_operator = true;
 
-    if (check(TokenType::NUMBER)) {
-        Token count_token = advance();
-        count = count_token.getNumber();
-        count_expr = count_token.lexeme;
-    }
-    else if (check(TokenType::IDENTIFIER)) {
-        // Symbol reference - will be resolved during semantic analysis
-        Token id_token = advance();
-        count_expr = id_token.lexeme;
-        // count remains -1 to indicate it needs resolution
+    while (!isAtEnd()) {
+        TokenType type = peek().type;
+        bool is_operator = type == TokenType::PLUS || type == TokenType::MINUS ||
+                           type == TokenType::STAR || type == TokenType::SLASH ||
+                           type == TokenType::LPAREN;
+        bool is_value = type == TokenType::NUMBER || type == TokenType::DOLLAR ||
+                        type == TokenType::DOUBLE_DOLLAR || type == TokenType::RPAREN ||
+                        (type == TokenType::IDENTIFIER && last_was_operator);
+        if (!is_operator && !is_value) {
+            break;
+        }
+
+        Token t = advance();
+        count_tokens.push_back(t);
+        count_expr += t.lexeme;
+        last_was_operator = is_operator;
     }
-    else {
+
+    if (count_tokens.empty()) {
         error("Expected count (number or constant) after TIMES");
         return nullptr;
     }
 
+    auto count_program = ExpressionParser::compile(count_tokens);
+    if (!count_program) {
+        error("Invalid TIMES count: " + count_expr);
+        return nullptr;
+    }
+
     // Parse the repeated statement
     auto repeated = parseStatement();
     if (!repeated) {
@@ -715,8 +818,15 @@ std::unique_ptr<TIMESDirective> Parser::parseTIMESDirective() {
         return nullptr;
     }
 
-    auto times_node = std::make_unique<TIMESDirective>(count, count_expr, times_token.location);
-    times_node->repeated_node = std::move(repeated);
+    // A count that folded to a number is final; anything else is evaluated
+    // during semantic analysis, once symbols and addresses are known
+    int64_t count = count_program->isConstant() ? count_program->constantValue() : -1;
+    auto times_node = m_arena->make<TIMESDirective>(count, count_expr, times_token.location);
+    times_node->repeated_node = repeated;
+    times_node->symbolic_count = !count_program->isConstant();
+    if (times_node->symbolic_count) {
+        times_node->count_program = std::move(*count_program);
+    }
 
     return times_node;
 }
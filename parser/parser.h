@@ -13,6 +13,7 @@
 #include <memory>
 #include "ast.h"
 #include "../lexer/token.h"
+#include "../lexer/token_stream.h"
 #include "../core/error.h"
 
 namespace e2asm {
@@ -38,6 +39,15 @@ public:
      */
     explicit Parser(std::vector<Token> tokens);
 
+    /**
+     * @brief Constructs a parser that pulls tokens on demand
+     * @param stream Token source (must outlive parse())
+     *
+     * Only the tokens of the statement being parsed are buffered; lines the
+     * parser is done with are released back to the stream.
+     */
+    explicit Parser(TokenStream& stream);
+
     /**
      * @brief Parses the token stream into an AST
      * @return Program node containing all statements, or partial tree if errors occurred
@@ -47,6 +57,24 @@ public:
      */
     std::unique_ptr<Program> parse();
 
+    /**
+     * @brief Parses the token stream, appending to an existing tree
+     * @param arena Arena the new nodes are allocated in
+     * @param statements Receives the parsed top-level statements
+     *
+     * Lets a caller assemble one Program out of separately parsed pieces
+     * (see AssemblySession).
+     */
+    void parseInto(AstArena& arena, std::vector<ASTNode*>& statements);
+
+    /**
+     * @brief Hands the token buffer back once parsing is done
+     * @return The tokens the parser was built with, so their capacity can be reused
+     *
+     * The parser must not be used afterwards.
+     */
+    std::vector<Token> releaseTokens() { return std::move(m_tokens); }
+
     /**
      * @brief Gets all syntax errors encountered
      * @return Vector of errors with source locations
@@ -61,46 +89,49 @@ public:
 
 private:
     /** @brief Parses any top-level statement (instruction, label, directive) */
-    std::unique_ptr<ASTNode> parseStatement();
+    ASTNode* parseStatement();
 
     /** @brief Parses an instruction with its operands */
-    std::unique_ptr<Instruction> parseInstruction();
+    Instruction* parseInstruction();
 
     /** @brief Parses a label definition (name followed by colon) */
-    std::unique_ptr<Label> parseLabel();
+    Label* parseLabel();
 
     /** @brief Parses DB/DW/DD/DQ/DT data definition */
-    std::unique_ptr<DataDirective> parseDataDirective();
+    DataDirective* parseDataDirective();
 
     /** @brief Parses name EQU value constant definition */
-    std::unique_ptr<EQUDirective> parseEQUDirective();
+    EQUDirective* parseEQUDirective();
 
     /** @brief Parses ORG address directive */
-    std::unique_ptr<ORGDirective> parseORGDirective();
+    ORGDirective* parseORGDirective();
 
     /** @brief Parses SEGMENT/SECTION name directive */
-    std::unique_ptr<SEGMENTDirective> parseSEGMENTDirective();
+    SEGMENTDirective* parseSEGMENTDirective();
 
     /** @brief Parses name ENDS directive */
-    std::unique_ptr<ENDSDirective> parseENDSDirective();
+    ENDSDirective* parseENDSDirective();
 
     /** @brief Parses RESB/RESW/RESD/RESQ/REST space reservation */
-    std::unique_ptr<RESDirective> parseRESDirective();
+    RESDirective* parseRESDirective();
 
     /** @brief Parses TIMES count directive/instruction repetition */
-    std::unique_ptr<TIMESDirective> parseTIMESDirective();
+    TIMESDirective* parseTIMESDirective();
+
+    /** @brief Parses GLOBAL/EXTERN name list */
+    LinkageDirective* parseLinkageDirective();
 
     /** @brief Parses an instruction operand (register, immediate, memory, label) */
-    std::unique_ptr<Operand> parseOperand(const std::string& mnemonic = "");
+    Operand* parseOperand(Mnemonic mnemonic = Mnemonic::NONE);
 
     /** @brief Parses a register operand (AX, BL, etc.) */
-    std::unique_ptr<RegisterOperand> parseRegister();
+    RegisterOperand* parseRegister();
 
     /** @brief Parses an immediate value or symbol */
-    std::unique_ptr<ImmediateOperand> parseImmediate(uint8_t size_hint = 0);
+    ImmediateOperand* parseImmediate(uint8_t size_hint = 0);
 
     /** @brief Parses a memory operand [expression] */
-    std::unique_ptr<MemoryOperand> parseMemory(const std::optional<std::string>& segment_override = std::nullopt, uint8_t size_hint = 0);
+    MemoryOperand* parseMemory(const std::optional<std::string>& segment_override = std::nullopt, uint8_t size_hint = 0);
 
     /** @brief Returns current token without consuming it */
     Token peek() const;
@@ -111,6 +142,21 @@ private:
     /** @brief Consumes and returns current token */
     Token advance();
 
+    /** @brief Pulls from the stream until the lookahead window is full */
+    void fill();
+
+    /**
+     * @brief Reports a literal the lexer rejected
+     * @param token Token just taken from the lexer
+     *
+     * An ERROR token is reported once, here, and then stands in as the number
+     * 0 so the statement around it parses without follow-on errors.
+     */
+    void screenToken(Token& token);
+
+    /** @brief Drops consumed tokens and the lines they came from (streaming only) */
+    void releaseConsumed();
+
     /** @brief Consumes token if it matches type, returns true if matched */
     bool match(TokenType type);
 
@@ -141,9 +187,11 @@ private:
     /** @brief Checks if token type is any register */
     bool isRegisterToken(TokenType type) const;
 
-    std::vector<Token> m_tokens;      ///< Token stream to parse
+    std::vector<Token> m_tokens;      ///< Token stream to parse (a sliding window when streaming)
+    TokenStream* m_stream = nullptr;  ///< Source of further tokens, if streaming
     size_t m_current;                 ///< Index of next token to consume
     ErrorReporter m_error_reporter;   ///< Collects syntax errors
+    AstArena* m_arena = nullptr;      ///< Arena of the Program being built
 };
 
 } // namespace e2asm
@@ -0,0 +1,192 @@
+#include "include_cache.h"
+#include "../core/mapped_file.h"
+#include <cctype>
+
+namespace e2asm {
+
+namespace {
+
+// Next line that isn't blank or a comment, trimmed; false at end of text
+bool nextSignificantLine(std::string_view text, size_t& pos, std::string_view& line) {
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string_view::npos) end = text.size();
+        line = text.substr(pos, end - pos);
+        pos = end + 1;
+
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string_view::npos || line[first] == ';') {
+            continue;
+        }
+        line = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+        return true;
+    }
+    return false;
+}
+
+// Splits "%name arg" into name and (trimmed) argument; false if not a directive
+bool splitDirective(std::string_view line, std::string_view& name, std::string_view& arg) {
+    if (line.empty() || line[0] != '%') return false;
+
+    size_t pos = 1;
+    while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) ++pos;
+    size_t start = pos;
+    while (pos < line.size() && (std::isalnum(static_cast<unsigned char>(line[pos])) || line[pos] == '_')) ++pos;
+    name = line.substr(start, pos - start);
+
+    while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) ++pos;
+    arg = line.substr(pos);
+    size_t space = arg.find_first_of(" \t;");
+    if (space != std::string_view::npos) arg = arg.substr(0, space);
+    return true;
+}
+
+} // namespace
+
+std::string IncludeCache::resolve(const std::string& name, const std::vector<std::string>& include_paths) {
+    std::string key = name;
+    for (const auto& path : include_paths) {
+        key += '\0';
+        key += path;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_resolved.find(key);
+        if (it != m_resolved.end()) {
+            return it->second;
+        }
+    }
+
+    // Same search order as Preprocessor::findIncludeFile
+    std::error_code ec;
+    std::string found;
+    if (std::filesystem::is_regular_file(name, ec)) {
+        found = name;
+    } else {
+        for (const auto& path : include_paths) {
+            std::string full_path = path + "/" + name;
+            if (std::filesystem::is_regular_file(full_path, ec)) {
+                found = full_path;
+                break;
+            }
+        }
+    }
+
+    // Misses aren't remembered, the file may show up later
+    if (!found.empty()) {
+        std::lock_guard lock(m_mutex);
+        m_resolved.emplace(std::move(key), found);
+    }
+    return found;
+}
+
+std::optional<IncludeCache::Entry> IncludeCache::load(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec) {
+        std::lock_guard lock(m_mutex);
+        m_entries.erase(path);
+        return std::nullopt;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_entries.find(path);
+        if (it != m_entries.end() && it->second.mtime == mtime) {
+            return it->second;
+        }
+    }
+
+    // Read without holding the lock; if two threads race on the same file
+    // both read it and the last one to finish wins, which is harmless
+    // The entry keeps its own copy: it outlives this run, and a mapping
+    // would see the file change under it if it's edited in place
+    MappedFile file;
+    if (!file.open(path)) {
+        return std::nullopt;
+    }
+
+    Entry entry;
+    entry.content = std::make_shared<const std::string>(file.view());
+    entry.mtime = mtime;
+    entry.guard = detectGuard(*entry.content);
+
+    std::lock_guard lock(m_mutex);
+    m_disk_reads++;
+    m_entries[path] = entry;
+    return entry;
+}
+
+std::optional<std::string> IncludeCache::guard(const std::string& path) {
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    {
+        std::lock_guard lock(m_mutex);
+        auto it = m_entries.find(path);
+        if (it == m_entries.end()) {
+            return std::nullopt;
+        }
+        if (!ec && it->second.mtime == mtime) {
+            return it->second.guard;
+        }
+    }
+
+    // The file changed since it was read, so the recorded guard may be gone
+    auto entry = load(path);
+    return entry ? entry->guard : std::nullopt;
+}
+
+size_t IncludeCache::diskReads() const {
+    std::lock_guard lock(m_mutex);
+    return m_disk_reads;
+}
+
+void IncludeCache::clear() {
+    std::lock_guard lock(m_mutex);
+    m_resolved.clear();
+    m_entries.clear();
+}
+
+std::optional<std::string> IncludeCache::detectGuard(std::string_view content) {
+    size_t pos = 0;
+    std::string_view line, name, arg;
+
+    // %ifndef GUARD
+    if (!nextSignificantLine(content, pos, line) || !splitDirective(line, name, arg) ||
+        name != "ifndef" || arg.empty()) {
+        return std::nullopt;
+    }
+    std::string guard(arg);
+
+    // %define GUARD
+    if (!nextSignificantLine(content, pos, line) || !splitDirective(line, name, arg) ||
+        name != "define" || arg != guard) {
+        return std::nullopt;
+    }
+
+    // The %endif closing the %ifndef has to be the last thing in the file
+    int depth = 1;
+    while (nextSignificantLine(content, pos, line)) {
+        if (depth == 0) {
+            return std::nullopt;
+        }
+        if (!splitDirective(line, name, arg)) {
+            continue;
+        }
+        if (name == "if" || name == "ifdef" || name == "ifndef") {
+            depth++;
+        } else if (name == "endif") {
+            depth--;
+        } else if (depth == 1 && (name == "else" || name == "elif")) {
+            // The file has a branch for when GUARD is already defined
+            return std::nullopt;
+        }
+    }
+    if (depth != 0) {
+        return std::nullopt;
+    }
+    return guard;
+}
+
+} // namespace e2asm
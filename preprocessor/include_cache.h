@@ -0,0 +1,101 @@
+/**
+ * @file include_cache.h
+ * @brief Cache of %include files shared across assembly runs
+ *
+ * Build farms assemble many modules that pull in the same headers. Without
+ * a cache every %include probes the include paths, reads the file, and the
+ * preprocessor walks it again even when an include guard makes it a no-op.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace e2asm {
+
+/**
+ * @brief Remembers resolved include paths, file contents, and include guards
+ *
+ * Contents are keyed by resolved path and revalidated against the file's
+ * modification time, so an edited header is picked up on the next load.
+ * A file whose whole body is wrapped in
+ * @code
+ * %ifndef GUARD
+ * %define GUARD
+ * ...
+ * %endif
+ * @endcode
+ * is recorded as guarded; once GUARD is defined the preprocessor skips the
+ * include without touching the file again.
+ *
+ * Owned by the Assembler so it survives between assemble() calls. All
+ * members are safe to call from several threads at once; entries are handed
+ * out by value and share the file text, so a reader is never affected by
+ * another thread refreshing the same file.
+ */
+class IncludeCache {
+public:
+    /**
+     * @brief A loaded include file
+     */
+    struct Entry {
+        std::shared_ptr<const std::string> content;  ///< File text (shared with readers still using it)
+        std::filesystem::file_time_type mtime;       ///< Modification time the content was read at
+        std::optional<std::string> guard;            ///< Include guard macro, if the file has one
+    };
+
+    /**
+     * @brief Finds the file an include name refers to
+     * @param name Name from the %include directive
+     * @param include_paths Directories searched after the current directory
+     * @return Resolved path, or empty if no such file exists
+     *
+     * Successful lookups are memoized per (name, include paths).
+     */
+    std::string resolve(const std::string& name, const std::vector<std::string>& include_paths);
+
+    /**
+     * @brief Returns the contents of a resolved include file
+     * @param path Path returned by resolve()
+     * @return Cached entry, re-read if the file changed; nullopt if it can't be read
+     */
+    std::optional<Entry> load(const std::string& path);
+
+    /**
+     * @brief Include guard recorded for a file by an earlier load()
+     * @param path Resolved path
+     * @return Guard macro name, or nullopt if unknown or unguarded
+     *
+     * A file edited since it was loaded is re-read first, so a guard that
+     * was removed from it isn't trusted.
+     */
+    std::optional<std::string> guard(const std::string& path);
+
+    /** @brief Forgets all resolved paths and contents */
+    void clear();
+
+    /** @brief Number of times a file was actually read from disk */
+    size_t diskReads() const;
+
+    /**
+     * @brief Detects a %ifndef/%define/%endif guard around a whole file
+     * @param content File text
+     * @return Guard macro name, or nullopt if the file isn't fully guarded
+     */
+    static std::optional<std::string> detectGuard(std::string_view content);
+
+private:
+    mutable std::mutex m_mutex;                               ///< Guards every member below
+    std::unordered_map<std::string, std::string> m_resolved;  ///< Name + search paths -> path
+    std::unordered_map<std::string, Entry> m_entries;         ///< Path -> contents
+    size_t m_disk_reads = 0;                                   ///< Reads that missed the cache
+};
+
+} // namespace e2asm
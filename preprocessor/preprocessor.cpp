@@ -1,6 +1,6 @@
 #include "preprocessor.h"
+#include "../parser/expression_parser.h"
 #include <fstream>
-#include <sstream>
 #include <algorithm>
 #include <cctype>
 
@@ -14,8 +14,23 @@ void Preprocessor::reset() {
     m_macros.clear();
     m_errors.clear();
     m_conditional_stack.clear();
-    m_output_lines.clear();
+    m_frames.clear();
     m_recording_macro = false;
+    m_expansions = 0;
+    m_macro_depth = 0;
+    m_macro_expansions = 0;
+}
+
+void Preprocessor::setFileTable(FileTable* files) {
+    m_files = files;
+}
+
+FileTable& Preprocessor::files() {
+    return m_files ? *m_files : m_own_files;
+}
+
+SourceLocation Preprocessor::location(size_t line_num) const {
+    return SourceLocation(m_current_file, line_num, 0);
 }
 
 void Preprocessor::setIncludePaths(const std::vector<std::string>& paths) {
@@ -23,74 +38,147 @@ void Preprocessor::setIncludePaths(const std::vector<std::string>& paths) {
 }
 
 Preprocessor::PreprocessResult Preprocessor::process(const std::string& source, const std::string& filename) {
+    begin(source, filename);
+
+    std::string output;
+    output.reserve(source.size());
+    while (auto line = nextLine()) {
+        output += *line;
+        output += '\n';
+    }
+
+    return PreprocessResult{output, m_errors, m_errors.empty()};
+}
+
+void Preprocessor::begin(std::string_view source, const std::string& filename) {
     reset();
-    m_current_filename = filename;
+    m_current_file = files().intern(filename);
+    enterFile(source, m_current_file);
+}
+
+void Preprocessor::enterFile(std::string_view text, FileId file, std::shared_ptr<const void> owner) {
+    auto& frame = m_frames.emplace_back();
+    frame.owner = std::move(owner);
+    frame.text = text;
+    frame.file = file;
+    frame.conditional_depth = m_conditional_stack.size();
+    m_current_file = file;
+}
+
+void Preprocessor::leaveFile() {
+    SourceFrame& frame = m_frames.back();
+    m_current_file = frame.file;
+
+    // Conditionals don't carry over file boundaries
+    if (m_conditional_stack.size() > frame.conditional_depth) {
+        m_errors.push_back(Error("Unclosed conditional block (missing %endif)",
+                                location(m_conditional_stack.back().line_num)));
+        m_conditional_stack.resize(frame.conditional_depth);
+    }
+
+    if (frame.is_macro) {
+        m_macro_depth--;
+    }
 
-    // Split source into lines
-    std::vector<std::string> lines;
-    std::istringstream stream(source);
-    std::string line;
-    while (std::getline(stream, line)) {
-        lines.push_back(line);
+    m_frames.pop_back();
+    if (!m_frames.empty()) {
+        m_current_file = m_frames.back().file;
+        return;
     }
 
-    // Process lines
-    for (size_t i = 0; i < lines.size(); ++i) {
-        std::string current_line = lines[i];
-        size_t line_num = i + 1;
+    if (m_recording_macro) {
+        m_errors.push_back(Error("Unclosed macro definition (missing %endmacro)",
+                                location(m_current_macro.line_defined)));
+        m_recording_macro = false;
+    }
+}
+
+bool Preprocessor::readLine(SourceFrame& frame, std::string_view& line) {
+    if (frame.pos >= frame.text.size()) {
+        return false;
+    }
+
+    size_t end = frame.text.find('\n', frame.pos);
+    if (end == std::string_view::npos) {
+        end = frame.text.size();
+    }
+    line = frame.text.substr(frame.pos, end - frame.pos);
+    frame.pos = end + 1;
+    frame.line_num++;
+    return true;
+}
+
+std::optional<std::string_view> Preprocessor::nextLine() {
+    while (!m_frames.empty()) {
+        SourceFrame& frame = m_frames.back();
+        std::string_view raw;
+        if (!readLine(frame, raw)) {
+            leaveFile();
+            continue;
+        }
+
+        size_t line_num = frame.line_num;
+        m_line.assign(raw);
 
         // Handle line continuation (\)
-        while (!current_line.empty() && current_line.back() == '\\') {
-            current_line.pop_back();  // Remove backslash
-            if (i + 1 < lines.size()) {
-                ++i;
-                current_line += lines[i];
+        while (!m_line.empty() && m_line.back() == '\\') {
+            m_line.pop_back();  // Remove backslash
+            if (readLine(frame, raw)) {
+                m_line += raw;
             } else {
                 m_errors.push_back(Error("Line continuation at end of file",
-                                        SourceLocation{m_current_filename, line_num, 0}));
+                                        location(line_num)));
                 break;
             }
         }
 
-        // Trim whitespace
-        current_line = trim(current_line);
+        // Trim whitespace in place, the buffer is reused for every line
+        size_t first = m_line.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos) {
+            m_line.clear();
+        } else {
+            m_line.erase(m_line.find_last_not_of(" \t\r\n") + 1);
+            m_line.erase(0, first);
+        }
+
+        bool active = m_conditional_stack.empty() || m_conditional_stack.back().is_true;
 
         // Skip empty lines and comments
-        if (current_line.empty() || current_line[0] == ';') {
-            if (!m_recording_macro && (m_conditional_stack.empty() || m_conditional_stack.back().is_true)) {
-                m_output_lines.push_back(current_line);
+        if (m_line.empty() || m_line[0] == ';') {
+            if (!m_recording_macro && active) {
+                return std::string_view(m_line);
             }
             continue;
         }
 
         // Check if this is a directive
-        if (isDirective(current_line)) {
-            std::string directive = getDirectiveName(current_line);
+        if (isDirective(m_line)) {
+            std::string directive = getDirectiveName(m_line);
 
             // Handle directives
             if (directive == "define") {
                 if (!m_recording_macro && (m_conditional_stack.empty() || m_conditional_stack.back().is_true)) {
-                    handleDefine(current_line, line_num);
+                    handleDefine(m_line, line_num);
                 }
             } else if (directive == "undef") {
                 if (!m_recording_macro && (m_conditional_stack.empty() || m_conditional_stack.back().is_true)) {
-                    handleUndef(current_line, line_num);
+                    handleUndef(m_line, line_num);
                 }
             } else if (directive == "ifdef") {
-                handleIfdef(current_line, line_num);
+                handleIfdef(m_line, line_num);
             } else if (directive == "ifndef") {
-                handleIfndef(current_line, line_num);
+                handleIfndef(m_line, line_num);
             } else if (directive == "if") {
-                handleIf(current_line, line_num);
+                handleIf(m_line, line_num);
             } else if (directive == "elif") {
-                handleElif(current_line, line_num);
+                handleElif(m_line, line_num);
             } else if (directive == "else") {
                 handleElse(line_num);
             } else if (directive == "endif") {
                 handleEndif(line_num);
             } else if (directive == "macro") {
                 if (!m_recording_macro && (m_conditional_stack.empty() || m_conditional_stack.back().is_true)) {
-                    handleMacro(current_line, line_num);
+                    handleMacro(m_line, line_num);
                 }
             } else if (directive == "endmacro") {
                 if (m_recording_macro) {
@@ -98,43 +186,30 @@ Preprocessor::PreprocessResult Preprocessor::process(const std::string& source,
                 }
             } else if (directive == "include") {
                 if (!m_recording_macro && (m_conditional_stack.empty() || m_conditional_stack.back().is_true)) {
-                    handleInclude(current_line, line_num);
+                    handleInclude(m_line, line_num);
                 }
             } else {
                 m_errors.push_back(Error("Unknown preprocessor directive: %" + directive,
-                                        SourceLocation{m_current_filename, line_num, 0}));
-            }
-        } else {
-            // Regular line - check if we should output it
-            if (m_recording_macro) {
-                // Add to current macro body
-                m_current_macro.body.push_back(current_line);
-            } else if (m_conditional_stack.empty() || m_conditional_stack.back().is_true) {
-                // Expand defines and check for macro calls
-                std::string expanded = expandDefines(current_line);
-                m_output_lines.push_back(expanded);
+                                        location(line_num)));
             }
+            continue;
         }
-    }
 
-    // Check for unclosed blocks
-    if (!m_conditional_stack.empty()) {
-        m_errors.push_back(Error("Unclosed conditional block (missing %endif)",
-                                SourceLocation{m_current_filename, m_conditional_stack.back().line_num, 0}));
-    }
-
-    if (m_recording_macro) {
-        m_errors.push_back(Error("Unclosed macro definition (missing %endmacro)",
-                                SourceLocation{m_current_filename, m_current_macro.line_defined, 0}));
-    }
-
-    // Build output
-    std::string output;
-    for (const auto& line : m_output_lines) {
-        output += line + "\n";
+        // Regular line - check if we should output it
+        if (m_recording_macro) {
+            // Add to current macro body
+            m_current_macro.body.push_back(m_line);
+        } else if (active) {
+            // Expand defines and check for macro calls
+            const std::string& expanded = expandDefines(m_line);
+            if (!m_macros.empty() && invokeMacro(expanded, line_num)) {
+                continue;
+            }
+            return std::string_view(expanded);
+        }
     }
 
-    return PreprocessResult{output, m_errors, m_errors.empty()};
+    return std::nullopt;
 }
 
 bool Preprocessor::isDirective(const std::string& line) const {
@@ -162,7 +237,7 @@ void Preprocessor::handleDefine(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%define requires a name",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -187,7 +262,7 @@ void Preprocessor::handleUndef(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%undef requires a name",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -208,7 +283,7 @@ void Preprocessor::handleIfdef(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%ifdef requires a name",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -229,7 +304,7 @@ void Preprocessor::handleIfndef(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%ifndef requires a name",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -250,11 +325,11 @@ void Preprocessor::handleIf(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%if requires an expression",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
-    std::string expr = expandDefines(line.substr(pos));
+    const std::string& expr = expandDefines(std::string_view(line).substr(pos));
     bool result = evaluateExpression(expr);
     bool parent_active = m_conditional_stack.empty() || m_conditional_stack.back().is_true;
 
@@ -264,7 +339,7 @@ void Preprocessor::handleIf(const std::string& line, size_t line_num) {
 void Preprocessor::handleElif(const std::string& line, size_t line_num) {
     if (m_conditional_stack.empty()) {
         m_errors.push_back(Error("%elif without matching %if",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -276,14 +351,14 @@ void Preprocessor::handleElif(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%elif requires an expression",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
     auto& block = m_conditional_stack.back();
 
     if (!block.has_true_branch) {
-        std::string expr = expandDefines(line.substr(pos));
+        const std::string& expr = expandDefines(std::string_view(line).substr(pos));
         bool result = evaluateExpression(expr);
         bool parent_active = m_conditional_stack.size() == 1 ||
                             m_conditional_stack[m_conditional_stack.size() - 2].is_true;
@@ -298,7 +373,7 @@ void Preprocessor::handleElif(const std::string& line, size_t line_num) {
 void Preprocessor::handleElse(size_t line_num) {
     if (m_conditional_stack.empty()) {
         m_errors.push_back(Error("%else without matching %if",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -317,7 +392,7 @@ void Preprocessor::handleElse(size_t line_num) {
 void Preprocessor::handleEndif(size_t line_num) {
     if (m_conditional_stack.empty()) {
         m_errors.push_back(Error("%endif without matching %if",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -333,7 +408,7 @@ void Preprocessor::handleMacro(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%macro requires a name",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -343,7 +418,10 @@ void Preprocessor::handleMacro(const std::string& line, size_t line_num) {
     std::string name = line.substr(name_start, pos - name_start);
 
     m_recording_macro = true;
-    m_current_macro = MacroDefinition{name, {}, {}, line_num};
+    m_current_macro = MacroDefinition{};
+    m_current_macro.name = name;
+    m_current_macro.line_defined = line_num;
+    m_current_macro.file_defined = m_current_file;
 
     // For simplicity, we'll support NASM-style numbered parameters (%1, %2, etc.)
     // Parse parameter count
@@ -367,14 +445,177 @@ void Preprocessor::handleMacro(const std::string& line, size_t line_num) {
 void Preprocessor::handleEndmacro(size_t line_num) {
     if (!m_recording_macro) {
         m_errors.push_back(Error("%endmacro without matching %macro",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
-    m_macros[m_current_macro.name] = m_current_macro;
+    compileMacro(m_current_macro);
+    std::string name = m_current_macro.name;
+    m_macros.insert_or_assign(std::move(name), std::move(m_current_macro));
     m_recording_macro = false;
 }
 
+void Preprocessor::compileMacro(MacroDefinition& macro) {
+    macro.text.clear();
+    macro.pieces.clear();
+    for (const auto& line : macro.body) {
+        macro.text += line;
+        macro.text += '\n';
+    }
+
+    const std::string& text = macro.text;
+    size_t literal_start = 0;
+    auto add_literal = [&](size_t end) {
+        if (end > literal_start) {
+            macro.pieces.push_back({static_cast<uint32_t>(literal_start),
+                                    static_cast<uint32_t>(end - literal_start), -1});
+        }
+    };
+
+    size_t pos = 0;
+    while ((pos = text.find('%', pos)) != std::string::npos) {
+        // %% stays as written
+        if (pos + 1 < text.size() && text[pos + 1] == '%') {
+            pos += 2;
+            continue;
+        }
+
+        size_t digits_end = pos + 1;
+        while (digits_end < text.size() && std::isdigit(static_cast<unsigned char>(text[digits_end]))) {
+            ++digits_end;
+        }
+        if (digits_end == pos + 1) {
+            ++pos;
+            continue;
+        }
+
+        int param = std::stoi(text.substr(pos + 1, digits_end - pos - 1));
+        if (static_cast<size_t>(param) > macro.parameters.size()) {
+            m_errors.push_back(Error("Macro '" + macro.name + "' has no parameter %" + std::to_string(param),
+                                    SourceLocation(macro.file_defined, macro.line_defined, 0)));
+        }
+
+        add_literal(pos);
+        macro.pieces.push_back({0, 0, param});
+        pos = digits_end;
+        literal_start = pos;
+    }
+    add_literal(text.size());
+}
+
+bool Preprocessor::invokeMacro(std::string_view line, size_t line_num) {
+    size_t name_end = 0;
+    while (name_end < line.size() &&
+           (std::isalnum(static_cast<unsigned char>(line[name_end])) || line[name_end] == '_')) {
+        ++name_end;
+    }
+    if (name_end == 0 || (name_end < line.size() && !std::isspace(static_cast<unsigned char>(line[name_end])))) {
+        return false;
+    }
+
+    auto it = m_macros.find(line.substr(0, name_end));
+    if (it == m_macros.end()) {
+        return false;
+    }
+    const MacroDefinition& macro = it->second;
+
+    parseMacroArgs(line.substr(name_end), m_macro_args);
+    if (m_macro_args.size() != macro.parameters.size()) {
+        m_errors.push_back(Error("Macro '" + macro.name + "' expects " +
+                                std::to_string(macro.parameters.size()) + " argument(s), got " +
+                                std::to_string(m_macro_args.size()), location(line_num)));
+        return true;
+    }
+    if (m_macro_depth >= MAX_MACRO_DEPTH) {
+        m_errors.push_back(Error("Macro expansion nested too deeply (recursive macro?): " + macro.name,
+                                location(line_num)));
+        return true;
+    }
+
+    // Frames are a stack, so the buffer for this depth is free again by the
+    // time another call at the same depth comes along
+    if (m_macro_buffers.size() <= m_macro_depth) {
+        m_macro_buffers.emplace_back();
+    }
+    std::string& buffer = m_macro_buffers[m_macro_depth];
+    buffer.clear();
+    expandMacro(macro, m_macro_args, buffer);
+
+    // The body is read like an included file, so defines, directives and
+    // nested calls inside it work as usual. Lines report the definition's location
+    m_macro_expansions++;
+    m_macro_depth++;
+    enterFile(buffer, macro.file_defined);
+    m_frames.back().line_num = macro.line_defined;
+    m_frames.back().is_macro = true;
+    return true;
+}
+
+void Preprocessor::expandMacro(const MacroDefinition& macro, const std::vector<std::string_view>& args,
+                               std::string& out) {
+    std::string_view text = macro.text;
+    for (const auto& piece : macro.pieces) {
+        if (piece.param < 0) {
+            out.append(text.substr(piece.offset, piece.length));
+        } else if (piece.param == 0) {
+            out += std::to_string(args.size());
+        } else if (static_cast<size_t>(piece.param) <= args.size()) {
+            out.append(args[piece.param - 1]);
+        }
+    }
+}
+
+void Preprocessor::parseMacroArgs(std::string_view args_str, std::vector<std::string_view>& args) {
+    args.clear();
+
+    auto trimmed = [](std::string_view text) {
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string_view::npos) {
+            return std::string_view();
+        }
+        return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+    };
+
+    // A trailing comment isn't part of the arguments (a ';' inside quotes is)
+    char quote = 0;
+    for (size_t i = 0; i < args_str.size(); ++i) {
+        char c = args_str[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == ';') {
+            args_str = args_str.substr(0, i);
+            break;
+        }
+    }
+
+    std::string_view rest = trimmed(args_str);
+    if (rest.empty()) {
+        return;
+    }
+
+    size_t start = 0;
+    int depth = 0;
+    quote = 0;
+    for (size_t i = 0; i < rest.size(); ++i) {
+        char c = rest[i];
+        if (quote) {
+            if (c == quote) quote = 0;
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+        } else if (c == '[' || c == '(') {
+            ++depth;
+        } else if ((c == ']' || c == ')') && depth > 0) {
+            --depth;
+        } else if (c == ',' && depth == 0) {
+            args.push_back(trimmed(rest.substr(start, i - start)));
+            start = i + 1;
+        }
+    }
+    args.push_back(trimmed(rest.substr(start)));
+}
+
 void Preprocessor::handleInclude(const std::string& line, size_t line_num) {
     // Parse: %include "filename" or %include <filename>
     size_t pos = line.find("include");
@@ -384,14 +625,14 @@ void Preprocessor::handleInclude(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%include requires a filename",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
     char quote = line[pos];
     if (quote != '"' && quote != '<') {
         m_errors.push_back(Error("%include filename must be in quotes or angle brackets",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
@@ -403,74 +644,102 @@ void Preprocessor::handleInclude(const std::string& line, size_t line_num) {
 
     if (pos >= line.size()) {
         m_errors.push_back(Error("%include missing closing quote",
-                                SourceLocation{m_current_filename, line_num, 0}));
+                                location(line_num)));
         return;
     }
 
     std::string filename = line.substr(filename_start, pos - filename_start);
 
-    // Find and read the file
-    std::string filepath = findIncludeFile(filename);
-    if (filepath.empty()) {
-        m_errors.push_back(Error("Could not find include file: " + filename,
-                                SourceLocation{m_current_filename, line_num, 0}));
+    if (m_frames.size() >= MAX_INCLUDE_DEPTH) {
+        m_errors.push_back(Error("Include nested too deeply: " + filename,
+                                location(line_num)));
         return;
     }
 
-    std::string content = readFile(filepath);
-    if (content.empty() && !m_errors.empty()) {
-        // Error already added by readFile
+    // Find and read the file
+    std::string filepath = m_include_cache ? m_include_cache->resolve(filename, m_include_paths)
+                                           : findIncludeFile(filename);
+    if (filepath.empty()) {
+        m_errors.push_back(Error("Could not find include file: " + filename,
+                                location(line_num)));
         return;
     }
 
-    // Recursively process the included file
-    std::string saved_filename = m_current_filename;
-    auto result = process(content, filepath);
-    m_current_filename = saved_filename;
+    std::string_view text;
+    std::shared_ptr<const void> owner;
+    if (m_include_cache) {
+        // A guarded header whose guard is already set would expand to nothing
+        auto guard = m_include_cache->guard(filepath);
+        if (guard && m_defines.find(*guard) != m_defines.end()) {
+            return;
+        }
 
-    if (!result.success) {
-        m_errors.insert(m_errors.end(), result.errors.begin(), result.errors.end());
+        auto entry = m_include_cache->load(filepath);
+        if (!entry) {
+            m_errors.push_back(Error("Could not open file: " + filepath,
+                                    location(line_num)));
+            return;
+        }
+        text = *entry->content;
+        owner = entry->content;
+    } else {
+        auto mapped = mapFile(filepath);
+        if (!mapped) {
+            // Error already added by mapFile
+            return;
+        }
+        text = mapped->view();
+        owner = std::move(mapped);
     }
 
-    // Add included content to output
-    std::istringstream stream(result.source);
-    std::string included_line;
-    while (std::getline(stream, included_line)) {
-        m_output_lines.push_back(included_line);
-    }
+    // Continue reading from the included file; its lines are emitted before
+    // the rest of this one
+    enterFile(text, files().intern(filepath), std::move(owner));
 }
 
-std::string Preprocessor::expandDefines(const std::string& line) {
-    std::string result = line;
-
-    // Simple text replacement for %define constants
-    for (const auto& [name, value] : m_defines) {
-        size_t pos = 0;
-        while ((pos = result.find(name, pos)) != std::string::npos) {
-            // Check if it's a whole word (not part of another identifier)
-            bool is_word_start = (pos == 0 || !std::isalnum(result[pos - 1]) && result[pos - 1] != '_');
-            bool is_word_end = (pos + name.size() >= result.size() ||
-                               !std::isalnum(result[pos + name.size()]) && result[pos + name.size()] != '_');
+const std::string& Preprocessor::expandDefines(std::string_view line) {
+    m_expand_buffer.clear();
+    m_expand_buffer.reserve(line.size());
+    m_expanding.clear();
+    expandInto(line, m_expand_buffer, 0);
+    return m_expand_buffer;
+}
 
-            if (is_word_start && is_word_end) {
-                result.replace(pos, name.size(), value);
-                pos += value.size();
-            } else {
-                ++pos;
-            }
+void Preprocessor::expandInto(std::string_view text, std::string& out, size_t depth) {
+    auto is_word_char = [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    };
+
+    size_t pos = 0;
+    while (pos < text.size()) {
+        if (!is_word_char(text[pos])) {
+            // Copy the run of punctuation/whitespace up to the next word in one go
+            size_t next = pos + 1;
+            while (next < text.size() && !is_word_char(text[next])) ++next;
+            out.append(text.substr(pos, next - pos));
+            pos = next;
+            continue;
         }
-    }
 
-    // Check for macro invocations
-    for (const auto& [name, macro] : m_macros) {
-        size_t pos = result.find(name);
-        if (pos != std::string::npos) {
-            // Simple macro expansion (no parameter support yet in this phase)
-            // TODO: Parse arguments and expand with parameters
+        size_t end = pos + 1;
+        while (end < text.size() && is_word_char(text[end])) ++end;
+        std::string_view word = text.substr(pos, end - pos);
+        pos = end;
+
+        auto it = m_defines.find(word);
+        if (it == m_defines.end() || depth >= MAX_DEFINE_DEPTH ||
+            std::find(m_expanding.begin(), m_expanding.end(), &it->first) != m_expanding.end()) {
+            out.append(word);
+            continue;
         }
-    }
 
-    return result;
+        // Rescan the replacement so defines built from other defines work.
+        // A name is never expanded inside its own expansion
+        m_expansions++;
+        m_expanding.push_back(&it->first);
+        expandInto(it->second, out, depth + 1);
+        m_expanding.pop_back();
+    }
 }
 
 bool Preprocessor::evaluateExpression(const std::string& expr) {
@@ -483,12 +752,9 @@ bool Preprocessor::evaluateExpression(const std::string& expr) {
         return false;
     }
 
-    // Try to parse as number
-    try {
-        int value = std::stoi(trimmed);
-        return value != 0;
-    } catch (...) {
-        // Not a simple number, try operators
+    // Arithmetic on numbers (defines are already expanded), e.g. "VERSION*2-1"
+    if (auto program = ExpressionParser::compile(trimmed); program && program->isConstant()) {
+        return program->constantValue() != 0;
     }
 
     // Check for comparison operators
@@ -520,17 +786,14 @@ std::string Preprocessor::trim(const std::string& str) const {
     return str.substr(start, end - start);
 }
 
-std::string Preprocessor::readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+std::shared_ptr<const MappedFile> Preprocessor::mapFile(const std::string& filename) {
+    auto file = std::make_shared<MappedFile>();
+    if (!file->open(filename)) {
         m_errors.push_back(Error("Could not open file: " + filename,
-                                SourceLocation{m_current_filename, 0, 0}));
-        return "";
+                                location(0)));
+        return nullptr;
     }
-
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    return file;
 }
 
 std::string Preprocessor::findIncludeFile(const std::string& filename) {
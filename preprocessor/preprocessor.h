@@ -9,11 +9,18 @@
 
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+#include <optional>
+#include <deque>
+#include <functional>
 #include <unordered_map>
 #include <vector>
 #include <memory>
 #include "../core/error.h"
+#include "../core/mapped_file.h"
+#include "include_cache.h"
 
 namespace e2asm {
 
@@ -36,7 +43,27 @@ struct MacroDefinition {
     std::string name;                   ///< Macro identifier
     std::vector<std::string> parameters; ///< Parameter names (%1, %2, etc.)
     std::vector<std::string> body;       ///< Lines of macro body
-    size_t line_defined;                 ///< Source line where macro was defined
+    size_t line_defined = 0;             ///< Source line where macro was defined
+    FileId file_defined = FileTable::INPUT; ///< File the macro was defined in
+
+    /**
+     * @brief One run of the compiled body: literal text or a parameter
+     */
+    struct Piece {
+        uint32_t offset = 0;  ///< Start of the literal in text
+        uint32_t length = 0;  ///< Length of the literal
+        int32_t param = -1;   ///< Replaced by argument N (1-based), the argument count for 0, -1 for a literal
+    };
+
+    /**
+     * @brief Body compiled at %endmacro
+     *
+     * text holds the body lines joined by newlines; pieces cut it into
+     * literal spans and %N references. Expanding a call just appends the
+     * spans and argument text, the body is never searched again.
+     */
+    std::string text;
+    std::vector<Piece> pieces;
 };
 
 /**
@@ -92,6 +119,34 @@ public:
      */
     PreprocessResult process(const std::string& source, const std::string& filename = "<input>");
 
+    /**
+     * @brief Starts preprocessing source incrementally
+     * @param source Raw assembly source (must outlive the nextLine() calls)
+     * @param filename Filename for error reporting
+     *
+     * Pull the output with nextLine() instead of building it all at once.
+     */
+    void begin(std::string_view source, const std::string& filename = "<input>");
+
+    /**
+     * @brief Produces the next line of preprocessed output
+     * @return Line without its trailing newline, or nullopt once all input is consumed
+     *
+     * Directives are handled as they are reached, and %include switches to
+     * the included file until it is exhausted. The returned view points into
+     * an internal buffer and is only valid until the next call.
+     */
+    std::optional<std::string_view> nextLine();
+
+    /** @brief Errors reported so far */
+    const std::vector<Error>& errors() const { return m_errors; }
+
+    /** @brief %define substitutions made since the last reset(), nested ones included */
+    size_t expansionCount() const { return m_expansions; }
+
+    /** @brief Macro calls expanded since the last reset(), nested ones included */
+    size_t macroExpansionCount() const { return m_macro_expansions; }
+
     /**
      * @brief Configures directories to search for %include files
      * @param paths Vector of directory paths
@@ -101,6 +156,25 @@ public:
      */
     void setIncludePaths(const std::vector<std::string>& paths);
 
+    /**
+     * @brief Sets the file table that source and include names are interned into
+     * @param files Table owned by the caller, or nullptr to use an internal one
+     *
+     * Error locations carry ids from this table; resolve them with
+     * resolveFileNames() (or Error::format(files)) before display.
+     */
+    void setFileTable(FileTable* files);
+
+    /**
+     * @brief Shares an include cache across preprocessor runs
+     * @param cache Cache owned by the caller, or nullptr to read includes directly
+     *
+     * With a cache, include paths are resolved once, header contents are
+     * reused while unchanged on disk, and includes whose guard macro is
+     * already defined are skipped outright.
+     */
+    void setIncludeCache(IncludeCache* cache) { m_include_cache = cache; }
+
     /**
      * @brief Clears all definitions and state
      *
@@ -110,6 +184,28 @@ public:
     void reset();
 
 private:
+    /**
+     * @brief A source file being read line by line
+     */
+    struct SourceFrame {
+        std::shared_ptr<const void> owner;  ///< Keeps an included file's text alive (null for the main source)
+        std::string_view text;      ///< Text being read
+        size_t pos = 0;             ///< Offset of the next unread character
+        size_t line_num = 0;        ///< Number of the last line read (1-based)
+        FileId file = FileTable::INPUT;
+        size_t conditional_depth = 0;  ///< Conditional nesting when the file was entered
+        bool is_macro = false;         ///< Expanded macro body rather than a file
+    };
+
+    /** @brief Pushes a file onto the input stack (owner, if given, is kept alive by the frame) */
+    void enterFile(std::string_view text, FileId file, std::shared_ptr<const void> owner = nullptr);
+
+    /** @brief Pops the finished file, reporting blocks it left open */
+    void leaveFile();
+
+    /** @brief Reads the next physical line of a file, returns false at its end */
+    bool readLine(SourceFrame& frame, std::string_view& line);
+
     /** @brief Handles %define name value directive */
     void handleDefine(const std::string& line, size_t line_num);
 
@@ -140,6 +236,16 @@ private:
     /** @brief Handles %endmacro directive */
     void handleEndmacro(size_t line_num);
 
+    /** @brief Splits a macro body into literal spans and parameter references */
+    void compileMacro(MacroDefinition& macro);
+
+    /**
+     * @brief Expands the line as a macro call if it starts with a macro name
+     * @param line Line with defines already expanded
+     * @return true if the line was a call (its expansion is read next)
+     */
+    bool invokeMacro(std::string_view line, size_t line_num);
+
     /** @brief Handles %include "filename" directive */
     void handleInclude(const std::string& line, size_t line_num);
 
@@ -149,32 +255,68 @@ private:
     /** @brief Extracts directive name from line */
     std::string getDirectiveName(const std::string& line) const;
 
-    /** @brief Replaces %define constants in line */
-    std::string expandDefines(const std::string& line);
+    /**
+     * @brief Replaces %define constants in line
+     * @return Expanded text; stays valid until the next call
+     */
+    const std::string& expandDefines(std::string_view line);
+
+    /**
+     * @brief Appends text to out with every defined identifier substituted
+     * @param depth Nesting level of the replacement being rescanned
+     */
+    void expandInto(std::string_view text, std::string& out, size_t depth);
 
-    /** @brief Expands a macro invocation with arguments */
-    std::string expandMacro(const std::string& name, const std::vector<std::string>& args);
+    /** @brief Appends the body of macro with args substituted to out */
+    void expandMacro(const MacroDefinition& macro, const std::vector<std::string_view>& args, std::string& out);
 
     /** @brief Evaluates constant expression for %if */
     bool evaluateExpression(const std::string& expr);
 
-    /** @brief Parses comma-separated macro arguments */
-    std::vector<std::string> parseMacroArgs(const std::string& args_str);
+    /**
+     * @brief Parses comma-separated macro arguments
+     *
+     * Commas inside quotes, brackets or parentheses don't split. The views
+     * point into args_str.
+     */
+    void parseMacroArgs(std::string_view args_str, std::vector<std::string_view>& args);
 
     /** @brief Removes leading/trailing whitespace */
     std::string trim(const std::string& str) const;
 
-    /** @brief Reads file contents as string */
-    std::string readFile(const std::string& filename);
+    /** @brief Table in use (the caller's, or m_own_files) */
+    FileTable& files();
+
+    /** @brief Location in the file currently being processed */
+    SourceLocation location(size_t line_num) const;
+
+    /** @brief Maps a file for reading, reporting an error if it can't be opened */
+    std::shared_ptr<const MappedFile> mapFile(const std::string& filename);
 
     /** @brief Searches include paths for file */
     std::string findIncludeFile(const std::string& filename);
 
-    std::unordered_map<std::string, std::string> m_defines;      ///< %define constants
-    std::unordered_map<std::string, MacroDefinition> m_macros;   ///< %macro definitions
+    /**
+     * @brief Hash that accepts string_view so lookups don't build a std::string
+     */
+    struct NameHash {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+
+    /// Deepest chain of defines-within-defines that is still expanded
+    static constexpr size_t MAX_DEFINE_DEPTH = 32;
+
+    std::unordered_map<std::string, std::string, NameHash, std::equal_to<>>
+        m_defines;                                               ///< %define constants
+    std::unordered_map<std::string, MacroDefinition, NameHash, std::equal_to<>>
+        m_macros;                                                ///< %macro definitions
     std::vector<std::string> m_include_paths;                    ///< Directories to search
     std::vector<Error> m_errors;                                 ///< Accumulated errors
-    std::string m_current_filename;                              ///< Current file being processed
+    FileTable* m_files = nullptr;                                ///< Caller's file table (see setFileTable)
+    FileTable m_own_files;                                       ///< Fallback when no table is set
+    IncludeCache* m_include_cache = nullptr;                     ///< Shared include cache (see setIncludeCache)
+    FileId m_current_file = FileTable::INPUT;                    ///< Current file being processed
 
     /**
      * @brief State for nested conditional blocks
@@ -189,7 +331,23 @@ private:
     bool m_recording_macro = false;      ///< Currently inside %macro/%endmacro
     MacroDefinition m_current_macro;     ///< Macro being recorded
 
-    std::vector<std::string> m_output_lines;  ///< Accumulated preprocessed output
+    /// Deepest %include nesting accepted (stops self-including files)
+    static constexpr size_t MAX_INCLUDE_DEPTH = 64;
+
+    /// Deepest chain of macros called from macro bodies (stops runaway recursion)
+    static constexpr size_t MAX_MACRO_DEPTH = 64;
+
+    std::deque<SourceFrame> m_frames;  ///< Files being read, innermost last (deque keeps views stable)
+    std::string m_line;                ///< Logical line currently being processed
+
+    std::string m_expand_buffer;                    ///< Reused output of expandDefines
+    std::vector<const std::string*> m_expanding;    ///< Defines currently being expanded
+    size_t m_expansions = 0;                        ///< See expansionCount()
+
+    size_t m_macro_depth = 0;                       ///< Macro bodies currently on m_frames
+    size_t m_macro_expansions = 0;                  ///< See macroExpansionCount()
+    std::vector<std::string_view> m_macro_args;     ///< Reused by invokeMacro
+    std::deque<std::string> m_macro_buffers;        ///< Expansion text per macro depth, reused between calls
 };
 
 } // namespace e2asm
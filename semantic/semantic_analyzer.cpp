@@ -1,5 +1,4 @@
 #include "semantic_analyzer.h"
-#include "../parser/expression_parser.h"
 #include <algorithm>
 
 namespace e2asm {
@@ -9,37 +8,61 @@ SemanticAnalyzer::SemanticAnalyzer()
     , m_segment_start_address(0)
     , m_origin_address(0)
     , m_last_was_terminator(false)
+    , m_pass_count(0)
 {
+    m_sizer.setDryRun(true);
 }
 
 void SemanticAnalyzer::clear() {
     m_symbol_table.clear();
     m_addresses.clear();
+    m_address_slots.clear();
     m_errors.clear();
-    m_current_address = 0;
+    m_current_address = m_base_origin;
     m_segments.clear();
     m_current_segment.clear();
-    m_segment_start_address = 0;
-    m_origin_address = 0;
+    m_segment_start_address = m_base_origin;
+    m_origin_address = m_base_origin;
     m_last_was_terminator = false;
+    m_pass_count = 0;
 }
 
 bool SemanticAnalyzer::analyze(Program* program) {
     clear();
+    m_sizer.setSymbolTable(&m_symbol_table);
 
+    // Ids from a previous analysis of this tree point into a table that's gone
+    bindSymbols(program);
+
+    m_pass_count = 1;
     if (!pass1_buildSymbols(program)) {
         return false;
     }
+    bindSymbols(program);
+
+    // Relax until no address moves. The last pass is the one that confirms it
+    bool changed = true;
+    while (changed) {
+        if (m_pass_count >= MAX_LAYOUT_PASSES) {
+            error("Branch relaxation did not converge after " +
+                  std::to_string(m_pass_count) + " passes", SourceLocation());
+            break;
+        }
+        changed = pass2_resolveSymbols(program);
+        m_pass_count++;
+    }
 
-    /**
-      Pass 2 is doing a single iteration for now
-      TODO: optimize this
-    */
-    pass2_resolveSymbols(program);
+    for (ASTNode* stmt : program->statements) {
+        auto* times = ast_cast<TIMESDirective>(stmt);
+        if (times && times->count < 0) {
+            error("TIMES count is negative: " + times->count_expr, times->location);
+        }
+    }
 
-    for (const auto& [name, symbol] : m_symbol_table.getAllSymbols()) {
-        if (!symbol.is_resolved) {
-            error("Undefined symbol: " + name, SourceLocation());
+    const auto& symbols = m_symbol_table.getAllSymbols();
+    for (SymbolId id = 0; id < symbols.size(); id++) {
+        if (!symbols[id].is_resolved) {
+            error("Undefined symbol: " + m_symbol_table.qualifiedName(id), SourceLocation());
         }
     }
 
@@ -50,201 +73,195 @@ bool SemanticAnalyzer::pass1_buildSymbols(Program* program) {
     m_current_address = m_origin_address;
     m_segment_start_address = m_origin_address;
     m_addresses.clear();
+    m_address_slots.assign(program->statements.size(), NO_ADDRESS);
 
     for (size_t i = 0; i < program->statements.size(); i++) {
-        auto& stmt = program->statements[i];
+        ASTNode* stmt = program->statements[i];
+
+        switch (stmt->kind) {
+            // Handle labels
+            case NodeKind::LABEL: {
+                auto* label = static_cast<Label*>(stmt);
+                // If this is a global label (doesn't start with '.'), update the scope
+                if (!SymbolTable::isLocalLabel(label->name)) {
+                    m_symbol_table.setGlobalScope(label->name);
+                }
 
-        // Handle labels
-        if (auto* label = dynamic_cast<Label*>(stmt.get())) {
-            // If this is a global label (doesn't start with '.'), update the scope
-            if (!SymbolTable::isLocalLabel(label->name)) {
-                m_symbol_table.setGlobalScope(label->name);
-            }
+                // Define label at current address (will be scoped if local)
+                if (!m_symbol_table.define(label->name, SymbolType::LABEL, m_current_address, label->location.line)) {
+                    error("Label '" + label->name + "' already defined", label->location);
+                    return false;
+                }
 
-            // Define label at current address (will be scoped if local)
-            if (!m_symbol_table.define(label->name, SymbolType::LABEL, m_current_address, label->location.line)) {
-                error("Label '" + label->name + "' already defined", label->location);
-                return false;
+                // Labels don't consume space, but record them
+                recordAddress(i, 0);
+                break;
             }
 
-            // Labels don't consume space, but record them
-            m_addresses.push_back({i, m_current_address, 0});
-            continue;
-        }
+            // Handle EQU directives
+            case NodeKind::EQU: {
+                auto* equ = static_cast<EQUDirective*>(stmt);
+                // Define constant
+                if (!m_symbol_table.define(equ->name, SymbolType::CONSTANT, equ->value, equ->location.line)) {
+                    error("Constant '" + equ->name + "' already defined", equ->location);
+                    return false;
+                }
 
-        // Handle EQU directives
-        if (auto* equ = dynamic_cast<EQUDirective*>(stmt.get())) {
-            // Define constant
-            if (!m_symbol_table.define(equ->name, SymbolType::CONSTANT, equ->value, equ->location.line)) {
-                error("Constant '" + equ->name + "' already defined", equ->location);
-                return false;
+                // EQU doesn't consume space
+                recordAddress(i, 0);
+                break;
             }
 
-            // EQU doesn't consume space
-            m_addresses.push_back({i, m_current_address, 0});
-            continue;
-        }
+            // Handle ORG directive
+            case NodeKind::ORG: {
+                auto* org = static_cast<ORGDirective*>(stmt);
+                if (m_relocatable) {
+                    error("ORG is not allowed in an object module (the linker places its segments)",
+                          org->location);
+                    return false;
+                }
+                setOrigin(org->address);
+                recordAddress(i, 0);
+                break;
+            }
 
-        // Handle ORG directive
-        if (auto* org = dynamic_cast<ORGDirective*>(stmt.get())) {
-            setOrigin(org->address);
-            m_addresses.push_back({i, m_current_address, 0});
-            continue;
-        }
+            // Handle SEGMENT directive
+            case NodeKind::SEGMENT: {
+                auto* seg = static_cast<SEGMENTDirective*>(stmt);
+                enterSegment(seg->name);
 
-        // Handle SEGMENT directive
-        if (auto* seg = dynamic_cast<SEGMENTDirective*>(stmt.get())) {
-            enterSegment(seg->name);
+                // Define the segment name as a label pointing to segment start
+                // Temporarily clear global scope so segment names like .data aren't treated as local labels
+                std::string saved_scope = m_symbol_table.getGlobalScope();
+                m_symbol_table.setGlobalScope("");  // Clear scope for segment label
 
-            // Define the segment name as a label pointing to segment start
-            // Temporarily clear global scope so segment names like .data aren't treated as local labels
-            std::string saved_scope = m_symbol_table.getGlobalScope();
-            m_symbol_table.setGlobalScope("");  // Clear scope for segment label
+                if (!m_symbol_table.define(seg->name, SymbolType::LABEL, m_current_address, seg->location.line)) {
+                    // If already defined, update it instead
+                    // Does it work this way in NASM? idk
+                    m_symbol_table.update(seg->name, m_current_address);
+                }
+
+                m_symbol_table.setGlobalScope(saved_scope);  // Restore scope
 
-            if (!m_symbol_table.define(seg->name, SymbolType::LABEL, m_current_address, seg->location.line)) {
-                // If already defined, update it instead
-                // Does it work this way in NASM? idk
-                m_symbol_table.update(seg->name, m_current_address);
+                recordAddress(i, 0);
+                break;
             }
 
-            m_symbol_table.setGlobalScope(saved_scope);  // Restore scope
+            // Handle ENDS directive
+            case NodeKind::ENDS: {
+                auto* ends = static_cast<ENDSDirective*>(stmt);
+                exitSegment(ends->name);
+                recordAddress(i, 0);
+                break;
+            }
 
-            m_addresses.push_back({i, m_current_address, 0});
-            continue;
-        }
+            // Handle GLOBAL/EXTERN directives
+            case NodeKind::LINKAGE: {
+                auto* linkage = static_cast<LinkageDirective*>(stmt);
+                if (linkage->linkage == LinkageDirective::Kind::EXTERN) {
+                    for (const auto& name : linkage->names) {
+                        if (!m_relocatable) {
+                            error("External symbol '" + name + "' needs an object module and a link step",
+                                  linkage->location);
+                            return false;
+                        }
+                        // Resolved to 0 here; the linker patches every use
+                        if (!m_symbol_table.define(name, SymbolType::EXTERNAL, 0, linkage->location.line)) {
+                            error("Symbol '" + name + "' already defined", linkage->location);
+                            return false;
+                        }
+                    }
+                }
+                // GLOBAL names are checked against the finished symbol table
+                // when the object module is built
+                recordAddress(i, 0);
+                break;
+            }
 
-        // Handle ENDS directive
-        if (auto* ends = dynamic_cast<ENDSDirective*>(stmt.get())) {
-            exitSegment(ends->name);
-            m_addresses.push_back({i, m_current_address, 0});
-            continue;
-        }
+            // Handle RES* directives
+            case NodeKind::RES: {
+                auto* res = static_cast<RESDirective*>(stmt);
+                size_t element_size = 0;
+                switch (res->size) {
+                    case RESDirective::Size::BYTE: element_size = 1; break;
+                    case RESDirective::Size::WORD: element_size = 2; break;
+                    case RESDirective::Size::DWORD: element_size = 4; break;
+                    case RESDirective::Size::QWORD: element_size = 8; break;
+                    case RESDirective::Size::TBYTE: element_size = 10; break;
+                }
 
-        // Handle RES* directives
-        if (auto* res = dynamic_cast<RESDirective*>(stmt.get())) {
-            size_t element_size = 0;
-            switch (res->size) {
-                case RESDirective::Size::BYTE: element_size = 1; break;
-                case RESDirective::Size::WORD: element_size = 2; break;
-                case RESDirective::Size::DWORD: element_size = 4; break;
-                case RESDirective::Size::QWORD: element_size = 8; break;
-                case RESDirective::Size::TBYTE: element_size = 10; break;
+                uint64_t total_size = element_size * res->count;
+                recordAddress(i, total_size);
+                m_current_address += total_size;
+                break;
             }
 
-            uint64_t total_size = element_size * res->count;
-            m_addresses.push_back({i, m_current_address, total_size});
-            m_current_address += total_size;
-            continue;
-        }
-
-        // Handle TIMES directive
-        if (auto* times = dynamic_cast<TIMESDirective*>(stmt.get())) {
-            // Resolve symbolic count if needed (count == -1 means unresolved)
-            if (times->count < 0) {
-                int64_t resolved_count;
-                if (!resolveSymbol(times->count_expr, times->location, resolved_count)) {
+            // Handle TIMES directive
+            case NodeKind::TIMES: {
+                auto* times = static_cast<TIMESDirective*>(stmt);
+                if (times->symbolic_count && !resolveTimesCount(times)) {
                     return false;
                 }
-                times->count = resolved_count;
-            }
-
-            // Calculate size of the repeated node
-            uint64_t single_size = 0;
-
-            if (auto* data = dynamic_cast<DataDirective*>(times->repeated_node.get())) {
-                // Resolve any symbols in the data directive first
-                if (!resolveDataSymbols(data)) {
+                if (times->count < 0) {
+                    error("TIMES count is negative: " + times->count_expr, times->location);
                     return false;
                 }
 
-                size_t element_size = 0;
-                switch (data->size) {
-                    case DataDirective::Size::BYTE: element_size = 1; break;
-                    case DataDirective::Size::WORD: element_size = 2; break;
-                    case DataDirective::Size::DWORD: element_size = 4; break;
-                    case DataDirective::Size::QWORD: element_size = 8; break;
-                    case DataDirective::Size::TBYTE: element_size = 10; break;
-                }
-                for (const auto& value : data->values) {
-                    if (value.type == DataValue::Type::STRING) {
-                        single_size += value.string_value.length();
-                    } else if (value.type == DataValue::Type::CHARACTER) {
-                        single_size += 1;
-                    } else {
-                        single_size += element_size;
+                // Resolve any symbols in the data directive first
+                if (auto* data = ast_cast<DataDirective>(times->repeated_node)) {
+                    if (!resolveDataSymbols(data)) {
+                        return false;
                     }
                 }
-            } else if (auto* instr = dynamic_cast<Instruction*>(times->repeated_node.get())) {
-                single_size = calculateInstructionSize(instr);
-            }
-
-            uint64_t total_size = single_size * times->count;
-            m_addresses.push_back({i, m_current_address, total_size});
-            m_current_address += total_size;
-            continue;
-        }
 
-        // Handle data directives
-        if (auto* data = dynamic_cast<DataDirective*>(stmt.get())) {
-            // Resolve any symbols in the data directive
-            if (!resolveDataSymbols(data)) {
-                return false;
+                uint64_t single_size = measureRepeated(times);
+                uint64_t total_size = single_size * times->count;
+                recordAddress(i, total_size);
+                m_current_address += total_size;
+                break;
             }
 
-            uint64_t size = 0;
+            // Handle data directives
+            case NodeKind::DATA: {
+                auto* data = static_cast<DataDirective*>(stmt);
+                // Resolve any symbols in the data directive
+                if (!resolveDataSymbols(data)) {
+                    return false;
+                }
 
-            // Calculate size based on directive and values
-            size_t element_size = 0;
-            switch (data->size) {
-                case DataDirective::Size::BYTE: element_size = 1; break;
-                case DataDirective::Size::WORD: element_size = 2; break;
-                case DataDirective::Size::DWORD: element_size = 4; break;
-                case DataDirective::Size::QWORD: element_size = 8; break;
-                case DataDirective::Size::TBYTE: element_size = 10; break;
+                uint64_t size = measureData(data);
+                recordAddress(i, size);
+                m_current_address += size;
+                break;
             }
 
-            for (const auto& value : data->values) {
-                if (value.type == DataValue::Type::STRING) {
-                    size += value.string_value.length();
-                } else if (value.type == DataValue::Type::CHARACTER) {
-                    size += 1;
+            // Handle instructions
+            case NodeKind::INSTRUCTION: {
+                auto* instr = static_cast<Instruction*>(stmt);
+                prepareInstruction(instr, m_symbol_table);
+
+                // Record address for this instruction
+                uint64_t size = measureInstruction(instr);
+                instr->assigned_address = m_current_address;  // Store address in instruction
+                instr->estimated_size = size;                // Store estimated size
+                recordAddress(i, size);
+                m_current_address += size;
+
+                // Check if this instruction terminates control flow
+                // TODO: This is garbage, but it works so I will refine it later
+                Mnemonic id = instr->id;
+                if ((id == Mnemonic::HLT || id == Mnemonic::RET || id == Mnemonic::RETF ||
+                    id == Mnemonic::IRET || id == Mnemonic::JMP ||
+                    id == Mnemonic::INT) && instr->operands.size() >= 1) {
+                    m_last_was_terminator = true;
                 } else {
-                    size += element_size;
+                    m_last_was_terminator = false;
                 }
-            }
 
-            m_addresses.push_back({i, m_current_address, size});
-            m_current_address += size;
-            continue;
-        }
-
-        // Handle instructions
-        if (auto* instr = dynamic_cast<Instruction*>(stmt.get())) {
-            // Resolve memory operand expressions (EQU constants, etc.)
-            if (!resolveMemoryOperands(instr)) {
-                return false;
-            }
-
-            // Record address for this instruction
-            uint64_t size = calculateInstructionSize(instr);
-            instr->assigned_address = m_current_address;  // Store address in instruction
-            instr->estimated_size = size;                // Store estimated size
-            m_addresses.push_back({i, m_current_address, size});
-            m_current_address += size;
-
-            // Check if this instruction terminates control flow
-            // TODO: This is garbage, but it works so I will refine it later
-            std::string mnem = instr->mnemonic;
-            std::transform(mnem.begin(), mnem.end(), mnem.begin(), ::toupper);
-            if ((mnem == "HLT" || mnem == "RET" || mnem == "RETF" ||
-                mnem == "IRET" || mnem == "JMP" ||
-                mnem == "INT") && instr->operands.size() >= 1) {
-                m_last_was_terminator = true;
-            } else {
-                m_last_was_terminator = false;
+                break;
             }
-
-            continue;
+            default:
+                break;
         }
     }
 
@@ -252,356 +269,226 @@ bool SemanticAnalyzer::pass1_buildSymbols(Program* program) {
 }
 
 bool SemanticAnalyzer::pass2_resolveSymbols(Program* program) {
-    /**
-      TODO: Full iterative res will be added here.
-      For now, all labels are resolved in phase 1 so, do nothing.
-      In the future, we will resolve EQU constants, handle forward references in expressions
-    */
-
-    return false;
-}
-
-/**
-  99% of the bugs we will find in the future are related to this function.
-*/
-uint64_t SemanticAnalyzer::calculateInstructionSize(Instruction* instr) {
-    std::string mnemonic = instr->mnemonic;
-    std::transform(mnemonic.begin(), mnemonic.end(), mnemonic.begin(), ::toupper);
+    // Replay the layout from pass 1. Only instruction sizes can change, data
+    // and reservations keep the size recorded the first time around (but not
+    // the label values data refers to)
+    bool changed = false;
+
+    m_current_address = m_base_origin;
+    m_segment_start_address = m_base_origin;
+    m_origin_address = m_base_origin;
+    m_segments.clear();
+    m_current_segment.clear();
+    m_symbol_table.setGlobalScope("");
 
-    // No Operand - 1 byte
-    if (instr->operands.empty()) {
-        // String instructions
-        if (mnemonic == "MOVSB" || mnemonic == "MOVSW" ||
-            mnemonic == "CMPSB" || mnemonic == "CMPSW" ||
-            mnemonic == "SCASB" || mnemonic == "SCASW" ||
-            mnemonic == "LODSB" || mnemonic == "LODSW" ||
-            mnemonic == "STOSB" || mnemonic == "STOSW") {
-            return 1;
-        }
+    for (auto& info : m_addresses) {
+        ASTNode* stmt = program->statements[info.statement_index];
+        uint64_t size = info.size;
 
-        // Control flow
-        if (mnemonic == "NOP" || mnemonic == "HLT" ||
-            mnemonic == "RET" || mnemonic == "RETF" ||
-            mnemonic == "IRET") {
-            return 1;
+        if (auto* org = ast_cast<ORGDirective>(stmt)) {
+            setOrigin(org->address);
         }
+        else if (auto* seg = ast_cast<SEGMENTDirective>(stmt)) {
+            enterSegment(seg->name, false);
 
-        // Stack operations
-        if (mnemonic == "PUSHA" || mnemonic == "POPA" ||
-            mnemonic == "PUSHF" || mnemonic == "POPF") {
-            return 1;
+            std::string saved_scope = m_symbol_table.getGlobalScope();
+            m_symbol_table.setGlobalScope("");
+            m_symbol_table.update(seg->name, m_current_address);
+            m_symbol_table.setGlobalScope(saved_scope);
         }
-
-        // Flag operations
-        if (mnemonic == "CLC" || mnemonic == "STC" || mnemonic == "CMC" ||
-            mnemonic == "CLD" || mnemonic == "STD" ||
-            mnemonic == "CLI" || mnemonic == "STI") {
-            return 1;
+        else if (auto* ends = ast_cast<ENDSDirective>(stmt)) {
+            exitSegment(ends->name);
         }
 
-        // Conversion
-        if (mnemonic == "CBW" || mnemonic == "CWD" ||
-            mnemonic == "LAHF" || mnemonic == "SAHF") {
-            return 1;
+        if (info.address != m_current_address) {
+            info.address = m_current_address;
+            changed = true;
         }
 
-        // BCD arithmetic
-        if (mnemonic == "AAA" || mnemonic == "AAS" ||
-            mnemonic == "AAM" || mnemonic == "AAD" ||
-            mnemonic == "DAA" || mnemonic == "DAS") {
-            return 1;
+        if (auto* label = ast_cast<Label>(stmt)) {
+            if (!SymbolTable::isLocalLabel(label->name)) {
+                m_symbol_table.setGlobalScope(label->name);
+            }
+            m_symbol_table.update(label->name, m_current_address);
         }
-
-        // Other
-        if (mnemonic == "XLAT" || mnemonic == "WAIT" || mnemonic == "LOCK" ||
-            mnemonic == "INT3" || mnemonic == "INTO") {
-            return 1;
+        else if (auto* instr = ast_cast<Instruction>(stmt)) {
+            size = measureInstruction(instr);
+            instr->assigned_address = m_current_address;
+            instr->estimated_size = size;
         }
-
-        // Repeat prefixes
-        if (mnemonic == "REP" || mnemonic == "REPE" || mnemonic == "REPZ" ||
-            mnemonic == "REPNE" || mnemonic == "REPNZ") {
-            return 1;
+        else if (auto* data = ast_cast<DataDirective>(stmt)) {
+            // Labels move as branches grow, so the values are taken again;
+            // the final pass leaves the ones the code generator emits
+            resolveDataSymbols(data);
         }
-    }
-
-    // RET with imm16 - 3 bytes
-    if ((mnemonic == "RET" || mnemonic == "RETF") && instr->operands.size() == 1) {
-        return 3;  // Opcode (1) + imm16 (2)
-    }
-
-    // JMPs (My nightmare)
-    // Im sure there are some bugs down there but they are hidden for now
-    if (mnemonic == "JMP" || mnemonic == "CALL") {
-        if (instr->operands.size() == 1) {
-            auto* label_ref = dynamic_cast<LabelRef*>(instr->operands[0].get());
-            if (label_ref) {
-                // CALL must always be NEAR (no SHORT encoding)
-                if (mnemonic == "CALL") {
-                    return 3;  // NEAR: opcode (1) + rel16 (2)
-                }
-
-                // For JMP: Use jump_type set by parser (no optimization)
-                // TODO: Implement multi-pass assembly for proper jump optimization
-                // Single-pass optimization causes forward reference issues
-                if (label_ref->jump_type == LabelRef::JumpType::SHORT) {
-                    return 2;
-                } else {
-                    return 3;  // NEAR
+        else if (auto* times = ast_cast<TIMESDirective>(stmt)) {
+            if (auto* data = ast_cast<DataDirective>(times->repeated_node)) {
+                resolveDataSymbols(data);
+            }
+            // A count like 510-($-$$) moves with the code in front of it
+            if (times->symbolic_count) {
+                if (auto count = evaluateExpression(times->count_program)) {
+                    times->count = *count;
                 }
+                // A count that went negative is reported once layout settles
+                size = times->count > 0 ? measureRepeated(times) * times->count : 0;
+            } else if (ast_cast<Instruction>(times->repeated_node)) {
+                size = measureRepeated(times) * times->count;
             }
-            // Default to NEAR
-            return 3;
         }
-        // Indirect jumps (JMP reg or JMP [mem])
-        return 2;  // Opcode (1) + ModRM (1)
-    }
-
-    // Conditional jumps (always SHORT - 2 bytes)
-    if (mnemonic == "JE" || mnemonic == "JNE" || mnemonic == "JZ" || mnemonic == "JNZ" ||
-        mnemonic == "JL" || mnemonic == "JLE" || mnemonic == "JG" || mnemonic == "JGE" ||
-        mnemonic == "JNL" || mnemonic == "JNLE" || mnemonic == "JNG" || mnemonic == "JNGE" ||
-        mnemonic == "JA" || mnemonic == "JAE" || mnemonic == "JB" || mnemonic == "JBE" ||
-        mnemonic == "JNA" || mnemonic == "JNAE" || mnemonic == "JNB" || mnemonic == "JNBE" ||
-        mnemonic == "JC" || mnemonic == "JNC" || mnemonic == "JO" || mnemonic == "JNO" ||
-        mnemonic == "JS" || mnemonic == "JNS" || mnemonic == "JP" || mnemonic == "JPE" ||
-        mnemonic == "JNP" || mnemonic == "JPO" ||
-        mnemonic == "LOOP" || mnemonic == "LOOPE" || mnemonic == "LOOPZ" ||
-        mnemonic == "LOOPNE" || mnemonic == "LOOPNZ" || mnemonic == "JCXZ") {
-        return 2;  // Opcode (1) + rel8 (1)
-    }
 
-    // INT instruction
-    if (mnemonic == "INT" && instr->operands.size() == 1) {
-        return 2;  // Opcode (1) + imm8 (1)
+        if (size != info.size) {
+            info.size = size;
+            changed = true;
+        }
+        m_current_address += size;
     }
 
-    // I/O INSTRUCTIONS
-    if (mnemonic == "IN" || mnemonic == "OUT") {
-        if (instr->operands.size() == 2) {
-            // Check if using immediate port or DX
-            auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[0].get());
-            if (!imm) imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
+    return changed;
+}
 
-            if (imm) {
-                return 2;  // Opcode (1) + imm8 (1)
-            }
-            return 1;  // Using DX register
+void SemanticAnalyzer::bindSymbols(Program* program) {
+    // Locals belong to the last global label, as in the layout passes
+    std::string_view scope;
+    auto bind = [&](std::string_view name) -> std::optional<SymbolId> {
+        const Symbol* symbol = m_symbol_table.findFrom(name, scope);
+        if (!symbol && SymbolTable::isLocalLabel(name)) {
+            symbol = m_symbol_table.findDirect(name);
         }
-    }
-
-    // MOV INSTRUCTION
-    if (mnemonic == "MOV" && instr->operands.size() == 2) {
-        auto* dest_reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-        auto* src_reg = dynamic_cast<RegisterOperand*>(instr->operands[1].get());
-        auto* dest_mem = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
-        auto* src_mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
-        auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
-
-        // MOV reg, immediate - use B8+r encoding (3 bytes for 16-bit, 2 for 8-bit)
-        if (dest_reg && imm) {
-            if (dest_reg->size == 16) {
-                return 3;  // Opcode (1) + imm16 (2)
-            } else {
-                return 2;  // Opcode (1) + imm8 (1)
-            }
+        if (!symbol) {
+            return std::nullopt;
         }
+        return m_symbol_table.idOf(*symbol);
+    };
 
-        // MOV reg, reg - 2 bytes (opcode + ModRM)
-        if (dest_reg && src_reg) {
-            return 2;
+    // Operand expressions look their constants up by exact name, a TIMES
+    // count is scoped like everything else, the way each evaluateExpression reads them
+    auto bindExpression = [&](ExpressionProgram& expression, bool exact_names) {
+        const auto& names = expression.symbols();
+        for (size_t slot = 0; slot < names.size(); slot++) {
+            const Symbol* symbol = exact_names ? m_symbol_table.findDirect(names[slot])
+                                               : m_symbol_table.findFrom(names[slot], scope);
+            expression.bind(slot, symbol ? std::optional<SymbolId>(m_symbol_table.idOf(*symbol)) : std::nullopt);
         }
+    };
 
-        // MOV with memory operands
-        if (dest_mem || src_mem) {
-            const MemoryOperand* mem = dest_mem ? dest_mem : src_mem;
-            uint64_t seg_prefix = mem->segment_override.has_value() ? 1 : 0;
-
-            // MOV mem, imm - needs opcode + ModRM + displacement + immediate
-            if ((dest_mem && imm)) {
-                uint64_t mem_size = calculateMemoryEncodingSize(dest_mem);
-                uint64_t imm_size = (dest_mem->size_hint == 16 || (dest_mem->size_hint == 0 && imm->value > 255)) ? 2 : 1;
-                return seg_prefix + 1 + mem_size + imm_size;  // prefix + opcode + mem_encoding + imm
-            }
-            // MOV AX/AL, [moffs] or MOV [moffs], AX/AL uses special 3-byte encoding
-            // But only for direct addresses (no registers)
-            if ((dest_reg && dest_reg->code == 0 && src_mem) ||
-                (src_reg && src_reg->code == 0 && dest_mem)) {
-                // Check if it's a direct address (moffs encoding)
-                bool is_moffs = mem->is_direct_address ||
-                    (mem->parsed_address && mem->parsed_address->registers.empty());
-                if (is_moffs) {
-                    return seg_prefix + 3;  // prefix + opcode (1) + moffs16 (2)
-                }
+    for (ASTNode* stmt : program->statements) {
+        if (auto* label = ast_cast<Label>(stmt)) {
+            if (!SymbolTable::isLocalLabel(label->name)) {
+                scope = label->name;
             }
-            // MOV reg, mem or MOV mem, reg (general form)
-            uint64_t mem_size = calculateMemoryEncodingSize(mem);
-            return seg_prefix + 1 + mem_size;  // prefix + opcode + mem_encoding
+            continue;
         }
-    }
 
-    // PUSH/POP
-    if (mnemonic == "PUSH" || mnemonic == "POP") {
-        if (instr->operands.size() == 1) {
-            auto* reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-            if (reg) {
-                return 1;  // PUSH/POP reg uses single-byte encoding
-            }
-            // PUSH/POP memory
-            return 2;  // Opcode + ModRM
+        auto* instr = ast_cast<Instruction>(stmt);
+        if (auto* times = ast_cast<TIMESDirective>(stmt)) {
+            bindExpression(times->count_program, false);
+            instr = ast_cast<Instruction>(times->repeated_node);
         }
-    }
-
-    // INC/DEC
-    if (mnemonic == "INC" || mnemonic == "DEC") {
-        if (instr->operands.size() == 1) {
-            auto* reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-            if (reg && reg->size == 16) {
-                return 1;  // Short form for 16-bit registers
-            }
-            // Memory operand or 8-bit register
-            auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
-            if (mem) {
-                uint64_t seg_prefix = mem->segment_override.has_value() ? 1 : 0;
-                return seg_prefix + 1 + calculateMemoryEncodingSize(mem);  // prefix + opcode + mem_encoding
-            }
-            // 8-bit register
-            return 2;  // Opcode + ModRM
+        if (!instr) {
+            continue;
         }
-    }
-
-    // ARITHMETIC/LOGIC WITH IMMEDIATE
-    if (mnemonic == "ADD" || mnemonic == "ADC" || mnemonic == "SUB" || mnemonic == "SBB" ||
-        mnemonic == "CMP" || mnemonic == "AND" || mnemonic == "OR" || mnemonic == "XOR") {
-
-        if (instr->operands.size() == 2) {
-            auto* reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-            auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
 
-            // AL/AX with immediate (special 2-byte encoding for AX, 3 bytes total)
-            if (reg && reg->code == 0 && imm) {
-                if (reg->size == 16) {
-                    return 3;  // Opcode (1) + imm16 (2)
-                } else {
-                    return 2;  // Opcode (1) + imm8 (1)
-                }
-            }
-
-            // General form with immediate
-            if (imm) {
-                // Check if first operand is memory
-                auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
-                if (mem) {
-                    uint64_t seg_prefix = mem->segment_override.has_value() ? 1 : 0;
-                    uint64_t mem_size = calculateMemoryEncodingSize(mem);
-                    uint64_t imm_size = (mem->size_hint == 16) ? 2 : 1;
-                    return seg_prefix + 1 + mem_size + imm_size;  // prefix + opcode + mem_encoding + imm
-                } else if (reg && reg->size == 16) {
-                    // Check if immediate has byte size hint (sign-extended imm8)
-                    if (imm->size_hint == 8) {
-                        return 3;  // Opcode (1) + ModRM (1) + imm8 (1) - uses 83 /r ib encoding
+        for (Operand* operand : instr->operands) {
+            if (auto* label_ref = ast_cast<LabelRef>(operand)) {
+                label_ref->label_id = bind(label_ref->label);
+            } else if (auto* imm = ast_cast<ImmediateOperand>(operand)) {
+                // An expression's label_name is its text, not a symbol
+                imm->label_id = imm->has_label && imm->expression.empty() ? bind(imm->label_name) : std::nullopt;
+                bindExpression(imm->expression, true);
+            } else if (auto* mem = ast_cast<MemoryOperand>(operand)) {
+                for (auto* addr : {&mem->parsed_address, &mem->written_address}) {
+                    if (!*addr) continue;
+                    for (auto& term : (*addr)->symbols) {
+                        term.id = bind(term.name);
                     }
-                    return 4;  // Opcode (1) + ModRM (1) + imm16 (2)
-                } else {
-                    return 3;  // Opcode (1) + ModRM (1) + imm8 (1)
-                }
-            }
-
-            // reg, reg
-            if (instr->operands.size() == 2) {
-                auto* op0_reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-                auto* op1_reg = dynamic_cast<RegisterOperand*>(instr->operands[1].get());
-                if (op0_reg && op1_reg) {
-                    return 2;  // Opcode + ModRM
                 }
             }
-
-            // reg, mem or mem, reg
-            auto* mem0 = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
-            auto* mem1 = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
-            const MemoryOperand* mem = mem0 ? mem0 : mem1;
-            if (mem) {
-                uint64_t seg_prefix = mem->segment_override.has_value() ? 1 : 0;
-                return seg_prefix + 1 + calculateMemoryEncodingSize(mem);  // prefix + opcode + mem_encoding
-            }
-            return 4;  // Fallback
         }
     }
+}
 
-    // TEST
-    if (mnemonic == "TEST" && instr->operands.size() == 2) {
-        auto* reg = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-        auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
-
-        if (reg && reg->code == 0 && imm) {
-            // TEST AL/AX, imm
-            return (reg->size == 16) ? 3 : 2;
-        }
-        if (imm) {
-            // TEST r/m, imm
-            return (reg && reg->size == 16) ? 4 : 3;
-        }
-        return 2;  // TEST r/m, reg
+uint64_t SemanticAnalyzer::measureInstruction(Instruction* instr) {
+    m_sizer.setCurrentAddress(m_current_address);
+    auto encoded = m_sizer.encode(instr);
+    if (!encoded.success) {
+        // The code generator reports the error when it encodes for real
+        return 0;
     }
 
-    // SHIFTS/ROTATES
-    if (mnemonic == "ROL" || mnemonic == "ROR" || mnemonic == "RCL" || mnemonic == "RCR" ||
-        mnemonic == "SHL" || mnemonic == "SHR" || mnemonic == "SAL" || mnemonic == "SAR") {
-
-        if (instr->operands.size() == 1) {
-            return 2;  // Shift by 1 (implicit): opcode + ModRM
-        }
-        if (instr->operands.size() == 2) {
-            auto* cl_reg = dynamic_cast<RegisterOperand*>(instr->operands[1].get());
-            if (cl_reg && cl_reg->code == 1) {
-                return 2;  // Shift by CL: opcode + ModRM
-            }
-            return 2;  // Shift by 1 (explicit): opcode + ModRM
+    // The encoder promotes an out-of-range SHORT JMP to E9 rel16. Pin it to NEAR
+    // so it never shrinks back on a later pass - sizes only grow, so relaxation ends
+    if (instr->operands.size() == 1 && encoded.bytes.size() == 3 && encoded.bytes[0] == 0xE9) {
+        auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
+        if (label_ref && label_ref->jump_type == LabelRef::JumpType::SHORT) {
+            label_ref->jump_type = LabelRef::JumpType::NEAR;
         }
     }
 
-    // UNARY OPERATIONS
-    if (mnemonic == "NOT" || mnemonic == "NEG" ||
-        mnemonic == "MUL" || mnemonic == "IMUL" ||
-        mnemonic == "DIV" || mnemonic == "IDIV") {
-        return 2;  // Opcode + ModRM
+    // Same for a register-relative address with labels in it: once its
+    // displacement needed 16 bits it keeps them. Otherwise shrinking to disp8
+    // can pull the label back out of range and the sizes flip forever
+    for (Operand* operand : instr->operands) {
+        auto* mem = ast_cast<MemoryOperand>(operand);
+        if (mem && mem->parsed_address && mem->parsed_address->hasRegisters() &&
+            mem->parsed_address->hasSymbols() && !mem->parsed_address->wide_displacement) {
+            auto fields = m_sizer.locateFields(instr, encoded.bytes.data(), encoded.bytes.size());
+            mem->parsed_address->wide_displacement = fields.displacement_size == 2;
+        }
     }
 
-    // LEA, LDS, LES
-    if (mnemonic == "LEA" || mnemonic == "LDS" || mnemonic == "LES") {
-        if (instr->operands.size() >= 2) {
-            auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
-            if (mem) {
-                uint64_t seg_prefix = mem->segment_override.has_value() ? 1 : 0;
-                return seg_prefix + 1 + calculateMemoryEncodingSize(mem);  // prefix + opcode + mem_encoding
+    // Nothing is known about how far away an external ends up, so an
+    // unannotated JMP to one gets the rel16 form right away
+    if (m_relocatable && instr->id == Mnemonic::JMP && instr->operands.size() == 1) {
+        auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
+        if (label_ref && !label_ref->distance_explicit &&
+            label_ref->jump_type == LabelRef::JumpType::SHORT) {
+            const Symbol* target = label_ref->label_id ? &m_symbol_table.get(*label_ref->label_id)
+                                                       : m_symbol_table.find(label_ref->label);
+            if (target && target->type == SymbolType::EXTERNAL) {
+                label_ref->jump_type = LabelRef::JumpType::NEAR;
+                encoded = m_sizer.encode(instr);
+                if (!encoded.success) {
+                    return 0;
+                }
             }
         }
-        return 4;  // Fallback
     }
 
-    // XCHG
-    if (mnemonic == "XCHG" && instr->operands.size() == 2) {
-        auto* reg1 = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
-        auto* reg2 = dynamic_cast<RegisterOperand*>(instr->operands[1].get());
+    return encoded.bytes.size();
+}
+
+uint64_t SemanticAnalyzer::measureData(const DataDirective* data) const {
+    size_t element_size = 0;
+    switch (data->size) {
+        case DataDirective::Size::BYTE: element_size = 1; break;
+        case DataDirective::Size::WORD: element_size = 2; break;
+        case DataDirective::Size::DWORD: element_size = 4; break;
+        case DataDirective::Size::QWORD: element_size = 8; break;
+        case DataDirective::Size::TBYTE: element_size = 10; break;
+    }
 
-        // XCHG AX, reg or XCHG reg, AX
-        if ((reg1 && reg1->code == 0 && reg1->size == 16) ||
-            (reg2 && reg2->code == 0 && reg2->size == 16)) {
-            return 1;  // Short form
+    uint64_t size = 0;
+    for (const auto& value : data->values) {
+        if (value.type == DataValue::Type::STRING) {
+            size += value.string_value.length();
+        } else if (value.type == DataValue::Type::CHARACTER) {
+            size += 1;
+        } else {
+            size += element_size;
         }
-        return 2;  // General form: opcode + ModRM
     }
+    return size;
+}
 
-    /**
-      This is also garbage, I should return 0 here because the perfect scenario is
-      having a single source of truth for know/unknown instructions (maybe it should be the encoding table)
-      but for now, it defaults to 3 to mitigate any instruction that the lexer will accept but not handled here
-      like, for example, STOS/LODS/SCAS(B/W).
-      Defaulting to anything also adds mainenance. I'm sure in the future I will change something inside
-      s_instructions and I will forget to change it here and I will debug for days to find out that
-      I deserved the pain because I chosed not to fix the design just because I'm lazy.
-    */
-    return 3;
+uint64_t SemanticAnalyzer::measureRepeated(TIMESDirective* times) {
+    if (auto* data = ast_cast<DataDirective>(times->repeated_node)) {
+        return measureData(data);
+    }
+    if (auto* instr = ast_cast<Instruction>(times->repeated_node)) {
+        return measureInstruction(instr);
+    }
+    return 0;
 }
 
 uint64_t SemanticAnalyzer::calculateDataSize(const std::string& directive, size_t value_count) {
@@ -613,59 +500,17 @@ uint64_t SemanticAnalyzer::calculateDataSize(const std::string& directive, size_
     return 0;
 }
 
-uint64_t SemanticAnalyzer::calculateMemoryEncodingSize(const MemoryOperand* mem) {
-    // Returns the size of ModRM byte + displacement bytes
-    // Does NOT include segment prefix (caller must add 1 if segment_override is present)
-
-    if (!mem) return 3;  // Conservative fallback
-
-    // Direct numeric address: ModRM (1) + disp16 (2)
-    if (mem->is_direct_address) {
-        return 3;
-    }
-
-    // Check parsed address for register indirect vs direct
-    if (mem->parsed_address) {
-        const auto& addr = *mem->parsed_address;
-
-        // Direct address with label: ModRM (1) + disp16 (2)
-        if (addr.registers.empty()) {
-            return 3;
-        }
-
-        // Register indirect with no displacement
-        // Special case: [BP] alone requires at least disp8
-        if (!addr.has_displacement && !addr.has_label) {
-            if (addr.registers.size() == 1 && addr.registers[0] == "BP") {
-                return 2;  // ModRM (1) + disp8 (1)
-            }
-            return 1;  // Just ModRM, no displacement
-        }
-
-        // Has displacement - check if it fits in 8 bits
-        int64_t disp = addr.displacement;
-        if (addr.has_label) {
-            // Label reference - assume 16-bit displacement needed
-            return 3;  // ModRM (1) + disp16 (2)
-        }
-
-        if (disp >= -128 && disp <= 127) {
-            return 2;  // ModRM (1) + disp8 (1)
-        }
-        return 3;  // ModRM (1) + disp16 (2)
-    }
-
-    // Fallback: assume direct addressing with disp16
-    return 3;
+void SemanticAnalyzer::recordAddress(size_t statement_index, uint64_t size) {
+    m_address_slots[statement_index] = m_addresses.size();
+    m_addresses.push_back({statement_index, m_current_address, size});
 }
 
 std::optional<uint64_t> SemanticAnalyzer::getAddress(size_t statement_index) const {
-    for (const auto& addr_info : m_addresses) {
-        if (addr_info.statement_index == statement_index) {
-            return addr_info.address;
-        }
+    if (statement_index >= m_address_slots.size() ||
+        m_address_slots[statement_index] == NO_ADDRESS) {
+        return std::nullopt;
     }
-    return std::nullopt;
+    return m_addresses[m_address_slots[statement_index]].address;
 }
 
 void SemanticAnalyzer::error(const std::string& message, SourceLocation loc) {
@@ -678,9 +523,10 @@ void SemanticAnalyzer::setOrigin(uint64_t address) {
     m_segment_start_address = address;
 }
 
-void SemanticAnalyzer::enterSegment(const std::string& name) {
+void SemanticAnalyzer::enterSegment(const std::string& name, bool check_fallthrough) {
     // Warn if transitioning from code to data without a terminator
-    if (!m_current_segment.empty() &&
+    if (check_fallthrough &&
+        !m_current_segment.empty() &&
         isCodeSegment(m_current_segment) &&
         isDataSegment(name) &&
         !m_last_was_terminator) {
@@ -748,7 +594,7 @@ bool SemanticAnalyzer::isDataSegment(const std::string& name) const {
 }
 
 bool SemanticAnalyzer::resolveSymbol(const std::string& name, SourceLocation loc, int64_t& out_value) {
-    auto symbol = m_symbol_table.lookup(name);
+    const Symbol* symbol = m_symbol_table.find(name);
     if (!symbol) {
         error("Undefined symbol: " + name, loc);
         return false;
@@ -761,6 +607,39 @@ bool SemanticAnalyzer::resolveSymbol(const std::string& name, SourceLocation loc
     return true;
 }
 
+std::optional<int64_t> SemanticAnalyzer::evaluateExpression(const ExpressionProgram& program) const {
+    const auto& names = program.symbols();
+    ExpressionContext context{static_cast<int64_t>(m_current_address),
+                              static_cast<int64_t>(m_segment_start_address)};
+
+    return program.evaluate([&](size_t slot) -> std::optional<int64_t> {
+        auto id = program.binding(slot);
+        const Symbol* symbol = id ? &m_symbol_table.get(*id) : m_symbol_table.find(names[slot]);
+        if (!symbol || !symbol->is_resolved) {
+            return std::nullopt;
+        }
+        return symbol->value;
+    }, context);
+}
+
+bool SemanticAnalyzer::resolveTimesCount(TIMESDirective* times) {
+    auto count = evaluateExpression(times->count_program);
+    if (!count) {
+        // Name the symbol that's missing, if that's what went wrong
+        int64_t unused;
+        for (const auto& name : times->count_program.symbols()) {
+            if (!resolveSymbol(name, times->location, unused)) {
+                return false;
+            }
+        }
+        error("Invalid TIMES count: " + times->count_expr, times->location);
+        return false;
+    }
+
+    times->count = *count;
+    return true;
+}
+
 bool SemanticAnalyzer::resolveDataSymbols(DataDirective* data) {
     for (auto& value : data->values) {
         if (value.type == DataValue::Type::SYMBOL) {
@@ -768,51 +647,68 @@ bool SemanticAnalyzer::resolveDataSymbols(DataDirective* data) {
             if (!resolveSymbol(value.string_value, data->location, resolved_value)) {
                 return false;
             }
-            // Convert SYMBOL to NUMBER with resolved value
+            // Stays a SYMBOL (codegen emits number_value for it), so
+            // analyzing the same tree again picks up a changed value
             value.number_value = resolved_value;
-            value.type = DataValue::Type::NUMBER;
         }
     }
     return true;
 }
 
-std::function<std::optional<int64_t>(const std::string&)> SemanticAnalyzer::createSymbolLookup() {
-    return [this](const std::string& name) -> std::optional<int64_t> {
-        auto symbol = m_symbol_table.lookup(name);
-        if (symbol && symbol->is_resolved) {
-            return symbol->value;
+void SemanticAnalyzer::prepareInstruction(Instruction* instr, const SymbolTable& symbols) {
+    // Resolve memory operand expressions (EQU constants, etc.)
+    resolveMemoryOperands(instr, symbols);
+
+    // Unannotated JMPs start out SHORT; pass 2 grows the ones that overflow
+    if (instr->id == Mnemonic::JMP && instr->operands.size() == 1) {
+        auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
+        if (label_ref && !label_ref->distance_explicit) {
+            label_ref->jump_type = LabelRef::JumpType::SHORT;
         }
-        return std::nullopt;
-    };
+    }
 }
 
-bool SemanticAnalyzer::resolveMemoryOperands(Instruction* instr) {
-    auto symbol_lookup = createSymbolLookup();
-
-    for (auto& operand : instr->operands) {
-        if (auto* mem = dynamic_cast<MemoryOperand*>(operand.get())) {
-            // Re-parse the address expression with symbol resolution
-            auto parsed = ExpressionParser::parseAddressWithSymbols(
-                mem->address_expr, symbol_lookup
-            );
+void SemanticAnalyzer::resolveMemoryOperands(Instruction* instr, const SymbolTable& symbols) {
+    for (Operand* operand : instr->operands) {
+        auto* mem = ast_cast<MemoryOperand>(operand);
+        if (!mem || !mem->parsed_address) {
+            continue;
+        }
 
-            if (!parsed) {
-                error("Invalid memory operand: " + mem->address_expr, mem->location);
-                return false;
+        // Start over from the address as written if an earlier analysis of
+        // this tree already folded constants into it
+        auto& addr = *mem->parsed_address;
+        if (mem->written_address) {
+            addr = *mem->written_address;
+            mem->is_direct_address = false;
+        }
+        // Displacements start out as short as they fit; pass 2 widens them
+        addr.wide_displacement = false;
+
+        // EQU constants never change within a run, so fold the ones already
+        // defined into the displacement. Labels stay symbolic and are looked
+        // up on every encode
+        auto& terms = addr.symbols;
+        for (auto it = terms.begin(); it != terms.end();) {
+            const Symbol* symbol = symbols.find(it->name);
+            if (symbol && symbol->is_resolved && symbol->type == SymbolType::CONSTANT) {
+                if (!mem->written_address) {
+                    mem->written_address = addr;
+                }
+                addr.displacement += it->scale * symbol->value;
+                addr.has_displacement = true;
+                it = terms.erase(it);
+            } else {
+                ++it;
             }
+        }
 
-            // Update the parsed address
-            mem->parsed_address = std::make_unique<AddressExpression>(*parsed);
-
-            // Check if it's a direct address (no registers)
-            if (parsed->registers.empty() && !parsed->has_label) {
-                mem->is_direct_address = true;
-                mem->direct_address_value = static_cast<uint16_t>(parsed->displacement);
-            }
+        // Nothing left to resolve and no registers: a plain [address]
+        if (!addr.hasRegisters() && !addr.hasSymbols()) {
+            mem->is_direct_address = true;
+            mem->direct_address_value = static_cast<uint16_t>(addr.displacement);
         }
     }
-
-    return true;
 }
 
 } // namespace e2asm
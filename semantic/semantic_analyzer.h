@@ -5,7 +5,7 @@
  * The semantic analyzer is the third compilation phase. It walks the AST,
  * builds the symbol table, assigns addresses to all statements, and validates
  * that symbols are properly defined. Performs multiple passes to handle forward
- * references and optimize instruction sizes.
+ * references and relax jumps to their shortest encoding.
  */
 
 #pragma once
@@ -13,9 +13,11 @@
 #include "symbol_table.h"
 #include "../parser/ast.h"
 #include "../core/error.h"
+#include "../codegen/instruction_encoder.h"
 #include <vector>
 #include <memory>
-#include <functional>
+#include <optional>
+#include <cstdint>
 
 namespace e2asm {
 
@@ -43,15 +45,15 @@ struct AddressInfo {
  * - Labels get the address where they're defined
  * - Forward references create unresolved symbols
  *
- * **Pass 2+: Address Refinement**
- * - Resolves forward references now that all symbols are known
- * - Recalculates instruction sizes (some instructions have multiple encodings)
- * - Updates addresses if sizes changed
- * - Repeats until addresses stabilize
+ * **Pass 2+: Branch Relaxation**
+ * - Re-measures every instruction now that all symbols are known
+ * - Unannotated JMPs start SHORT; one whose target is out of rel8 range
+ *   grows to NEAR and stays NEAR, so sizes only ever grow
+ * - Updates label addresses if sizes changed
+ * - Repeats until addresses stabilize (see getPassCount())
  *
- * **Future: Jump Optimization**
- * - Could shrink jumps from NEAR to SHORT when target is close enough
- * - Requires additional iteration as sizes change
+ * Instruction sizes come from InstructionEncoder in dry-run mode, so the
+ * analyzer and the code generator always agree on how long an encoding is.
  *
  * The analyzer also handles:
  * - Segment tracking for SEGMENT/ENDS directives
@@ -98,6 +100,31 @@ public:
      */
     uint64_t getOriginAddress() const { return m_origin_address; }
 
+    /**
+     * @brief Sets the origin used until an ORG directive says otherwise
+     * @param address Load address of the program (e.g. 0x100 for COM files)
+     */
+    void setBaseOrigin(uint64_t address) { m_base_origin = address; }
+
+    /**
+     * @brief Lays the program out as a relocatable object module
+     * @param enabled true when the output goes to a linker instead of a flat binary
+     *
+     * EXTERN symbols are accepted (they read as 0 until linked), ORG is
+     * rejected because the linker decides where segments go, and an
+     * unannotated JMP to an external is NEAR from the start.
+     */
+    void setRelocatable(bool enabled) {
+        m_relocatable = enabled;
+        m_sizer.setRelocatable(enabled);
+    }
+
+    /**
+     * @brief Gets the number of layout passes the last analyze() took
+     * @return Pass count (1 for symbol discovery plus each relaxation pass)
+     */
+    size_t getPassCount() const { return m_pass_count; }
+
     /**
      * @brief Gets all semantic errors encountered
      * @return Vector of errors (undefined symbols, duplicate definitions, etc.)
@@ -111,6 +138,17 @@ public:
      */
     void clear();
 
+    /**
+     * @brief Gets an instruction ready to encode, as pass 1 does
+     * @param instr Parsed instruction
+     * @param symbols Symbols defined so far
+     *
+     * Folds EQU constants into memory operands and starts an unannotated
+     * JMP out SHORT (the encoder grows it when the target is too far).
+     * Used on its own by AssemblyContext::assembleInstruction().
+     */
+    static void prepareInstruction(Instruction* instr, const SymbolTable& symbols);
+
 private:
     /**
      * @brief First pass: discovers symbols and assigns initial addresses
@@ -118,7 +156,7 @@ private:
      * @return true if successful
      *
      * Creates symbol table entries for labels and constants. Assigns
-     * provisional addresses assuming worst-case instruction sizes.
+     * provisional addresses assuming optimistic (SHORT) jump sizes.
      */
     bool pass1_buildSymbols(Program* program);
 
@@ -129,27 +167,45 @@ private:
      *
      * Looks up forward references now that all symbols exist. Recalculates
      * instruction sizes with known operand values. Updates addresses if
-     * sizes changed.
+     * sizes changed. Called repeatedly by analyze() until it returns false.
      */
     bool pass2_resolveSymbols(Program* program);
 
     /**
-     * @brief Estimates instruction size in bytes
-     * @param instr Instruction to measure
-     * @return Size in bytes (1-6 for 8086)
+     * @brief Binds operand and TIMES count symbol references to their SymbolIds
+     * @param program AST to process
      *
-     * Size depends on operand types and whether addresses fit in smaller encodings.
+     * Run once pass 1 has defined every symbol, so the relaxation passes and
+     * the code generator index the table instead of hashing names. References
+     * that don't resolve are left unbound and looked up by name, which
+     * reports them. Running it on the empty table clears the ids an earlier
+     * analysis of the same tree left behind.
      */
-    uint64_t calculateInstructionSize(Instruction* instr);
+    void bindSymbols(Program* program);
 
     /**
-     * @brief Calculates the ModRM + displacement size for a memory operand
-     * @param mem Memory operand to measure
-     * @return Size in bytes (1-3: 1 for ModRM, 0-2 for displacement)
+     * @brief Measures an instruction placed at the current address
+     * @param instr Instruction to measure
+     * @return Size in bytes (0 if the instruction cannot be encoded)
      *
-     * Accounts for register indirect (no disp), disp8, and disp16 cases.
+     * Dry-run encodes the instruction. A SHORT JMP that came back in its
+     * near form is pinned to NEAR, and a label-relative displacement that
+     * needed 16 bits is pinned wide, so neither shrinks on a later pass.
+     * Encoding errors are left for the code generator to report.
+     */
+    uint64_t measureInstruction(Instruction* instr);
+
+    /**
+     * @brief Size of a data directive's output
+     * @param data Data directive to measure
+     * @return Total size in bytes (strings count one byte per character)
      */
-    uint64_t calculateMemoryEncodingSize(const MemoryOperand* mem);
+    uint64_t measureData(const DataDirective* data) const;
+
+    /**
+     * @brief Size of one copy of a TIMES directive's repeated statement
+     */
+    uint64_t measureRepeated(TIMESDirective* times);
 
     /**
      * @brief Calculates size of data directive output
@@ -184,8 +240,9 @@ private:
     /**
      * @brief Enters a new segment
      * @param name Segment name from SEGMENT directive
+     * @param check_fallthrough Warn about code falling into data (first pass only)
      */
-    void enterSegment(const std::string& name);
+    void enterSegment(const std::string& name, bool check_fallthrough = true);
 
     /**
      * @brief Exits current segment
@@ -193,8 +250,19 @@ private:
      */
     void exitSegment(const std::string& name);
 
+    /**
+     * @brief Records the address of a statement at the current location
+     * @param statement_index Index in Program's statements vector
+     * @param size Space the statement occupies
+     */
+    void recordAddress(size_t statement_index, uint64_t size);
+
     SymbolTable m_symbol_table;          ///< All labels and constants
     std::vector<AddressInfo> m_addresses; ///< Address assignment for each statement
+    std::vector<size_t> m_address_slots;  ///< Statement index -> position in m_addresses
+
+    /// Marks statements that never got an address (m_address_slots)
+    static constexpr size_t NO_ADDRESS = SIZE_MAX;
     std::vector<Error> m_errors;         ///< Accumulated semantic errors
     uint64_t m_current_address;          ///< Next available address ($ symbol)
 
@@ -202,7 +270,16 @@ private:
     std::string m_current_segment;       ///< Name of active segment
     uint64_t m_segment_start_address;    ///< Start of current segment ($$ symbol)
     uint64_t m_origin_address;           ///< Base address from ORG directive
+    uint64_t m_base_origin = 0;          ///< Origin before any ORG (see setBaseOrigin)
+    bool m_relocatable = false;          ///< Object module layout (see setRelocatable)
     bool m_last_was_terminator;          ///< Prevents fall-through between segments
+    size_t m_pass_count;                 ///< Layout passes taken by the last analyze()
+
+    /// Upper bound on layout passes; jumps only grow, so this is only hit if
+    /// displacement sizes oscillate
+    static constexpr size_t MAX_LAYOUT_PASSES = 100;
+
+    InstructionEncoder m_sizer;          ///< Dry-run encoder used for instruction sizes
 
     /**
      * @brief Checks if segment is a code segment
@@ -227,6 +304,21 @@ private:
      */
     bool resolveSymbol(const std::string& name, SourceLocation loc, int64_t& out_value);
 
+    /**
+     * @brief Evaluates a compiled expression at the current address
+     * @param program Expression to run; symbols are looked up in the symbol table
+     * @return Value, or nullopt if a symbol is unresolved or it divides by zero
+     *
+     * $ is the current address and $$ the start of the current segment.
+     */
+    std::optional<int64_t> evaluateExpression(const ExpressionProgram& program) const;
+
+    /**
+     * @brief Evaluates a symbolic TIMES count into times->count, reporting failures
+     * @return false if the count can't be evaluated or is negative
+     */
+    bool resolveTimesCount(TIMESDirective* times);
+
     /**
      * @brief Resolves all SYMBOL type values in a DataDirective to numbers
      * @param data Data directive to process
@@ -237,18 +329,13 @@ private:
     /**
      * @brief Resolves memory operand expressions in an instruction
      * @param instr Instruction to process
-     * @return true if all memory operand expressions resolved successfully
+     * @param symbols Symbols defined so far
      *
-     * Re-parses memory address expressions with symbol lookup to resolve
-     * EQU constants in expressions like [label + s_size * 2 - 2].
-     */
-    bool resolveMemoryOperands(Instruction* instr);
-
-    /**
-     * @brief Creates a symbol lookup callback for expression evaluation
-     * @return Callback function that looks up symbols in the symbol table
+     * The parser has already split each address into registers, a folded
+     * displacement and symbolic terms. EQU constants defined so far are
+     * folded into the displacement here; labels are left for the encoder.
      */
-    std::function<std::optional<int64_t>(const std::string&)> createSymbolLookup();
+    static void resolveMemoryOperands(Instruction* instr, const SymbolTable& symbols);
 };
 
 } // namespace e2asm
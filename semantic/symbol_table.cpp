@@ -2,61 +2,148 @@
 
 namespace e2asm {
 
-bool SymbolTable::define(const std::string& name, SymbolType type, int64_t value, size_t line) {
-    std::string qualified_name = getFullyQualifiedName(name);
+SymbolTable::NameId SymbolTable::intern(std::string_view name) {
+    if (auto id = findName(name)) {
+        return *id;
+    }
+    NameId id = static_cast<NameId>(m_names.size());
+    m_names.emplace_back(name);
+    m_name_ids.emplace(m_names.back(), id);
+    return id;
+}
+
+std::optional<SymbolTable::NameId> SymbolTable::findName(std::string_view name) const {
+    auto it = m_name_ids.find(name);
+    if (it == m_name_ids.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+std::optional<SymbolId> SymbolTable::findKey(NameId scope, std::string_view name) const {
+    // A name that was never interned can't belong to any symbol
+    auto name_id = findName(name);
+    if (!name_id) {
+        return std::nullopt;
+    }
+    auto it = m_index.find(key(scope, *name_id));
+    if (it == m_index.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
 
-    if (exists(qualified_name)) {
+bool SymbolTable::define(const std::string& name, SymbolType type, int64_t value, size_t line) {
+    NameId scope = scopeFor(name);
+    SymbolId id = static_cast<SymbolId>(m_symbols.size());
+    if (!m_index.emplace(key(scope, intern(name)), id).second) {
         return false;
     }
 
-    Symbol symbol(name, type, value, line);
-    m_symbols[qualified_name] = symbol;
+    m_symbols.emplace_back(name, type, value, line);
+    m_symbol_scopes.push_back(scope);
     return true;
 }
 
-bool SymbolTable::update(const std::string& name, int64_t new_value) {
-    std::string qualified_name = getFullyQualifiedName(name);
-    auto it = m_symbols.find(qualified_name);
-    if (it == m_symbols.end()) {
+bool SymbolTable::update(std::string_view name, int64_t new_value) {
+    auto id = findId(name);
+    if (!id) {
         return false;
     }
 
-    it->second.value = new_value;
+    m_symbols[*id].value = new_value;
     return true;
 }
 
-bool SymbolTable::resolve(const std::string& name, int64_t value) {
-    std::string qualified_name = getFullyQualifiedName(name);
-    auto it = m_symbols.find(qualified_name);
-    if (it == m_symbols.end()) {
+bool SymbolTable::resolve(std::string_view name, int64_t value) {
+    auto id = findId(name);
+    if (!id) {
         return false;
     }
 
-    it->second.value = value;
-    it->second.is_resolved = true;
+    m_symbols[*id].value = value;
+    m_symbols[*id].is_resolved = true;
     return true;
 }
 
-std::optional<Symbol> SymbolTable::lookup(const std::string& name) const {
-    std::string qualified_name = getFullyQualifiedName(name);
-    auto it = m_symbols.find(qualified_name);
-    if (it == m_symbols.end()) {
+std::optional<SymbolId> SymbolTable::findId(std::string_view name) const {
+    return findKey(scopeFor(name), name);
+}
+
+const Symbol* SymbolTable::find(std::string_view name) const {
+    auto id = findId(name);
+    return id ? &m_symbols[*id] : nullptr;
+}
+
+const Symbol* SymbolTable::findDirect(std::string_view name) const {
+    if (auto id = findKey(NO_SCOPE, name)) {
+        return &m_symbols[*id];
+    }
+
+    // "start.loop" names the local ".loop" under "start"
+    size_t dot = name.find('.', 1);
+    if (dot == std::string_view::npos) {
+        return nullptr;
+    }
+    auto scope = findName(name.substr(0, dot));
+    if (!scope) {
+        return nullptr;
+    }
+    auto id = findKey(*scope, name.substr(dot));
+    return id ? &m_symbols[*id] : nullptr;
+}
+
+const Symbol* SymbolTable::findFrom(std::string_view name, std::string_view global_label) const {
+    NameId scope = NO_SCOPE;
+    if (isLocalLabel(name) && !global_label.empty()) {
+        // A scope that was never interned has no locals under it
+        auto id = findName(global_label);
+        if (!id) {
+            return nullptr;
+        }
+        scope = *id;
+    }
+    auto id = findKey(scope, name);
+    return id ? &m_symbols[*id] : nullptr;
+}
+
+std::optional<Symbol> SymbolTable::lookup(std::string_view name) const {
+    const Symbol* symbol = find(name);
+    if (!symbol) {
         return std::nullopt;
     }
-    return it->second;
+    return *symbol;
 }
 
-std::optional<Symbol> SymbolTable::lookupDirect(const std::string& name) const {
-    auto it = m_symbols.find(name);
-    if (it == m_symbols.end()) {
+std::optional<Symbol> SymbolTable::lookupDirect(std::string_view name) const {
+    const Symbol* symbol = findDirect(name);
+    if (!symbol) {
         return std::nullopt;
     }
-    return it->second;
+    return *symbol;
+}
+
+std::string SymbolTable::qualifiedName(SymbolId id) const {
+    NameId scope = m_symbol_scopes[id];
+    if (scope == NO_SCOPE) {
+        return m_symbols[id].name;
+    }
+    return m_names[scope] + m_symbols[id].name;
+}
+
+void SymbolTable::clear() {
+    m_names.clear();
+    m_name_ids.clear();
+    m_symbols.clear();
+    m_symbol_scopes.clear();
+    m_index.clear();
+    m_current_global_label.clear();
+    m_current_scope = NO_SCOPE;
 }
 
-bool SymbolTable::exists(const std::string& name) const {
-    std::string qualified_name = getFullyQualifiedName(name);
-    return m_symbols.find(qualified_name) != m_symbols.end();
+void SymbolTable::setGlobalScope(const std::string& global_label) {
+    m_current_global_label = global_label;
+    m_current_scope = global_label.empty() ? NO_SCOPE : intern(global_label);
 }
 
 } // namespace e2asm
@@ -10,6 +10,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <deque>
+#include <vector>
 #include <unordered_map>
 #include <optional>
 #include <cstdint>
@@ -24,7 +27,8 @@ namespace e2asm {
 enum class SymbolType {
     LABEL,      ///< Code or data position marker (gets an address)
     CONSTANT,   ///< EQU-defined constant (purely compile-time)
-    VARIABLE    ///< Reserved space (future use)
+    VARIABLE,   ///< Reserved space (future use)
+    EXTERNAL    ///< Declared by EXTERN, defined in another module (value 0 until linked)
 };
 
 /**
@@ -51,17 +55,30 @@ struct Symbol {
     {}
 };
 
+/**
+ * @brief Dense index of a symbol inside its SymbolTable
+ *
+ * Ids are handed out in definition order and stay valid until clear().
+ */
+using SymbolId = uint32_t;
+
 /**
  * @brief Hash functor for case-insensitive string hashing
  *
  * Allows the symbol table to treat "Start", "START", and "start" as the same
- * identifier, matching traditional assembler behavior.
+ * identifier, matching traditional assembler behavior. Folds case one
+ * character at a time (FNV-1a), so hashing never allocates.
  */
 struct CaseInsensitiveHash {
-    size_t operator()(const std::string& str) const {
-        std::string lower = str;
-        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-        return std::hash<std::string>()(lower);
+    using is_transparent = void;
+
+    size_t operator()(std::string_view str) const {
+        uint64_t hash = 14695981039346656037ull;
+        for (char c : str) {
+            hash ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(c)));
+            hash *= 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
     }
 };
 
@@ -69,10 +86,15 @@ struct CaseInsensitiveHash {
  * @brief Equality functor for case-insensitive string comparison
  */
 struct CaseInsensitiveEqual {
-    bool operator()(const std::string& a, const std::string& b) const {
+    using is_transparent = void;
+
+    bool operator()(std::string_view a, std::string_view b) const {
         if (a.length() != b.length()) return false;
         return std::equal(a.begin(), a.end(), b.begin(), b.end(),
-            [](char ca, char cb) { return std::tolower(ca) == std::tolower(cb); });
+            [](char ca, char cb) {
+                return std::tolower(static_cast<unsigned char>(ca)) ==
+                       std::tolower(static_cast<unsigned char>(cb));
+            });
     }
 };
 
@@ -86,6 +108,11 @@ struct CaseInsensitiveEqual {
  * The table supports multi-pass assembly where symbols can be defined as
  * unresolved initially and filled in later when their addresses are known.
  *
+ * Every distinct name is interned once. A symbol is keyed by the pair
+ * (scope name, name) - the scope is empty for globals - and its data lives in
+ * a flat vector indexed by SymbolId, so lookups never build a qualified
+ * string or copy a Symbol.
+ *
  * Example of local label scoping:
  * @code
  * start:           ; Global label, starts new scope
@@ -127,7 +154,7 @@ public:
      * Used during multi-pass assembly when addresses change as instruction
      * sizes are refined.
      */
-    bool update(const std::string& name, int64_t new_value);
+    bool update(std::string_view name, int64_t new_value);
 
     /**
      * @brief Marks an unresolved symbol as resolved with a final value
@@ -138,49 +165,98 @@ public:
      * Used for forward references: first pass creates unresolved placeholders,
      * later passes fill in actual addresses.
      */
-    bool resolve(const std::string& name, int64_t value);
+    bool resolve(std::string_view name, int64_t value);
+
+    /**
+     * @brief Finds the id of a symbol, handling local label scoping
+     * @param name Symbol to find (may be local like ".loop")
+     * @return Id if found, nullopt otherwise
+     */
+    std::optional<SymbolId> findId(std::string_view name) const;
+
+    /**
+     * @brief Finds a symbol, handling local label scoping
+     * @param name Symbol to find (may be local like ".loop")
+     * @return Pointer into the table, or nullptr if not found
+     *
+     * Non-allocating; the pointer stays valid until the next define() or clear().
+     */
+    const Symbol* find(std::string_view name) const;
+
+    /**
+     * @brief Finds a symbol by exact name without scoping
+     * @param name Unscoped name, or a qualified one like "start.loop"
+     * @return Pointer into the table, or nullptr if not found
+     */
+    const Symbol* findDirect(std::string_view name) const;
+
+    /**
+     * @brief Finds a symbol as seen from inside a given global label
+     * @param name Symbol to find (may be local like ".loop")
+     * @param global_label Scope to apply to local names ("" for none)
+     * @return Pointer into the table, or nullptr if not found
+     *
+     * Same as find() but ignores the current scope, so several readers can
+     * resolve names from different places in the program at once.
+     */
+    const Symbol* findFrom(std::string_view name, std::string_view global_label) const;
 
     /**
      * @brief Looks up a symbol, handling local label scoping
      * @param name Symbol to find (may be local like ".loop")
-     * @return Symbol if found, nullopt otherwise
+     * @return Copy of the symbol if found, nullopt otherwise
      *
      * Automatically qualifies local labels with current scope before lookup.
+     * Prefer find() on hot paths.
      */
-    std::optional<Symbol> lookup(const std::string& name) const;
+    std::optional<Symbol> lookup(std::string_view name) const;
 
     /**
      * @brief Looks up a symbol by exact name without scoping
      * @param name Exact symbol name to find
-     * @return Symbol if found, nullopt otherwise
+     * @return Copy of the symbol if found, nullopt otherwise
      *
      * Use when you need to find a fully-qualified name directly.
      */
-    std::optional<Symbol> lookupDirect(const std::string& name) const;
+    std::optional<Symbol> lookupDirect(std::string_view name) const;
 
     /**
      * @brief Checks if a symbol exists
      * @param name Symbol to check (handles local label scoping)
      * @return true if symbol is defined
      */
-    bool exists(const std::string& name) const;
+    bool exists(std::string_view name) const { return findId(name).has_value(); }
+
+    /** @brief Symbol data for an id returned by findId() */
+    const Symbol& get(SymbolId id) const { return m_symbols[id]; }
+
+    /**
+     * @brief Id of a symbol returned by one of the find functions
+     * @param symbol Symbol stored in this table
+     */
+    SymbolId idOf(const Symbol& symbol) const { return static_cast<SymbolId>(&symbol - m_symbols.data()); }
 
     /**
      * @brief Gets all symbols for iteration
-     * @return Map of all symbols (case-insensitive)
+     * @return Symbols in definition order, indexed by SymbolId
      */
-    const std::unordered_map<std::string, Symbol, CaseInsensitiveHash, CaseInsensitiveEqual>&
-    getAllSymbols() const { return m_symbols; }
+    const std::vector<Symbol>& getAllSymbols() const { return m_symbols; }
+
+    /**
+     * @brief Rebuilds the fully qualified name of a symbol
+     * @param id Symbol id
+     * @return "scope.local" for scoped locals, the plain name otherwise
+     *
+     * Only needed for diagnostics; allocates.
+     */
+    std::string qualifiedName(SymbolId id) const;
 
     /**
      * @brief Removes all symbols and resets scope
      *
      * Call between assembly runs to reuse the same table instance.
      */
-    void clear() {
-        m_symbols.clear();
-        m_current_global_label.clear();
-    }
+    void clear();
 
     /**
      * @brief Sets the current global label for local label scoping
@@ -189,9 +265,7 @@ public:
      * Called when encountering a new global label. All subsequent local labels
      * will be qualified with this name.
      */
-    void setGlobalScope(const std::string& global_label) {
-        m_current_global_label = global_label;
-    }
+    void setGlobalScope(const std::string& global_label);
 
     /**
      * @brief Gets the current global scope name
@@ -221,16 +295,45 @@ public:
      * @param label Label name to check
      * @return true if label starts with '.'
      */
-    static bool isLocalLabel(const std::string& label) {
+    static bool isLocalLabel(std::string_view label) {
         return !label.empty() && label[0] == '.';
     }
 
 private:
-    /// Symbol storage with case-insensitive keys
-    std::unordered_map<std::string, Symbol, CaseInsensitiveHash, CaseInsensitiveEqual> m_symbols;
+    using NameId = uint32_t;
+
+    /// Scope id of symbols that aren't nested under a global label
+    static constexpr NameId NO_SCOPE = UINT32_MAX;
+
+    /** @brief Returns the id of a name, registering it on first use */
+    NameId intern(std::string_view name);
+
+    /** @brief Returns the id of an already registered name */
+    std::optional<NameId> findName(std::string_view name) const;
+
+    /** @brief Finds the symbol stored under (scope, name) */
+    std::optional<SymbolId> findKey(NameId scope, std::string_view name) const;
+
+    /** @brief Scope that applies to name: the current one for locals, none otherwise */
+    NameId scopeFor(std::string_view name) const {
+        return isLocalLabel(name) ? m_current_scope : NO_SCOPE;
+    }
+
+    static uint64_t key(NameId scope, NameId name) {
+        return (static_cast<uint64_t>(scope) << 32) | name;
+    }
+
+    std::deque<std::string> m_names;   ///< Interned names, indexed by NameId (deque keeps views stable)
+    std::unordered_map<std::string_view, NameId, CaseInsensitiveHash, CaseInsensitiveEqual>
+        m_name_ids;                    ///< Name -> id, case-insensitive
+
+    std::vector<Symbol> m_symbols;                    ///< Symbol data, indexed by SymbolId
+    std::vector<NameId> m_symbol_scopes;              ///< Scope of each symbol, for qualifiedName()
+    std::unordered_map<uint64_t, SymbolId> m_index;   ///< (scope, name) -> SymbolId
 
     /// Current global label for local label scoping
     std::string m_current_global_label;
+    NameId m_current_scope = NO_SCOPE;  ///< Interned m_current_global_label
 };
 
 } // namespace e2asm
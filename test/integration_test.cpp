@@ -1,5 +1,19 @@
 #include <gtest/gtest.h>
 #include "E2Asm/core/assembler.h"
+#include "E2Asm/core/assembly_context.h"
+#include "E2Asm/core/assembly_session.h"
+#include "E2Asm/core/linker.h"
+#include "E2Asm/core/mapped_file.h"
+#include "E2Asm/core/result_cache.h"
+#include "E2Asm/preprocessor/include_cache.h"
+#include "E2Asm/preprocessor/preprocessor.h"
+#include "E2Asm/semantic/symbol_table.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
 
 using namespace e2asm;
 
@@ -77,6 +91,14 @@ TEST_F(AssemblerIntegrationTest, MovAllGeneralRegisters) {
     EXPECT_TRUE(result.success);
 }
 
+TEST_F(AssemblerIntegrationTest, LowercaseMnemonic) {
+    auto result = assembler.assemble("mov al, 0x42\nadd ax, 0x1234");
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 5);
+    EXPECT_EQ(result.binary[0], 0xB0);
+    EXPECT_EQ(result.binary[2], 0x05);
+}
+
 TEST_F(AssemblerIntegrationTest, AddRegReg) {
     auto result = assembler.assemble("ADD AX, BX");
     EXPECT_TRUE(result.success);
@@ -183,6 +205,65 @@ TEST_F(AssemblerIntegrationTest, JmpShortBackward) {
     EXPECT_TRUE(result.success);
 }
 
+TEST_F(AssemblerIntegrationTest, JmpForwardRelaxedToShort) {
+    std::string source = R"(
+        JMP target
+        NOP
+        target: HLT
+    )";
+    auto result = assembler.assemble(source);
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 4);
+    EXPECT_EQ(result.binary[0], 0xEB);
+    EXPECT_EQ(result.binary[1], 0x01);
+    EXPECT_GE(result.passes, 2u);
+}
+
+TEST_F(AssemblerIntegrationTest, JmpForwardGrowsToNear) {
+    std::string source = R"(
+        JMP target
+        TIMES 200 NOP
+        target: HLT
+    )";
+    auto result = assembler.assemble(source);
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 204);
+    EXPECT_EQ(result.binary[0], 0xE9);
+    EXPECT_EQ(result.binary[1], 200);
+    EXPECT_EQ(result.binary[2], 0x00);
+    EXPECT_EQ(result.binary[203], 0xF4);
+}
+
+TEST_F(AssemblerIntegrationTest, DataLabelsFollowGrowingJmp) {
+    std::string source = R"(
+        start: JMP far_target
+        lbl: NOP
+        DW lbl
+        TIMES 2 DW lbl
+        TIMES 200 NOP
+        far_target: HLT
+    )";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.symbols["lbl"], 3);
+    ASSERT_GE(result.binary.size(), 10);
+    EXPECT_EQ(result.binary[0], 0xE9);
+    // All three words hold the address after the JMP grew, not the SHORT estimate
+    EXPECT_EQ(std::vector<uint8_t>(result.binary.begin() + 4, result.binary.begin() + 10),
+              (std::vector<uint8_t>{0x03, 0x00, 0x03, 0x00, 0x03, 0x00}));
+}
+
+TEST_F(AssemblerIntegrationTest, LabelDisplacementStaysWideOnceGrown) {
+    // disp8 puts lbl-192 at -129, disp16 at -128: the width must not flip back
+    std::string source = "MOV AX, [BX+lbl-192]\nTIMES 60 NOP\nlbl: NOP";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.symbols["lbl"], 64);
+    ASSERT_EQ(result.binary.size(), 65);
+    EXPECT_EQ(std::vector<uint8_t>(result.binary.begin(), result.binary.begin() + 4),
+              (std::vector<uint8_t>{0x8B, 0x87, 0x80, 0xFF}));
+}
+
 TEST_F(AssemblerIntegrationTest, ConditionalJump) {
     std::string source = R"(
         CMP AX, BX
@@ -309,6 +390,35 @@ TEST_F(AssemblerIntegrationTest, TIMESWithNOP) {
     }
 }
 
+TEST_F(AssemblerIntegrationTest, TIMESGetsOneListingLine) {
+    auto result = assembler.assemble("TIMES 5 DW 0x1234, 0x56\nNOP");
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 21);
+    for (int i = 0; i < 5; i++) {
+        EXPECT_EQ(result.binary[i * 4], 0x34);
+        EXPECT_EQ(result.binary[i * 4 + 1], 0x12);
+        EXPECT_EQ(result.binary[i * 4 + 2], 0x56);
+        EXPECT_EQ(result.binary[i * 4 + 3], 0x00);
+    }
+    ASSERT_EQ(result.listing.size(), 2);
+    EXPECT_EQ(result.listing[0].repeat, 5);
+    EXPECT_EQ(result.listing[0].machine_code, (std::vector<uint8_t>{0x34, 0x12, 0x56, 0x00}));
+    EXPECT_EQ(result.listing[1].address, 20);
+    EXPECT_NE(result.getListingText().find("x5"), std::string::npos);
+}
+
+TEST_F(AssemblerIntegrationTest, RESBIsOneFilledLine) {
+    auto result = assembler.assemble("RESB 0x8000\nHLT");
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 0x8001);
+    EXPECT_EQ(std::count(result.binary.begin(), result.binary.end() - 1, 0), 0x8000);
+    EXPECT_EQ(result.binary.back(), 0xF4);
+    ASSERT_EQ(result.listing.size(), 2);
+    EXPECT_EQ(result.listing[0].machine_code.size(), 1);
+    EXPECT_EQ(result.listing[0].repeat, 0x8000);
+    EXPECT_EQ(result.listing[1].address, 0x8000);
+}
+
 TEST_F(AssemblerIntegrationTest, ORGDirective) {
     auto result = assembler.assemble("ORG 0x7C00\nNOP");
     EXPECT_TRUE(result.success);
@@ -365,8 +475,6 @@ TEST_F(AssemblerIntegrationTest, MovRegMemBXDisp) {
     EXPECT_TRUE(result.success);
 }
 
-// Expression support for TIMES directive is still in progress
-#if 0
 TEST_F(AssemblerIntegrationTest, SimpleBootloader) {
     std::string source = R"(
         ORG 0x7C00
@@ -392,13 +500,123 @@ TEST_F(AssemblerIntegrationTest, SimpleBootloader) {
     EXPECT_TRUE(result.success);
     EXPECT_EQ(result.origin_address, 0x7C00);
 
-    EXPECT_EQ(result.binary.size(), 512);
+    ASSERT_EQ(result.binary.size(), 512);
+    EXPECT_EQ(result.binary[510], 0x55);
+    EXPECT_EQ(result.binary[511], 0xAA);
+}
+
+TEST_F(AssemblerIntegrationTest, TIMESCountFollowsRelaxation) {
+    // The JMP only becomes near once the padding sits between it and its
+    // target, so the count has to be evaluated again on every pass
+    std::string source = "start: JMP done\n"
+                         "TIMES 200-($-$$) DB 0x90\n"
+                         "done: NOP\n";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 201);
+    EXPECT_EQ(result.binary[0], 0xE9);
+    EXPECT_EQ(result.binary[3], 0x90);
+    EXPECT_EQ(result.binary[200], 0x90);
+}
 
-    // Segfault because of wrong test logic
-    // EXPECT_EQ(result.binary[510], 0x55);
-    // EXPECT_EQ(result.binary[511], 0xAA);
+TEST_F(AssemblerIntegrationTest, TIMESCountUsesConstants) {
+    auto result = assembler.assemble("N EQU 3\nTIMES N*2-1 NOP");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, std::vector<uint8_t>(5, 0x90));
+}
+
+TEST_F(AssemblerIntegrationTest, TIMESCountErrors) {
+    auto undefined = assembler.assemble("TIMES MISSING+1 NOP");
+    EXPECT_FALSE(undefined.success);
+    ASSERT_FALSE(undefined.errors.empty());
+    EXPECT_NE(undefined.errors[0].message.find("MISSING"), std::string::npos);
+
+    auto negative = assembler.assemble("TIMES 2-($-$$) NOP\nstart: NOP\nTIMES 2-($-$$) NOP\nNOP");
+    EXPECT_FALSE(negative.success);
+}
+
+TEST_F(AssemblerIntegrationTest, OutOfRangeNumberIsReported) {
+    auto result = assembler.assemble("MOV AX, 99999999999999999999999");
+    EXPECT_FALSE(result.success);
+    ASSERT_EQ(result.errors.size(), 1);
+    EXPECT_EQ(result.errors[0].message, "Number literal out of range");
+    EXPECT_TRUE(result.binary.empty());
+}
+
+TEST_F(AssemblerIntegrationTest, MacroWithoutParameters) {
+    auto result = assembler.assemble("%macro SAVE 0\nPUSH AX\nPUSH BX\n%endmacro\nSAVE\nNOP\nSAVE");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0x50, 0x53, 0x90, 0x50, 0x53}));
+}
+
+TEST_F(AssemblerIntegrationTest, MacroParametersAreSubstituted) {
+    std::string source = "%macro OUTB 2\n"
+                         "MOV DX, %1\n"
+                         "MOV AL, %2\n"
+                         "OUT DX, AL\n"
+                         "%endmacro\n"
+                         "%macro LOAD 2\n"
+                         "MOV %1, %2\n"
+                         "%endmacro\n"
+                         "OUTB 0x3F8, 'A'\n"
+                         "LOAD AX, [BX+SI]\n";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xBA, 0xF8, 0x03, 0xB0, 0x41, 0xEE, 0x8B, 0x00}));
+}
+
+TEST_F(AssemblerIntegrationTest, MacroCallIgnoresTrailingComment) {
+    std::string source = "%macro SAVE 0\nPUSH AX\n%endmacro\n"
+                         "%macro TWO 2\nMOV %1, %2\n%endmacro\n"
+                         "%macro ONE 1\nMOV AL, %1\n%endmacro\n"
+                         "SAVE ; keep ax\n"
+                         "TWO AX, BX ; comment, here\n"
+                         "ONE 7 ; c\n"
+                         "ONE ';' ; quoted semicolon\n";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success) << (result.errors.empty() ? "" : result.errors[0].message);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0x50, 0x89, 0xD8, 0xB0, 0x07, 0xB0, 0x3B}));
+}
+
+TEST_F(AssemblerIntegrationTest, NestedMacrosAreCounted) {
+    std::string source = "%define PORT 0x60\n"
+                         "%macro READ 1\n"
+                         "IN AL, %1\n"
+                         "%endmacro\n"
+                         "%macro READ_TWICE 1\n"
+                         "READ %1\n"
+                         "READ %1\n"
+                         "%endmacro\n"
+                         "READ_TWICE PORT\n"
+                         "READ_TWICE PORT\n";
+    assembler.enableStats(true);
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xE4, 0x60, 0xE4, 0x60, 0xE4, 0x60, 0xE4, 0x60}));
+    ASSERT_TRUE(result.stats.has_value());
+    EXPECT_EQ(result.stats->macro_expansions, 6);
+}
+
+TEST_F(AssemblerIntegrationTest, MacroCallErrors) {
+    auto wrong_count = assembler.assemble("%macro TWO 2\nMOV %1, %2\n%endmacro\nTWO AX");
+    EXPECT_FALSE(wrong_count.success);
+    ASSERT_FALSE(wrong_count.errors.empty());
+    EXPECT_NE(wrong_count.errors[0].message.find("expects 2"), std::string::npos);
+
+    auto missing_param = assembler.assemble("%macro ONE 1\nMOV %1, %2\n%endmacro\nONE AX");
+    EXPECT_FALSE(missing_param.success);
+
+    auto recursive = assembler.assemble("%macro LOOP_FOREVER 0\nNOP\nLOOP_FOREVER\n%endmacro\nLOOP_FOREVER");
+    EXPECT_FALSE(recursive.success);
+    ASSERT_FALSE(recursive.errors.empty());
+    EXPECT_NE(recursive.errors[0].message.find("nested too deeply"), std::string::npos);
+}
+
+TEST_F(AssemblerIntegrationTest, ConditionalArithmetic) {
+    auto result = assembler.assemble("%define V 2\n%if V*2-4\nNOP\n%elif V-1\nCLI\n%endif");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xFA}));
 }
-#endif
 
 TEST_F(AssemblerIntegrationTest, UndefinedLabel) {
     auto result = assembler.assemble("JMP undefined_label");
@@ -499,3 +717,929 @@ TEST_F(AssemblerIntegrationTest, InALImm) {
     EXPECT_EQ(result.binary[0], 0xE4);
     EXPECT_EQ(result.binary[1], 0x60);
 }
+
+TEST_F(AssemblerIntegrationTest, ErrorNamesSourceFile) {
+    auto result = assembler.assemble("NOP\nMOV AX,", "boot.asm");
+    EXPECT_FALSE(result.success);
+    ASSERT_FALSE(result.errors.empty());
+    EXPECT_EQ(result.errors[0].format().rfind("boot.asm:", 0), 0);
+}
+
+TEST_F(AssemblerIntegrationTest, MemoryWithScaledConstant) {
+    auto result = assembler.assemble("COUNT EQU 4\nMOV AX, [BX+SI+COUNT*2]");
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 3);
+    EXPECT_EQ(result.binary[0], 0x8B);
+    EXPECT_EQ(result.binary[1], 0x40);
+    EXPECT_EQ(result.binary[2], 0x08);
+}
+
+TEST_F(AssemblerIntegrationTest, MemoryLabelResolvedAtEncode) {
+    // Label references stay symbolic until encoding, so a forward label
+    // moved by jump relaxation still gets its final address
+    auto result = assembler.assemble("JMP over\nover:\nMOV AL, [data]\ndata: DB 0");
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 6);
+    EXPECT_EQ(result.binary[2], 0xA0);
+    EXPECT_EQ(result.binary[3], 0x05);
+    EXPECT_EQ(result.binary[4], 0x00);
+}
+
+TEST_F(AssemblerIntegrationTest, NestedDefinesExpand) {
+    auto result = assembler.assemble("%define BASE 0x10\n%define PORT BASE\nMOV AL, PORT");
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 2);
+    EXPECT_EQ(result.binary[0], 0xB0);
+    EXPECT_EQ(result.binary[1], 0x10);
+}
+
+TEST_F(AssemblerIntegrationTest, SelfReferentialDefineTerminates) {
+    // A define is not re-expanded inside its own replacement
+    auto result = assembler.assemble("%define LOOP_ LOOP_\nLOOP_: JMP LOOP_");
+    EXPECT_TRUE(result.success);
+    EXPECT_EQ(result.binary.size(), 2);
+}
+
+TEST_F(AssemblerIntegrationTest, IncludeKeepsSurroundingLines) {
+    const char* header = "e2asm_include_test.inc";
+    {
+        std::ofstream out(header);
+        out << "%define VALUE 7\nCLI\n";
+    }
+
+    auto result = assembler.assemble("NOP\n%include \"e2asm_include_test.inc\"\nMOV AL, VALUE\nHLT");
+    std::remove(header);
+
+    EXPECT_TRUE(result.success);
+    ASSERT_EQ(result.binary.size(), 5);
+    EXPECT_EQ(result.binary[0], 0x90);
+    EXPECT_EQ(result.binary[1], 0xFA);
+    EXPECT_EQ(result.binary[2], 0xB0);
+    EXPECT_EQ(result.binary[3], 0x07);
+    EXPECT_EQ(result.binary[4], 0xF4);
+}
+
+TEST_F(AssemblerIntegrationTest, AssembleFileReadsMappedSource) {
+    const char* path = "e2asm_file_test.asm";
+    const char* header = "e2asm_file_test.inc";
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << "%include \"e2asm_file_test.inc\"\nstart: MOV AL, VALUE\nJMP start";  // No final newline
+    }
+    {
+        std::ofstream out(header, std::ios::binary);
+        out << "%define VALUE 3\r\nCLI\r\n";
+    }
+
+    auto result = assembler.assembleFile(path);
+    auto missing = assembler.assembleFile("e2asm_no_such_file.asm");
+
+    // Without an include cache the preprocessor maps the header itself
+    std::ifstream in(path, std::ios::binary);
+    std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    Preprocessor preprocessor;
+    auto preprocessed = preprocessor.process(source, path);
+    std::remove(path);
+    std::remove(header);
+
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xFA, 0xB0, 0x03, 0xEB, 0xFC}));
+    EXPECT_EQ(result.symbols["start"], 1);
+    EXPECT_FALSE(missing.success);
+    ASSERT_TRUE(preprocessed.success);
+    EXPECT_NE(preprocessed.source.find("CLI"), std::string::npos);
+}
+
+TEST_F(AssemblerIntegrationTest, GuardedIncludeExpandsOnce) {
+    const char* header = "e2asm_guard_test.inc";
+    {
+        std::ofstream out(header);
+        out << "; shared header\n%ifndef GUARD_INC\n%define GUARD_INC\nCLI\n%endif\n";
+    }
+
+    std::string source = "%include \"e2asm_guard_test.inc\"\n%include \"e2asm_guard_test.inc\"\nHLT";
+    auto first = assembler.assemble(source);
+    auto second = assembler.assemble(source);
+    std::remove(header);
+
+    ASSERT_TRUE(first.success);
+    ASSERT_TRUE(second.success);
+    EXPECT_EQ(first.binary, (std::vector<uint8_t>{0xFA, 0xF4}));
+    EXPECT_EQ(second.binary, first.binary);
+}
+
+TEST_F(AssemblerIntegrationTest, IncludeWithElseBranchIsNotGuarded) {
+    const char* header = "e2asm_else_guard_test.inc";
+    {
+        std::ofstream out(header);
+        out << "%ifndef ONCE_INC\n%define ONCE_INC\nCLI\n%else\nSTI\n%endif\n";
+    }
+
+    std::string source = "%include \"e2asm_else_guard_test.inc\"\n%include \"e2asm_else_guard_test.inc\"\nHLT";
+    auto first = assembler.assemble(source);
+    auto second = assembler.assemble(source);
+    std::remove(header);
+
+    // The second include takes the %else branch
+    ASSERT_TRUE(first.success);
+    ASSERT_TRUE(second.success);
+    EXPECT_EQ(first.binary, (std::vector<uint8_t>{0xFA, 0xFB, 0xF4}));
+    EXPECT_EQ(second.binary, first.binary);
+}
+
+TEST_F(AssemblerIntegrationTest, SetOriginShiftsLabels) {
+    assembler.setOrigin(0x100);
+    auto result = assembler.assemble("MOV AX, msg\nmsg: DB 0");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.symbols["msg"], 0x103);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xB8, 0x03, 0x01, 0x00}));
+}
+
+TEST_F(AssemblerIntegrationTest, BatchMatchesSequentialAssembly) {
+    std::vector<AssemblyJob> jobs;
+    for (size_t i = 0; i < 24; i++) {
+        std::string source;
+        for (size_t n = 0; n <= i * 5; n++) {
+            source += "MOV AX, end\nNOP\n";
+        }
+        source += i % 7 == 3 ? "MOV AX,\n" : "end: HLT\n";
+        jobs.push_back({source, "job" + std::to_string(i) + ".asm", i * 0x10});
+    }
+
+    auto results = assembler.assembleBatch(jobs, 4);
+    ASSERT_EQ(results.size(), jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        assembler.setOrigin(jobs[i].origin);
+        auto expected = assembler.assemble(jobs[i].source, jobs[i].filename);
+        EXPECT_EQ(results[i].success, expected.success) << jobs[i].filename;
+        EXPECT_EQ(results[i].binary, expected.binary) << jobs[i].filename;
+        EXPECT_EQ(results[i].symbols, expected.symbols) << jobs[i].filename;
+        ASSERT_EQ(results[i].errors.size(), expected.errors.size()) << jobs[i].filename;
+        for (size_t e = 0; e < expected.errors.size(); e++) {
+            EXPECT_EQ(results[i].errors[e].format(), expected.errors[e].format());
+        }
+    }
+    EXPECT_EQ(results[12].symbols["end"], 12 * 0x10 + 61 * 4);
+}
+
+TEST_F(AssemblerIntegrationTest, BatchHandlesEmptyAndSingleWorker) {
+    EXPECT_TRUE(assembler.assembleBatch({}).empty());
+    auto results = assembler.assembleBatch({{"NOP", "a.asm", 0}, {"HLT", "b.asm", 0}}, 1);
+    ASSERT_EQ(results.size(), 2);
+    EXPECT_EQ(results[0].binary, (std::vector<uint8_t>{0x90}));
+    EXPECT_EQ(results[1].binary, (std::vector<uint8_t>{0xF4}));
+}
+
+TEST_F(AssemblerIntegrationTest, ParallelCodegenMatchesSequential) {
+    std::string source = "ORG 0x100\n";
+    for (int i = 0; i < 40; i++) {
+        std::string n = std::to_string(i);
+        source += "f" + n + ":\n.loop: DEC CX\nJNZ .loop\nMOV AX, [table+" + n + "]\n";
+        source += "JMP f" + std::to_string((i + 7) % 40) + "\nMOV BL, " + n + "\n";
+    }
+    source += "table: TIMES 4 DW 0xBEEF\n";
+
+    auto expected = assembler.assemble(source);
+    ASSERT_TRUE(expected.success);
+
+    assembler.setParallelCodegen(4, 0);
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, expected.binary);
+    EXPECT_EQ(result.symbols, expected.symbols);
+    ASSERT_EQ(result.listing.size(), expected.listing.size());
+    for (size_t i = 0; i < expected.listing.size(); i++) {
+        EXPECT_EQ(result.listing[i].address, expected.listing[i].address) << i;
+        EXPECT_EQ(result.listing[i].machine_code, expected.listing[i].machine_code) << i;
+        EXPECT_EQ(result.listing[i].source_text, expected.listing[i].source_text) << i;
+    }
+}
+
+TEST_F(AssemblerIntegrationTest, ParallelCodegenStopsAtFirstError) {
+    std::string source;
+    for (int i = 0; i < 30; i++) {
+        source += i == 20 ? "MOV AL, [nowhere]\n" : "NOP\n";
+    }
+
+    auto expected = assembler.assemble(source);
+    assembler.setParallelCodegen(3, 0);
+    auto result = assembler.assemble(source);
+    EXPECT_FALSE(result.success);
+    EXPECT_EQ(result.binary, expected.binary);
+    EXPECT_EQ(result.listing.size(), expected.listing.size());
+    ASSERT_EQ(result.errors.size(), expected.errors.size());
+    EXPECT_EQ(result.errors[0].format(), expected.errors[0].format());
+}
+
+TEST_F(AssemblerIntegrationTest, SpanSinkGrowsAndMatchesBinary) {
+    std::string source = "start: MOV AX, 0x1234\nJMP start\nRESB 0x18000\nDB 'end'\n";
+    auto expected = assembler.assemble(source);
+    ASSERT_TRUE(expected.success);
+
+    std::vector<uint8_t> image(16);
+    size_t grow_calls = 0;
+    SpanSink sink(image, [&](size_t required) {
+        grow_calls++;
+        image.resize(required * 2);
+        return std::span<uint8_t>(image);
+    });
+    auto result = assembler.assemble(source, sink);
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.binary.empty());
+    EXPECT_EQ(result.symbols, expected.symbols);
+    ASSERT_EQ(sink.size(), expected.binary.size());
+    EXPECT_TRUE(std::equal(expected.binary.begin(), expected.binary.end(), image.begin()));
+    EXPECT_GT(grow_calls, 0);
+}
+
+TEST_F(AssemblerIntegrationTest, FullSinkFailsAssembly) {
+    std::array<uint8_t, 4> buffer{};
+    SpanSink sink(buffer);
+    auto result = assembler.assemble("TIMES 8 NOP", sink);
+    EXPECT_FALSE(result.success);
+    ASSERT_FALSE(result.errors.empty());
+    EXPECT_NE(result.errors[0].message.find("Output sink"), std::string::npos);
+}
+
+TEST_F(AssemblerIntegrationTest, StreamSinkWritesImage) {
+    std::ostringstream out;
+    StreamSink sink(out);
+    auto result = assembler.assemble("MOV AL, 'A'\nHLT", sink);
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(out.str(), std::string("\xB0\x41\xF4", 3));
+}
+
+TEST_F(AssemblerIntegrationTest, WriteBinaryMatchesStreamedImage) {
+    const char* path = "e2asm_write_binary_test.bin";
+    std::string source = "MOV AL, 'A'\nTIMES 3 NOP\nHLT";
+    auto result = assembler.assemble(source);
+    ASSERT_TRUE(result.success);
+    ASSERT_TRUE(result.writeBinary(path));
+
+    std::ifstream in(path, std::ios::binary);
+    std::string written((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    std::remove(path);
+
+    std::ostringstream streamed;
+    StreamSink sink(streamed);
+    ASSERT_TRUE(assembler.assemble(source, sink).success);
+    EXPECT_EQ(written, streamed.str());
+    EXPECT_FALSE(result.writeBinary("no_such_dir/e2asm.bin"));
+}
+
+TEST_F(AssemblerIntegrationTest, ListingTextFormat) {
+    auto result = assembler.assemble("ORG 0x100\nstart: MOV AX, 0x1234\nJMP start\nTIMES 2 DB 7");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.getListingText(),
+              "0100 |  | ORG 0x100\n"
+              "0100 |  | start:\n"
+              "0100 | B8 34 12  | MOV AX, 0x1234\n"
+              "0103 | EB FB  | JMP start\n"
+              "0105 | 07 x2  | TIMES 2 DB 0x7\n");
+}
+
+TEST_F(AssemblerIntegrationTest, LazyListingMatchesFull) {
+    std::string source = "ORG 0x7C00\nstart:\n.l: DEC CX\nJNZ .l\nMSG EQU 3\n"
+                         "MOV AL, MSG\nRESW 4\nDB \"hi\", 'x'\nTIMES 3 NOP\n";
+    auto full = assembler.assemble(source);
+    ASSERT_TRUE(full.success);
+
+    AssemblyResult lazy;
+    {
+        Assembler other;
+        other.setListingMode(ListingMode::LAZY);
+        lazy = other.assemble(source);
+    }
+    ASSERT_TRUE(lazy.success);
+    EXPECT_TRUE(lazy.listing.empty());
+    EXPECT_EQ(lazy.binary, full.binary);
+    EXPECT_EQ(lazy.getListingText(), full.getListingText());
+
+    auto lines = lazy.getListing();
+    ASSERT_EQ(lines.size(), full.listing.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        EXPECT_EQ(lines[i].source_line, full.listing[i].source_line) << i;
+        EXPECT_EQ(lines[i].source_text, full.listing[i].source_text) << i;
+        EXPECT_EQ(lines[i].machine_code, full.listing[i].machine_code) << i;
+        EXPECT_EQ(lines[i].address, full.listing[i].address) << i;
+        EXPECT_EQ(lines[i].repeat, full.listing[i].repeat) << i;
+    }
+}
+
+TEST_F(AssemblerIntegrationTest, LazyListingWithParallelCodegen) {
+    std::string source;
+    for (int i = 0; i < 50; i++) {
+        source += "l" + std::to_string(i) + ": MOV AX, " + std::to_string(i) + "\nJMP l0\n";
+    }
+    auto full = assembler.assemble(source);
+
+    assembler.setParallelCodegen(4, 0);
+    assembler.setListingMode(ListingMode::LAZY);
+    auto lazy = assembler.assemble(source);
+    ASSERT_TRUE(lazy.success);
+    EXPECT_EQ(lazy.getListingText(), full.getListingText());
+}
+
+TEST_F(AssemblerIntegrationTest, ListingCanBeDisabled) {
+    assembler.setListingMode(ListingMode::NONE);
+    auto result = assembler.assemble("start: NOP\nJMP start\nTIMES 4 DB 1");
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.listing.empty());
+    EXPECT_EQ(result.lazy_listing, nullptr);
+    EXPECT_TRUE(result.getListingText().empty());
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0x90, 0xEB, 0xFD, 1, 1, 1, 1}));
+}
+
+TEST_F(AssemblerIntegrationTest, StatsAreOffByDefault) {
+    auto result = assembler.assemble("NOP");
+    EXPECT_FALSE(result.stats.has_value());
+}
+
+TEST_F(AssemblerIntegrationTest, StatsCountPhaseOutput) {
+    assembler.enableStats(true);
+    auto result = assembler.assemble("%define N 3\nstart: MOV AX, N\nJMP start\nTIMES N NOP");
+    ASSERT_TRUE(result.success);
+    ASSERT_TRUE(result.stats.has_value());
+    const AssemblyStats& stats = *result.stats;
+    EXPECT_EQ(stats.statements, 4);
+    EXPECT_EQ(stats.tokens, 11);
+    EXPECT_EQ(stats.symbols, 1);
+    EXPECT_EQ(stats.define_expansions, 2);
+    EXPECT_EQ(stats.passes, result.passes);
+    EXPECT_EQ(stats.bytes_emitted, result.binary.size());
+    EXPECT_EQ(stats.listing_entries, result.listing.size());
+    EXPECT_GT(stats.ast_bytes, 0);
+    EXPECT_GE(stats.peak_buffered_lines, 1);
+    EXPECT_GE(stats.parse_time.count(), 0);
+}
+
+TEST_F(AssemblerIntegrationTest, PhaseCallbackSeesEveryBoundary) {
+    std::vector<AssemblyPhase> phases;
+    size_t bytes_at_codegen = 0;
+    assembler.setPhaseCallback([&](AssemblyPhase phase, const AssemblyStats& stats) {
+        phases.push_back(phase);
+        if (phase == AssemblyPhase::CODEGEN) {
+            bytes_at_codegen = stats.bytes_emitted;
+        }
+    });
+
+    auto result = assembler.assemble("MOV AX, 1\nHLT");
+    ASSERT_TRUE(result.success);
+    EXPECT_TRUE(result.stats.has_value());
+    EXPECT_EQ(phases, (std::vector<AssemblyPhase>{AssemblyPhase::PREPROCESS, AssemblyPhase::LEX,
+                                                  AssemblyPhase::PARSE, AssemblyPhase::SEMANTIC,
+                                                  AssemblyPhase::CODEGEN}));
+    EXPECT_EQ(bytes_at_codegen, 4);
+
+    phases.clear();
+    auto failed = assembler.assemble("MOV AX,");
+    EXPECT_FALSE(failed.success);
+    EXPECT_EQ(phases.size(), 3);
+}
+
+TEST_F(AssemblerIntegrationTest, LongestFormsEncodeInline) {
+    // Prefix, opcode, ModR/M, disp16 and imm16 all in one instruction
+    auto result = assembler.assemble("MOV WORD ES:[BX+SI+0x1234], 0x5678\nADD WORD [BP+DI+0x100], 0x200");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0x26, 0xC7, 0x80, 0x34, 0x12, 0x78, 0x56,
+                                                   0x81, 0x83, 0x00, 0x01, 0x00, 0x02}));
+}
+
+TEST(IncludeCacheTest, DetectsWholeFileGuard) {
+    EXPECT_EQ(IncludeCache::detectGuard("%ifndef A\n%define A\nNOP\n%endif\n"), "A");
+    EXPECT_EQ(IncludeCache::detectGuard("; c\n\n%ifndef A\n%define A\n%ifdef B\n%endif\n%endif"), "A");
+    EXPECT_FALSE(IncludeCache::detectGuard("%ifndef A\n%define B\n%endif\n"));
+    EXPECT_FALSE(IncludeCache::detectGuard("%ifndef A\n%define A\n%endif\nNOP\n"));
+    EXPECT_FALSE(IncludeCache::detectGuard("NOP\n"));
+    EXPECT_FALSE(IncludeCache::detectGuard("%ifndef A\n%define A\nNOP\n%else\nCLI\n%endif\n"));
+    EXPECT_FALSE(IncludeCache::detectGuard("%ifndef A\n%define A\nNOP\n%elif 1\nCLI\n%endif\n"));
+    EXPECT_EQ(IncludeCache::detectGuard("%ifndef A\n%define A\n%if 0\n%else\n%endif\n%endif\n"), "A");
+}
+
+TEST(IncludeCacheTest, ReusesUnchangedContents) {
+    const char* path = "e2asm_cache_test.inc";
+    {
+        std::ofstream out(path);
+        out << "NOP\n";
+    }
+
+    IncludeCache cache;
+    EXPECT_EQ(cache.resolve(path, {}), path);
+    auto first = cache.load(path);
+    auto second = cache.load(path);
+    std::remove(path);
+
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_EQ(*second->content, "NOP\n");
+    EXPECT_EQ(second->content, first->content);
+    EXPECT_EQ(cache.diskReads(), 1);
+    EXPECT_FALSE(cache.load(path).has_value());
+}
+
+TEST(IncludeCacheTest, EditedHeaderDropsStaleGuard) {
+    const char* path = "e2asm_guard_test.inc";
+    std::string source = "%define G\n%include \"e2asm_guard_test.inc\"\n%include \"e2asm_guard_test.inc\"";
+    {
+        std::ofstream out(path);
+        out << "%ifndef G\n%define G\nNOP\n%endif\n";
+    }
+    Assembler assembler;
+    auto guarded = assembler.assemble(source);
+
+    {
+        std::ofstream out(path);
+        out << "CLI\n";
+    }
+    // Make sure the edit is visible through the modification time
+    std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+    auto edited = assembler.assemble(source);
+    std::remove(path);
+
+    ASSERT_TRUE(guarded.success);
+    EXPECT_TRUE(guarded.binary.empty());
+    ASSERT_TRUE(edited.success);
+    EXPECT_EQ(edited.binary, (std::vector<uint8_t>{0xFA, 0xFA}));
+}
+
+TEST(AssemblySessionTest, MatchesFullAssembly) {
+    std::string source = "start:\nMOV AX, 5\nCOUNT EQU 3\nMOV BX, [table+COUNT]\nJMP start\ntable: DW 1, 2";
+    AssemblySession session;
+    Assembler assembler;
+
+    const auto& update = session.update(source);
+    auto expected = assembler.assemble(source);
+    ASSERT_TRUE(update.result.success);
+    EXPECT_TRUE(update.incremental);
+    EXPECT_EQ(update.result.binary, expected.binary);
+    EXPECT_EQ(update.result.symbols, expected.symbols);
+    ASSERT_EQ(update.changed.size(), 1);
+    EXPECT_EQ(update.changed[0], (ByteRange{0, expected.binary.size()}));
+}
+
+TEST(AssemblySessionTest, EditReparsesOnlyChangedLine) {
+    AssemblySession session;
+    session.update("MOV AX, 1\nMOV BX, 2\nMOV CX, 3\nHLT");
+
+    const auto& update = session.update("MOV AX, 1\nMOV BX, 7\nMOV CX, 3\nHLT");
+    ASSERT_TRUE(update.result.success);
+    EXPECT_TRUE(update.incremental);
+    EXPECT_EQ(update.reparsed_lines, 1);
+    EXPECT_EQ(update.encoded_instructions, 1);
+    ASSERT_EQ(update.changed.size(), 1);
+    EXPECT_EQ(update.changed[0], (ByteRange{4, 1}));
+    EXPECT_EQ(update.result.binary[4], 0x07);
+}
+
+TEST(AssemblySessionTest, InsertedLineMovesFollowingCode) {
+    AssemblySession session;
+    session.update("JMP done\nNOP\ndone: HLT");
+
+    const auto& update = session.update("JMP done\nNOP\nNOP\ndone: HLT");
+    Assembler assembler;
+    auto expected = assembler.assemble("JMP done\nNOP\nNOP\ndone: HLT");
+    ASSERT_TRUE(update.result.success);
+    EXPECT_EQ(update.reparsed_lines, 1);
+    EXPECT_EQ(update.result.binary, expected.binary);
+    ASSERT_FALSE(update.result.listing.empty());
+    EXPECT_EQ(update.result.listing.back().source_line, 4);
+}
+
+TEST(AssemblySessionTest, ReportsTruncatedTail) {
+    AssemblySession session;
+    const auto& first = session.update("MOV AX, 1\nNOP\nHLT");
+    EXPECT_EQ(first.truncated_from, 0);
+
+    const auto& shorter = session.update("MOV AX, 1\nHLT");
+    ASSERT_TRUE(shorter.result.success);
+    EXPECT_EQ(shorter.result.binary.size(), 4);
+    EXPECT_EQ(shorter.truncated_from, 5);
+    ASSERT_EQ(shorter.changed.size(), 1);
+    EXPECT_EQ(shorter.changed[0], (ByteRange{3, 1}));
+
+    // Growing back points at the new bytes instead
+    const auto& longer = session.update("MOV AX, 1\nNOP\nHLT");
+    EXPECT_EQ(longer.truncated_from, 0);
+    ASSERT_EQ(longer.changed.size(), 1);
+    EXPECT_EQ(longer.changed[0], (ByteRange{3, 2}));
+}
+
+TEST(AssemblySessionTest, ConstantChangeReencodesUsers) {
+    AssemblySession session;
+    session.update("SIZE EQU 2\nMOV AX, [BX+SIZE]\nNOP");
+
+    const auto& update = session.update("SIZE EQU 4\nMOV AX, [BX+SIZE]\nNOP");
+    ASSERT_TRUE(update.result.success);
+    EXPECT_EQ(update.reparsed_lines, 1);
+    EXPECT_EQ(update.encoded_instructions, 1);
+    EXPECT_EQ(update.result.binary[2], 0x04);
+}
+
+TEST(AssemblySessionTest, ErrorsAndDirectivesUseFullPipeline) {
+    AssemblySession session;
+    const auto& broken = session.update("NOP\nMOV AX,");
+    EXPECT_FALSE(broken.result.success);
+    EXPECT_FALSE(broken.incremental);
+
+    const auto& fixed = session.update("NOP\nMOV AX, 1");
+    EXPECT_TRUE(fixed.result.success);
+    EXPECT_TRUE(fixed.incremental);
+    EXPECT_EQ(fixed.reparsed_lines, 1);
+
+    const auto& defined = session.update("%define V 9\nMOV AL, V");
+    EXPECT_TRUE(defined.result.success);
+    EXPECT_FALSE(defined.incremental);
+    EXPECT_EQ(defined.result.binary, (std::vector<uint8_t>{0xB0, 0x09}));
+}
+
+TEST(LinkerTest, ResolvesCallsAndDataAcrossModules) {
+    Assembler assembler;
+    auto modules = assembler.assembleObjects({
+        {"EXTERN print\nGLOBAL start\nstart: CALL print\nHLT", "main.asm"},
+        {"GLOBAL print\nprint: MOV AX, msg\nRET\nSEGMENT data\nmsg: DB 'hi'", "print.asm"},
+    });
+    ASSERT_EQ(modules.size(), 2);
+    ASSERT_TRUE(modules[0].success);
+    ASSERT_TRUE(modules[1].success);
+    EXPECT_EQ(modules[0].externals, (std::vector<std::string>{"print"}));
+    ASSERT_EQ(modules[1].segments.size(), 2);
+    EXPECT_EQ(modules[1].segments[1].name, "data");
+
+    Linker linker;
+    linker.setOrigin(0x100);
+    auto image = linker.link(modules);
+    ASSERT_TRUE(image.success) << (image.errors.empty() ? "" : image.errors[0].message);
+    EXPECT_EQ(image.binary, (std::vector<uint8_t>{0xE8, 0x01, 0x00, 0xF4, 0xB8, 0x08, 0x01, 0xC3, 'h', 'i'}));
+    EXPECT_EQ(image.symbols["start"], 0x100);
+    EXPECT_EQ(image.symbols["print"], 0x104);
+    ASSERT_NE(image.symbol_index.symbolAt(0x106), nullptr);
+    EXPECT_EQ(image.symbol_index.symbolAt(0x106)->name, "print");
+}
+
+TEST(LinkerTest, MatchesSingleSourceAssembly) {
+    std::string code = "start: MOV SI, table\nMOV AX, [table+2]\nJMP start\n";
+    std::string data = "table: DW start, 2\n";
+    Assembler assembler;
+    auto whole = assembler.assemble("ORG 0x100\n" + code + data);
+    ASSERT_TRUE(whole.success);
+
+    auto module = assembler.assembleObject(code + data, "whole.asm");
+    ASSERT_TRUE(module.success);
+    EXPECT_FALSE(module.relocations.empty());
+    Linker linker;
+    linker.setOrigin(0x100);
+    auto image = linker.link({module});
+    ASSERT_TRUE(image.success);
+    EXPECT_EQ(image.binary, whole.binary);
+}
+
+TEST(LinkerTest, ParallelLinkMatchesSerial) {
+    Assembler assembler;
+    std::vector<AssemblyJob> jobs;
+    for (int i = 0; i < 8; i++) {
+        std::string n = std::to_string(i);
+        std::string next = std::to_string((i + 1) % 8);
+        jobs.push_back({"EXTERN f" + next + "\nGLOBAL f" + n + "\nf" + n + ": CALL f" + next + "\nRET\nDW f" + n, "m" + n});
+    }
+    auto modules = assembler.assembleObjects(jobs, 4);
+
+    Linker serial;
+    Linker parallel;
+    parallel.setWorkers(4);
+    auto expected = serial.link(modules);
+    auto actual = parallel.link(modules);
+    ASSERT_TRUE(expected.success);
+    EXPECT_EQ(actual.binary, expected.binary);
+    EXPECT_EQ(expected.symbols["f3"], 18);
+}
+
+TEST(LinkerTest, ReportsUnresolvedAndDuplicateSymbols) {
+    Assembler assembler;
+    Linker linker;
+
+    auto missing = linker.link({assembler.assembleObject("EXTERN nowhere\nJMP nowhere", "a.asm")});
+    EXPECT_FALSE(missing.success);
+    ASSERT_FALSE(missing.errors.empty());
+    EXPECT_NE(missing.errors[0].message.find("nowhere"), std::string::npos);
+    EXPECT_EQ(missing.errors[0].filename, "a.asm");
+
+    auto twice = linker.link({assembler.assembleObject("GLOBAL f\nf: RET", "a.asm"),
+                              assembler.assembleObject("GLOBAL F\nF: RET", "b.asm")});
+    EXPECT_FALSE(twice.success);
+}
+
+TEST(LinkerTest, ObjectModeRejectsWhatCantBeRelocated) {
+    Assembler assembler;
+    EXPECT_FALSE(assembler.assemble("EXTERN f\nCALL f").success);
+    EXPECT_FALSE(assembler.assembleObject("ORG 0x100\nNOP").success);
+    EXPECT_FALSE(assembler.assembleObject("GLOBAL COUNT\nCOUNT EQU 3").success);
+    EXPECT_FALSE(assembler.assembleObject("a: NOP\nb: MOV AX, [a+b]").success);
+    EXPECT_FALSE(assembler.assembleObject("SEGMENT one\nNOP\nSEGMENT two\nNOP\nSEGMENT one\nNOP").success);
+}
+
+TEST(LinkerTest, ShortJumpOutOfRangeFailsAtLinkTime) {
+    Assembler assembler;
+    auto caller = assembler.assembleObject("EXTERN far_away\nJMP SHORT far_away", "a.asm");
+    ASSERT_TRUE(caller.success);
+    auto callee = assembler.assembleObject("TIMES 300 NOP\nGLOBAL far_away\nfar_away: RET", "b.asm");
+    ASSERT_TRUE(callee.success);
+
+    Linker linker;
+    auto image = linker.link({caller, callee});
+    EXPECT_FALSE(image.success);
+    EXPECT_TRUE(image.binary.empty());
+}
+
+class ResultCacheTest : public ::testing::Test {
+protected:
+    const std::filesystem::path directory = "e2asm_result_cache_test";
+
+    void SetUp() override { std::filesystem::remove_all(directory); }
+    void TearDown() override { std::filesystem::remove_all(directory); }
+};
+
+TEST_F(ResultCacheTest, HitReturnsStoredResult) {
+    std::string source = "start: MOV AX, [table]\nJMP start\ntable: DW 1, 2";
+    Assembler assembler;
+    assembler.setResultCache(directory.string());
+    assembler.enableStats(true);
+
+    auto miss = assembler.assemble(source, "prog.asm");
+    auto hit = assembler.assemble(source, "prog.asm");
+    ASSERT_TRUE(miss.success);
+    ASSERT_TRUE(hit.success);
+    EXPECT_FALSE(miss.stats->from_cache);
+    EXPECT_TRUE(hit.stats->from_cache);
+    EXPECT_EQ(hit.binary, miss.binary);
+    EXPECT_EQ(hit.symbols, miss.symbols);
+    EXPECT_EQ(hit.passes, miss.passes);
+    EXPECT_EQ(hit.getListingText(), miss.getListingText());
+    EXPECT_EQ(hit.symbol_index.entries(), miss.symbol_index.entries());
+
+    auto stats = assembler.resultCacheStats();
+    EXPECT_EQ(stats.hits, 1);
+    EXPECT_EQ(stats.misses, 1);
+    EXPECT_EQ(stats.stores, 1);
+    EXPECT_GT(stats.bytes, 0);
+
+    // A second assembler pointed at the same directory shares the entries
+    Assembler other;
+    other.setResultCache(directory.string());
+    auto shared = other.assemble(source, "prog.asm");
+    EXPECT_EQ(shared.binary, miss.binary);
+    EXPECT_EQ(other.resultCacheStats().hits, 1);
+}
+
+TEST_F(ResultCacheTest, ReplacingAnEntryCountsItOnce) {
+    Assembler assembler;
+    auto result = assembler.assemble("MOV AX, 1");
+    ASSERT_TRUE(result.success);
+
+    ResultCache cache(directory, 1 << 20);
+    ResultCache::KeyBuilder builder;
+    builder.add("MOV AX, 1");
+    auto key = builder.finish();
+    cache.store(key, result);
+    cache.store(key, result);
+
+    uint64_t on_disk = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        on_disk += entry.file_size();
+    }
+    EXPECT_EQ(cache.stats().stores, 2);
+    EXPECT_GT(on_disk, 0);
+    EXPECT_EQ(cache.stats().bytes, on_disk);
+}
+
+TEST_F(ResultCacheTest, KeyCoversIncludesAndOrigin) {
+    const char* header = "e2asm_result_cache_test.inc";
+    std::string source = "%include \"e2asm_result_cache_test.inc\"\nlabel: HLT";
+    Assembler assembler;
+    assembler.setResultCache(directory.string());
+
+    {
+        std::ofstream out(header);
+        out << "NOP\n";
+    }
+    auto first = assembler.assemble(source);
+    {
+        std::ofstream out(header);
+        out << "CLI\nSTI\n";
+    }
+    assembler.clearIncludeCache();
+    auto edited = assembler.assemble(source);
+    assembler.setOrigin(0x100);
+    auto moved = assembler.assemble(source);
+    std::remove(header);
+
+    EXPECT_EQ(first.binary, (std::vector<uint8_t>{0x90, 0xF4}));
+    EXPECT_EQ(edited.binary, (std::vector<uint8_t>{0xFA, 0xFB, 0xF4}));
+    EXPECT_EQ(moved.symbols["label"], 0x102);
+    EXPECT_EQ(assembler.resultCacheStats().hits, 0);
+    EXPECT_EQ(assembler.resultCacheStats().stores, 3);
+}
+
+TEST_F(ResultCacheTest, FailuresAndDamagedEntriesAreNotReused) {
+    Assembler assembler;
+    assembler.setResultCache(directory.string());
+
+    EXPECT_FALSE(assembler.assemble("MOV AX,").success);
+    EXPECT_FALSE(assembler.assemble("MOV AX,").success);
+    EXPECT_EQ(assembler.resultCacheStats().stores, 0);
+
+    ASSERT_TRUE(assembler.assemble("MOV AX, 1").success);
+    for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+        std::ofstream out(entry.path(), std::ios::binary | std::ios::trunc);
+        out << "E2ASMRC";
+    }
+    auto result = assembler.assemble("MOV AX, 1");
+    ASSERT_TRUE(result.success);
+    EXPECT_EQ(result.binary, (std::vector<uint8_t>{0xB8, 0x01, 0x00}));
+    EXPECT_EQ(assembler.resultCacheStats().hits, 0);
+}
+
+TEST_F(ResultCacheTest, EvictsBeyondSizeLimit) {
+    Assembler assembler;
+    assembler.setListingMode(ListingMode::NONE);
+    assembler.setResultCache(directory.string(), 200);
+
+    for (int i = 0; i < 10; i++) {
+        ASSERT_TRUE(assembler.assemble("MOV AX, " + std::to_string(i)).success);
+    }
+    auto stats = assembler.resultCacheStats();
+    EXPECT_EQ(stats.stores, 10);
+    EXPECT_GT(stats.evictions, 0);
+    EXPECT_LE(stats.bytes, 200);
+
+    // The newest entry is still there
+    assembler.assemble("MOV AX, 9");
+    EXPECT_EQ(assembler.resultCacheStats().hits, 1);
+}
+
+TEST(AssemblyContextTest, MatchesFullAssembly) {
+    std::string program = "ORG 0x100\nstart: NOP\nretry: DEC CX\nTIMES 40 NOP\ntable: DW 0\n";
+    Assembler assembler;
+    auto base = assembler.assemble(program);
+    ASSERT_TRUE(base.success);
+
+    AssemblyContext context;
+    context.setSymbols(base.symbols);
+    for (const char* line : {"MOV AX, [BX+SI+4]", "JNZ retry", "MOV SI, table", "ADD WORD [table+2], 5",
+                             "JMP retry", "CALL start", "LOOP retry ; comment", "OUT DX, AL"}) {
+        auto expected = assembler.assemble(program + line);
+        ASSERT_TRUE(expected.success) << line;
+        std::vector<uint8_t> tail(expected.binary.begin() + base.binary.size(), expected.binary.end());
+
+        auto result = context.assembleInstruction(line, 0x100 + base.binary.size());
+        ASSERT_TRUE(result.success) << line;
+        EXPECT_EQ(std::vector<uint8_t>(result.bytes.begin(), result.bytes.end()), tail) << line;
+    }
+}
+
+TEST(AssemblyContextTest, UsesCallersSymbolTable) {
+    SymbolTable symbols;
+    symbols.define("COUNT", SymbolType::CONSTANT, 3, 0);
+    symbols.define("far_label", SymbolType::LABEL, 0x2000, 0);
+
+    AssemblyContext context;
+    auto mov = context.assembleInstruction("MOV AX, [BX+COUNT*2]", 0, symbols);
+    ASSERT_TRUE(mov.success);
+    EXPECT_EQ(std::vector<uint8_t>(mov.bytes.begin(), mov.bytes.end()), (std::vector<uint8_t>{0x8B, 0x47, 0x06}));
+
+    // Too far for SHORT, so the unannotated JMP grows to NEAR
+    auto jmp = context.assembleInstruction("JMP far_label", 0x100, symbols);
+    ASSERT_TRUE(jmp.success);
+    EXPECT_EQ(std::vector<uint8_t>(jmp.bytes.begin(), jmp.bytes.end()), (std::vector<uint8_t>{0xE9, 0xFD, 0x1E}));
+}
+
+TEST(AssemblyContextTest, ReportsLinesThatArentOneInstruction) {
+    AssemblyContext context;
+    EXPECT_FALSE(context.assembleInstruction("", 0).success);
+    EXPECT_FALSE(context.assembleInstruction("MOV AX,", 0).success);
+    EXPECT_FALSE(context.assembleInstruction("NOP\nNOP", 0).success);
+    EXPECT_FALSE(context.assembleInstruction("here: NOP", 0).success);
+    EXPECT_FALSE(context.assembleInstruction("DB 1", 0).success);
+
+    auto undefined = context.assembleInstruction("JMP nowhere", 0);
+    EXPECT_FALSE(undefined.success);
+    ASSERT_EQ(undefined.errors.size(), 1);
+    EXPECT_NE(undefined.errors[0].message.find("nowhere"), std::string::npos);
+
+    // Failures leave the context usable
+    auto after = context.assembleInstruction("INT 0x21", 0);
+    ASSERT_TRUE(after.success);
+    EXPECT_EQ(std::vector<uint8_t>(after.bytes.begin(), after.bytes.end()), (std::vector<uint8_t>{0xCD, 0x21}));
+}
+
+TEST(SymbolIndexTest, LabelsCoverUpToTheNextOne) {
+    Assembler assembler;
+    auto result = assembler.assemble("ORG 0x100\nstart: NOP\nNOP\n.loop: DEC CX\nJNZ .loop\nother: alias: HLT");
+    ASSERT_TRUE(result.success);
+
+    const auto& index = result.symbol_index;
+    ASSERT_EQ(index.size(), 4);
+    EXPECT_EQ(index.entries()[0], (SymbolIndex::Entry{0x100, 2, "start"}));
+    EXPECT_EQ(index.entries()[1], (SymbolIndex::Entry{0x102, 3, "start.loop"}));
+    EXPECT_EQ(index.entries()[2], (SymbolIndex::Entry{0x105, 1, "alias"}));
+    EXPECT_EQ(index.entries()[3], (SymbolIndex::Entry{0x105, 1, "other"}));
+
+    EXPECT_EQ(index.symbolAt(0xFF), nullptr);
+    EXPECT_EQ(index.symbolAt(0x101)->name, "start");
+    EXPECT_EQ(index.symbolAt(0x104)->name, "start.loop");
+    EXPECT_EQ(index.symbolAt(0x105)->name, "alias");
+    EXPECT_EQ(index.symbolAt(0x106), nullptr);
+}
+
+TEST(SymbolIndexTest, MapFileRoundTrips) {
+    Assembler assembler;
+    auto result = assembler.assemble("main: CALL helper\nRET\nhelper: .inner: RET\ntable: DW 1, 2, 3");
+    ASSERT_TRUE(result.success);
+
+    const char* path = "e2asm_map_test.map";
+    ASSERT_TRUE(result.writeMapFile(path));
+    MappedFile file;
+    ASSERT_TRUE(file.open(path));
+    std::string text(file.view());
+    SymbolIndex loaded;
+    bool parsed = SymbolIndex::parseMapFile(file.view(), loaded);
+    file.close();
+    std::remove(path);
+
+    EXPECT_NE(text.find("00000004  00000001  helper\n"), std::string::npos);
+    ASSERT_TRUE(parsed);
+    EXPECT_EQ(loaded.entries(), result.symbol_index.entries());
+    EXPECT_EQ(loaded.symbolAt(7)->name, "table");
+
+    SymbolIndex broken;
+    EXPECT_FALSE(SymbolIndex::parseMapFile("Address   Size      Name\nzz  1  x\n", broken));
+    EXPECT_FALSE(SymbolIndex::parseMapFile("no header", broken));
+}
+
+TEST(CycleEstimateTest, AddsEffectiveAddressToMemoryForms) {
+    Assembler assembler;
+    auto result = assembler.assemble(
+        "MOV AX, BX\nMOV AX, [0x1234]\nADD AX, [SI]\nADD [BX], AX\nADD AX, [ES:BX+SI+4]\n"
+        "INC WORD [BP]\nJNZ next\nnext: DB 1");
+    ASSERT_TRUE(result.success);
+
+    std::vector<uint32_t> cycles;
+    for (const auto& line : result.listing) {
+        cycles.push_back(line.cycles);
+    }
+    // Register form, accumulator move, 9+5, 16+5, 9+11+2 for the override,
+    // 15+9 ([BP] always has a displacement), taken branch, then label and data
+    std::vector<uint32_t> expected = {2, 10, 14, 21, 22, 24, 16, 0, 0};
+    EXPECT_EQ(cycles, expected);
+}
+
+TEST(CycleEstimateTest, LazyListingKeepsCycles) {
+    const std::string source = "start: MOV CX, 4\n.loop: ADD AX, [SI]\nLOOP .loop\nTIMES 3 NOP";
+    Assembler full;
+    Assembler lazy;
+    lazy.setListingMode(ListingMode::LAZY);
+    auto expected = full.assemble(source);
+    auto result = lazy.assemble(source);
+    ASSERT_TRUE(result.success);
+
+    auto lines = result.getListing();
+    ASSERT_EQ(lines.size(), expected.listing.size());
+    for (size_t i = 0; i < lines.size(); i++) {
+        EXPECT_EQ(lines[i].cycles, expected.listing[i].cycles) << lines[i].source_text;
+    }
+}
+
+TEST(CycleEstimateTest, ReportSumsEachLabelRange) {
+    Assembler assembler;
+    auto result = assembler.assemble(
+        "ORG 0x100\nstart: MOV CX, 10\n.loop: ADD AX, [SI]\nINC SI\nLOOP .loop\nRET\n"
+        "table: DW 1, 2\nTIMES 3 NOP");
+    ASSERT_TRUE(result.success);
+
+    auto report = result.getCycleReport();
+    ASSERT_EQ(report.size(), 3);
+    EXPECT_EQ(report[0].label, "start");
+    EXPECT_EQ(report[0].address, 0x100);
+    EXPECT_EQ(report[0].bytes, 3);
+    EXPECT_EQ(report[0].cycles, 4);
+    EXPECT_EQ(report[0].instructions, 1);
+
+    // ADD 14 + INC 2 + LOOP 17 + RET 8
+    EXPECT_EQ(report[1].label, "start.loop");
+    EXPECT_EQ(report[1].bytes, 6);
+    EXPECT_EQ(report[1].cycles, 41);
+    EXPECT_EQ(report[1].instructions, 4);
+
+    // Data counts towards the size, each NOP copy towards the cycles
+    EXPECT_EQ(report[2].label, "table");
+    EXPECT_EQ(report[2].bytes, 7);
+    EXPECT_EQ(report[2].cycles, 9);
+    EXPECT_EQ(report[2].instructions, 3);
+
+    std::string text = result.getCycleReportText();
+    EXPECT_NE(text.find("00000103  6         41        4         start.loop\n"), std::string::npos) << text;
+
+    Assembler none;
+    none.setListingMode(ListingMode::NONE);
+    EXPECT_TRUE(none.assemble("start: NOP").getCycleReport().empty());
+}
@@ -1,14 +1,23 @@
 #include <gtest/gtest.h>
+#include <cctype>
+#include <deque>
+#include "E2Asm/lexer/char_scan.h"
 #include "E2Asm/lexer/lexer.h"
+#include "E2Asm/lexer/reserved_words.h"
+#include "E2Asm/lexer/token_stream.h"
 
 using namespace e2asm;
 
 class LexerTest : public ::testing::Test {
 protected:
     std::vector<Token> tokenize(const std::string& source) {
-        Lexer lexer(source);
+        // Token lexemes view the source, so keep every buffer alive for the test
+        m_sources.push_back(source);
+        Lexer lexer(m_sources.back());
         return lexer.tokenize();
     }
+
+    std::deque<std::string> m_sources;
 };
 
 TEST_F(LexerTest, EmptyInput) {
@@ -74,6 +83,24 @@ TEST_F(LexerTest, OctalNumber) {
     EXPECT_EQ(tokens[0].getNumber(), 42);
 }
 
+TEST_F(LexerTest, BinaryNumberWithSuffix) {
+    auto tokens = tokenize("101010b");
+    ASSERT_GE(tokens.size(), 1);
+    EXPECT_EQ(tokens[0].type, TokenType::NUMBER);
+    EXPECT_EQ(tokens[0].getNumber(), 42);
+}
+
+TEST_F(LexerTest, OutOfRangeNumberIsError) {
+    auto tokens = tokenize("99999999999999999999999 0x1FFFFFFFFFFFFFFFF 12b");
+    ASSERT_EQ(tokens.size(), 4);
+    EXPECT_EQ(tokens[0].type, TokenType::ERROR);
+    EXPECT_EQ(tokens[0].lexeme, "Number literal out of range");
+    EXPECT_EQ(tokens[1].type, TokenType::ERROR);
+    EXPECT_EQ(tokens[1].lexeme, "Number literal out of range");
+    EXPECT_EQ(tokens[2].type, TokenType::ERROR);
+    EXPECT_EQ(tokens[2].lexeme, "Invalid number literal");
+}
+
 TEST_F(LexerTest, DoubleQuotedString) {
     auto tokens = tokenize("\"hello\"");
     ASSERT_GE(tokens.size(), 1);
@@ -87,6 +114,70 @@ TEST_F(LexerTest, SingleQuotedString) {
     EXPECT_EQ(tokens[0].type, TokenType::STRING);
 }
 
+TEST_F(LexerTest, StringLexemeViewsSource) {
+    std::string source = "DB \"a\\tb\\x41\"";
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+    ASSERT_GE(tokens.size(), 2);
+    EXPECT_EQ(tokens[1].type, TokenType::STRING);
+    EXPECT_EQ(tokens[1].lexeme, "\"a\\tb\\x41\"");
+    EXPECT_EQ(tokens[1].lexeme.data(), source.data() + 3);
+    EXPECT_EQ(tokens[1].getString(), "a\tbA");
+}
+
+TEST_F(LexerTest, LocationCarriesFileId) {
+    FileTable files;
+    FileId id = files.intern("boot.asm");
+    EXPECT_EQ(files.intern("boot.asm"), id);
+    EXPECT_EQ(files.name(FileTable::INPUT), "<input>");
+
+    std::string source = "NOP\n  HLT";
+    Lexer lexer(source, id);
+    auto tokens = lexer.tokenize();
+    ASSERT_GE(tokens.size(), 3);
+    EXPECT_EQ(tokens[2].location.file, id);
+    EXPECT_EQ(tokens[2].location.format(files), "boot.asm:2:3");
+}
+
+TEST_F(LexerTest, TokenStreamMatchesBatchLexer) {
+    std::vector<std::string> lines = {"start: MOV AX, [BX+2] ; comment", "", "  JMP start"};
+    size_t next_line = 0;
+    TokenStream stream([&]() -> std::optional<std::string_view> {
+        if (next_line == lines.size()) return std::nullopt;
+        return lines[next_line++];
+    });
+
+    std::vector<Token> batch;
+    for (const auto& token : tokenize("start: MOV AX, [BX+2] ; comment\n\n  JMP start\n")) {
+        if (token.type != TokenType::NEWLINE) batch.push_back(token);
+    }
+
+    for (const auto& expected : batch) {
+        Token token = stream.next();
+        EXPECT_EQ(token.type, expected.type);
+        EXPECT_EQ(token.lexeme, expected.lexeme);
+        EXPECT_EQ(token.location.line, expected.location.line);
+        EXPECT_EQ(token.location.column, expected.location.column);
+    }
+    EXPECT_EQ(stream.next().type, TokenType::END_OF_FILE);
+}
+
+TEST_F(LexerTest, TokenStreamReleasesLines) {
+    size_t remaining = 100;
+    TokenStream stream([&]() -> std::optional<std::string_view> {
+        if (remaining == 0) return std::nullopt;
+        remaining--;
+        return "NOP";
+    });
+
+    for (size_t line = 1; line <= 100; line++) {
+        Token token = stream.next();
+        ASSERT_EQ(token.type, TokenType::INSTRUCTION);
+        stream.release(line);
+        EXPECT_LE(stream.bufferedLines(), 1);
+    }
+}
+
 TEST_F(LexerTest, CharacterLiteral) {
     auto tokens = tokenize("'A'");
     ASSERT_GE(tokens.size(), 1);
@@ -376,6 +467,109 @@ TEST_F(LexerTest, LocationTracking) {
     EXPECT_EQ(tokens[2].location.line, 2);
 }
 
+TEST_F(LexerTest, LongRunsKeepLocations) {
+    // Runs longer than a scan block, with the interesting byte at varied offsets
+    std::string ident(40, 'a');
+    ident[17] = '_';
+    ident[31] = '7';
+    std::string source = ident + std::string(37, ' ') + "\t, " + "; " + std::string(50, 'c') + "\n" +
+                         "  \"" + std::string(14, 's') + "\\\"" + std::string(20, 't') + "\\\\\"" +
+                         " 'x\ny' dest";
+    auto tokens = tokenize(source);
+
+    ASSERT_GE(tokens.size(), 7);
+    EXPECT_EQ(tokens[0].type, TokenType::IDENTIFIER);
+    EXPECT_EQ(tokens[0].lexeme, ident);
+    EXPECT_EQ(tokens[1].type, TokenType::COMMA);
+    EXPECT_EQ(tokens[1].location.column, 79);
+    EXPECT_EQ(tokens[2].type, TokenType::NEWLINE);
+    EXPECT_EQ(tokens[3].type, TokenType::NEWLINE);
+
+    EXPECT_EQ(tokens[4].type, TokenType::STRING);
+    EXPECT_EQ(tokens[4].location.line, 2);
+    EXPECT_EQ(tokens[4].location.column, 3);
+    EXPECT_EQ(tokens[4].getString(), std::string(14, 's') + "\"" + std::string(20, 't') + "\\");
+
+    // A literal spanning a newline moves the following tokens to the next line
+    EXPECT_EQ(tokens[5].type, TokenType::STRING);
+    EXPECT_EQ(tokens[5].location.column, 44);
+    EXPECT_EQ(tokens[6].lexeme, "dest");
+    EXPECT_EQ(tokens[6].location.line, 3);
+    EXPECT_EQ(tokens[6].location.column, 4);
+}
+
+TEST_F(LexerTest, InstructionTokensCarryMnemonicId) {
+    auto tokens = tokenize("mov ax, 1\nJnz here\nloop: nop");
+    EXPECT_EQ(tokens[0].mnemonic, Mnemonic::MOV);
+    EXPECT_EQ(tokens[5].type, TokenType::INSTRUCTION);
+    EXPECT_EQ(tokens[5].mnemonic, Mnemonic::JNZ);
+    EXPECT_EQ(tokens[8].type, TokenType::IDENTIFIER);  // "loop:" is a label
+    EXPECT_EQ(tokens[8].mnemonic, Mnemonic::NONE);
+    EXPECT_EQ(tokens[10].mnemonic, Mnemonic::NOP);
+}
+
+TEST(ReservedWordTest, ClassifiesEveryMnemonicIgnoringCase) {
+    for (size_t i = 1; i < MNEMONIC_COUNT; i++) {
+        auto mnemonic = static_cast<Mnemonic>(i);
+        std::string name(mnemonicName(mnemonic));
+        if (mnemonic == Mnemonic::INT3) {
+            EXPECT_EQ(classifyWord(name).type, TokenType::IDENTIFIER);
+            continue;
+        }
+        std::string lower = name;
+        for (char& c : lower) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        for (const std::string& spelling : {name, lower}) {
+            SCOPED_TRACE(spelling);
+            ReservedWord word = classifyWord(spelling);
+            EXPECT_EQ(word.type, TokenType::INSTRUCTION);
+            EXPECT_EQ(word.mnemonic, mnemonic);
+        }
+    }
+}
+
+TEST(ReservedWordTest, ClassifiesOtherReservedWords) {
+    EXPECT_EQ(classifyWord("ax").type, TokenType::REG16_AX);
+    EXPECT_EQ(classifyWord("Ds").type, TokenType::SEGREG_DS);
+    EXPECT_EQ(classifyWord("times").type, TokenType::DIR_TIMES);
+    EXPECT_EQ(classifyWord("PTR").type, TokenType::WORD_PTR);
+    EXPECT_EQ(classifyWord("%IfNDef").type, TokenType::PREP_IFNDEF);
+    EXPECT_EQ(classifyWord("ax").mnemonic, Mnemonic::NONE);
+
+    for (const char* word : {"", "A", "MOVX", "MO", "DEFINE", "%FOO", "axe", "loop_1", "averyverylongname"}) {
+        SCOPED_TRACE(word);
+        EXPECT_EQ(classifyWord(word).type, TokenType::IDENTIFIER);
+    }
+}
+
+TEST(CharScanTest, MatchesScalarScanAtEveryOffset) {
+    std::string text = "MOV  ax_1.loop\t\r, [bx+si]; comment \"q\\\" 'c' \xC3\xA9t\xE9_x" +
+                       std::string(20, ' ') + std::string(33, 'Z') + "\n;\"";
+    auto scalar = [&](size_t pos, auto stop) {
+        while (pos < text.size() && !stop(text[pos])) {
+            pos++;
+        }
+        return pos;
+    };
+    auto ident = [](char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') ||
+               c == '_' || c == '.';
+    };
+
+    for (size_t pos = 0; pos <= text.size(); pos++) {
+        SCOPED_TRACE(pos);
+        EXPECT_EQ(skipBlanks(text, pos),
+                  scalar(pos, [](char c) { return c != ' ' && c != '\t' && c != '\r'; }));
+        EXPECT_EQ(skipIdentifierChars(text, pos), scalar(pos, [&](char c) { return !ident(c); }));
+        EXPECT_EQ(findLineEnd(text, pos), scalar(pos, [](char c) { return c == '\n'; }));
+        EXPECT_EQ(findQuoteOrEscape(text, pos, '"'),
+                  scalar(pos, [](char c) { return c == '"' || c == '\\'; }));
+        EXPECT_EQ(findQuoteOrEscape(text, pos, '\''),
+                  scalar(pos, [](char c) { return c == '\'' || c == '\\'; }));
+    }
+}
+
 TEST_F(LexerTest, PreprocessorDirectives) {
     auto define = tokenize("%define");
     EXPECT_EQ(define[0].type, TokenType::PREP_DEFINE);
@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include "E2Asm/lexer/lexer.h"
 #include "E2Asm/parser/parser.h"
+#include "E2Asm/parser/expression_parser.h"
 
 using namespace e2asm;
 
@@ -33,7 +34,7 @@ TEST_F(ParserTest, SingleNOP) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "NOP");
     EXPECT_TRUE(instr->operands.empty());
@@ -44,7 +45,7 @@ TEST_F(ParserTest, SimpleLabel) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* label = dynamic_cast<Label*>(program->statements[0].get());
+    auto* label = ast_cast<Label>(program->statements[0]);
     ASSERT_NE(label, nullptr);
     EXPECT_EQ(label->name, "start");
 }
@@ -54,7 +55,7 @@ TEST_F(ParserTest, LocalLabel) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* label = dynamic_cast<Label*>(program->statements[0].get());
+    auto* label = ast_cast<Label>(program->statements[0]);
     ASSERT_NE(label, nullptr);
     EXPECT_EQ(label->name, ".loop");
 }
@@ -64,11 +65,11 @@ TEST_F(ParserTest, LabelWithInstruction) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 2);
 
-    auto* label = dynamic_cast<Label*>(program->statements[0].get());
+    auto* label = ast_cast<Label>(program->statements[0]);
     ASSERT_NE(label, nullptr);
     EXPECT_EQ(label->name, "start");
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[1].get());
+    auto* instr = ast_cast<Instruction>(program->statements[1]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "NOP");
 }
@@ -78,17 +79,17 @@ TEST_F(ParserTest, MovRegReg) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "MOV");
     ASSERT_EQ(instr->operands.size(), 2);
 
-    auto* dest = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
+    auto* dest = ast_cast<RegisterOperand>(instr->operands[0]);
     ASSERT_NE(dest, nullptr);
     EXPECT_EQ(dest->name, "AX");
     EXPECT_EQ(dest->size, 16);
 
-    auto* src = dynamic_cast<RegisterOperand*>(instr->operands[1].get());
+    auto* src = ast_cast<RegisterOperand>(instr->operands[1]);
     ASSERT_NE(src, nullptr);
     EXPECT_EQ(src->name, "BX");
     EXPECT_EQ(src->size, 16);
@@ -99,11 +100,11 @@ TEST_F(ParserTest, MovReg8Reg8) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     ASSERT_EQ(instr->operands.size(), 2);
 
-    auto* dest = dynamic_cast<RegisterOperand*>(instr->operands[0].get());
+    auto* dest = ast_cast<RegisterOperand>(instr->operands[0]);
     ASSERT_NE(dest, nullptr);
     EXPECT_EQ(dest->size, 8);
 }
@@ -113,11 +114,11 @@ TEST_F(ParserTest, MovRegImm) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     ASSERT_EQ(instr->operands.size(), 2);
 
-    auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
+    auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
     ASSERT_NE(imm, nullptr);
     EXPECT_EQ(imm->value, 42);
 }
@@ -126,10 +127,10 @@ TEST_F(ParserTest, MovRegHexImm) {
     auto program = parse("MOV AX, 0x1234");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[1].get());
+    auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
     ASSERT_NE(imm, nullptr);
     EXPECT_EQ(imm->value, 0x1234);
 }
@@ -138,11 +139,11 @@ TEST_F(ParserTest, MovRegMemDirect) {
     auto program = parse("MOV AX, [1234h]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     ASSERT_EQ(instr->operands.size(), 2);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
     ASSERT_NE(mem, nullptr);
 }
 
@@ -150,11 +151,11 @@ TEST_F(ParserTest, MovRegMemRegister) {
     auto program = parse("MOV AX, [BX]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     ASSERT_EQ(instr->operands.size(), 2);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
     ASSERT_NE(mem, nullptr);
 }
 
@@ -162,10 +163,10 @@ TEST_F(ParserTest, MovRegMemComplex) {
     auto program = parse("MOV AX, [BX+SI+10]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
     ASSERT_NE(mem, nullptr);
 }
 
@@ -173,10 +174,10 @@ TEST_F(ParserTest, MemoryWithSizeHint) {
     auto program = parse("MOV BYTE [BX], 0");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[0]);
     ASSERT_NE(mem, nullptr);
     EXPECT_EQ(mem->size_hint, 8);
 }
@@ -185,10 +186,10 @@ TEST_F(ParserTest, MemoryWithWordSizeHint) {
     auto program = parse("MOV WORD [BX], 0");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[0].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[0]);
     ASSERT_NE(mem, nullptr);
     EXPECT_EQ(mem->size_hint, 16);
 }
@@ -197,10 +198,10 @@ TEST_F(ParserTest, MemoryWithSegmentOverride) {
     auto program = parse("MOV AX, [ES:BX]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* mem = dynamic_cast<MemoryOperand*>(instr->operands[1].get());
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
     ASSERT_NE(mem, nullptr);
     ASSERT_TRUE(mem->segment_override.has_value());
     EXPECT_EQ(mem->segment_override.value(), "ES");
@@ -210,12 +211,12 @@ TEST_F(ParserTest, JmpLabel) {
     auto program = parse("JMP start");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "JMP");
     ASSERT_EQ(instr->operands.size(), 1);
 
-    auto* label_ref = dynamic_cast<LabelRef*>(instr->operands[0].get());
+    auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
     ASSERT_NE(label_ref, nullptr);
     EXPECT_EQ(label_ref->label, "start");
 }
@@ -224,10 +225,10 @@ TEST_F(ParserTest, JmpShortLabel) {
     auto program = parse("JMP SHORT .loop");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
 
-    auto* label_ref = dynamic_cast<LabelRef*>(instr->operands[0].get());
+    auto* label_ref = ast_cast<LabelRef>(instr->operands[0]);
     ASSERT_NE(label_ref, nullptr);
     EXPECT_EQ(label_ref->jump_type, LabelRef::JumpType::SHORT);
 }
@@ -236,7 +237,7 @@ TEST_F(ParserTest, ConditionalJump) {
     auto program = parse("JE done");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "JE");
 }
@@ -245,7 +246,7 @@ TEST_F(ParserTest, CallInstruction) {
     auto program = parse("CALL my_function");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "CALL");
 }
@@ -254,7 +255,7 @@ TEST_F(ParserTest, PushReg) {
     auto program = parse("PUSH AX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "PUSH");
     ASSERT_EQ(instr->operands.size(), 1);
@@ -264,7 +265,7 @@ TEST_F(ParserTest, PopReg) {
     auto program = parse("POP BX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "POP");
 }
@@ -274,7 +275,7 @@ TEST_F(ParserTest, DBDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[0].get());
+    auto* data = ast_cast<DataDirective>(program->statements[0]);
     ASSERT_NE(data, nullptr);
     EXPECT_EQ(data->size, DataDirective::Size::BYTE);
     ASSERT_EQ(data->values.size(), 1);
@@ -285,7 +286,7 @@ TEST_F(ParserTest, DWDirective) {
     auto program = parse("DW 0x1234");
     ASSERT_NE(program, nullptr);
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[0].get());
+    auto* data = ast_cast<DataDirective>(program->statements[0]);
     ASSERT_NE(data, nullptr);
     EXPECT_EQ(data->size, DataDirective::Size::WORD);
 }
@@ -294,7 +295,7 @@ TEST_F(ParserTest, DBMultipleValues) {
     auto program = parse("DB 1, 2, 3, 4");
     ASSERT_NE(program, nullptr);
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[0].get());
+    auto* data = ast_cast<DataDirective>(program->statements[0]);
     ASSERT_NE(data, nullptr);
     EXPECT_EQ(data->values.size(), 4);
 }
@@ -303,7 +304,7 @@ TEST_F(ParserTest, DBString) {
     auto program = parse("DB \"Hello\"");
     ASSERT_NE(program, nullptr);
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[0].get());
+    auto* data = ast_cast<DataDirective>(program->statements[0]);
     ASSERT_NE(data, nullptr);
     ASSERT_EQ(data->values.size(), 1);
     EXPECT_EQ(data->values[0].type, DataValue::Type::STRING);
@@ -314,7 +315,7 @@ TEST_F(ParserTest, DBStringWithNull) {
     auto program = parse("DB \"Hello\", 0");
     ASSERT_NE(program, nullptr);
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[0].get());
+    auto* data = ast_cast<DataDirective>(program->statements[0]);
     ASSERT_NE(data, nullptr);
     EXPECT_EQ(data->values.size(), 2);
 }
@@ -324,11 +325,11 @@ TEST_F(ParserTest, LabeledData) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 2);
 
-    auto* label = dynamic_cast<Label*>(program->statements[0].get());
+    auto* label = ast_cast<Label>(program->statements[0]);
     ASSERT_NE(label, nullptr);
     EXPECT_EQ(label->name, "msg");
 
-    auto* data = dynamic_cast<DataDirective*>(program->statements[1].get());
+    auto* data = ast_cast<DataDirective>(program->statements[1]);
     ASSERT_NE(data, nullptr);
 }
 
@@ -337,7 +338,7 @@ TEST_F(ParserTest, EQUDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* equ = dynamic_cast<EQUDirective*>(program->statements[0].get());
+    auto* equ = ast_cast<EQUDirective>(program->statements[0]);
     ASSERT_NE(equ, nullptr);
     EXPECT_EQ(equ->name, "SCREEN_WIDTH");
     EXPECT_EQ(equ->value, 80);
@@ -348,7 +349,7 @@ TEST_F(ParserTest, ORGDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* org = dynamic_cast<ORGDirective*>(program->statements[0].get());
+    auto* org = ast_cast<ORGDirective>(program->statements[0]);
     ASSERT_NE(org, nullptr);
     EXPECT_EQ(org->address, 0x7C00);
 }
@@ -358,7 +359,7 @@ TEST_F(ParserTest, SEGMENTDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* seg = dynamic_cast<SEGMENTDirective*>(program->statements[0].get());
+    auto* seg = ast_cast<SEGMENTDirective>(program->statements[0]);
     ASSERT_NE(seg, nullptr);
     EXPECT_EQ(seg->name, ".text");
 }
@@ -368,7 +369,7 @@ TEST_F(ParserTest, RESBDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* res = dynamic_cast<RESDirective*>(program->statements[0].get());
+    auto* res = ast_cast<RESDirective>(program->statements[0]);
     ASSERT_NE(res, nullptr);
     EXPECT_EQ(res->size, RESDirective::Size::BYTE);
     EXPECT_EQ(res->count, 512);
@@ -378,7 +379,7 @@ TEST_F(ParserTest, RESWDirective) {
     auto program = parse("RESW 100");
     ASSERT_NE(program, nullptr);
 
-    auto* res = dynamic_cast<RESDirective*>(program->statements[0].get());
+    auto* res = ast_cast<RESDirective>(program->statements[0]);
     ASSERT_NE(res, nullptr);
     EXPECT_EQ(res->size, RESDirective::Size::WORD);
     EXPECT_EQ(res->count, 100);
@@ -389,11 +390,11 @@ TEST_F(ParserTest, TIMESDirective) {
     ASSERT_NE(program, nullptr);
     ASSERT_EQ(program->statements.size(), 1);
 
-    auto* times = dynamic_cast<TIMESDirective*>(program->statements[0].get());
+    auto* times = ast_cast<TIMESDirective>(program->statements[0]);
     ASSERT_NE(times, nullptr);
     EXPECT_EQ(times->count, 10);
 
-    auto* repeated = dynamic_cast<DataDirective*>(times->repeated_node.get());
+    auto* repeated = ast_cast<DataDirective>(times->repeated_node);
     ASSERT_NE(repeated, nullptr);
 }
 
@@ -401,20 +402,92 @@ TEST_F(ParserTest, TIMESWithNOP) {
     auto program = parse("TIMES 5 NOP");
     ASSERT_NE(program, nullptr);
 
-    auto* times = dynamic_cast<TIMESDirective*>(program->statements[0].get());
+    auto* times = ast_cast<TIMESDirective>(program->statements[0]);
     ASSERT_NE(times, nullptr);
     EXPECT_EQ(times->count, 5);
 
-    auto* repeated = dynamic_cast<Instruction*>(times->repeated_node.get());
+    auto* repeated = ast_cast<Instruction>(times->repeated_node);
     ASSERT_NE(repeated, nullptr);
     EXPECT_EQ(repeated->mnemonic, "NOP");
 }
 
+TEST_F(ParserTest, TIMESCountExpressionIsCompiled) {
+    auto program = parse("TIMES 510-($-$$) DB 0\nTIMES (2+3)*4 NOP");
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(program->statements.size(), 2);
+
+    auto* padding = ast_cast<TIMESDirective>(program->statements[0]);
+    ASSERT_NE(padding, nullptr);
+    EXPECT_TRUE(padding->symbolic_count);
+    EXPECT_EQ(padding->count_expr, "510-($-$$)");
+    EXPECT_TRUE(padding->count_program.usesPosition());
+    ASSERT_NE(ast_cast<DataDirective>(padding->repeated_node), nullptr);
+
+    // Folded while parsing, nothing left to evaluate later
+    auto* folded = ast_cast<TIMESDirective>(program->statements[1]);
+    ASSERT_NE(folded, nullptr);
+    EXPECT_FALSE(folded->symbolic_count);
+    EXPECT_EQ(folded->count, 20);
+    EXPECT_TRUE(folded->count_program.empty());
+}
+
+TEST_F(ParserTest, ImmediateExpressionIsCompiled) {
+    auto program = parse("MOV AX, WIDTH*2 + WIDTH - 6/2");
+    ASSERT_NE(program, nullptr);
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
+    ASSERT_NE(instr, nullptr);
+    auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
+    ASSERT_NE(imm, nullptr);
+    EXPECT_TRUE(imm->has_label);
+
+    // One slot for both uses of WIDTH, and 6/2 folded to 3
+    const ExpressionProgram& expr = imm->expression;
+    ASSERT_EQ(expr.symbols(), std::vector<std::string>{"WIDTH"});
+    ASSERT_EQ(expr.code().size(), 7);
+    EXPECT_EQ(expr.code()[5].op, ExprOp::PUSH_CONST);
+    EXPECT_EQ(expr.code()[5].operand, 3);
+
+    auto value = expr.evaluate([](size_t slot) { return std::optional<int64_t>(slot == 0 ? 10 : 0); });
+    EXPECT_EQ(value, 27);
+}
+
+TEST_F(ParserTest, PlainLabelImmediateHasNoProgram) {
+    auto program = parse("MOV AX, msg");
+    ASSERT_NE(program, nullptr);
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
+    ASSERT_NE(instr, nullptr);
+    auto* imm = ast_cast<ImmediateOperand>(instr->operands[1]);
+    ASSERT_NE(imm, nullptr);
+    EXPECT_TRUE(imm->expression.empty());
+}
+
+TEST_F(ParserTest, ConstantDivisionByZeroIsRejected) {
+    EXPECT_FALSE(parseSucceeds("MOV AX, 4/(2-2)"));
+    EXPECT_FALSE(parseSucceeds("TIMES 1/0 NOP"));
+}
+
+TEST(ExpressionParserTest, TextExpressionsEvaluate) {
+    EXPECT_EQ(ExpressionParser::evaluate("0x10 + 2*3"), 22);
+    EXPECT_EQ(ExpressionParser::evaluate("-(8/2) - -1"), -3);
+    EXPECT_EQ(ExpressionParser::evaluate("2+"), std::nullopt);
+    EXPECT_EQ(ExpressionParser::evaluate("5 @ 3"), std::nullopt);
+    EXPECT_EQ(ExpressionParser::evaluate("$"), std::nullopt);  // No position to read
+
+    EXPECT_EQ(ExpressionParser::evaluateWithContext("$-$$", 0x7C10, 0x7C00), 0x10);
+
+    auto lookup = [](const std::string& name) -> std::optional<int64_t> {
+        if (name == "SIZE") return 8;
+        return std::nullopt;
+    };
+    EXPECT_EQ(ExpressionParser::evaluateWithSymbols("SIZE*SIZE+1", lookup), 65);
+    EXPECT_EQ(ExpressionParser::evaluateWithSymbols("SIZE+OTHER", lookup), std::nullopt);
+}
+
 TEST_F(ParserTest, AddRegReg) {
     auto program = parse("ADD AX, BX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "ADD");
     EXPECT_EQ(instr->operands.size(), 2);
@@ -424,7 +497,7 @@ TEST_F(ParserTest, SubRegImm) {
     auto program = parse("SUB AX, 10");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "SUB");
 }
@@ -433,7 +506,7 @@ TEST_F(ParserTest, AndRegReg) {
     auto program = parse("AND AX, BX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "AND");
 }
@@ -442,7 +515,7 @@ TEST_F(ParserTest, OrRegImm) {
     auto program = parse("OR AL, 0x0F");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "OR");
 }
@@ -451,7 +524,7 @@ TEST_F(ParserTest, ShlReg) {
     auto program = parse("SHL AX, 1");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "SHL");
 }
@@ -460,7 +533,7 @@ TEST_F(ParserTest, ShrRegCL) {
     auto program = parse("SHR BX, CL");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "SHR");
 }
@@ -477,12 +550,12 @@ TEST_F(ParserTest, IntInstruction) {
     auto program = parse("INT 0x21");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "INT");
     ASSERT_EQ(instr->operands.size(), 1);
 
-    auto* imm = dynamic_cast<ImmediateOperand*>(instr->operands[0].get());
+    auto* imm = ast_cast<ImmediateOperand>(instr->operands[0]);
     ASSERT_NE(imm, nullptr);
     EXPECT_EQ(imm->value, 0x21);
 }
@@ -491,7 +564,7 @@ TEST_F(ParserTest, LeaInstruction) {
     auto program = parse("LEA BX, [SI+10]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "LEA");
     EXPECT_EQ(instr->operands.size(), 2);
@@ -539,7 +612,7 @@ TEST_F(ParserTest, InInstruction) {
     auto program = parse("IN AL, DX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "IN");
 }
@@ -548,7 +621,7 @@ TEST_F(ParserTest, OutInstruction) {
     auto program = parse("OUT DX, AL");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "OUT");
 }
@@ -557,7 +630,7 @@ TEST_F(ParserTest, IncReg) {
     auto program = parse("INC AX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "INC");
     EXPECT_EQ(instr->operands.size(), 1);
@@ -567,7 +640,7 @@ TEST_F(ParserTest, DecMem) {
     auto program = parse("DEC WORD [BX]");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "DEC");
 }
@@ -576,7 +649,7 @@ TEST_F(ParserTest, NegReg) {
     auto program = parse("NEG AX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "NEG");
 }
@@ -585,7 +658,99 @@ TEST_F(ParserTest, NotReg) {
     auto program = parse("NOT BX");
     ASSERT_NE(program, nullptr);
 
-    auto* instr = dynamic_cast<Instruction*>(program->statements[0].get());
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
     ASSERT_NE(instr, nullptr);
     EXPECT_EQ(instr->mnemonic, "NOT");
 }
+
+TEST_F(ParserTest, NodesCarryKindTags) {
+    auto program = parse("start:\nMOV AX, [BX]\nTIMES 2 NOP");
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(program->statements.size(), 3);
+    EXPECT_EQ(program->statements[0]->kind, NodeKind::LABEL);
+    EXPECT_EQ(program->statements[1]->kind, NodeKind::INSTRUCTION);
+    EXPECT_EQ(program->statements[2]->kind, NodeKind::TIMES);
+    EXPECT_EQ(ast_cast<Label>(program->statements[1]), nullptr);
+
+    auto* instr = ast_cast<Instruction>(program->statements[1]);
+    ASSERT_NE(instr, nullptr);
+    EXPECT_EQ(instr->operands[0]->kind, NodeKind::REGISTER_OPERAND);
+    EXPECT_EQ(instr->operands[1]->kind, NodeKind::MEMORY_OPERAND);
+
+    auto* times = ast_cast<TIMESDirective>(program->statements[2]);
+    ASSERT_NE(times, nullptr);
+    EXPECT_NE(ast_cast<Instruction>(times->repeated_node), nullptr);
+    EXPECT_GT(program->arena.bytesUsed(), 0);
+}
+
+TEST_F(ParserTest, TooManyOperands) {
+    EXPECT_FALSE(parseSucceeds("MOV AX, BX, CX, DX"));
+}
+
+TEST_F(ParserTest, MemoryAddressIsStructured) {
+    auto program = parse("MOV AX, [BX+SI+2*3+table-COUNT*2]");
+    ASSERT_NE(program, nullptr);
+
+    auto* instr = ast_cast<Instruction>(program->statements[0]);
+    ASSERT_NE(instr, nullptr);
+    auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
+    ASSERT_NE(mem, nullptr);
+    ASSERT_TRUE(mem->parsed_address.has_value());
+
+    const auto& addr = *mem->parsed_address;
+    ASSERT_EQ(addr.register_count, 2);
+    EXPECT_EQ(addr.registers[0], 3);  // BX
+    EXPECT_EQ(addr.registers[1], 6);  // SI
+    EXPECT_EQ(addr.displacement, 6);
+    ASSERT_EQ(addr.symbols.size(), 2);
+    EXPECT_EQ(addr.symbols[0].name, "table");
+    EXPECT_EQ(addr.symbols[0].scale, 1);
+    EXPECT_EQ(addr.symbols[1].name, "COUNT");
+    EXPECT_EQ(addr.symbols[1].scale, -2);
+}
+
+TEST_F(ParserTest, InvalidMemoryAddress) {
+    EXPECT_FALSE(parseSucceeds("MOV AX, [AX]"));
+    EXPECT_FALSE(parseSucceeds("MOV AX, [-BX]"));
+    EXPECT_FALSE(parseSucceeds("MOV AX, [BX+SI+DI]"));
+}
+
+TEST_F(ParserTest, StreamingParseMatchesBatch) {
+    std::vector<std::string> lines = {"start:", "  MOV AX,", "    [BX+SI]", "  JMP start"};
+    size_t next_line = 0;
+    TokenStream stream([&]() -> std::optional<std::string_view> {
+        if (next_line == lines.size()) return std::nullopt;
+        return lines[next_line++];
+    });
+
+    Parser parser(stream);
+    auto program = parser.parse();
+    ASSERT_FALSE(parser.hasErrors());
+    ASSERT_EQ(program->statements.size(), 3);
+
+    auto* mov = ast_cast<Instruction>(program->statements[1]);
+    ASSERT_NE(mov, nullptr);
+    EXPECT_EQ(mov->mnemonic, "MOV");
+    ASSERT_EQ(mov->operands.size(), 2);
+    EXPECT_NE(ast_cast<MemoryOperand>(mov->operands[1]), nullptr);
+    EXPECT_EQ(program->statements[2]->location.line, 4);
+}
+
+TEST_F(ParserTest, LinkageDirectives) {
+    auto program = parse("GLOBAL start, print\nEXTERN putc");
+    ASSERT_NE(program, nullptr);
+    ASSERT_EQ(program->statements.size(), 2);
+
+    auto* global = ast_cast<LinkageDirective>(program->statements[0]);
+    ASSERT_NE(global, nullptr);
+    EXPECT_EQ(global->linkage, LinkageDirective::Kind::GLOBAL);
+    EXPECT_EQ(global->names, (std::vector<std::string>{"start", "print"}));
+
+    auto* external = ast_cast<LinkageDirective>(program->statements[1]);
+    ASSERT_NE(external, nullptr);
+    EXPECT_EQ(external->linkage, LinkageDirective::Kind::EXTERN);
+    EXPECT_EQ(external->names, (std::vector<std::string>{"putc"}));
+
+    EXPECT_FALSE(parseSucceeds("GLOBAL"));
+    EXPECT_FALSE(parseSucceeds("EXTERN .local"));
+}
@@ -301,7 +301,7 @@ TEST_F(SemanticAnalyzerTest, ShortJumpSize) {
 
 TEST_F(SemanticAnalyzerTest, NearJumpSize) {
     std::string source = R"(
-        start: JMP target
+        start: JMP NEAR target
         target: NOP
     )";
 
@@ -316,6 +316,62 @@ TEST_F(SemanticAnalyzerTest, NearJumpSize) {
     EXPECT_EQ(target->value - start->value, 3);
 }
 
+TEST_F(SemanticAnalyzerTest, UnannotatedForwardJumpRelaxesToShort) {
+    std::string source = R"(
+        start: JMP target
+        target: NOP
+    )";
+
+    auto analyzer = analyzeAndGet(source);
+
+    auto start = analyzer.getSymbolTable().lookup("start");
+    auto target = analyzer.getSymbolTable().lookup("target");
+
+    ASSERT_TRUE(start.has_value());
+    ASSERT_TRUE(target.has_value());
+
+    EXPECT_EQ(target->value - start->value, 2);
+}
+
+TEST_F(SemanticAnalyzerTest, OutOfRangeJumpGrowsToNear) {
+    std::string source = R"(
+        start: JMP target
+        TIMES 200 NOP
+        target: NOP
+    )";
+
+    auto analyzer = analyzeAndGet(source);
+
+    auto target = analyzer.getSymbolTable().lookup("target");
+    ASSERT_TRUE(target.has_value());
+
+    EXPECT_EQ(target->value, 203);
+    EXPECT_TRUE(analyzer.getErrors().empty());
+}
+
+TEST_F(SemanticAnalyzerTest, RelaxationPassCount) {
+    // Growing the inner jump pushes the outer one out of range
+    std::string source = R"(
+        JMP near_target
+        JMP far_target
+        TIMES 125 NOP
+        near_target: NOP
+        TIMES 3 NOP
+        far_target: NOP
+    )";
+
+    auto analyzer = analyzeAndGet(source);
+
+    auto near_target = analyzer.getSymbolTable().lookup("near_target");
+    auto far_target = analyzer.getSymbolTable().lookup("far_target");
+    ASSERT_TRUE(near_target.has_value());
+    ASSERT_TRUE(far_target.has_value());
+
+    EXPECT_EQ(near_target->value, 131);
+    EXPECT_EQ(far_target->value, 135);
+    EXPECT_GE(analyzer.getPassCount(), 3u);
+}
+
 TEST_F(SemanticAnalyzerTest, ConditionalJumpSize) {
     std::string source = R"(
         start: JE target
@@ -441,6 +497,63 @@ TEST_F(SemanticAnalyzerTest, GetAddressByStatementIndex) {
     EXPECT_EQ(*addr2, 2);
 }
 
+TEST_F(SemanticAnalyzerTest, BindsAddressTermsToSymbolIds) {
+    auto program = parse("start: NOP\n.loop: MOV AX, [BX+.loop]\nMOV BX, [SI+data]\ndata: DW 0");
+    SemanticAnalyzer analyzer;
+    ASSERT_TRUE(analyzer.analyze(program.get()));
+    const auto& table = analyzer.getSymbolTable();
+
+    auto term = [&](size_t statement) {
+        auto* instr = ast_cast<Instruction>(program->statements[statement]);
+        auto* mem = ast_cast<MemoryOperand>(instr->operands[1]);
+        return mem->parsed_address->symbols[0];
+    };
+    ASSERT_TRUE(term(3).id.has_value());
+    EXPECT_EQ(table.qualifiedName(*term(3).id), "start.loop");
+    ASSERT_TRUE(term(4).id.has_value());
+    EXPECT_EQ(table.qualifiedName(*term(4).id), "data");
+
+    // Analyzing the tree again binds it afresh
+    ASSERT_TRUE(analyzer.analyze(program.get()));
+    EXPECT_EQ(table.get(*term(4).id).value, 7);
+}
+
+TEST_F(SemanticAnalyzerTest, BindsOperandLabelsToSymbolIds) {
+    auto program = parse("start: JMP .next\n.next: MOV AX, start\nMOV BX, start+2");
+    SemanticAnalyzer analyzer;
+    ASSERT_TRUE(analyzer.analyze(program.get()));
+    const auto& table = analyzer.getSymbolTable();
+
+    auto* jump = ast_cast<LabelRef>(ast_cast<Instruction>(program->statements[1])->operands[0]);
+    ASSERT_TRUE(jump->label_id.has_value());
+    EXPECT_EQ(table.qualifiedName(*jump->label_id), "start.next");
+
+    auto* imm = ast_cast<ImmediateOperand>(ast_cast<Instruction>(program->statements[3])->operands[1]);
+    ASSERT_TRUE(imm->label_id.has_value());
+    EXPECT_EQ(table.qualifiedName(*imm->label_id), "start");
+
+    auto* expr = ast_cast<ImmediateOperand>(ast_cast<Instruction>(program->statements[4])->operands[1]);
+    EXPECT_FALSE(expr->label_id.has_value());
+}
+
+TEST_F(SemanticAnalyzerTest, BindsExpressionSlotsToSymbolIds) {
+    auto program = parse("N EQU 2\nstart: MOV AX, N*3+1\nTIMES N+start NOP");
+    SemanticAnalyzer analyzer;
+    ASSERT_TRUE(analyzer.analyze(program.get()));
+    const auto& table = analyzer.getSymbolTable();
+
+    auto* imm = ast_cast<ImmediateOperand>(ast_cast<Instruction>(program->statements[2])->operands[1]);
+    ASSERT_EQ(imm->expression.symbols().size(), 1);
+    ASSERT_TRUE(imm->expression.binding(0).has_value());
+    EXPECT_EQ(table.get(*imm->expression.binding(0)).name, "N");
+
+    auto* times = ast_cast<TIMESDirective>(program->statements[3]);
+    ASSERT_EQ(times->count_program.symbols().size(), 2);
+    ASSERT_TRUE(times->count_program.binding(1).has_value());
+    EXPECT_EQ(table.get(*times->count_program.binding(1)).name, "start");
+    EXPECT_EQ(times->count, 2);
+}
+
 class SymbolTableTest : public ::testing::Test {
 protected:
     SymbolTable table;
@@ -519,6 +632,32 @@ TEST_F(SymbolTableTest, FullyQualifiedNameNoScope) {
     EXPECT_EQ(table.getFullyQualifiedName("global"), "global");
 }
 
+TEST_F(SymbolTableTest, LocalLabelsKeyedByScope) {
+    table.setGlobalScope("main");
+    EXPECT_TRUE(table.define(".loop", SymbolType::LABEL, 10, 1));
+    table.setGlobalScope("other");
+    EXPECT_TRUE(table.define(".loop", SymbolType::LABEL, 20, 2));
+
+    const Symbol* other = table.find(".LOOP");
+    ASSERT_NE(other, nullptr);
+    EXPECT_EQ(other->value, 20);
+
+    const Symbol* main_loop = table.findDirect("main.loop");
+    ASSERT_NE(main_loop, nullptr);
+    EXPECT_EQ(main_loop->value, 10);
+
+    auto id = table.findId(".loop");
+    ASSERT_TRUE(id.has_value());
+    EXPECT_EQ(&table.get(*id), other);
+    EXPECT_EQ(table.qualifiedName(*id), "other.loop");
+}
+
+TEST_F(SymbolTableTest, FindUnknownNameReturnsNull) {
+    table.define("known", SymbolType::LABEL, 1, 1);
+    EXPECT_EQ(table.find("unknown"), nullptr);
+    EXPECT_EQ(table.findDirect("known.local"), nullptr);
+}
+
 TEST_F(SymbolTableTest, ClearTable) {
     table.define("test1", SymbolType::LABEL, 100, 1);
     table.define("test2", SymbolType::LABEL, 200, 2);